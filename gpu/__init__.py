@@ -1,4 +1,5 @@
 __all__ = [
+    "command_processor",
     "input_assembly",
     "vertex_transform",
     "vertex_shading",
@@ -0,0 +1,217 @@
+import amaranth_soc.wishbone.bus as wb
+from amaranth import *
+from amaranth.lib import wiring
+from amaranth.lib.wiring import In, Out
+from amaranth.utils import exact_log2
+
+from ..utils.layouts import wb_bus_addr_width, wb_bus_data_width
+from ..utils.types import address_shape
+from .layouts import CommandHeader, CommandOpcode
+
+__all__ = ["CommandProcessor"]
+
+
+class CommandProcessor(wiring.Component):
+    """Consumes command packets from a ring buffer in memory.
+
+    The host appends packets to the ring at ``c_base`` (``c_size`` bytes) and publishes
+    them by advancing ``c_wptr``. Packets are fetched word by word until ``rptr`` catches
+    up with ``c_wptr``. Register writes are replayed on ``csr_bus`` exactly as if they
+    were issued by the host, so any register (including ``idx.start``) can be programmed.
+
+    Packets (32-bit words, first word is a CommandHeader):
+      NOP        : header, ``arg`` payload words that are skipped
+      WRITE_REGS : header, CSR byte offset, ``arg`` data words for consecutive registers
+      WAIT_READY : header only, waits until all stages in ``arg`` mask are ready
+      CALL       : header (``arg`` = 2), list address, list size in bytes
+
+    CALL executes the packets of a linear command list (a recorded display list) before
+    continuing with the ring. ``rptr`` only moves past the CALL packet once the whole
+    list has been fetched, so the host can tell when the list memory may be rewritten.
+    Lists cannot nest: a CALL inside a list is skipped like a NOP.
+
+    Packets may wrap around the end of the ring (lists are linear). While ``enable`` is
+    low the read pointer is held at zero and a running list is abandoned, so the host can
+    (re)program the ring; it must only be cleared while the processor is ready.
+    """
+
+    def __init__(self, csr_addr_width: int = 10, settle_cycles: int = 4):
+        self._settle_cycles = settle_cycles
+        super().__init__(
+            {
+                "bus": Out(
+                    wb.Signature(
+                        addr_width=wb_bus_addr_width, data_width=wb_bus_data_width
+                    )
+                ),
+                "csr_bus": Out(
+                    wb.Signature(
+                        addr_width=csr_addr_width, data_width=32, granularity=32
+                    )
+                ),
+                "c_base": In(address_shape),
+                "c_size": In(unsigned(32)),
+                "c_wptr": In(unsigned(32)),
+                "enable": In(1),
+                # [input assembly, vertex transform, rasterizer, pixel pipeline]
+                "ready_components": In(4),
+                "rptr": Out(unsigned(32)),
+                "ready": Out(1),
+            }
+        )
+
+    def elaborate(self, platform) -> Module:
+        m = Module()
+
+        word_bytes = self.bus.data_width // 8
+        word_shift = exact_log2(word_bytes)
+
+        header = Signal(CommandHeader)
+        remaining = Signal.like(header.arg)
+        csr_offset = Signal(32)
+        csr_data = Signal(32)
+        settle = Signal(range(self._settle_cycles))
+
+        rptr_next = Signal.like(self.rptr)
+        m.d.comb += rptr_next.eq(
+            Mux(self.rptr + word_bytes >= self.c_size, 0, self.rptr + word_bytes)
+        )
+
+        # executing a CALLed list: fetch from call_ptr until it reaches call_end
+        in_call = Signal()
+        call_ptr = Signal(address_shape)
+        call_end = Signal(address_shape)
+
+        fetch_addr = Signal(address_shape)
+        m.d.comb += fetch_addr.eq(Mux(in_call, call_ptr, self.c_base + self.rptr))
+
+        def advance():
+            with m.If(in_call):
+                m.d.sync += call_ptr.eq(call_ptr + word_bytes)
+            with m.Else():
+                m.d.sync += self.rptr.eq(rptr_next)
+
+        def read_word():
+            m.d.comb += [
+                self.bus.cyc.eq(1),
+                self.bus.stb.eq(1),
+                self.bus.we.eq(0),
+                self.bus.sel.eq(~0),
+                self.bus.adr.eq(fetch_addr[word_shift:]),
+            ]
+            return self.bus.ack
+
+        wait_mask = header.arg[: len(self.ready_components)]
+
+        with m.FSM():
+            with m.State("IDLE"):
+                m.d.comb += self.ready.eq(
+                    ~self.enable | ((self.rptr == self.c_wptr) & ~in_call)
+                )
+                with m.If(in_call):
+                    # a size that is not a multiple of the word ends after the partial word
+                    with m.If(call_ptr >= call_end):
+                        # list done, step over the last word of the CALL packet
+                        m.d.sync += [
+                            in_call.eq(0),
+                            self.rptr.eq(rptr_next),
+                        ]
+                    with m.Else():
+                        m.next = "READ_HEADER"
+                with m.Elif(self.enable & (self.rptr != self.c_wptr)):
+                    m.next = "READ_HEADER"
+
+            with m.State("READ_HEADER"):
+                with m.If(read_word()):
+                    m.d.sync += header.eq(self.bus.dat_r)
+                    advance()
+                    m.next = "DECODE"
+
+            with m.State("DECODE"):
+                m.d.sync += [
+                    remaining.eq(header.arg),
+                    settle.eq(0),
+                ]
+                with m.Switch(header.opcode):
+                    with m.Case(CommandOpcode.WRITE_REGS):
+                        m.next = "READ_OFFSET"
+                    with m.Case(CommandOpcode.WAIT_READY):
+                        m.next = "WAIT_SETTLE"
+                    with m.Case(CommandOpcode.CALL):
+                        with m.If(in_call | (header.arg != 2)):
+                            m.next = "SKIP"
+                        with m.Else():
+                            m.next = "READ_CALL_ADDR"
+                    with m.Default():
+                        # NOP and unknown opcodes skip their payload
+                        m.next = "SKIP"
+
+            with m.State("SKIP"):
+                with m.If(remaining == 0):
+                    m.next = "IDLE"
+                with m.Else():
+                    m.d.sync += remaining.eq(remaining - 1)
+                    advance()
+
+            with m.State("READ_CALL_ADDR"):
+                with m.If(read_word()):
+                    m.d.sync += call_ptr.eq(self.bus.dat_r)
+                    advance()
+                    m.next = "READ_CALL_SIZE"
+
+            with m.State("READ_CALL_SIZE"):
+                # rptr stays on this word until the list is done
+                with m.If(read_word()):
+                    m.d.sync += [
+                        call_end.eq(call_ptr + self.bus.dat_r),
+                        in_call.eq(1),
+                    ]
+                    m.next = "IDLE"
+
+            with m.State("READ_OFFSET"):
+                with m.If(read_word()):
+                    m.d.sync += csr_offset.eq(self.bus.dat_r)
+                    advance()
+                    m.next = "READ_DATA"
+
+            with m.State("READ_DATA"):
+                with m.If(remaining == 0):
+                    m.next = "IDLE"
+                with m.Elif(read_word()):
+                    m.d.sync += csr_data.eq(self.bus.dat_r)
+                    advance()
+                    m.next = "WRITE_CSR"
+
+            with m.State("WRITE_CSR"):
+                m.d.comb += [
+                    self.csr_bus.cyc.eq(1),
+                    self.csr_bus.stb.eq(1),
+                    self.csr_bus.we.eq(1),
+                    self.csr_bus.sel.eq(~0),
+                    self.csr_bus.adr.eq(csr_offset[2:]),
+                    self.csr_bus.dat_w.eq(csr_data),
+                ]
+                with m.If(self.csr_bus.ack):
+                    m.d.sync += [
+                        csr_offset.eq(csr_offset + 4),
+                        remaining.eq(remaining - 1),
+                    ]
+                    m.next = "READ_DATA"
+
+            with m.State("WAIT_SETTLE"):
+                # ready signals lag behind a freshly issued start by a few cycles
+                m.d.sync += settle.eq(settle + 1)
+                with m.If(settle == self._settle_cycles - 1):
+                    m.next = "WAIT_READY"
+
+            with m.State("WAIT_READY"):
+                with m.If((self.ready_components & wait_mask) == wait_mask):
+                    m.next = "IDLE"
+
+        with m.If(~self.enable):
+            m.d.sync += [
+                self.rptr.eq(0),
+                in_call.eq(0),
+            ]
+
+        return m
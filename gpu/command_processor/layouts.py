@@ -0,0 +1,16 @@
+from amaranth.lib import data, enum
+
+__all__ = ["CommandOpcode", "CommandHeader"]
+
+
+class CommandOpcode(enum.Enum, shape=8):
+    NOP = 0  # skip `arg` payload words
+    WRITE_REGS = 1  # CSR byte offset word followed by `arg` data words
+    WAIT_READY = 2  # wait until all stages in `arg` mask are ready
+    CALL = 3  # list address and list size (bytes) words, `arg` must be 2
+
+
+class CommandHeader(data.Struct):
+    opcode: CommandOpcode
+    _pad: 8
+    arg: 16
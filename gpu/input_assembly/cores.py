@@ -12,6 +12,7 @@ from ..utils.layouts import (
     wb_bus_addr_width,
     wb_bus_data_width,
 )
+from ..utils.mem import StreamPrefetcher
 from ..utils.stream import WideStreamOutput
 from ..utils.types import (
     FixedPoint_mem,
@@ -20,7 +21,14 @@ from ..utils.types import (
     address_shape,
     index_shape,
 )
-from .layouts import InputData, InputMode
+from .layouts import (
+    AttrFormat,
+    ComponentType,
+    DrawRange,
+    IndirectDrawRecord,
+    InputData,
+    InputMode,
+)
 
 __all__ = [
     "IndexGenerator",
@@ -34,26 +42,48 @@ class IndexGenerator(wiring.Component):
 
     Gets index stream description and outputs index stream.
 
-    TODO: add memory burst support
+    With ``c_draw_count`` set to zero a single draw of ``c_count`` indices at ``c_address``
+    is generated. Otherwise ``c_address`` points to an array of ``c_draw_count``
+    IndirectDrawRecord entries that are walked in order after a single ``start``. Each
+    non-empty draw is announced on ``draws`` before its indices are streamed, so the
+    topology processor can restart primitives and apply the draw's base vertex.
+
+    Draw records and index buffers are read through a StreamPrefetcher of
+    ``prefetch_depth`` words, in bursts; U8/U16 indices sharing a word are read once.
     """
 
     o: Out(stream.Signature(index_shape))
-    bus: Out(wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width))
+    draws: Out(stream.Signature(DrawRange))
+    bus: Out(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+    )
     ready: Out(1)
 
     c_address: In(address_shape)
     c_count: In(unsigned(32))
     c_kind: In(IndexKind)
+    c_draw_count: In(unsigned(32))
     start: In(1)
 
     start_stb: Out(1)  # signal to indicate start command has been accepted
 
+    def __init__(self, prefetch_depth: int = 16):
+        super().__init__()
+        self._prefetch_depth = prefetch_depth
+
     def elaborate(self, platform) -> Module:
         m = Module()
 
+        m.submodules.prefetch = prefetch = StreamPrefetcher(self._prefetch_depth)
+        wiring.connect(m, prefetch.bus, wiring.flipped(self.bus))
+
         address = Signal.like(self.c_address)
         kind = self.c_kind
-        count = self.c_count
+        count = Signal.like(self.c_count)
 
         index_increment = Signal(3)
         index_shift = Signal(2)
@@ -94,9 +124,48 @@ class IndexGenerator(wiring.Component):
 
         cur_idx = Signal.like(count)
 
+        # multi-draw state
+        record = Signal(IndirectDrawRecord)
+        record_words = Shape.cast(IndirectDrawRecord).width // self.bus.data_width
+        record_word = Signal(range(record_words))
+        record_address = Signal.like(self.c_address)
+        draws_left = Signal.like(self.c_draw_count)
+
+        m.d.comb += [
+            self.draws.payload.count.eq(record.count),
+            self.draws.payload.base_vertex.eq(record.base_vertex),
+        ]
+
         with m.If(self.o.ready):
             m.d.sync += self.o.valid.eq(0)
 
+        def prefetch_words(first_address, byte_count):
+            """Starts prefetching the words holding ``byte_count`` bytes from there."""
+            offset_bits = len(offset)
+            end = first_address[:offset_bits] + byte_count + (1 << offset_bits) - 1
+            m.d.comb += [
+                prefetch.start.eq(1),
+                prefetch.address.eq(first_address[offset_bits:]),
+                prefetch.count.eq(end[offset_bits:]),
+            ]
+
+        def start_draw(first_address, index_count):
+            with m.If(kind == IndexKind.NOT_INDEXED):
+                m.next = "STREAM_NON_INDEXED"
+            with m.Else():
+                prefetch_words(first_address, index_count << index_shift)
+                m.next = "MEM_READ"
+
+        def read_record():
+            prefetch_words(record_address, record_words * (self.bus.data_width // 8))
+            m.next = "RECORD_READ"
+
+        def end_draw():
+            with m.If(draws_left != 0):
+                read_record()
+            with m.Else():
+                m.next = "WAIT_FLUSH"
+
         with m.FSM():
             with m.State("IDLE"):
                 m.d.comb += self.ready.eq(1)
@@ -105,13 +174,50 @@ class IndexGenerator(wiring.Component):
                     m.d.sync += [
                         cur_idx.eq(0),
                         address.eq(self.c_address),
+                        count.eq(self.c_count),
+                        record_address.eq(self.c_address),
+                        record_word.eq(0),
+                        draws_left.eq(self.c_draw_count),
                     ]
-                    with m.If(count == 0):
+                    with m.If(self.c_draw_count != 0):
+                        prefetch_words(
+                            self.c_address, record_words * (self.bus.data_width // 8)
+                        )
+                        m.next = "RECORD_READ"
+                    with m.Elif(self.c_count == 0):
                         m.next = "IDLE"
-                    with m.Elif(kind == IndexKind.NOT_INDEXED):
-                        m.next = "STREAM_NON_INDEXED"
                     with m.Else():
-                        m.next = "MEM_READ"
+                        start_draw(self.c_address, self.c_count)
+
+            with m.State("RECORD_READ"):
+                m.d.comb += prefetch.o.ready.eq(1)
+                with m.If(prefetch.o.valid):
+                    m.d.sync += [
+                        record.as_value()
+                        .word_select(record_word, self.bus.data_width)
+                        .eq(prefetch.o.payload),
+                        record_address.eq(record_address + self.bus.data_width // 8),
+                        record_word.eq(record_word + 1),
+                    ]
+                    with m.If(record_word == record_words - 1):
+                        m.d.sync += [
+                            record_word.eq(0),
+                            draws_left.eq(draws_left - 1),
+                        ]
+                        m.next = "RECORD_START"
+
+            with m.State("RECORD_START"):
+                with m.If(record.count == 0):
+                    end_draw()  # empty draws are skipped
+                with m.Else():
+                    m.d.comb += self.draws.valid.eq(1)
+                    with m.If(self.draws.ready):
+                        m.d.sync += [
+                            cur_idx.eq(0),
+                            address.eq(record.address),
+                            count.eq(record.count),
+                        ]
+                        start_draw(record.address, record.count)
 
             with m.State("STREAM_NON_INDEXED"):
                 with m.If(~self.o.valid | self.o.ready):
@@ -121,19 +227,13 @@ class IndexGenerator(wiring.Component):
                         cur_idx.eq(cur_idx + 1),
                     ]
                     with m.If(cur_idx + 1 == count):  # last index streamed
-                        m.next = "WAIT_FLUSH"
+                        end_draw()
 
             with m.State("MEM_READ"):
-                # initiate memory read
-                m.d.comb += [
-                    self.bus.cyc.eq(1),
-                    self.bus.adr.eq(address[len(offset) :]),
-                    self.bus.we.eq(0),
-                    self.bus.stb.eq(1),
-                    self.bus.sel.eq(~0),
-                ]
-                with m.If(self.bus.ack):
-                    m.d.sync += data_read.eq(self.bus.dat_r)
+                # next word of the index buffer
+                m.d.comb += prefetch.o.ready.eq(1)
+                with m.If(prefetch.o.valid):
+                    m.d.sync += data_read.eq(prefetch.o.payload)
                     m.next = "INDEX_SEND"
 
             with m.State("INDEX_SEND"):
@@ -146,7 +246,7 @@ class IndexGenerator(wiring.Component):
                         cur_idx.eq(cur_idx + 1),
                     ]
                     with m.If(cur_idx + 1 == count):
-                        m.next = "WAIT_FLUSH"
+                        end_draw()
                     with m.Elif(next_addr[: len(offset)] != 0):
                         m.next = "INDEX_SEND"
                     with m.Else():
@@ -162,9 +262,14 @@ class InputTopologyProcessor(wiring.Component):
     """Processes input topology description.
 
     Gets input index stream and outputs vertex index stream based on input topology.
+
+    With ``c_multi_draw`` set, indices are only accepted within a draw announced on
+    ``draws``. Every draw restarts the primitive assembly and uses its own base vertex
+    instead of ``c_base_vertex``.
     """
 
     i: In(stream.Signature(index_shape))
+    draws: In(stream.Signature(DrawRange))
     o: Out(stream.Signature(index_shape))
     ready: Out(1)
 
@@ -174,6 +279,7 @@ class InputTopologyProcessor(wiring.Component):
     c_primitive_restart_enable: In(unsigned(1))
     c_primitive_restart_index: In(unsigned(32))
     c_base_vertex: In(unsigned(32))
+    c_multi_draw: In(1)
 
     def __init__(self):
         super().__init__()
@@ -190,27 +296,50 @@ class InputTopologyProcessor(wiring.Component):
         m.submodules.w_out = w_out = WideStreamOutput(index_shape, 3)
         wiring.connect(m, w_out.o, wiring.flipped(self.o))
 
+        # current draw of a multi-draw batch
+        draw_remaining = Signal.like(self.draws.payload.count)
+        draw_base_vertex = Signal.like(self.draws.payload.base_vertex)
+
+        i_valid = Signal()
+        m.d.comb += i_valid.eq(
+            self.i.valid & (~self.c_multi_draw | (draw_remaining != 0))
+        )
+
         reset_sig = Signal()
         m.d.comb += reset_sig.eq(
-            self.i.valid
+            i_valid
             & self.c_primitive_restart_enable
             & (self.i.payload == self.c_primitive_restart_index)
         )
 
+        base_vertex = Mux(self.c_multi_draw, draw_base_vertex, self.c_base_vertex)
         idx = Signal.like(self.i.payload)
-        m.d.comb += idx.eq(self.i.payload + self.c_base_vertex)
+        m.d.comb += idx.eq(self.i.payload + base_vertex)
 
         m.d.comb += self.ready.eq(~w_out.i.valid & ~w_out.o.valid)
 
+        m.d.comb += self.draws.ready.eq(self.c_multi_draw & (draw_remaining == 0))
+        with m.If(self.i.valid & self.i.ready & self.c_multi_draw):
+            m.d.sync += draw_remaining.eq(draw_remaining - 1)
+        with m.If(self.draws.valid & self.draws.ready):
+            m.d.sync += [
+                draw_remaining.eq(self.draws.payload.count),
+                draw_base_vertex.eq(self.draws.payload.base_vertex),
+                vertex_count.eq(0),
+            ]
+
         with m.If(self.start):
-            m.d.sync += vertex_count.eq(0)
+            m.d.sync += [
+                vertex_count.eq(0),
+                draw_remaining.eq(0),
+            ]
             m.d.sync += Print("InputTopologyProcessor started ", self.c_input_topology)
 
         with m.If(reset_sig):
             m.d.sync += vertex_count.eq(0)
             m.d.comb += self.i.ready.eq(1)
 
-        with m.If(self.i.valid & ~reset_sig):
+        with m.If(i_valid & ~reset_sig):
             with m.Switch(self.c_input_topology):
                 with m.Case(InputTopology.POINT_LIST):
                     m.d.comb += [
@@ -375,20 +504,38 @@ class InputAssembly(wiring.Component):
     Takes configuration for vertex attributes including position, normal, texcoords, and color.
     Each attribute can be constant or per-vertex.
 
-    TODO: support other formats than Fixed 16.16
-    TODO: add memory burst support
+    Per-vertex attributes are stored as Fixed 16.16 or as 8/16-bit (normalized) integers,
+    see AttrFormat. Packed components sharing a memory word are read only once.
+
+    Every attribute is read through its own StreamPrefetcher of ``prefetch_depth``
+    words. An attribute whose stride equals its size is streamed with bursts, skipping
+    the words of vertices not fetched (up to the prefetch depth), so ascending indices
+    only wait for memory at the start of the stream. Other attributes prefetch the
+    words of the attribute being fetched. ``flush`` drops the prefetched data, it is
+    strobed between draws.
     """
 
     i: In(stream.Signature(index_shape))
     o: Out(stream.Signature(VertexLayout))
-    bus: Out(wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width))
+    bus: Out(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+    )
     ready: Out(1)
+    flush: In(1)
 
     c_pos: In(InputAssemblyAttrConfigLayout)
     c_norm: In(InputAssemblyAttrConfigLayout)
     c_tex: In(InputAssemblyAttrConfigLayout).array(num_textures)
     c_col: In(InputAssemblyAttrConfigLayout)
 
+    def __init__(self, prefetch_depth: int = 16):
+        super().__init__()
+        self._prefetch_depth = prefetch_depth
+
     def elaborate(self, platform) -> Module:
         m = Module()
 
@@ -406,6 +553,7 @@ class InputAssembly(wiring.Component):
 
         @dataclass
         class AttrInfo:
+            name: str
             config: InputAssemblyAttrConfigLayout
             data_v: Signal
 
@@ -414,15 +562,91 @@ class InputAssembly(wiring.Component):
                 return len(self.data_v)
 
         attr_info = [
-            AttrInfo(config=self.c_pos, data_v=vtx.position),
-            AttrInfo(config=self.c_norm, data_v=vtx.normal),
+            AttrInfo(name="position", config=self.c_pos, data_v=vtx.position),
+            AttrInfo(name="normal", config=self.c_norm, data_v=vtx.normal),
             *[
-                AttrInfo(config=self.c_tex[i], data_v=vtx.texcoords[i])
+                AttrInfo(
+                    name=f"texcoord{i}", config=self.c_tex[i], data_v=vtx.texcoords[i]
+                )
                 for i in range(num_textures)
             ],
-            AttrInfo(config=self.c_col, data_v=vtx.color),
+            AttrInfo(name="color", config=self.c_col, data_v=vtx.color),
         ]
 
+        m.submodules.bus_arbiter = bus_arbiter = wb.Arbiter(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+        wiring.connect(m, bus_arbiter.bus, wiring.flipped(self.bus))
+
+        prefetchers = []
+        for attr in attr_info:
+            prefetch = StreamPrefetcher(self._prefetch_depth)
+            m.submodules[f"{attr.name}_prefetch"] = prefetch
+            bus_arbiter.add(prefetch.bus)
+            m.d.comb += prefetch.start.eq(self.flush)  # restart with nothing to read
+            prefetchers.append(prefetch)
+
+        # the attribute being fetched is streamed, word address of its last word
+        streaming = Signal()
+        last_word = Signal(wb_bus_addr_width)
+        fetched = Signal(wb_bus_data_width)
+
+        # format of the attribute being fetched
+        fmt = Signal(AttrFormat)
+        fmt_size = Signal(range(5))
+
+        # last word read from memory (packed components share words)
+        word = Signal(wb_bus_data_width)
+        word_addr = Signal(wb_bus_addr_width)
+        word_valid = Signal()
+
+        mem_word = Signal(wb_bus_data_width)
+        m.d.comb += mem_word.eq(Mux(word_valid & (word_addr == addr[2:]), word, fetched))
+
+        # convert component at `addr` of `mem_word` to raw Fixed 16.16
+        unpacked = Signal(32)
+        byte = mem_word.word_select(addr[0:2], 8)
+        half = mem_word.word_select(addr[1], 16)
+        s_byte = Mux(byte.as_signed() < -127, -127, byte.as_signed())
+        s_half = Mux(half.as_signed() < -32767, -32767, half.as_signed())
+        with m.Switch(fmt.type):
+            with m.Case(ComponentType.S8):
+                with m.If(fmt.normalized):
+                    # x / 127 ~= (x * 33026) >> 22 with 16 fraction bits
+                    m.d.comb += unpacked.eq((s_byte * 33026) >> 6)
+                with m.Else():
+                    m.d.comb += unpacked.eq(byte.as_signed() << 16)
+            with m.Case(ComponentType.U8):
+                with m.If(fmt.normalized):
+                    # x / 255 ~= x * 257 + (x >> 7) with 16 fraction bits
+                    m.d.comb += unpacked.eq(Cat(byte, byte) + byte[7])
+                with m.Else():
+                    m.d.comb += unpacked.eq(byte << 16)
+            with m.Case(ComponentType.S16):
+                with m.If(fmt.normalized):
+                    m.d.comb += unpacked.eq((s_half * 131076) >> 16)
+                with m.Else():
+                    m.d.comb += unpacked.eq(half.as_signed() << 16)
+            with m.Case(ComponentType.U16):
+                with m.If(fmt.normalized):
+                    m.d.comb += unpacked.eq(half + half[15])
+                with m.Else():
+                    m.d.comb += unpacked.eq(half << 16)
+            with m.Default():
+                m.d.comb += unpacked.eq(mem_word)
+
+        def type_bytes(type):
+            return Mux(
+                (type == ComponentType.S8) | (type == ComponentType.U8),
+                1,
+                Mux((type == ComponentType.S16) | (type == ComponentType.U16), 2, 4),
+            )
+
+        component_bytes = Signal(range(5))
+        m.d.comb += component_bytes.eq(type_bytes(fmt.type))
+
         with m.FSM():
             with m.State("IDLE"):
                 m.d.comb += [
@@ -431,11 +655,20 @@ class InputAssembly(wiring.Component):
                 ]
 
                 with m.If(self.i.valid):
-                    m.d.sync += idx.eq(self.i.payload)
+                    m.d.sync += [
+                        idx.eq(self.i.payload),
+                        # later words of streamed attributes are kept by the prefetchers
+                        word_valid.eq(0),
+                    ]
                     m.next = "FETCH_ATTR_0_START"
 
-            for attr_no, attr in enumerate(attr_info):
+            for attr_no, (attr, prefetch) in enumerate(zip(attr_info, prefetchers)):
                 base_name = f"FETCH_ATTR_{attr_no}"
+                next_attr = (
+                    f"FETCH_ATTR_{attr_no + 1}_START"
+                    if attr_no + 1 < len(attr_info)
+                    else "DONE"  # all attributes fetched
+                )
                 with m.State(f"{base_name}_START"):
                     config = attr.config
                     with m.Switch(config.mode):
@@ -445,45 +678,82 @@ class InputAssembly(wiring.Component):
                                 attr.data_v[i].eq(config.info.constant_value[i])
                                 for i in range(attr.components)
                             ]
-                            if attr_no + 1 < len(attr_info):
-                                m.next = f"FETCH_ATTR_{attr_no + 1}_START"
-                            else:
-                                # all attributes fetched
-                                m.next = "DONE"
+                            m.next = next_attr
                         with m.Case(InputMode.PER_VERTEX):
                             # per-vertex attribute
                             base_addr = config.info.per_vertex.address
                             stride = config.info.per_vertex.stride
-                            m.d.sync += addr.eq(base_addr + idx * stride)
+                            vfmt = config.info.per_vertex.format
+                            vsize = Mux(
+                                (vfmt.size == 0) | (vfmt.size > attr.components),
+                                attr.components,
+                                vfmt.size,
+                            )
+                            vertex_addr = base_addr + idx * stride
+                            attr_bytes = vsize * type_bytes(vfmt.type)
+                            m.d.sync += [
+                                addr.eq(vertex_addr),
+                                fmt.eq(vfmt),
+                                fmt_size.eq(vsize),
+                                streaming.eq(stride == attr_bytes),
+                                last_word.eq((vertex_addr + attr_bytes - 1)[2:]),
+                            ]
+                            # components missing in memory default to (0, 0, 0, 1)
+                            m.d.sync += [
+                                attr.data_v[i].eq(
+                                    FixedPoint_mem(C(1 << 16 if i == 3 else 0, 32))
+                                )
+                                for i in range(attr.components)
+                            ]
                             m.next = f"{base_name}_MEM_READ_COMPONENT_0"
 
+                # position of the word at `addr` in the prefetched stream
+                ahead = Signal(wb_bus_addr_width, name=f"{attr.name}_ahead")
+                in_stream = Signal(name=f"{attr.name}_in_stream")
+                m.d.comb += [
+                    ahead.eq(addr[2:] - prefetch.head),
+                    in_stream.eq(
+                        (ahead < prefetch.left) & (ahead < self._prefetch_depth)
+                    ),
+                ]
+
                 for i in range(attr.components):
                     with m.State(f"{base_name}_MEM_READ_COMPONENT_{i}"):
-                        # initiate memory read
-                        m.d.comb += [
-                            self.bus.cyc.eq(1),
-                            self.bus.stb.eq(1),
-                            self.bus.adr.eq(addr[2:]),
-                            self.bus.we.eq(0),
-                            self.bus.sel.eq(~0),
-                        ]
-                        with m.If(self.bus.ack):
+                        hit = word_valid & (word_addr == addr[2:])
+                        got = in_stream & (ahead == 0) & prefetch.o.valid
+                        m.d.comb += fetched.eq(prefetch.o.payload)
+                        with m.If(~hit & ~in_stream):
+                            m.d.comb += [
+                                prefetch.start.eq(1),
+                                prefetch.address.eq(addr[2:]),
+                                prefetch.count.eq(
+                                    Mux(streaming, 0xFFFFFFFF, last_word - addr[2:] + 1)
+                                ),
+                            ]
+                        with m.Elif(~hit & (ahead != 0)):
+                            # words in front of it are not needed any more, the word
+                            # at the head is kept for vertices sharing it
+                            m.d.comb += prefetch.o.ready.eq(1)
+                        with m.If(~hit & got):
+                            m.d.sync += [
+                                word.eq(prefetch.o.payload),
+                                word_addr.eq(addr[2:]),
+                                word_valid.eq(1),
+                            ]
+                        with m.If(hit | got):
                             # parse and store
-                            m.d.sync += attr.data_v[i].eq(
-                                FixedPoint_mem(self.bus.dat_r)
-                            )
+                            m.d.sync += attr.data_v[i].eq(FixedPoint_mem(unpacked))
 
                             if i + 1 < attr.components:
                                 # next component
-
-                                # 4 bytes per component (Fixed point 16.16)
-                                m.d.sync += addr.eq(addr + 4)
-                                m.next = f"{base_name}_MEM_READ_COMPONENT_{i + 1}"
-                            elif attr_no + 1 < len(attr_info):
-                                m.next = f"FETCH_ATTR_{attr_no + 1}_START"
+                                m.d.sync += addr.eq(addr + component_bytes)
+                                with m.If(i + 1 < fmt_size):
+                                    m.next = f"{base_name}_MEM_READ_COMPONENT_{i + 1}"
+                                with m.Else():
+                                    m.next = next_attr
                             else:
                                 # all components read
-                                m.next = "DONE"
+                                m.next = next_attr
 
             with m.State("DONE"):
                 with m.If(output_next_free):
@@ -1,8 +1,16 @@
+from amaranth import unsigned
 from amaranth.lib import data, enum
 
 from ..utils.types import Vector4_mem, address_shape, stride_shape
 
-__all__ = ["InputMode", "InputData"]
+__all__ = [
+    "InputMode",
+    "ComponentType",
+    "AttrFormat",
+    "InputData",
+    "IndirectDrawRecord",
+    "DrawRange",
+]
 
 
 class InputMode(enum.Enum, shape=1):
@@ -10,15 +18,50 @@ class InputMode(enum.Enum, shape=1):
     PER_VERTEX = 1
 
 
+class ComponentType(enum.Enum, shape=3):
+    FIXED = 0  # FixedPoint 16.16, 4 bytes
+    S8 = 1
+    U8 = 2
+    S16 = 3
+    U16 = 4
+
+
+class AttrFormat(data.Struct):
+    """Memory format of a per-vertex attribute
+
+    Components must be naturally aligned. Integer components are converted to their
+    value, or with ``normalized`` mapped to [-1, 1] (signed) / [0, 1] (unsigned).
+    Components not present in memory default to (0, 0, 0, 1).
+    """
+
+    type: ComponentType
+    normalized: 1
+    size: 3  # components in memory (1-4), 0 - all components of the attribute
+    _pad: 9
+
+
 class PerVertexData(data.Struct):
     address: address_shape
     stride: stride_shape
-    _pad0: 16
+    format: AttrFormat
     _pad1: 32
-    # for now assume format (FixedPoint 16.16) for all attributes
-    # with appropriate number of components
 
 
 class InputData(data.Union):
     constant_value: Vector4_mem
     per_vertex: PerVertexData
+
+
+class IndirectDrawRecord(data.Struct):
+    """Single draw of a multi-draw batch, as stored in memory (3 words)"""
+
+    address: address_shape  # index buffer address (ignored for NOT_INDEXED)
+    count: unsigned(32)
+    base_vertex: unsigned(32)
+
+
+class DrawRange(data.Struct):
+    """Marks the start of a draw of a multi-draw batch in the index stream"""
+
+    count: unsigned(32)
+    base_vertex: unsigned(32)
@@ -1,25 +1,34 @@
 import amaranth_soc.wishbone.bus as wb
 from amaranth import *
 from amaranth.lib import data, fifo, wiring
-from amaranth.lib.cdc import FFSynchronizer
+from amaranth.lib.cdc import FFSynchronizer, PulseSynchronizer
 from amaranth.lib.wiring import In, Out
 from amaranth_soc import csr
 from amaranth_soc.csr.wishbone import WishboneCSRBridge
 from amaranth_soc.memory import MemoryMap
 
+from .command_processor.cores import CommandProcessor
 from .input_assembly.cores import (
     IndexGenerator,
     InputAssembly,
     InputAssemblyAttrConfigLayout,
     InputTopologyProcessor,
 )
+from .input_assembly.layouts import DrawRange
 from .pixel_shading.cores import (
     BlendConfig,
+    ClearConfig,
+    ClearFlags,
     DepthStencilTest,
     DepthTestConfig,
+    FastClear,
+    HierarchicalZ,
     StencilOpConfig,
     SwapchainOutput,
+    TextureCache,
+    TextureConfig,
     Texturing,
+    TileCache,
 )
 from .rasterizer.cores import (
     PerspectiveDivide,
@@ -35,13 +44,17 @@ from .utils.layouts import (
     num_textures,
     wb_bus_addr_width,
     wb_bus_data_width,
+    wb_bus_granularity,
 )
+from .utils.perf import CounterSnapshot
 from .utils.types import (
     FixedPoint_mem,
     IndexKind,
     InputTopology,
     address_shape,
 )
+from .vertex_cache.cores import EarlyCull, VertexCacheLookup, VertexCacheMerge
+from .vertex_cache.layouts import VertexCacheTicket
 from .vertex_shading.cores import (
     LightPropertyLayout,
     MaterialPropertyLayout,
@@ -55,21 +68,158 @@ from .vertex_transform.cores import (
 __all__ = ["GraphicsPipeline", "GraphicsPipelineCSR", "GraphicsPipelineAvalonCSR"]
 
 
+class PixelDrawState(data.Struct):
+    """Draw-latched state of the pixel clock domain stages."""
+
+    fb_info: FramebufferInfoLayout
+    stencil_conf_front: StencilOpConfig
+    stencil_conf_back: StencilOpConfig
+    depth_conf: DepthTestConfig
+    blend_conf: BlendConfig
+    tex_conf: TextureConfig
+    tex_address: address_shape
+
+
+class DrawState(data.Struct):
+    """State captured when a draw starts (everything after input assembly)."""
+
+    vt_enabled: VertexTransformEnablementLayout
+    position_mv: data.ArrayLayout(FixedPoint_mem, 16)
+    position_p: data.ArrayLayout(FixedPoint_mem, 16)
+    normal_mv_inv_t: data.ArrayLayout(FixedPoint_mem, 9)
+    texture_transforms: data.ArrayLayout(
+        data.ArrayLayout(FixedPoint_mem, 16), num_textures
+    )
+    material: MaterialPropertyLayout
+    lights: data.ArrayLayout(LightPropertyLayout, num_lights)
+    light_enable: unsigned(num_lights)
+    pa_conf: PrimitiveAssemblyConfigLayout
+    pixel: PixelDrawState
+
+
+class StreamTag(data.Struct):
+    """Extra bits stored with every entry of the inter-stage FIFOs."""
+
+    marker: 1  # draw boundary instead of stream data
+    slot: 1  # state slot of the draw that follows the marker
+
+
+# Inter-stage FIFOs and memory buses covered by the performance counters
+perf_fifos = [
+    "idx_to_topo",
+    "idx_to_topo_draws",
+    "topo_to_ia",
+    "vc_to_ia",
+    "vc_tickets",
+    "ia_to_vtx_xf",
+    "vtx_xf_to_cull",
+    "cull_to_vtx_sh",
+    "cull_tickets",
+    "vtx_sh_to_clip",
+    "vc_to_clip",
+    "clip_to_div",
+    "div_to_tri_prep",
+    "tri_prep_to_rast",
+    "rast_to_tex",
+    "tex_to_ds",
+    "ds_to_sc",
+]
+perf_buses = ["index", "vertex", "depthstencil", "color"]
+
+
+class FifoPerfCounters(data.Struct):
+    stall: unsigned(32)  # output valid but not taken, the stage after it is behind
+    starve: unsigned(32)  # stage after it ready but the FIFO empty
+
+
+class BusPerfCounters(data.Struct):
+    read_beats: unsigned(32)
+    write_beats: unsigned(32)
+    wait_cycles: unsigned(32)  # request cycles without an acknowledge
+
+
+class CachePerfCounters(data.Struct):
+    lookups: unsigned(32)
+    misses: unsigned(32)
+
+
+class PerfCounters(data.Struct):
+    """Performance counters (wrapping around) between the last reset and snapshot."""
+
+    triangles_in: unsigned(32)  # reaching the clipper or culled before shading
+    triangles_clipped: unsigned(32)  # sent through full clipping
+    triangles_culled: unsigned(32)  # outside the clip volume, face or scissor culled
+    triangles_rasterized: unsigned(32)
+    hiz_tile_rejects: unsigned(32)
+    coarse_block_rejects: unsigned(32)
+    fragments_generated: unsigned(32)  # pixels leaving the rasterizer
+    fragments_early_z_rejected: unsigned(32)  # per-fragment early depth test rejects
+    fragments_stencil_failed: unsigned(32)
+    fragments_depth_failed: unsigned(32)
+    fragments_written: unsigned(32)  # passing depth/stencil, blended into the target
+    fifo: data.StructLayout({name: FifoPerfCounters for name in perf_fifos})
+    bus: data.StructLayout({name: BusPerfCounters for name in perf_buses})
+    cache: data.StructLayout(
+        {
+            "depthstencil": CachePerfCounters,
+            "color": CachePerfCounters,
+            "texture": CachePerfCounters,
+        }
+    )
+
+
 class GraphicsPipeline(wiring.Component):
     """End-to-end graphics pipeline wiring.
 
     Stages (streams):
-      IndexGenerator → InputTopologyProcessor → InputAssembly → VertexTransform →
-      VertexShading → PrimitiveClipper → TriangleRasterizer →
-      Texturing → DepthStencilTest → SwapchainOutput
+      IndexGenerator → InputTopologyProcessor → VertexCacheLookup → InputAssembly →
+      VertexTransform → EarlyCull → VertexShading → VertexCacheMerge →
+      PrimitiveClipper → TriangleRasterizer → Texturing → DepthStencilTest →
+      SwapchainOutput
+
+    Indices found in the post-transform vertex cache skip input assembly and vertex
+    processing, VertexCacheMerge puts the cached vertices back in order. The cache is
+    invalidated at every draw boundary. EarlyCull drops face culled triangles before
+    shading, their vertices are only shaded when a surviving primitive uses them.
+
+    FastClear shares the depth/stencil and color buses with the fragment back end.
+    The fragment back end (and the early depth test) accesses them through write-back
+    TileCaches, which burst whole tile rows. They are written back whenever the
+    fragment back end runs dry and invalidated when a draw reaches the rasterizer or a
+    clear starts, the clear itself writes around them. A marker only passes the depth
+    test and the color output once their cache has been written back, so the draw in
+    front of it is in memory when it leaves the pipeline.
+
+    Texturing reads through a read-only TextureCache on the color bus, which is
+    invalidated whenever a draw reaches it.
+
+    The configuration inputs are a pending copy. On ``start`` the state used after
+    input assembly is captured into one of two slots and a marker is queued in front
+    of the draw's data. Every stage drains the previous draw when the marker reaches
+    its input and then switches to the marker's slot, so state for the next draw can
+    be written while the current one is still in flight. A slot can only be reused
+    once the marker of the following draw has left the pipeline, until then input
+    assembly reports busy and ``start`` is ignored. Index, topology and vertex
+    attribute configuration is used directly and still requires input assembly to
+    be idle.
+
+    Draws and clears complete in the order they were started. ``draw_started`` strobes
+    when ``start`` is accepted, ``marker_retired`` when a marker leaves the pipeline
+    (the draw in front of it, if any, is complete) and ``clear_done`` when a clear has
+    finished. The last draw is complete once the pipeline is ``ready``.
 
     Exposes separate Wishbone buses for vertex fetch, depth/stencil and color.
+
+    Performance counters run in the clock domain of their events. ``perf_snapshot``
+    latches them (relative to the last ``perf_reset``) into ``perf``, which is valid
+    once ``perf_pending`` has dropped.
     """
 
     # Draw/index generation
     c_index_address: In(address_shape)
     c_index_count: In(unsigned(32))
     c_index_kind: In(IndexKind)
+    c_index_draw_count: In(unsigned(32))  # non-zero: multi-draw from records at address
     start: In(1)
 
     # Input topology
@@ -78,6 +228,30 @@ class GraphicsPipeline(wiring.Component):
     c_primitive_restart_index: In(unsigned(32))
     c_base_vertex: In(unsigned(32))
 
+    # Post-transform vertex cache
+    c_vtx_cache_enable: In(1)
+    vtx_cache_lookups: Out(32)
+    vtx_cache_hits: Out(32)
+
+    # Face culling in front of vertex shading
+    c_early_cull_enable: In(1)
+    early_culled: Out(32)
+
+    # Clipper guard band (log2 of the size relative to the viewport, 0 - disabled)
+    c_guard_band: In(2)
+    clip_trivial_accepts: Out(32)
+    clip_guard_band_accepts: Out(32)
+    clip_clipped: Out(32)
+
+    # Hierarchical Z (takes effect at the next depth clear)
+    c_hiz_enable: In(1)
+
+    # Performance counters
+    perf_snapshot: In(1)
+    perf_reset: In(1)
+    perf_pending: Out(1)
+    perf: Out(PerfCounters)
+
     # Input assembly attributes
     c_pos: In(InputAssemblyAttrConfigLayout)
     c_norm: In(InputAssemblyAttrConfigLayout)
@@ -94,6 +268,7 @@ class GraphicsPipeline(wiring.Component):
     # Shading configuration
     material: In(MaterialPropertyLayout)
     lights: In(LightPropertyLayout).array(num_lights)
+    light_enable: In(num_lights)  # lights without their bit set are skipped
 
     # Primitive assembly configuration
     pa_conf: In(PrimitiveAssemblyConfigLayout)
@@ -105,20 +280,49 @@ class GraphicsPipeline(wiring.Component):
     depth_conf: In(DepthTestConfig)
     blend_conf: In(BlendConfig)
 
+    # Texturing (texture 0)
+    tex_conf: In(TextureConfig)
+    tex_address: In(address_shape)
+
+    # Fast clear of the scissor rectangle
+    clear_conf: In(ClearConfig)
+    clear_start: In(1)
+
     # Wishbone buses (separate for simplicity)
     wb_index: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
     wb_vertex: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
     wb_depthstencil: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
     wb_color: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
 
+    # Completion strobes, in order of the started draws and clears
+    draw_started: Out(1)
+    marker_retired: Out(1)
+    clear_done: Out(1)
+
     # ready (reflect index generator readiness)
     ready: Out(1)
     ready_components: Out(
@@ -126,55 +330,108 @@ class GraphicsPipeline(wiring.Component):
     )  # [input assembly, vertex transform, rasterizer, pixel pipeline]
     ready_vec: Out(32)
 
+    def __init__(
+        self, num_generators: int = 8, fifo_depth: int = 256, num_light_lanes: int = 1
+    ):
+        # exposed for throughput comparisons (tests/bench)
+        self._num_generators = num_generators
+        self._fifo_depth = fifo_depth
+        self._num_light_lanes = num_light_lanes
+        super().__init__()
+
     def elaborate(self, platform):
         m = Module()
 
         # Submodules
         m.submodules.idx = idx = IndexGenerator()
         m.submodules.topo = topo = InputTopologyProcessor()
+        m.submodules.vc_lookup = vc_lookup = VertexCacheLookup()
         m.submodules.ia = ia = InputAssembly()
 
         m.submodules.vtx_xf = vtx_xf = VertexTransform()
-        m.submodules.vtx_sh = vtx_sh = VertexShading()
+        m.submodules.cull = cull = EarlyCull()
+        m.submodules.vtx_sh = vtx_sh = VertexShading(
+            num_lights, num_lanes=self._num_light_lanes
+        )
+        m.submodules.vc_merge = vc_merge = VertexCacheMerge()
 
         m.submodules.clip = clip = PrimitiveClipper()
         m.submodules.div = div = PerspectiveDivide()
         m.submodules.tri_prep = tri_prep = TrianglePrep()
 
         m.submodules.rast = rast = DomainRenamer("pixel")(
-            TriangleRasterizer(num_generators=8, inv_steps=2)
+            TriangleRasterizer(num_generators=self._num_generators, inv_steps=2)
         )
         m.submodules.tex = tex = DomainRenamer("pixel")(Texturing())
         m.submodules.ds = ds = DomainRenamer("pixel")(DepthStencilTest())
         m.submodules.sc = sc = DomainRenamer("pixel")(SwapchainOutput())
+        m.submodules.clear = clear = DomainRenamer("pixel")(FastClear())
+        m.submodules.hiz = hiz = DomainRenamer("pixel")(HierarchicalZ())
+        m.submodules.ds_cache = ds_cache = DomainRenamer("pixel")(TileCache())
+        m.submodules.color_cache = color_cache = DomainRenamer("pixel")(TileCache())
+        m.submodules.tex_cache = tex_cache = DomainRenamer("pixel")(TextureCache())
 
-        fifo_size_default = 256
+        fifo_size_default = self._fifo_depth
+        tag_width = Shape.cast(StreamTag).width
 
         # FIFO buffers between stages
         m.submodules.idx_to_topo_fifo = fifo_idx_topo = fifo.SyncFIFOBuffered(
-            width=Shape.cast(topo.i.p.shape()).width, depth=fifo_size_default
+            width=Shape.cast(topo.i.p.shape()).width + tag_width,
+            depth=fifo_size_default,
+        )
+        m.submodules.idx_to_topo_draws_fifo = fifo_idx_topo_draws = (
+            fifo.SyncFIFOBuffered(width=Shape.cast(DrawRange).width, depth=4)
         )
         m.submodules.topo_to_ia_fifo = fifo_topo_ia = fifo.SyncFIFOBuffered(
-            width=Shape.cast(ia.i.p.shape()).width, depth=fifo_size_default
+            width=Shape.cast(ia.i.p.shape()).width + tag_width,
+            depth=fifo_size_default,
+        )
+        # the cache stages only add a cycle, so small FIFOs are enough around them
+        m.submodules.vc_to_ia_fifo = fifo_vc_ia = fifo.SyncFIFOBuffered(
+            width=Shape.cast(ia.i.p.shape()).width + tag_width,
+            depth=16,
+        )
+        # bounds the number of vertices between lookup and merge
+        m.submodules.vc_tickets_fifo = fifo_vc_tickets = fifo.SyncFIFOBuffered(
+            width=Shape.cast(VertexCacheTicket).width,
+            depth=fifo_size_default,
         )
         m.submodules.ia_to_vtx_xf_fifo = fifo_ia_vtx_xf = fifo.SyncFIFOBuffered(
-            width=Shape.cast(vtx_xf.i.p.shape()).width, depth=fifo_size_default
+            width=Shape.cast(vtx_xf.i.p.shape()).width + tag_width,
+            depth=fifo_size_default,
         )
-        m.submodules.vtx_xf_to_vtx_sh_fifo = fifo_vtx_xf_vtx_sh = fifo.SyncFIFOBuffered(
-            width=Shape.cast(vtx_sh.i.p.shape()).width, depth=fifo_size_default
+        m.submodules.vtx_xf_to_cull_fifo = fifo_vtx_xf_cull = fifo.SyncFIFOBuffered(
+            width=Shape.cast(cull.i.p.shape()).width + tag_width,
+            depth=fifo_size_default,
+        )
+        m.submodules.cull_to_vtx_sh_fifo = fifo_cull_vtx_sh = fifo.SyncFIFOBuffered(
+            width=Shape.cast(vtx_sh.i.p.shape()).width + tag_width,
+            depth=16,
+        )
+        # bounds the number of vertices between culling and merge
+        m.submodules.cull_tickets_fifo = fifo_cull_tickets = fifo.SyncFIFOBuffered(
+            width=Shape.cast(VertexCacheTicket).width,
+            depth=fifo_size_default,
         )
         m.submodules.vtx_sh_to_clip_fifo = fifo_vtx_sh_clip = fifo.SyncFIFOBuffered(
-            width=Shape.cast(clip.i.p.shape()).width, depth=fifo_size_default
+            width=Shape.cast(clip.i.p.shape()).width + tag_width,
+            depth=fifo_size_default,
+        )
+        m.submodules.vc_to_clip_fifo = fifo_vc_clip = fifo.SyncFIFOBuffered(
+            width=Shape.cast(clip.i.p.shape()).width + tag_width,
+            depth=16,
         )
         m.submodules.clip_to_div_fifo = fifo_clip_div = fifo.SyncFIFOBuffered(
-            width=Shape.cast(div.i.p.shape()).width, depth=fifo_size_default
+            width=Shape.cast(div.i.p.shape()).width + tag_width,
+            depth=fifo_size_default,
         )
         m.submodules.div_to_tri_prep_fifo = fifo_div_tri_prep = fifo.SyncFIFOBuffered(
-            width=Shape.cast(tri_prep.i.p.shape()).width, depth=fifo_size_default
+            width=Shape.cast(tri_prep.i.p.shape()).width + tag_width,
+            depth=fifo_size_default,
         )
         m.submodules.tri_prep_to_rast_fifo = fifo_tri_prep_rast = (
             fifo.AsyncFIFOBuffered(
-                width=Shape.cast(rast.i.p.shape()).width,
+                width=Shape.cast(rast.i.p.shape()).width + tag_width,
                 depth=fifo_size_default,
                 w_domain="sync",
                 r_domain="pixel",
@@ -182,73 +439,287 @@ class GraphicsPipeline(wiring.Component):
         )
         m.submodules.rast_to_tex_fifo = fifo_rast_tex = DomainRenamer("pixel")(
             fifo.SyncFIFOBuffered(
-                width=Shape.cast(tex.i.p.shape()).width, depth=fifo_size_default
+                width=Shape.cast(tex.i.p.shape()).width + tag_width,
+                depth=fifo_size_default,
             )
         )
         m.submodules.tex_to_ds_fifo = fifo_tex_ds = DomainRenamer("pixel")(
             fifo.SyncFIFOBuffered(
-                width=Shape.cast(ds.i.p.shape()).width, depth=fifo_size_default
+                width=Shape.cast(ds.i.p.shape()).width + tag_width,
+                depth=fifo_size_default,
             )
         )
         m.submodules.ds_to_sc_fifo = fifo_ds_sc = DomainRenamer("pixel")(
             fifo.SyncFIFOBuffered(
-                width=Shape.cast(sc.i.p.shape()).width, depth=fifo_size_default
+                width=Shape.cast(sc.i.p.shape()).width + tag_width,
+                depth=fifo_size_default,
             )
         )
 
-        wiring.connect(m, idx.o, fifo_idx_topo.w_stream)
-
-        wiring.connect(m, fifo_idx_topo.r_stream, topo.i)
-        wiring.connect(m, topo.o, fifo_topo_ia.w_stream)
-
-        wiring.connect(m, fifo_topo_ia.r_stream, ia.i)
-        wiring.connect(m, ia.o, fifo_ia_vtx_xf.w_stream)
-
-        wiring.connect(m, fifo_ia_vtx_xf.r_stream, vtx_xf.i)
-        wiring.connect(m, vtx_xf.o, fifo_vtx_xf_vtx_sh.w_stream)
-
-        wiring.connect(m, fifo_vtx_xf_vtx_sh.r_stream, vtx_sh.i)
-        wiring.connect(m, vtx_sh.o, fifo_vtx_sh_clip.w_stream)
-
-        wiring.connect(m, fifo_vtx_sh_clip.r_stream, clip.i)
-        wiring.connect(m, clip.o, fifo_clip_div.w_stream)
-
-        wiring.connect(m, fifo_clip_div.r_stream, div.i)
-        wiring.connect(m, div.o, fifo_div_tri_prep.w_stream)
+        # Draw-latched state: snapshot of the pending configuration per started draw
+        pending = Signal(DrawState)
+        m.d.comb += [
+            pending.vt_enabled.eq(self.vt_enabled),
+            pending.position_mv.eq(self.position_mv),
+            pending.position_p.eq(self.position_p),
+            pending.normal_mv_inv_t.eq(self.normal_mv_inv_t),
+            *[
+                pending.texture_transforms[i].eq(self.texture_transforms[i])
+                for i in range(num_textures)
+            ],
+            pending.material.eq(self.material),
+            *[pending.lights[i].eq(self.lights[i]) for i in range(num_lights)],
+            pending.light_enable.eq(self.light_enable),
+            pending.pa_conf.eq(self.pa_conf),
+            pending.pixel.fb_info.eq(self.fb_info),
+            pending.pixel.stencil_conf_front.eq(self.stencil_conf_front),
+            pending.pixel.stencil_conf_back.eq(self.stencil_conf_back),
+            pending.pixel.depth_conf.eq(self.depth_conf),
+            pending.pixel.blend_conf.eq(self.blend_conf),
+            pending.pixel.tex_conf.eq(self.tex_conf),
+            pending.pixel.tex_address.eq(self.tex_address),
+        ]
 
-        wiring.connect(m, fifo_div_tri_prep.r_stream, tri_prep.i)
-        wiring.connect(m, tri_prep.o, fifo_tri_prep_rast.w_stream)
+        state_slots = [Signal(DrawState, name=f"state_slot{i}") for i in range(2)]
+        latest_slot = Signal()  # slot of the most recently started draw
+        retired_slot = Signal()  # slot of the last marker that left the pipeline
+        marker_pending = Signal()
+
+        # Starting a draw overwrites the slot of the draw before the latest one, which is
+        # complete once the marker of the latest draw has left the pipeline
+        slot_free = Signal()
+        m.d.comb += slot_free.eq(retired_slot == latest_slot)
+
+        with m.If(marker_pending & fifo_idx_topo.w_stream.ready):
+            m.d.sync += marker_pending.eq(0)
+        with m.If(idx.start_stb):
+            m.d.sync += [
+                latest_slot.eq(~latest_slot),
+                marker_pending.eq(1),
+            ]
+            for i, slot in enumerate(state_slots):
+                with m.If(latest_slot != i):
+                    m.d.sync += slot.eq(pending)
 
-        wiring.connect(m, fifo_tri_prep_rast.r_stream, rast.i)
-        wiring.connect(m, rast.o, fifo_rast_tex.w_stream)
+        def write_tagged(w_stream, o, inject, slot):
+            """Feeds stream ``o`` into a tagged FIFO, or a marker for ``slot`` while ``inject``."""
+            tag = Signal(StreamTag)
+            m.d.comb += [
+                tag.marker.eq(inject),
+                tag.slot.eq(slot),
+                w_stream.payload.eq(Cat(o.payload, tag)),
+                w_stream.valid.eq(o.valid | inject),
+                o.ready.eq(w_stream.ready & ~inject),
+            ]
 
-        wiring.connect(m, fifo_rast_tex.r_stream, tex.i)
-        wiring.connect(m, tex.o, fifo_tex_ds.w_stream)
+        def connect_stage(
+            name,
+            r_stream,
+            stage,
+            w_stream=None,
+            domain="sync",
+            enable=C(1),
+            flush=None,
+            hold=C(0),
+        ):
+            """Runs ``stage`` between tagged FIFOs, returns the slot of the draw it processes.
+
+            A marker is passed on (and the slot switched) only once the stage has drained
+            everything in front of it and ``hold`` is low. ``flush`` is strobed when a
+            marker is passed on.
+            """
+            tag = StreamTag(r_stream.payload[-tag_width:])
+            slot = Signal(name=f"{name}_slot")
+
+            drained = stage.ready if w_stream is None else stage.ready & ~stage.o.valid
+            inject = Signal(name=f"{name}_marker")
+            forward = Signal(name=f"{name}_marker_done")
+            m.d.comb += [
+                inject.eq(r_stream.valid & tag.marker & drained & enable & ~hold),
+                forward.eq(inject & (C(1) if w_stream is None else w_stream.ready)),
+                stage.i.payload.eq(r_stream.payload[:-tag_width]),
+                stage.i.valid.eq(r_stream.valid & ~tag.marker & enable),
+                r_stream.ready.eq(Mux(tag.marker, forward, stage.i.ready & enable)),
+            ]
+            with m.If(forward):
+                m.d[domain] += slot.eq(tag.slot)
+            if flush is not None:
+                m.d.comb += flush.eq(forward)
+
+            if w_stream is not None:
+                write_tagged(w_stream, stage.o, inject, Mux(inject, tag.slot, slot))
+
+            return slot
+
+        write_tagged(fifo_idx_topo.w_stream, idx.o, marker_pending, latest_slot)
+        wiring.connect(m, idx.draws, fifo_idx_topo_draws.w_stream)
+        wiring.connect(m, fifo_idx_topo_draws.r_stream, topo.draws)
+
+        connect_stage("topo", fifo_idx_topo.r_stream, topo, fifo_topo_ia.w_stream)
+        connect_stage(
+            "vc_lookup",
+            fifo_topo_ia.r_stream,
+            vc_lookup,
+            fifo_vc_ia.w_stream,
+            flush=vc_lookup.flush,
+        )
+        wiring.connect(m, vc_lookup.tickets, fifo_vc_tickets.w_stream)
+        wiring.connect(m, fifo_vc_tickets.r_stream, cull.tickets)
+        wiring.connect(m, cull.o_tickets, fifo_cull_tickets.w_stream)
+        wiring.connect(m, fifo_cull_tickets.r_stream, vc_merge.tickets)
+        connect_stage(
+            "ia", fifo_vc_ia.r_stream, ia, fifo_ia_vtx_xf.w_stream, flush=ia.flush
+        )
+        vtx_xf_slot = connect_stage(
+            "vtx_xf", fifo_ia_vtx_xf.r_stream, vtx_xf, fifo_vtx_xf_cull.w_stream
+        )
+        cull_slot = connect_stage(
+            "cull",
+            fifo_vtx_xf_cull.r_stream,
+            cull,
+            fifo_cull_vtx_sh.w_stream,
+            flush=cull.flush,
+        )
+        vtx_sh_slot = connect_stage(
+            "vtx_sh", fifo_cull_vtx_sh.r_stream, vtx_sh, fifo_vtx_sh_clip.w_stream
+        )
+        connect_stage(
+            "vc_merge",
+            fifo_vtx_sh_clip.r_stream,
+            vc_merge,
+            fifo_vc_clip.w_stream,
+            flush=vc_merge.flush,
+        )
+        clip_slot = connect_stage(
+            "clip", fifo_vc_clip.r_stream, clip, fifo_clip_div.w_stream
+        )
+        connect_stage("div", fifo_clip_div.r_stream, div, fifo_div_tri_prep.w_stream)
+        tri_prep_slot = connect_stage(
+            "tri_prep",
+            fifo_div_tri_prep.r_stream,
+            tri_prep,
+            fifo_tri_prep_rast.w_stream,
+        )
 
-        wiring.connect(m, fifo_tex_ds.r_stream, ds.i)
-        wiring.connect(m, ds.o, fifo_ds_sc.w_stream)
+        # Triangles of later draws wait until a running clear has finished
+        rast_marker = Signal()
+        rast_slot = connect_stage(
+            "rast",
+            fifo_tri_prep_rast.r_stream,
+            rast,
+            fifo_rast_tex.w_stream,
+            domain="pixel",
+            enable=clear.ready,
+            flush=rast_marker,
+        )
+        tex_marker = Signal()
+        tex_slot = connect_stage(
+            "tex",
+            fifo_rast_tex.r_stream,
+            tex,
+            fifo_tex_ds.w_stream,
+            domain="pixel",
+            flush=tex_marker,
+        )
+        # the draw in front of a marker is only done once its writes are in memory
+        ds_slot = connect_stage(
+            "ds",
+            fifo_tex_ds.r_stream,
+            ds,
+            fifo_ds_sc.w_stream,
+            domain="pixel",
+            hold=~ds_cache.clean,
+        )
+        sc_slot = connect_stage(
+            "sc", fifo_ds_sc.r_stream, sc, domain="pixel", hold=~color_cache.clean
+        )
 
-        wiring.connect(m, fifo_ds_sc.r_stream, sc.i)
+        m.submodules.retired_slot_cdc = FFSynchronizer(
+            sc_slot, retired_slot, o_domain="sync"
+        )
+        # at most one marker is past sc's input (see slot_free), so every toggle of
+        # the retired slot is seen
+        retired_slot_last = Signal()
+        m.d.sync += retired_slot_last.eq(retired_slot)
+        m.d.comb += [
+            self.draw_started.eq(idx.start_stb),
+            self.marker_retired.eq(retired_slot != retired_slot_last),
+        ]
 
         # Wishbone buses wiring
         wiring.connect(m, idx.bus, wiring.flipped(self.wb_index))
         wiring.connect(m, ia.bus, wiring.flipped(self.wb_vertex))
-        wiring.connect(m, ds.wb_bus, wiring.flipped(self.wb_depthstencil))
-        wiring.connect(m, sc.wb_bus, wiring.flipped(self.wb_color))
+        ds_arbiter = wb.Arbiter(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            granularity=wb_bus_granularity,
+        )
+        ds_arbiter.add(ds.wb_bus)
+        ds_arbiter.add(rast.ds_bus)
+        m.submodules.ds_arbiter = DomainRenamer("pixel")(ds_arbiter)
+        wiring.connect(m, ds_arbiter.bus, ds_cache.bus)
+        wiring.connect(m, sc.wb_bus, color_cache.bus)
+        wiring.connect(m, tex.bus, tex_cache.bus)
+
+        # fast clears write around the caches, textures share the color bus
+        ds_mem_arbiter = wb.Arbiter(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+        ds_mem_arbiter.add(ds_cache.mem_bus)
+        ds_mem_arbiter.add(clear.wb_depthstencil)
+        m.submodules.ds_mem_arbiter = DomainRenamer("pixel")(ds_mem_arbiter)
+
+        color_mem_arbiter = wb.Arbiter(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+        color_mem_arbiter.add(color_cache.mem_bus)
+        color_mem_arbiter.add(clear.wb_color)
+        color_mem_arbiter.add(tex_cache.mem_bus)
+        m.submodules.color_mem_arbiter = DomainRenamer("pixel")(color_mem_arbiter)
+
+        wiring.connect(m, ds_mem_arbiter.bus, wiring.flipped(self.wb_depthstencil))
+        wiring.connect(m, color_mem_arbiter.bus, wiring.flipped(self.wb_color))
 
         input_assembly_ready_ = [
-            idx.ready & ~fifo_idx_topo.w_en,
-            ~fifo_idx_topo.r_rdy & topo.ready & ~fifo_topo_ia.w_en,
-            ~fifo_topo_ia.r_rdy & ia.ready & ~fifo_ia_vtx_xf.w_en,
+            idx.ready
+            & ~fifo_idx_topo.w_en
+            & ~fifo_idx_topo_draws.w_en
+            & ~marker_pending
+            & slot_free,
+            ~fifo_idx_topo.r_rdy
+            & ~fifo_idx_topo_draws.r_rdy
+            & topo.ready
+            & ~fifo_topo_ia.w_en,
+            ~fifo_topo_ia.r_rdy
+            & vc_lookup.ready
+            & ~vc_lookup.o.valid
+            & ~fifo_vc_ia.w_en
+            & ~fifo_vc_tickets.w_en,
+            ~fifo_vc_ia.r_rdy & ia.ready & ~fifo_ia_vtx_xf.w_en,
         ]
 
         vertex_transform_ready_ = [
-            ~fifo_ia_vtx_xf.r_rdy & vtx_xf.ready & ~fifo_vtx_xf_vtx_sh.w_en,
-            ~fifo_vtx_xf_vtx_sh.r_rdy & vtx_sh.ready & ~fifo_vtx_sh_clip.w_en,
+            ~fifo_ia_vtx_xf.r_rdy & vtx_xf.ready & ~fifo_vtx_xf_cull.w_en,
+            ~fifo_vtx_xf_cull.r_rdy
+            & ~fifo_vc_tickets.r_rdy
+            & cull.ready
+            & ~cull.o.valid
+            & ~fifo_cull_vtx_sh.w_en
+            & ~fifo_cull_tickets.w_en,
+            ~fifo_cull_vtx_sh.r_rdy & vtx_sh.ready & ~fifo_vtx_sh_clip.w_en,
+            ~fifo_vtx_sh_clip.r_rdy
+            & ~fifo_cull_tickets.r_rdy
+            & vc_merge.ready
+            & ~vc_merge.o.valid
+            & ~fifo_vc_clip.w_en,
         ]
 
         raster_ready_ = [
-            ~fifo_vtx_sh_clip.r_rdy & clip.ready & ~fifo_clip_div.w_en,
+            ~fifo_vc_clip.r_rdy & clip.ready & ~fifo_clip_div.w_en,
             ~fifo_clip_div.r_rdy & div.ready & ~fifo_div_tri_prep.w_en,
             ~fifo_div_tri_prep.r_rdy & tri_prep.ready & ~fifo_tri_prep_rast.w_en,
         ]
@@ -259,6 +730,8 @@ class GraphicsPipeline(wiring.Component):
             ~fifo_rast_tex.r_rdy & tex.ready & ~fifo_tex_ds.w_en,
             ~fifo_tex_ds.r_rdy & ds.ready & ~fifo_ds_sc.w_en,
             ~fifo_ds_sc.r_rdy & sc.ready,
+            clear.ready,
+            ds_cache.clean & color_cache.clean,
         ]
 
         input_assembly_ready = Signal(len(input_assembly_ready_))
@@ -309,12 +782,31 @@ class GraphicsPipeline(wiring.Component):
             )
         )
 
+        # a clear is busy from its start strobe, before the pixel domain sees it
+        clear_pending = Signal()
+        m.submodules.clear_start_cdc = clear_start_cdc = PulseSynchronizer(
+            i_domain="sync", o_domain="pixel"
+        )
+        m.submodules.clear_done_cdc = clear_done_cdc = PulseSynchronizer(
+            i_domain="pixel", o_domain="sync"
+        )
+        m.d.comb += [
+            clear_start_cdc.i.eq(self.clear_start),
+            clear.start.eq(clear_start_cdc.o),
+            clear_done_cdc.i.eq(clear.done),
+            self.clear_done.eq(clear_done_cdc.o),
+        ]
+        with m.If(self.clear_start):
+            m.d.sync += clear_pending.eq(1)
+        with m.Elif(clear_done_cdc.o):
+            m.d.sync += clear_pending.eq(0)
+
         m.d.comb += self.ready_components.eq(
             Cat(
                 input_assembly_ready_filtered.all(),
                 vertex_transform_ready_filtered.all(),
                 raster_ready_filtered.all(),
-                fragment_processing_ready_filtered.all(),
+                fragment_processing_ready_filtered.all() & ~clear_pending,
             )
         )
 
@@ -325,7 +817,8 @@ class GraphicsPipeline(wiring.Component):
             idx.c_address.eq(self.c_index_address),
             idx.c_count.eq(self.c_index_count),
             idx.c_kind.eq(self.c_index_kind),
-            idx.start.eq(self.start),
+            idx.c_draw_count.eq(self.c_index_draw_count),
+            idx.start.eq(self.start & slot_free),
         ]
 
         # Topology configuration
@@ -334,9 +827,17 @@ class GraphicsPipeline(wiring.Component):
             topo.c_primitive_restart_enable.eq(self.c_primitive_restart_enable),
             topo.c_primitive_restart_index.eq(self.c_primitive_restart_index),
             topo.c_base_vertex.eq(self.c_base_vertex),
+            topo.c_multi_draw.eq(self.c_index_draw_count != 0),
             topo.start.eq(idx.start_stb),
         ]
 
+        # Vertex cache
+        m.d.comb += [
+            vc_lookup.c_enable.eq(self.c_vtx_cache_enable),
+            self.vtx_cache_lookups.eq(vc_lookup.lookups),
+            self.vtx_cache_hits.eq(vc_lookup.hits),
+        ]
+
         # Input Assembly configuration
         m.d.comb += [
             ia.c_pos.eq(self.c_pos),
@@ -345,89 +846,357 @@ class GraphicsPipeline(wiring.Component):
             ia.c_col.eq(self.c_col),
         ]
 
+        def draw_state(name, slot, slots, layout):
+            state = Signal(layout, name=name)
+            m.d.comb += state.eq(Mux(slot, slots[1], slots[0]))
+            return state
+
         # Vertex transform configuration
+        vtx_xf_state = draw_state("vtx_xf_state", vtx_xf_slot, state_slots, DrawState)
         m.d.comb += [
-            vtx_xf.enabled.eq(self.vt_enabled),
-            vtx_xf.position_mv.eq(self.position_mv),
-            vtx_xf.position_p.eq(self.position_p),
-            vtx_xf.normal_mv_inv_t.eq(self.normal_mv_inv_t),
+            vtx_xf.enabled.eq(vtx_xf_state.vt_enabled),
+            vtx_xf.position_mv.eq(vtx_xf_state.position_mv),
+            vtx_xf.position_p.eq(vtx_xf_state.position_p),
+            vtx_xf.normal_mv_inv_t.eq(vtx_xf_state.normal_mv_inv_t),
             *[
-                vtx_xf.texture_transforms[i].eq(self.texture_transforms[i])
+                vtx_xf.texture_transforms[i].eq(vtx_xf_state.texture_transforms[i])
                 for i in range(num_textures)
             ],
         ]
 
+        # Early face culling configuration
+        cull_state = draw_state("cull_state", cull_slot, state_slots, DrawState)
+        m.d.comb += [
+            cull.c_enable.eq(self.c_early_cull_enable),
+            cull.pa_conf.eq(cull_state.pa_conf),
+            cull.viewport_flip.eq(
+                (cull_state.pixel.fb_info.viewport_width < 0)
+                ^ (cull_state.pixel.fb_info.viewport_height < 0)
+            ),
+            self.early_culled.eq(cull.culled),
+        ]
+
         # Vertex shading configuration
+        vtx_sh_state = draw_state("vtx_sh_state", vtx_sh_slot, state_slots, DrawState)
         m.d.comb += [
-            vtx_sh.material.eq(self.material),
-            *[vtx_sh.lights[i].eq(self.lights[i]) for i in range(num_lights)],
+            vtx_sh.material.eq(vtx_sh_state.material),
+            *[vtx_sh.lights[i].eq(vtx_sh_state.lights[i]) for i in range(num_lights)],
+            vtx_sh.light_enable.eq(vtx_sh_state.light_enable),
         ]
 
         # Primitive assembly and clipper configuration
+        clip_state = draw_state("clip_state", clip_slot, state_slots, DrawState)
         m.d.comb += [
-            clip.prim_type.eq(self.pa_conf.type),
+            clip.prim_type.eq(clip_state.pa_conf.type),
+            clip.guard_band.eq(self.c_guard_band),
+            clip.fb_info.eq(clip_state.pixel.fb_info),
+            self.clip_trivial_accepts.eq(clip.trivial_accepts),
+            self.clip_guard_band_accepts.eq(clip.guard_band_accepts),
+            self.clip_clipped.eq(clip.clipped),
         ]
 
-        m.d.comb += tri_prep.fb_info.eq(self.fb_info)
-        m.d.comb += tri_prep.pa_conf.eq(self.pa_conf)
+        tri_prep_state = draw_state(
+            "tri_prep_state", tri_prep_slot, state_slots, DrawState
+        )
+        m.d.comb += tri_prep.fb_info.eq(tri_prep_state.pixel.fb_info)
+        m.d.comb += tri_prep.pa_conf.eq(tri_prep_state.pa_conf)
 
+        # A slot is only rewritten once no pixel stage uses it anymore, long before
+        # the marker that selects it again arrives through the triangle FIFO
+        pixel_slots = [
+            Signal(PixelDrawState, name=f"pixel_state_slot{i}") for i in range(2)
+        ]
+        for i in range(2):
+            m.submodules[f"pixel_state_slot{i}_cdc"] = FFSynchronizer(
+                state_slots[i].pixel.as_value(), pixel_slots[i], o_domain="pixel"
+            )
+
+        rast_state = draw_state("rast_state", rast_slot, pixel_slots, PixelDrawState)
+        m.d.comb += [
+            rast.fb_info.eq(rast_state.fb_info),
+            rast.stencil_conf_front.eq(rast_state.stencil_conf_front),
+            rast.stencil_conf_back.eq(rast_state.stencil_conf_back),
+            rast.depth_conf.eq(rast_state.depth_conf),
+            # every depth write of the fragments sent so far has reached the cache
+            rast.pixel_drained.eq(
+                (fifo_rast_tex.r_level == 0)
+                & ~fifo_rast_tex.w_en
+                & tex.ready
+                & (fifo_tex_ds.r_level == 0)
+                & ~fifo_tex_ds.w_en
+                & ds.ready
+            ),
+        ]
+
+        tex_state = draw_state("tex_state", tex_slot, pixel_slots, PixelDrawState)
+        m.d.comb += [
+            tex.conf.eq(tex_state.tex_conf),
+            tex.address.eq(tex_state.tex_address),
+        ]
+
+        ds_state = draw_state("ds_state", ds_slot, pixel_slots, PixelDrawState)
+        m.d.comb += [
+            ds.fb_info.eq(ds_state.fb_info),
+            ds.stencil_conf_front.eq(ds_state.stencil_conf_front),
+            ds.stencil_conf_back.eq(ds_state.stencil_conf_back),
+            ds.depth_conf.eq(ds_state.depth_conf),
+        ]
+
+        sc_state = draw_state("sc_state", sc_slot, pixel_slots, PixelDrawState)
+        m.d.comb += [
+            sc.fb_info.eq(sc_state.fb_info),
+            sc.conf.eq(sc_state.blend_conf),
+        ]
+
+        # Clears are not draws, they use the pending framebuffer configuration
         fb_info_pix = Signal.like(self.fb_info)
         m.submodules.fb_info_cdc = FFSynchronizer(
             self.fb_info.as_value(), fb_info_pix, o_domain="pixel"
         )
+        m.submodules.clear_conf_cdc = FFSynchronizer(
+            self.clear_conf.as_value(), clear.conf, o_domain="pixel"
+        )
+        m.d.comb += clear.fb_info.eq(fb_info_pix)
+
+        # Tile caches: written back once the fragment back end has run dry or a marker
+        # waits for them, so the pipeline only reports ready (and a marker only leaves
+        # it) with everything in memory. Dropped before memory written around them (by
+        # clears or the host) can be accessed again.
+        fragments_drained = Signal()
+        m.d.comb += fragments_drained.eq(Cat(fragment_processing_ready_[:-1]).all())
+        for cache, r_stream in [
+            (ds_cache, fifo_tex_ds.r_stream),
+            (color_cache, fifo_ds_sc.r_stream),
+        ]:
+            marker_waiting = (
+                r_stream.valid & StreamTag(r_stream.payload[-tag_width:]).marker
+            )
+            m.d.comb += [
+                cache.flush.eq((fragments_drained | marker_waiting) & ~cache.clean),
+                cache.invalidate.eq(rast_marker | clear.start),
+            ]
+
+        # Texture cache: textures may have been rewritten by the host before any draw
+        m.d.comb += tex_cache.invalidate.eq(tex_marker)
+
+        # Hierarchical Z: reset by depth clears, refined by DepthStencilTest,
+        # consulted by the rasterizer
+        m.submodules.hiz_enable_cdc = FFSynchronizer(
+            self.c_hiz_enable, hiz.c_enable, o_domain="pixel"
+        )
         m.d.comb += [
-            rast.fb_info.eq(fb_info_pix),
-            ds.fb_info.eq(fb_info_pix),
-            sc.fb_info.eq(fb_info_pix),
+            hiz.clear_start.eq(clear.hiz_clear_start),
+            hiz.clear.eq(clear.hiz_clear),
+            clear.hiz_busy.eq(hiz.busy),
+            hiz.update.eq(ds.hiz_update),
+            ds.hiz_buffer.eq(hiz.buffer),
+            hiz.query.eq(rast.hiz_query),
+            rast.hiz_bound.eq(hiz.bound),
+            rast.hiz_buffer.eq(hiz.buffer),
         ]
 
-        m.submodules.stencil_conf_front_cdc = FFSynchronizer(
-            self.stencil_conf_front.as_value(), ds.stencil_conf_front, o_domain="pixel"
+        # Performance counters: stage counters and events counted here, per domain
+        perf_sources = {"sync": [], "pixel": []}
+
+        def perf_counter(domain, field, value):
+            perf_sources[domain].append((field, value))
+
+        def perf_event(domain, field, event):
+            counter = Signal(32, name=f"perf_{domain}_{len(perf_sources[domain])}")
+            m.d[domain] += counter.eq(counter + event)
+            perf_counter(domain, field, counter)
+
+        perf = self.perf
+        perf_counter(
+            "sync",
+            perf.triangles_in,
+            (
+                clip.trivial_accepts
+                + clip.guard_band_accepts
+                + clip.clipped
+                + clip.trivial_rejects
+                + cull.culled
+            )[:32],
         )
-        m.submodules.stencil_conf_back_cdc = FFSynchronizer(
-            self.stencil_conf_back.as_value(), ds.stencil_conf_back, o_domain="pixel"
+        perf_counter("sync", perf.triangles_clipped, clip.clipped)
+        perf_counter(
+            "sync",
+            perf.triangles_culled,
+            (cull.culled + clip.trivial_rejects + tri_prep.culled)[:32],
         )
-        m.submodules.depth_conf_cdc = FFSynchronizer(
-            self.depth_conf.as_value(), ds.depth_conf, o_domain="pixel"
+        perf_event("pixel", perf.triangles_rasterized, rast.i.valid & rast.i.ready)
+        perf_counter("pixel", perf.hiz_tile_rejects, rast.hiz_rejects)
+        perf_counter("pixel", perf.coarse_block_rejects, rast.coarse_rejects)
+        perf_event("pixel", perf.fragments_generated, rast.o.valid & rast.o.ready)
+        perf_counter("pixel", perf.fragments_early_z_rejected, rast.early_z_rejects)
+        perf_counter("pixel", perf.fragments_stencil_failed, ds.stencil_fails)
+        perf_counter("pixel", perf.fragments_depth_failed, ds.depth_fails)
+        perf_event("pixel", perf.fragments_written, sc.i.valid & sc.i.ready)
+
+        perf_fifo_domains = {
+            "idx_to_topo": (fifo_idx_topo, "sync"),
+            "idx_to_topo_draws": (fifo_idx_topo_draws, "sync"),
+            "topo_to_ia": (fifo_topo_ia, "sync"),
+            "vc_to_ia": (fifo_vc_ia, "sync"),
+            "vc_tickets": (fifo_vc_tickets, "sync"),
+            "ia_to_vtx_xf": (fifo_ia_vtx_xf, "sync"),
+            "vtx_xf_to_cull": (fifo_vtx_xf_cull, "sync"),
+            "cull_to_vtx_sh": (fifo_cull_vtx_sh, "sync"),
+            "cull_tickets": (fifo_cull_tickets, "sync"),
+            "vtx_sh_to_clip": (fifo_vtx_sh_clip, "sync"),
+            "vc_to_clip": (fifo_vc_clip, "sync"),
+            "clip_to_div": (fifo_clip_div, "sync"),
+            "div_to_tri_prep": (fifo_div_tri_prep, "sync"),
+            "tri_prep_to_rast": (fifo_tri_prep_rast, "pixel"),
+            "rast_to_tex": (fifo_rast_tex, "pixel"),
+            "tex_to_ds": (fifo_tex_ds, "pixel"),
+            "ds_to_sc": (fifo_ds_sc, "pixel"),
+        }
+        for name in perf_fifos:
+            fifo_, domain = perf_fifo_domains[name]
+            r = fifo_.r_stream
+            perf_event(domain, perf.fifo[name].stall, r.valid & ~r.ready)
+            perf_event(domain, perf.fifo[name].starve, ~r.valid & r.ready)
+
+        perf_bus_domains = {
+            "index": (self.wb_index, "sync"),
+            "vertex": (self.wb_vertex, "sync"),
+            "depthstencil": (self.wb_depthstencil, "pixel"),
+            "color": (self.wb_color, "pixel"),
+        }
+        for name in perf_buses:
+            bus, domain = perf_bus_domains[name]
+            request = bus.cyc & bus.stb
+            counters = perf.bus[name]
+            perf_event(domain, counters.read_beats, request & bus.ack & ~bus.we)
+            perf_event(domain, counters.write_beats, request & bus.ack & bus.we)
+            perf_event(domain, counters.wait_cycles, request & ~bus.ack)
+
+        for name, cache in [
+            ("depthstencil", ds_cache),
+            ("color", color_cache),
+            ("texture", tex_cache),
+        ]:
+            perf_counter("pixel", perf.cache[name].lookups, cache.lookups)
+            perf_counter("pixel", perf.cache[name].misses, cache.misses)
+
+        m.submodules.perf_sync = perf_sync = CounterSnapshot(len(perf_sources["sync"]))
+        m.submodules.perf_pixel = perf_pixel = DomainRenamer("pixel")(
+            CounterSnapshot(len(perf_sources["pixel"]))
         )
-        m.submodules.blend_conf_cdc = FFSynchronizer(
-            self.blend_conf.as_value(), sc.conf, o_domain="pixel"
+        m.d.comb += [
+            perf_sync.snapshot.eq(self.perf_snapshot),
+            perf_sync.reset.eq(self.perf_reset),
+        ]
+        for i, (field, value) in enumerate(perf_sources["sync"]):
+            m.d.comb += [perf_sync.counters[i].eq(value), field.eq(perf_sync.values[i])]
+
+        # The pixel snapshot is static by the time its acknowledge crosses back
+        m.submodules.perf_snapshot_cdc = perf_snapshot_cdc = PulseSynchronizer(
+            i_domain="sync", o_domain="pixel"
+        )
+        m.submodules.perf_reset_cdc = perf_reset_cdc = PulseSynchronizer(
+            i_domain="sync", o_domain="pixel"
         )
+        m.submodules.perf_done_cdc = perf_done_cdc = PulseSynchronizer(
+            i_domain="pixel", o_domain="sync"
+        )
+        perf_pixel_done = Signal()
+        perf_pixel_values = Signal.like(perf_pixel.values)
+        m.submodules.perf_values_cdc = FFSynchronizer(
+            perf_pixel.values.as_value(), perf_pixel_values, o_domain="sync"
+        )
+        m.d.comb += [
+            perf_snapshot_cdc.i.eq(self.perf_snapshot),
+            perf_reset_cdc.i.eq(self.perf_reset),
+            perf_pixel.snapshot.eq(perf_snapshot_cdc.o),
+            perf_pixel.reset.eq(perf_reset_cdc.o),
+            perf_done_cdc.i.eq(perf_pixel_done),
+        ]
+        m.d.pixel += perf_pixel_done.eq(perf_snapshot_cdc.o | perf_reset_cdc.o)
+        for i, (field, value) in enumerate(perf_sources["pixel"]):
+            m.d.comb += [
+                perf_pixel.counters[i].eq(value),
+                field.eq(perf_pixel_values[i]),
+            ]
+
+        with m.If(self.perf_snapshot | self.perf_reset):
+            m.d.sync += self.perf_pending.eq(1)
+        with m.Elif(perf_done_cdc.o):
+            m.d.sync += self.perf_pending.eq(0)
 
         return m
 
 
 class GraphicsPipelineCSR(wiring.Component):
-    """Graphics pipeline with CSR interface exposing configuration registers."""
+    """Graphics pipeline with CSR interface exposing configuration registers.
+
+    Registers can be written either directly by the host or by the CommandProcessor,
+    which replays packets from a ring buffer in memory (``cmd`` cluster). The command
+    processor shares the index memory bus with the IndexGenerator.
+
+    Every accepted draw or clear start increments ``fence.issued``. ``fence.retired``
+    follows one draw at a time, as the marker behind a draw leaves the back end (the
+    last draw once the pipeline is ready) or a clear finishes. ``irq`` is raised for
+    enabled bits of ``irq.status`` (write 1 to clear):
+      bits 0-3 : stage k (together with all stages before it) became ready
+      bit  4   : ``fence.retired`` advanced
+
+    Writing 1 to ``perf.snapshot`` latches the performance counters (``perf.reset``
+    restarts them from zero), they can be read once ``perf.pending`` is 0.
+    """
 
     ready: Out(1)
+    irq: Out(1)
 
     wb_index: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
     wb_vertex: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
     wb_depthstencil: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
     wb_color: Out(
-        wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width)
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
     )
 
     wb_csr: In(wb.Signature(addr_width=10, data_width=32, granularity=32))
 
+    def __init__(self, retire_holdoff: int = 4):
+        # ready signals lag behind a freshly issued start by a few cycles
+        self._retire_holdoff = retire_holdoff
+        super().__init__()
+
     def elaborate(self, platform):
         m = Module()
 
         m.submodules.pipeline = pipeline = GraphicsPipeline()
+        m.submodules.cmd = cmd = CommandProcessor(csr_addr_width=10)
 
         bld = csr.Builder(addr_width=10, data_width=32)
 
         class RWReg(csr.Register):
-            def __init__(self, field_shape):
+            def __init__(self, field_shape, init=0):
                 super().__init__(
-                    csr.Field(csr.action.RW, Shape.cast(field_shape)), "rw"
+                    csr.Field(csr.action.RW, Shape.cast(field_shape), init=init), "rw"
                 )
 
         with bld.Cluster("idx"):
@@ -480,13 +1249,6 @@ class GraphicsPipelineCSR(wiring.Component):
 
             ia_pos_mode, ia_pos_info = add_attr_cluster("pos", pipeline.c_pos)
             ia_norm_mode, ia_norm_info = add_attr_cluster("norm", pipeline.c_norm)
-            ia_tex_mode = []
-            ia_tex_info = []
-            for i in range(num_textures):
-                with bld.Index(i):
-                    mode, info = add_attr_cluster("tex", pipeline.c_tex[i])
-                    ia_tex_mode.append(mode)
-                    ia_tex_info.append(info)
             ia_col_mode, ia_col_info = add_attr_cluster("col", pipeline.c_col)
 
             m.d.comb += [
@@ -497,11 +1259,6 @@ class GraphicsPipelineCSR(wiring.Component):
                 pipeline.c_col.mode.eq(ia_col_mode.f.data),
                 pipeline.c_col.info.eq(ia_col_info.f.data),
             ]
-            for i in range(num_textures):
-                m.d.comb += [
-                    pipeline.c_tex[i].mode.eq(ia_tex_mode[i].f.data),
-                    pipeline.c_tex[i].info.eq(ia_tex_info[i].f.data),
-                ]
 
         with bld.Cluster("vtx_xf"):
             vt_enabled = bld.add("enabled", RWReg(pipeline.vt_enabled.shape()))
@@ -518,23 +1275,12 @@ class GraphicsPipelineCSR(wiring.Component):
                 "normal_mv_inv_t",
                 RWReg(pipeline.normal_mv_inv_t.shape()),
             )
-            tex_xf_regs = []
-            for t in range(num_textures):
-                for i in range(len(pipeline.texture_transforms[t])):
-                    tex_xf_regs.append(
-                        bld.add(
-                            "texture_transform",
-                            RWReg(pipeline.texture_transforms[t].shape()),
-                        )
-                    )
             m.d.comb += [
                 pipeline.vt_enabled.eq(vt_enabled.f.data),
                 pipeline.position_mv.eq(pos_mv_regs.f.data),
                 pipeline.position_p.eq(pos_p_regs.f.data),
                 pipeline.normal_mv_inv_t.eq(norm_mv_regs.f.data),
             ]
-            for t in range(num_textures):
-                m.d.comb += pipeline.texture_transforms[t].eq(tex_xf_regs[t].f.data)
 
         with bld.Cluster("vtx_sh"):
             with bld.Cluster("material"):
@@ -706,33 +1452,312 @@ class GraphicsPipelineCSR(wiring.Component):
         ready_reg = bld.add(
             "ready", csr.Register(csr.Field(csr.action.R, unsigned(1)), "r")
         )
-        m.d.comb += ready_reg.f.r_data.eq(pipeline.ready)
 
         ready_components = bld.add(
             "ready_components", csr.Register(csr.Field(csr.action.R, unsigned(4)), "r")
         )
-        m.d.comb += ready_components.f.r_data.eq(pipeline.ready_components)
 
         ready_vec = bld.add(
             "ready_vec", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
         )
         m.d.comb += ready_vec.f.r_data.eq(pipeline.ready_vec)
 
+        with bld.Cluster("cmd"):
+            cmd_base = bld.add("base", RWReg(cmd.c_base.shape()))
+            cmd_size = bld.add("size", RWReg(cmd.c_size.shape()))
+            cmd_wptr = bld.add("wptr", RWReg(cmd.c_wptr.shape()))
+            cmd_rptr = bld.add(
+                "rptr", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+            )
+            cmd_enable = bld.add("enable", RWReg(cmd.enable.shape()))
+
+            m.d.comb += [
+                cmd.c_base.eq(cmd_base.f.data),
+                cmd.c_size.eq(cmd_size.f.data),
+                cmd.c_wptr.eq(cmd_wptr.f.data),
+                cmd.enable.eq(cmd_enable.f.data),
+                cmd_rptr.f.r_data.eq(cmd.rptr),
+            ]
+
+        # Stages are only reported ready once no queued commands are left, so host
+        # waits also cover draws that are still sitting in the command ring.
+        ready_components_gated = Signal(4)
+        m.d.comb += [
+            cmd.ready_components.eq(pipeline.ready_components),
+            ready_components_gated.eq(
+                pipeline.ready_components & cmd.ready.replicate(4)
+            ),
+            ready_reg.f.r_data.eq(pipeline.ready & cmd.ready),
+            ready_components.f.r_data.eq(ready_components_gated),
+        ]
+
+        with bld.Cluster("fence"):
+            fence_issued = bld.add(
+                "issued", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+            )
+            fence_retired = bld.add(
+                "retired", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+            )
+
+        issued = Signal(32)
+        retired = Signal(32)
+        retire_stb = Signal()
+        holdoff = Signal(range(self._retire_holdoff + 1))
+        unfinished = Signal()  # a draw is in flight behind the last retired marker
+        draw_done = Signal()
+
+        # clears are tracked like draws
+        with m.If(pipeline.draw_started | pipeline.clear_start):
+            m.d.sync += [
+                issued.eq(issued + pipeline.draw_started + pipeline.clear_start),
+                holdoff.eq(self._retire_holdoff),
+            ]
+        with m.Elif(holdoff != 0):
+            m.d.sync += holdoff.eq(holdoff - 1)
+
+        # the marker of a draw retires the one in front of it, the last draw has no
+        # marker behind it and retires once the pipeline is ready
+        with m.If(pipeline.marker_retired):
+            m.d.comb += draw_done.eq(unfinished)
+            m.d.sync += unfinished.eq(1)
+        with m.Elif(unfinished & pipeline.ready & (holdoff == 0)):
+            m.d.comb += draw_done.eq(1)
+            m.d.sync += unfinished.eq(0)
+
+        m.d.comb += retire_stb.eq(draw_done | pipeline.clear_done)
+        m.d.sync += retired.eq(retired + draw_done + pipeline.clear_done)
+
+        m.d.comb += [
+            fence_issued.f.r_data.eq(issued),
+            fence_retired.f.r_data.eq(retired),
+        ]
+
+        with bld.Cluster("irq"):
+            irq_enable = bld.add("enable", RWReg(unsigned(5)))
+            irq_status = bld.add(
+                "status", csr.Register(csr.Field(csr.action.RW1C, unsigned(5)), "rw")
+            )
+
+        stage_ready = Signal(4)
+        stage_ready_last = Signal(4)
+        m.d.comb += stage_ready.eq(
+            Cat(ready_components_gated[: k + 1].all() for k in range(4))
+        )
+        m.d.sync += stage_ready_last.eq(stage_ready)
+
+        m.d.comb += [
+            irq_status.f.set.eq(Cat(stage_ready & ~stage_ready_last, retire_stb)),
+            self.irq.eq((irq_status.f.data & irq_enable.f.data).any()),
+        ]
+
+        with bld.Cluster("clear"):
+            clear_flags = bld.add("flags", RWReg(ClearFlags))
+            clear_color = bld.add("color", RWReg(unsigned(32)))
+            clear_ds = bld.add("depthstencil", RWReg(unsigned(32)))
+            clear_start = bld.add(
+                "start", csr.Register(csr.Field(csr.action.W, 1), "w")
+            )
+
+            m.d.comb += [
+                pipeline.clear_conf.flags.eq(clear_flags.f.data),
+                pipeline.clear_conf.color.eq(clear_color.f.data),
+                pipeline.clear_conf.depthstencil.eq(clear_ds.f.data),
+                pipeline.clear_start.eq(clear_start.f.w_data & clear_start.f.w_stb),
+            ]
+
+        with bld.Cluster("multi_draw"):
+            multi_draw_count = bld.add("count", RWReg(unsigned(32)))
+            m.d.comb += pipeline.c_index_draw_count.eq(multi_draw_count.f.data)
+
+        with bld.Cluster("vtx_cache"):
+            vtx_cache_enable = bld.add("enable", RWReg(unsigned(1)))
+            vtx_cache_lookups = bld.add(
+                "lookups", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+            )
+            vtx_cache_hits = bld.add(
+                "hits", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+            )
+
+            m.d.comb += [
+                pipeline.c_vtx_cache_enable.eq(vtx_cache_enable.f.data),
+                vtx_cache_lookups.f.r_data.eq(pipeline.vtx_cache_lookups),
+                vtx_cache_hits.f.r_data.eq(pipeline.vtx_cache_hits),
+            ]
+
+        with bld.Cluster("clip"):
+            clip_guard_band = bld.add("guard_band", RWReg(unsigned(2)))
+            clip_trivial = bld.add(
+                "trivial_accepts",
+                csr.Register(csr.Field(csr.action.R, unsigned(32)), "r"),
+            )
+            clip_guard_band_acc = bld.add(
+                "guard_band_accepts",
+                csr.Register(csr.Field(csr.action.R, unsigned(32)), "r"),
+            )
+            clip_clipped = bld.add(
+                "clipped", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+            )
+
+            m.d.comb += [
+                pipeline.c_guard_band.eq(clip_guard_band.f.data),
+                clip_trivial.f.r_data.eq(pipeline.clip_trivial_accepts),
+                clip_guard_band_acc.f.r_data.eq(pipeline.clip_guard_band_accepts),
+                clip_clipped.f.r_data.eq(pipeline.clip_clipped),
+            ]
+
+        with bld.Cluster("hiz"):
+            hiz_enable = bld.add("enable", RWReg(unsigned(1)))
+            m.d.comb += pipeline.c_hiz_enable.eq(hiz_enable.f.data)
+
+        with bld.Cluster("perf"):
+            perf_snapshot = bld.add(
+                "snapshot", csr.Register(csr.Field(csr.action.W, 1), "w")
+            )
+            perf_reset = bld.add("reset", csr.Register(csr.Field(csr.action.W, 1), "w"))
+            perf_pending = bld.add(
+                "pending", csr.Register(csr.Field(csr.action.R, unsigned(1)), "r")
+            )
+            m.d.comb += [
+                pipeline.perf_snapshot.eq(
+                    perf_snapshot.f.w_data & perf_snapshot.f.w_stb
+                ),
+                pipeline.perf_reset.eq(perf_reset.f.w_data & perf_reset.f.w_stb),
+                perf_pending.f.r_data.eq(pipeline.perf_pending),
+            ]
+
+            def add_perf_counter(name, value):
+                reg = bld.add(
+                    name, csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+                )
+                m.d.comb += reg.f.r_data.eq(value)
+
+            perf = pipeline.perf
+            for name in [
+                "triangles_in",
+                "triangles_clipped",
+                "triangles_culled",
+                "triangles_rasterized",
+                "hiz_tile_rejects",
+                "coarse_block_rejects",
+                "fragments_generated",
+                "fragments_early_z_rejected",
+                "fragments_stencil_failed",
+                "fragments_depth_failed",
+                "fragments_written",
+            ]:
+                add_perf_counter(name, perf[name])
+
+            with bld.Cluster("fifo"):
+                for name in perf_fifos:
+                    with bld.Cluster(name):
+                        add_perf_counter("stall", perf.fifo[name].stall)
+                        add_perf_counter("starve", perf.fifo[name].starve)
+
+            with bld.Cluster("bus"):
+                for name in perf_buses:
+                    with bld.Cluster(name):
+                        add_perf_counter("read_beats", perf.bus[name].read_beats)
+                        add_perf_counter("write_beats", perf.bus[name].write_beats)
+                        add_perf_counter("wait_cycles", perf.bus[name].wait_cycles)
+
+            with bld.Cluster("cache"):
+                for name in ["depthstencil", "color", "texture"]:
+                    with bld.Cluster(name):
+                        add_perf_counter("lookups", perf.cache[name].lookups)
+                        add_perf_counter("misses", perf.cache[name].misses)
+
+        with bld.Cluster("lighting"):
+            # only light 0 after reset, as before the mask existed
+            light_enable = bld.add("enable", RWReg(unsigned(num_lights), init=1))
+            m.d.comb += pipeline.light_enable.eq(light_enable.f.data)
+
+        with bld.Cluster("fb_format"):
+            fb_color_format = bld.add(
+                "color", RWReg(pipeline.fb_info.color_format.shape())
+            )
+            fb_depthstencil_format = bld.add(
+                "depthstencil", RWReg(pipeline.fb_info.depthstencil_format.shape())
+            )
+            m.d.comb += [
+                pipeline.fb_info.color_format.eq(fb_color_format.f.data),
+                pipeline.fb_info.depthstencil_format.eq(fb_depthstencil_format.f.data),
+            ]
+
+        # Texture coordinate attributes and transforms, then the texture unit
+        with bld.Cluster("tex"):
+            for i in range(num_textures):
+                with bld.Cluster(f"{i}"):
+                    tex_mode, tex_info = add_attr_cluster("attr", pipeline.c_tex[i])
+                    tex_xf = bld.add(
+                        "transform", RWReg(pipeline.texture_transforms[i].shape())
+                    )
+                    m.d.comb += [
+                        pipeline.c_tex[i].mode.eq(tex_mode.f.data),
+                        pipeline.c_tex[i].info.eq(tex_info.f.data),
+                        pipeline.texture_transforms[i].eq(tex_xf.f.data),
+                    ]
+            tex_address = bld.add("address", RWReg(pipeline.tex_address.shape()))
+            tex_config = bld.add("config", RWReg(pipeline.tex_conf.shape()))
+            m.d.comb += [
+                pipeline.tex_address.eq(tex_address.f.data),
+                pipeline.tex_conf.eq(tex_config.f.data),
+            ]
+
+        with bld.Cluster("early_cull"):
+            early_cull_enable = bld.add("enable", RWReg(unsigned(1)))
+            early_culled = bld.add(
+                "culled", csr.Register(csr.Field(csr.action.R, unsigned(32)), "r")
+            )
+            m.d.comb += [
+                pipeline.c_early_cull_enable.eq(early_cull_enable.f.data),
+                early_culled.f.r_data.eq(pipeline.early_culled),
+            ]
+
         m.submodules.csr_bus = csr_bus = csr.Bridge(bld.as_memory_map())
         m.submodules.csr_bridge = csr_bridge = WishboneCSRBridge(
             csr_bus.bus, data_width=32
         )
 
-        wiring.connect(m, wiring.flipped(self.wb_csr), csr_bridge.wb_bus)
+        # Host and command processor share the CSR bus
+        host_csr = wb.Interface(
+            addr_width=10, data_width=32, granularity=32, path=("host_csr",)
+        )
+        m.d.comb += [
+            host_csr.cyc.eq(self.wb_csr.cyc),
+            host_csr.stb.eq(self.wb_csr.stb),
+            host_csr.we.eq(self.wb_csr.we),
+            host_csr.sel.eq(self.wb_csr.sel),
+            host_csr.adr.eq(self.wb_csr.adr),
+            host_csr.dat_w.eq(self.wb_csr.dat_w),
+            self.wb_csr.dat_r.eq(host_csr.dat_r),
+            self.wb_csr.ack.eq(host_csr.ack),
+        ]
+
+        m.submodules.csr_arbiter = csr_arbiter = wb.Arbiter(
+            addr_width=10, data_width=32, granularity=32
+        )
+        csr_arbiter.add(host_csr)
+        csr_arbiter.add(cmd.csr_bus)
+
+        wiring.connect(m, csr_arbiter.bus, csr_bridge.wb_bus)
         self.wb_csr.memory_map = csr_bridge.wb_bus.memory_map
 
-        wiring.connect(m, wiring.flipped(self.wb_index), pipeline.wb_index)
+        # Command fetch shares the index bus
+        m.submodules.index_arbiter = index_arbiter = wb.Arbiter(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+        index_arbiter.add(pipeline.wb_index)
+        index_arbiter.add(cmd.bus)
+
+        wiring.connect(m, wiring.flipped(self.wb_index), index_arbiter.bus)
         wiring.connect(m, wiring.flipped(self.wb_vertex), pipeline.wb_vertex)
         wiring.connect(
             m, wiring.flipped(self.wb_depthstencil), pipeline.wb_depthstencil
         )
         wiring.connect(m, wiring.flipped(self.wb_color), pipeline.wb_color)
-        m.d.comb += self.ready.eq(pipeline.ready)
+        m.d.comb += self.ready.eq(pipeline.ready & cmd.ready)
 
         return m
 
@@ -763,7 +1788,7 @@ class GraphicsPipelineAvalonCSR(wiring.Component):
 
         super().__init__(
             {
-                "ready": Out(1),
+                "irq": Out(1),
                 "avl_index": Out(self._bridge_index.avl_bus.signature),
                 "avl_vertex": Out(self._bridge_vertex.avl_bus.signature),
                 "avl_depthstencil": Out(self._bridge_depthstencil.avl_bus.signature),
@@ -798,8 +1823,8 @@ class GraphicsPipelineAvalonCSR(wiring.Component):
         # Connect CSR bus
         wiring.connect(m, bridge_csr.avl_bus, wiring.flipped(self.avl_csr))
 
-        # Connect ready signal
-        m.d.comb += self.ready.eq(pipeline.ready)
+        # Connect interrupt
+        m.d.comb += self.irq.eq(pipeline.irq)
 
         return m
 
@@ -839,6 +1864,11 @@ if __name__ == "__main__":
             {
                 "address": byte_addr,
                 "size": byte_size,
+                # plain storage registers can be mirrored by the host (writing
+                # back the same value has no effect), strobes and status cannot
+                "shadow": all(
+                    isinstance(action, csr.action.RW) for _, action in ri.resource
+                ),
             }
         )
 
@@ -5,12 +5,22 @@ from .cores import (
     BlendConfig,
     BlendFactor,
     BlendOp,
+    ClearConfig,
+    ClearFlags,
     DepthStencilTest,
     DepthTestConfig,
+    FastClear,
+    HierarchicalZ,
     StencilOp,
     StencilOpConfig,
     SwapchainOutput,
+    TextureCache,
+    TextureConfig,
+    TextureEnvMode,
+    TextureFilter,
+    TextureWrap,
     Texturing,
+    TileCache,
 )
 
 __all__ = [
@@ -21,7 +31,17 @@ __all__ = [
     "StencilOpConfig",
     "DepthTestConfig",
     "BlendConfig",
+    "ClearFlags",
+    "ClearConfig",
+    "TextureFilter",
+    "TextureWrap",
+    "TextureEnvMode",
+    "TextureConfig",
     "Texturing",
+    "TextureCache",
     "DepthStencilTest",
+    "HierarchicalZ",
     "SwapchainOutput",
+    "FastClear",
+    "TileCache",
 ]
@@ -11,7 +11,9 @@ Implements the fragment pipeline with memory access:
 import amaranth_soc.wishbone.bus as wb
 from amaranth import *
 from amaranth.lib import data, enum, stream, wiring
+from amaranth.lib.memory import Memory
 from amaranth.lib.wiring import In, Out
+from amaranth.utils import exact_log2
 
 from gpu.utils import fixed
 
@@ -20,8 +22,18 @@ from ..utils.layouts import (
     FramebufferInfoLayout,
     wb_bus_addr_width,
     wb_bus_data_width,
+    wb_bus_granularity,
+)
+from ..utils.transactron_utils import max_value
+from ..utils.types import (
+    ColorFormat,
+    CompareOp,
+    DepthStencilFormat,
+    FixedPoint,
+    address_shape,
+    stride_shape,
+    texture_coord_shape,
 )
-from ..utils.types import CompareOp
 
 one = fixed.Const(1.0)
 zero = fixed.Const(0.0)
@@ -67,6 +79,29 @@ class BlendFactor(enum.Enum, shape=unsigned(4)):
     ONE_MINUS_DST_ALPHA = 9
 
 
+class TextureFilter(enum.Enum, shape=unsigned(1)):
+    """Texture filters (used for both minification and magnification)"""
+
+    NEAREST = 0
+    LINEAR = 1
+
+
+class TextureWrap(enum.Enum, shape=unsigned(1)):
+    """Texture coordinate wrap modes"""
+
+    REPEAT = 0
+    CLAMP_TO_EDGE = 1
+
+
+class TextureEnvMode(enum.Enum, shape=unsigned(2)):
+    """Texture environment functions (combining the texel with the fragment)"""
+
+    MODULATE = 0
+    REPLACE = 1
+    DECAL = 2
+    ADD = 3
+
+
 class StencilOpConfig(data.Struct):
     """Stencil operation configuration"""
 
@@ -104,28 +139,474 @@ class BlendConfig(data.Struct):
     _2: 4
 
 
+class TextureConfig(data.Struct):
+    """Texture unit configuration"""
+
+    enabled: 1
+    filter: TextureFilter
+    wrap_s: TextureWrap
+    wrap_t: TextureWrap
+    env_mode: TextureEnvMode
+    _1: 2
+    width_log2: 4
+    height_log2: 4
+
+
+class ClearFlags(data.Struct):
+    """Which parts of the framebuffer a clear writes"""
+
+    color_enable: 1
+    depth_enable: 1
+    stencil_mask: 8  # stencil bits to overwrite (0 keeps the stencil)
+    _1: 6
+
+
+class ClearConfig(data.Struct):
+    """Fast clear configuration"""
+
+    flags: ClearFlags
+    # as stored in memory, 16-bit formats in the low half
+    color: unsigned(32)
+    depthstencil: unsigned(32)
+
+
+# Hierarchical Z tiles are hiz_tile_size x hiz_tile_size pixels
+hiz_tile_size = 8
+hiz_tile_coord_shape = unsigned(texture_coord_shape.width - 3)
+
+
+class HiZTile(data.Struct):
+    """Hierarchical Z entry: upper bound of the tile's depth and its refinement"""
+
+    coverage: hiz_tile_size * hiz_tile_size  # pixels reported since the last refinement
+    zmax: 8  # every stored depth is <= zmax * 256 + 255
+    zrun: 8  # same bound for the covered pixels only
+
+
+class HiZBuffer(data.Struct):
+    """Depth/stencil buffer tracked by the hierarchical Z"""
+
+    valid: 1
+    address: address_shape
+    pitch: stride_shape
+
+
+class HiZClear(data.Struct):
+    """Depth clear of a rectangle (inclusive start, exclusive end)"""
+
+    x0: texture_coord_shape
+    y0: texture_coord_shape
+    x1: unsigned(texture_coord_shape.width + 1)
+    y1: unsigned(texture_coord_shape.width + 1)
+    depth: unsigned(16)
+    address: address_shape
+    pitch: stride_shape
+
+
+class HiZUpdate(data.Struct):
+    """Depth stored for a pixel, reported by DepthStencilTest"""
+
+    valid: 1
+    x: texture_coord_shape
+    y: texture_coord_shape
+    depth: unsigned(16)
+
+
+class HiZQuery(data.Struct):
+    tx: hiz_tile_coord_shape
+    ty: hiz_tile_coord_shape
+
+
+class HierarchicalZ(wiring.Component):
+    """On-chip per-tile upper bounds of the depth buffer.
+
+    A tile's bound is set by a depth fast clear (``clear_start``, which also selects
+    the tracked ``buffer``) and only lowered once every pixel of the tile has been
+    reported since the last refinement: the bound becomes the maximum reported
+    depth. Reports (``update``, one per fragment leaving DepthStencilTest) that
+    exceed the bound raise it, so it always holds for the stored depths.
+
+    ``query`` returns the bound of a tile one cycle later, 0xFFFF (unknown) for
+    tiles outside of ``max_width`` x ``max_height`` or while nothing is tracked.
+    With ``c_enable`` low nothing is tracked; enabling it takes effect at the next
+    depth clear. The depth buffer must not be written by the host while tracked.
+    """
+
+    c_enable: In(1)
+
+    clear_start: In(1)
+    clear: In(HiZClear)
+    busy: Out(1)
+    buffer: Out(HiZBuffer)
+
+    update: In(HiZUpdate)
+
+    query: In(HiZQuery)
+    bound: Out(unsigned(16))
+
+    def __init__(self, max_width: int = 640, max_height: int = 480):
+        super().__init__()
+        self._tiles_x = (max_width + hiz_tile_size - 1) // hiz_tile_size
+        self._tiles_y = (max_height + hiz_tile_size - 1) // hiz_tile_size
+
+    def elaborate(self, platform):
+        m = Module()
+
+        tiles_x = self._tiles_x
+        tiles_y = self._tiles_y
+        tile_count = tiles_x * tiles_y
+        tile_bits = hiz_tile_size.bit_length() - 1
+
+        unknown = {"zmax": 0xFF}
+        m.submodules.storage = storage = Memory(
+            shape=HiZTile, depth=tile_count, init=[unknown] * tile_count
+        )
+        wr = storage.write_port()
+        rd = storage.read_port(transparent_for=(wr,))
+        q_rd = storage.read_port()
+
+        with m.If(~self.c_enable):
+            m.d.sync += self.buffer.valid.eq(0)
+
+        # Query
+        q_known = Signal()
+        m.d.comb += q_rd.addr.eq(self.query.ty * tiles_x + self.query.tx)
+        m.d.sync += q_known.eq(
+            self.buffer.valid & (self.query.tx < tiles_x) & (self.query.ty < tiles_y)
+        )
+        m.d.comb += self.bound.eq(
+            Mux(q_known, Cat(C(0xFF, 8), q_rd.data.zmax), 0xFFFF)
+        )
+
+        # Read-modify-write of one tile per cycle, for reports and clears
+        p_valid = Signal()
+        p_clear = Signal()
+        p_index = Signal(range(tile_count))
+        p_pixel = Signal(range(hiz_tile_size * hiz_tile_size))
+        p_depth = Signal(8)
+        p_inside = Signal()
+        p_overlap = Signal()
+
+        clear = Signal.like(self.clear)
+        same_buffer = Signal()
+        sweep_tx = Signal(range(tiles_x))
+        sweep_ty = Signal(range(tiles_y))
+        sweep_index = Signal(range(tile_count))
+
+        m.d.sync += p_valid.eq(0)
+
+        with m.FSM():
+            with m.State("IDLE"):
+                upd = self.update
+                in_range = ((upd.x >> tile_bits) < tiles_x) & (
+                    (upd.y >> tile_bits) < tiles_y
+                )
+                index = (upd.y >> tile_bits) * tiles_x + (upd.x >> tile_bits)
+                with m.If(upd.valid & self.buffer.valid & in_range):
+                    m.d.comb += rd.addr.eq(index)
+                    m.d.sync += [
+                        p_valid.eq(1),
+                        p_clear.eq(0),
+                        p_index.eq(index),
+                        p_pixel.eq(Cat(upd.x[:tile_bits], upd.y[:tile_bits])),
+                        p_depth.eq(upd.depth[8:]),
+                    ]
+
+                with m.If(self.clear_start):
+                    m.d.sync += [
+                        clear.eq(self.clear),
+                        same_buffer.eq(
+                            self.buffer.valid
+                            & (self.buffer.address == self.clear.address)
+                            & (self.buffer.pitch == self.clear.pitch)
+                        ),
+                        self.buffer.valid.eq(self.c_enable),
+                        self.buffer.address.eq(self.clear.address),
+                        self.buffer.pitch.eq(self.clear.pitch),
+                        sweep_tx.eq(0),
+                        sweep_ty.eq(0),
+                        sweep_index.eq(0),
+                    ]
+                    m.next = "SWEEP"
+
+            with m.State("SWEEP"):
+                m.d.comb += self.busy.eq(1)
+
+                tile_x0 = sweep_tx << tile_bits
+                tile_y0 = sweep_ty << tile_bits
+                tile_x1 = tile_x0 + hiz_tile_size
+                tile_y1 = tile_y0 + hiz_tile_size
+
+                m.d.comb += rd.addr.eq(sweep_index)
+                m.d.sync += [
+                    p_valid.eq(1),
+                    p_clear.eq(1),
+                    p_index.eq(sweep_index),
+                    p_depth.eq(clear.depth[8:]),
+                    p_inside.eq(
+                        (clear.x0 <= tile_x0)
+                        & (tile_x1 <= clear.x1)
+                        & (clear.y0 <= tile_y0)
+                        & (tile_y1 <= clear.y1)
+                    ),
+                    p_overlap.eq(
+                        (tile_x0 < clear.x1)
+                        & (clear.x0 < tile_x1)
+                        & (tile_y0 < clear.y1)
+                        & (clear.y0 < tile_y1)
+                    ),
+                    sweep_index.eq(sweep_index + 1),
+                ]
+
+                with m.If(sweep_tx != tiles_x - 1):
+                    m.d.sync += sweep_tx.eq(sweep_tx + 1)
+                with m.Elif(sweep_ty != tiles_y - 1):
+                    m.d.sync += [sweep_tx.eq(0), sweep_ty.eq(sweep_ty + 1)]
+                with m.Else():
+                    m.next = "SWEEP_LAST"
+
+            with m.State("SWEEP_LAST"):
+                m.d.comb += self.busy.eq(1)
+                m.next = "IDLE"
+
+        old = rd.data
+        new = Signal(HiZTile)
+        coverage = Signal.like(old.coverage)
+        zrun = Signal(8)
+        zmax = Signal(8)
+
+        with m.If(p_clear):
+            with m.If(p_inside):
+                m.d.comb += new.zmax.eq(p_depth)
+            with m.Elif(p_overlap & same_buffer):
+                m.d.comb += new.zmax.eq(max_value(old.zmax, p_depth))
+            with m.Elif(same_buffer):
+                m.d.comb += new.eq(old)
+            with m.Else():
+                m.d.comb += new.zmax.eq(0xFF)
+        with m.Else():
+            m.d.comb += [
+                coverage.eq(old.coverage | (C(1, len(coverage)) << p_pixel)),
+                zrun.eq(
+                    Mux(old.coverage.any(), max_value(old.zrun, p_depth), p_depth)
+                ),
+                zmax.eq(max_value(old.zmax, p_depth)),
+            ]
+            with m.If(coverage.all()):
+                # every pixel was reported: the refined bound replaces the old one
+                m.d.comb += new.zmax.eq(zrun)
+            with m.Else():
+                m.d.comb += [
+                    new.coverage.eq(coverage),
+                    new.zrun.eq(zrun),
+                    new.zmax.eq(zmax),
+                ]
+
+        m.d.comb += [
+            wr.en.eq(p_valid),
+            wr.addr.eq(p_index),
+            wr.data.eq(new),
+        ]
+
+        return m
+
+
+# Textures are stored in texture_tile_size x texture_tile_size texel tiles
+texture_tile_size = 4
+
+
 class Texturing(wiring.Component):
     """Texture fetch and filtering unit.
 
-    Currently a stub that just passes through the fragment data,
-    dropping texture coordinates.
+    Samples the texture at (s, t) of the fragment (r and q are not used) and
+    combines the texel with the fragment color as selected by ``conf.env_mode``.
+
+    Textures are B8G8R8A8 with power-of-two sizes. They are stored in 4x4 texel
+    tiles of 16 consecutive words, the tiles in row-major order from ``address``
+    (64-byte aligned), so the 2x2 footprint of bilinear filtering usually lies in
+    a single line of the texture cache behind ``bus``.
+
+    LINEAR filtering reads the texels of the footprint one by one, skipping the
+    ones without weight; NEAREST reads a single texel. Fragments just pass through
+    while texturing is disabled.
     """
 
-    def __init__(self):
-        super().__init__(
-            {
-                "i": In(stream.Signature(FragmentLayout)),
-                "o": Out(stream.Signature(FragmentLayout)),
-                "ready": Out(1),
-            }
-        )
+    i: In(stream.Signature(FragmentLayout))
+    o: Out(stream.Signature(FragmentLayout))
+
+    conf: In(TextureConfig)
+    address: In(address_shape)
+    bus: Out(wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width))
+
+    ready: Out(1)
 
     def elaborate(self, platform):
         m = Module()
 
-        m.d.comb += self.ready.eq(1)
+        conf = self.conf
+        tile_bits = exact_log2(texture_tile_size)
+        f_bits = FixedPoint.f_bits
+        frac_bits = 8  # of the filter weights
+        linear = conf.filter == TextureFilter.LINEAR
+
+        frag = Signal.like(self.i.payload)
+
+        # footprint: texel columns and rows, weights of the second column and row
+        x = Signal(data.ArrayLayout(texture_coord_shape, 2))
+        y = Signal(data.ArrayLayout(texture_coord_shape, 2))
+        fx = Signal(frac_bits)
+        fy = Signal(frac_bits)
+
+        def footprint(coord, size_log2, wrap, pos, frac):
+            u = Signal(signed(len(coord.as_value()) + 2 ** len(size_log2) - 1))
+            last = Signal(texture_coord_shape)
+            m.d.comb += [
+                # texel centers are at +0.5
+                u.eq(
+                    (coord.as_value() << size_log2)
+                    - Mux(linear, 1 << (f_bits - 1), 0)
+                ),
+                last.eq((C(1) << size_log2) - 1),
+            ]
+            for k in range(2):
+                texel = Signal(signed(len(u) - f_bits + 1))
+                m.d.comb += texel.eq((u >> f_bits) + k)
+                with m.If(wrap == TextureWrap.REPEAT):
+                    m.d.sync += pos[k].eq(texel[: len(last)] & last)
+                with m.Elif(texel < 0):
+                    m.d.sync += pos[k].eq(0)
+                with m.Elif(texel > last):
+                    m.d.sync += pos[k].eq(last)
+                with m.Else():
+                    m.d.sync += pos[k].eq(texel)
+            m.d.sync += frac.eq(Mux(linear, u[f_bits - frac_bits : f_bits], 0))
+
+        # texel of the footprint being read, bit 0 selects the column, bit 1 the row
+        tap = Signal(2)
+        next_tap = Signal(2)
+        last_tap = Signal()
+        with m.Switch(tap):
+            with m.Case(0):
+                m.d.comb += [
+                    next_tap.eq(Mux(fx != 0, 1, 2)),
+                    last_tap.eq((fx == 0) & (fy == 0)),
+                ]
+            with m.Case(1):
+                m.d.comb += [next_tap.eq(2), last_tap.eq(fy == 0)]
+            with m.Case(2):
+                m.d.comb += [next_tap.eq(3), last_tap.eq(fx == 0)]
+            with m.Case(3):
+                m.d.comb += last_tap.eq(1)
+
+        tx = Mux(tap[0], x[1], x[0])
+        ty = Mux(tap[1], y[1], y[0])
+        row_shift = Signal(4)  # log2 of the tiles in a row
+        tile = Signal(2 * (texture_coord_shape.width - tile_bits))
+        texel_addr = Signal(wb_bus_addr_width)
+        m.d.comb += [
+            row_shift.eq(
+                Mux(conf.width_log2 > tile_bits, conf.width_log2 - tile_bits, 0)
+            ),
+            tile.eq(((ty >> tile_bits) << row_shift) | (tx >> tile_bits)),
+            texel_addr.eq(
+                self.address[2:] + Cat(tx[:tile_bits], ty[:tile_bits], tile)
+            ),
+        ]
+
+        weight = Signal(2 * frac_bits + 1)
+        m.d.comb += weight.eq(
+            Mux(tap[0], fx, (1 << frac_bits) - fx)
+            * Mux(tap[1], fy, (1 << frac_bits) - fy)
+        )
+
+        # sum of texel components * weight, the weights add up to 1 << 2 * frac_bits
+        acc = Signal(data.ArrayLayout(unsigned(8 + 2 * frac_bits), 4))
+
+        color_shape = fixed.UQ(0, 9)
+        tex_color = Signal(data.ArrayLayout(color_shape, 4))
+        frag_color = Signal(data.ArrayLayout(color_shape, 4))
+        m.d.comb += [
+            # acc / (255 << 16) in 9 bits, with 1/255 ~ 257/65536
+            *[tex_color[i].eq((acc[i] + (acc[i] >> 8))[15:24]) for i in range(4)],
+            *[frag_color[i].eq(frag.color[i].saturate(color_shape)) for i in range(4)],
+        ]
+
+        # texture function: base + mul_a * mul_b per component
+        base = Signal(data.ArrayLayout(fixed.UQ(1, 9), 4))
+        mul_a = Signal(data.ArrayLayout(fixed.SQ(1, 9), 4))
+        mul_b = Signal(data.ArrayLayout(color_shape, 4))
+        result = Signal(data.ArrayLayout(color_shape, 4))
+        m.d.comb += [
+            result[i].eq((base[i] + mul_a[i] * mul_b[i]).saturate(color_shape))
+            for i in range(4)
+        ]
+
+        with m.FSM():
+            with m.State("IDLE"):
+                m.d.comb += self.ready.eq(1)
+                with m.If(conf.enabled):
+                    m.d.comb += self.i.ready.eq(1)
+                    with m.If(self.i.valid):
+                        m.d.sync += frag.eq(self.i.payload)
+                        m.next = "SETUP"
+                with m.Else():
+                    m.d.comb += [
+                        self.o.payload.eq(self.i.payload),
+                        self.o.valid.eq(self.i.valid),
+                        self.i.ready.eq(self.o.ready),
+                    ]
+
+            with m.State("SETUP"):
+                footprint(frag.texcoords[0][0], conf.width_log2, conf.wrap_s, x, fx)
+                footprint(frag.texcoords[0][1], conf.height_log2, conf.wrap_t, y, fy)
+                m.d.sync += [tap.eq(0), acc.eq(0)]
+                m.next = "FETCH"
 
-        wiring.connect(m, wiring.flipped(self.i), wiring.flipped(self.o))
+            with m.State("FETCH"):
+                m.d.comb += [
+                    self.bus.cyc.eq(1),
+                    self.bus.stb.eq(1),
+                    self.bus.adr.eq(texel_addr),
+                ]
+                with m.If(self.bus.ack):
+                    m.d.sync += [
+                        acc[i].eq(
+                            acc[i] + self.bus.dat_r.word_select(BGRA_MAP[i], 8) * weight
+                        )
+                        for i in range(4)
+                    ]
+                    m.d.sync += tap.eq(next_tap)
+                    with m.If(last_tap):
+                        m.next = "COMBINE"
+
+            with m.State("COMBINE"):
+                with m.Switch(conf.env_mode):
+                    with m.Case(TextureEnvMode.MODULATE):
+                        m.d.comb += [mul_a[i].eq(frag_color[i]) for i in range(4)]
+                        m.d.comb += [mul_b[i].eq(tex_color[i]) for i in range(4)]
+                    with m.Case(TextureEnvMode.REPLACE):
+                        m.d.comb += [base[i].eq(tex_color[i]) for i in range(4)]
+                    with m.Case(TextureEnvMode.DECAL):
+                        m.d.comb += [base[i].eq(frag_color[i]) for i in range(4)]
+                        m.d.comb += [
+                            mul_a[i].eq(tex_color[i] - frag_color[i]) for i in range(3)
+                        ]
+                        m.d.comb += [mul_b[i].eq(tex_color[3]) for i in range(3)]
+                    with m.Case(TextureEnvMode.ADD):
+                        m.d.comb += [
+                            base[i].eq(frag_color[i] + tex_color[i]) for i in range(3)
+                        ]
+                        m.d.comb += [
+                            mul_a[3].eq(frag_color[3]),
+                            mul_b[3].eq(tex_color[3]),
+                        ]
+                m.d.sync += [frag.color[i].eq(result[i]) for i in range(4)]
+                m.next = "OUTPUT"
+
+            with m.State("OUTPUT"):
+                m.d.comb += [self.o.payload.eq(frag), self.o.valid.eq(1)]
+                with m.If(self.o.ready):
+                    m.next = "IDLE"
 
         return m
 
@@ -155,9 +636,14 @@ class DepthStencilTest(wiring.Component):
                     wb.Signature(
                         addr_width=wb_bus_addr_width,
                         data_width=wb_bus_data_width,
+                        granularity=wb_bus_granularity,
                     )
                 ),
+                "hiz_buffer": In(HiZBuffer),
+                "hiz_update": Out(HiZUpdate),
                 "ready": Out(1),
+                "stencil_fails": Out(32),
+                "depth_fails": Out(32),  # of fragments passing the stencil test
             }
         )
 
@@ -166,8 +652,11 @@ class DepthStencilTest(wiring.Component):
 
         v = Signal.like(self.i.payload)
 
-        # Combined depth/stencil buffer (D16_X8_S8 format)
+        # Combined D16_X8_S8 buffer (a word per pixel) or D16 (two pixels per word,
+        # no stencil)
+        d16 = self.fb_info.depthstencil_format == DepthStencilFormat.D16
         depthstencil_addr = Signal(wb_bus_addr_width)
+        ds_high = Signal()  # D16 pixel in the upper half of the word
 
         stencil_value = Signal(unsigned(8))
         depth_value = Signal(unsigned(16))
@@ -183,13 +672,38 @@ class DepthStencilTest(wiring.Component):
         real_new_stencil_value = Signal(unsigned(8))
         new_depth_value = Signal(unsigned(16))
         new_depthstencil = Signal(unsigned(32))
-        m.d.comb += new_depthstencil.eq(
-            Cat(
-                new_depth_value,
-                Const(0, 8),  # padding
-                real_new_stencil_value,
-            )
+        new_depthstencil_sel = Signal(4)
+        ds_changed = Signal()
+        with m.If(d16):
+            m.d.comb += [
+                new_depthstencil.eq(Cat(new_depth_value, new_depth_value)),
+                new_depthstencil_sel.eq(Mux(ds_high, 0b1100, 0b0011)),
+                ds_changed.eq(new_depth_value != depth_value),
+            ]
+        with m.Else():
+            m.d.comb += [
+                new_depthstencil.eq(
+                    Cat(
+                        new_depth_value,
+                        Const(0, 8),  # padding
+                        real_new_stencil_value,
+                    )
+                ),
+                new_depthstencil_sel.eq(0b1111),
+                ds_changed.eq(new_depthstencil != depthstencil_data),
+            ]
+
+        # The depth stored for every fragment is reported to the hierarchical Z
+        hiz_tracked = (
+            self.hiz_buffer.valid
+            & (self.hiz_buffer.address == self.fb_info.depthstencil_address)
+            & (self.hiz_buffer.pitch == self.fb_info.depthstencil_pitch)
         )
+        m.d.comb += [
+            self.hiz_update.x.eq(v.coord_pos[0]),
+            self.hiz_update.y.eq(v.coord_pos[1]),
+            self.hiz_update.depth.eq(new_depth_value),
+        ]
 
         m.d.comb += s_conf.eq(
             Mux(v.front_facing, self.stencil_conf_front, self.stencil_conf_back)
@@ -223,11 +737,14 @@ class DepthStencilTest(wiring.Component):
                 depth_zero_one = v.depth.clamp(zero, one)
                 m.d.sync += d_frag.eq(((depth_zero_one << 16) - depth_zero_one).round())
 
-                m.d.sync += depthstencil_addr.eq(
-                    self.fb_info.depthstencil_address[2:]
-                    + v.coord_pos[0] * 1
-                    + v.coord_pos[1] * self.fb_info.depthstencil_pitch[2:]
-                )
+                m.d.sync += [
+                    depthstencil_addr.eq(
+                        self.fb_info.depthstencil_address[2:]
+                        + Mux(d16, v.coord_pos[0] >> 1, v.coord_pos[0])
+                        + v.coord_pos[1] * self.fb_info.depthstencil_pitch[2:]
+                    ),
+                    ds_high.eq(d16 & v.coord_pos[0][0]),
+                ]
 
                 m.d.sync += s_accepted.eq(0)
                 m.d.sync += d_accepted.eq(0)
@@ -247,13 +764,20 @@ class DepthStencilTest(wiring.Component):
                     m.d.sync += [
                         depthstencil_data.eq(self.wb_bus.dat_r),
                         # Extract: [15:0]=depth, [31:24]=stencil
-                        depth_value.eq(self.wb_bus.dat_r[0:16]),
-                        stencil_value.eq(self.wb_bus.dat_r[24:32]),
+                        depth_value.eq(
+                            Mux(
+                                ds_high,
+                                self.wb_bus.dat_r[16:32],
+                                self.wb_bus.dat_r[0:16],
+                            )
+                        ),
+                        stencil_value.eq(Mux(d16, 0, self.wb_bus.dat_r[24:32])),
                     ]
                     m.next = "CHECK_DEPTH_STENCIL"
 
             with m.State("CHECK_DEPTH_STENCIL"):
-                s_passed = perform_compare(
+                # without a stencil buffer the stencil test always passes
+                s_passed = d16 | perform_compare(
                     s_conf.compare_op,
                     stencil_value & s_conf.mask,
                     s_conf.reference & s_conf.mask,
@@ -355,20 +879,25 @@ class DepthStencilTest(wiring.Component):
                     ),
                 ]
 
-                with m.If(new_depthstencil != depthstencil_data):
+                with m.If(ds_changed):
                     m.d.comb += [
                         self.wb_bus.cyc.eq(1),
                         self.wb_bus.stb.eq(1),
                         self.wb_bus.adr.eq(depthstencil_addr),
                         self.wb_bus.we.eq(1),
                         self.wb_bus.dat_w.eq(new_depthstencil),
-                        self.wb_bus.sel.eq(~0),
+                        self.wb_bus.sel.eq(new_depthstencil_sel),
                     ]
                     m.d.comb += ready_send.eq(self.wb_bus.ack)
                 with m.Else():
                     m.d.comb += ready_send.eq(1)
 
                 with m.If(ready_send):
+                    m.d.comb += self.hiz_update.valid.eq(hiz_tracked)
+                    with m.If(~s_accepted):
+                        m.d.sync += self.stencil_fails.eq(self.stencil_fails + 1)
+                    with m.Elif(~d_accepted):
+                        m.d.sync += self.depth_fails.eq(self.depth_fails + 1)
                     with m.If(~s_accepted | ~d_accepted):
                         m.next = "IDLE"
                     with m.Else():
@@ -384,7 +913,12 @@ class DepthStencilTest(wiring.Component):
 
 
 class SwapchainOutput(wiring.Component):
-    """Perform blending and write final fragment to framebuffer memory."""
+    """Perform blending and write final fragment to framebuffer memory.
+
+    R5G6B5 pixels are half words, so they are written with byte selects. Their
+    destination is also read when the write mask splits the pixel's components;
+    they have no alpha, so it reads as 1.0.
+    """
 
     def __init__(self):
         super().__init__(
@@ -396,6 +930,7 @@ class SwapchainOutput(wiring.Component):
                     wb.Signature(
                         addr_width=wb_bus_addr_width,
                         data_width=wb_bus_data_width,
+                        granularity=wb_bus_granularity,
                     )
                 ),
                 "ready": Out(1),
@@ -423,6 +958,11 @@ class SwapchainOutput(wiring.Component):
 
         color_addr = Signal(wb_bus_addr_width)
 
+        rgb565 = self.fb_info.color_format == ColorFormat.R5G6B5
+        color_high = Signal()  # R5G6B5 pixel in the upper half of the word
+        dst_pixel = Signal(unsigned(16))  # R5G6B5 destination as stored
+        rgb_mask = self.conf.color_write_mask[0:3]
+
         src_rgb = src_data[0:3]
         src_a = src_data[3]
         dst_rgb = dst_data[0:3]
@@ -488,12 +1028,20 @@ class SwapchainOutput(wiring.Component):
                 m.d.sync += src_data.eq(in_data)
                 m.d.sync += [out_data[i].eq(in_data[i]) for i in range(4)]
 
-                m.d.sync += color_addr.eq(
-                    (self.fb_info.color_address[2:] + v.coord_pos[0])
-                    + (v.coord_pos[1] * self.fb_info.color_pitch[2:])
-                )
+                m.d.sync += [
+                    color_addr.eq(
+                        (
+                            self.fb_info.color_address[2:]
+                            + Mux(rgb565, v.coord_pos[0] >> 1, v.coord_pos[0])
+                        )
+                        + (v.coord_pos[1] * self.fb_info.color_pitch[2:])
+                    ),
+                    color_high.eq(rgb565 & v.coord_pos[0][0]),
+                ]
 
-                with m.If(self.conf.enabled):
+                with m.If(
+                    self.conf.enabled | (rgb565 & (rgb_mask != 0b111) & rgb_mask.any())
+                ):
                     m.next = "READ_DEST"
                 with m.Else():
                     m.next = "WRITE_OUTPUT"
@@ -512,14 +1060,32 @@ class SwapchainOutput(wiring.Component):
                         plain_dat[i].eq(self.wb_bus.dat_r.word_select(BGRA_MAP[i], 8))
                         for i in range(4)
                     ]
+                    pixel = Signal(unsigned(16))
+                    m.d.comb += pixel.eq(self.wb_bus.dat_r.word_select(color_high, 16))
+                    r5 = pixel[11:16]
+                    g6 = pixel[5:11]
+                    b5 = pixel[0:5]
                     assert color_shape.i_bits == 0
                     assert color_shape.f_bits == 9
-                    m.d.sync += [
-                        # approximate conversion from [0,255] to [0,1] fixed-point
-                        dst_data[i].eq(Cat(plain_dat[i][7], plain_dat[i]))
-                        for i in range(4)
-                    ]
-                    m.next = "CALC_FACTORS"
+                    with m.If(rgb565):
+                        # bit replication, as for the 8-bit components below
+                        m.d.sync += [
+                            dst_data[0].eq(Cat(r5[1:5], r5)),
+                            dst_data[1].eq(Cat(g6[3:6], g6)),
+                            dst_data[2].eq(Cat(b5[1:5], b5)),
+                            dst_data[3].eq(one),
+                            dst_pixel.eq(pixel),
+                        ]
+                    with m.Else():
+                        m.d.sync += [
+                            # approximate conversion from [0,255] to [0,1] fixed-point
+                            dst_data[i].eq(Cat(plain_dat[i][7], plain_dat[i]))
+                            for i in range(4)
+                        ]
+                    with m.If(self.conf.enabled):
+                        m.next = "CALC_FACTORS"
+                    with m.Else():
+                        m.next = "WRITE_OUTPUT"
 
             with m.State("CALC_FACTORS"):
                 m.d.sync += factor_src_rgb.eq(factor_value(self.conf.src_factor))
@@ -610,15 +1176,612 @@ class SwapchainOutput(wiring.Component):
                 m.d.comb += write_mask_swizzled.eq(
                     Cat(self.conf.color_write_mask[b] for b in BGRA_MAP)
                 )
+
+                # Convert to 5/6 bits (*31 or *63), masked components are kept
+                dst_rgb_565 = [dst_pixel[11:16], dst_pixel[5:11], dst_pixel[0:5]]
+                ret_565 = [Signal(len(c)) for c in dst_rgb_565]
+                m.d.comb += [
+                    ret_565[i].eq(
+                        Mux(
+                            rgb_mask[i],
+                            (
+                                (out_data_clamped[i] << len(c)) - out_data_clamped[i]
+                            ).round(),
+                            c,
+                        )
+                    )
+                    for i, c in enumerate(dst_rgb_565)
+                ]
+                pixel_565 = Cat(ret_565[2], ret_565[1], ret_565[0])
+
                 m.d.comb += [
                     self.wb_bus.cyc.eq(1),
                     self.wb_bus.adr.eq(color_addr),
                     self.wb_bus.we.eq(1),
                     self.wb_bus.stb.eq(1),
-                    self.wb_bus.sel.eq(write_mask_swizzled),
-                    self.wb_bus.dat_w.eq(Cat(ret_v)),
                 ]
+                with m.If(rgb565):
+                    m.d.comb += [
+                        self.wb_bus.sel.eq(
+                            Mux(rgb_mask.any(), Mux(color_high, 0b1100, 0b0011), 0)
+                        ),
+                        self.wb_bus.dat_w.eq(Cat(pixel_565, pixel_565)),
+                    ]
+                with m.Else():
+                    m.d.comb += [
+                        self.wb_bus.sel.eq(write_mask_swizzled),
+                        self.wb_bus.dat_w.eq(Cat(ret_v)),
+                    ]
                 with m.If(self.wb_bus.ack):
                     m.next = "IDLE"
 
         return m
+
+
+class FastClear(wiring.Component):
+    """Fill the scissor rectangle of the color and/or depth/stencil buffer.
+
+    Started by ``start``; the rectangle is the scissor clamped to the framebuffer.
+    One word is written per acknowledge on each bus, the color and depth/stencil
+    writes of a pixel run in parallel. Words are only read back when some of their
+    bits have to be preserved (depth kept, partial stencil mask, or the other pixel
+    of a 16-bit format word outside of the rectangle). 16-bit formats write a word
+    on every second pixel and on the last one of a row.
+
+    Depth clears also reset the hierarchical Z (``hiz_clear_start``), ``done``
+    waits until it has finished.
+
+    It must only be started when no fragments are in flight; ``done`` pulses once
+    the last word has been written.
+    """
+
+    def __init__(self):
+        super().__init__(
+            {
+                "start": In(1),
+                "conf": In(ClearConfig),
+                "fb_info": In(FramebufferInfoLayout),
+                "wb_color": Out(
+                    wb.Signature(
+                        addr_width=wb_bus_addr_width,
+                        data_width=wb_bus_data_width,
+                    )
+                ),
+                "wb_depthstencil": Out(
+                    wb.Signature(
+                        addr_width=wb_bus_addr_width,
+                        data_width=wb_bus_data_width,
+                    )
+                ),
+                "hiz_clear_start": Out(1),
+                "hiz_clear": Out(HiZClear),
+                "hiz_busy": In(1),
+                "ready": Out(1),
+                "done": Out(1),
+            }
+        )
+
+    def elaborate(self, platform):
+        m = Module()
+
+        conf = Signal.like(self.conf)
+
+        rgb565 = self.fb_info.color_format == ColorFormat.R5G6B5
+        d16 = self.fb_info.depthstencil_format == DepthStencilFormat.D16
+
+        # D16_X8_S8 bits to overwrite
+        ds_mask = Signal(32)
+        m.d.comb += ds_mask.eq(
+            Cat(
+                conf.flags.depth_enable.replicate(16),
+                Const(0, 8),
+                conf.flags.stencil_mask,
+            )
+        )
+        color_en = conf.flags.color_enable
+        ds_en = Mux(d16, conf.flags.depth_enable, ds_mask.any())
+        ds_rmw = ~conf.flags.depth_enable | (conf.flags.stencil_mask != 0xFF)
+
+        # Rectangle (inclusive start, exclusive end)
+        coord_shape = signed(34)
+        x0 = Signal(coord_shape)
+        x1 = Signal(coord_shape)
+        y1 = Signal(coord_shape)
+        x = Signal(coord_shape)
+        y = Signal(coord_shape)
+
+        color_row = Signal(wb_bus_addr_width)
+        ds_row = Signal(wb_bus_addr_width)
+
+        color_pitch = self.fb_info.color_pitch[2:]
+        ds_pitch = self.fb_info.depthstencil_pitch[2:]
+
+        # Halves of the word of a 16-bit pixel inside of the rectangle
+        word_end = x[0] | (x + 1 >= x1)
+        low_in = ~x[0] | (x > x0)
+        high_in = x[0]
+        half_mask = Cat(low_in.replicate(16), high_in.replicate(16))
+
+        def write_word(bus, issue, addr, mask, rmw, value):
+            """Writes ``value`` under ``mask``, returns whether the pixel is done."""
+            done = Signal()
+            have_old = Signal()
+            old = Signal(32)
+            finished = Signal()
+
+            with m.If(issue & ~done):
+                m.d.comb += [
+                    bus.cyc.eq(1),
+                    bus.stb.eq(1),
+                    bus.sel.eq(~0),
+                    bus.adr.eq(addr),
+                ]
+                with m.If(rmw & ~have_old):
+                    m.d.comb += bus.we.eq(0)
+                    with m.If(bus.ack):
+                        m.d.sync += [old.eq(bus.dat_r), have_old.eq(1)]
+                with m.Else():
+                    m.d.comb += [
+                        bus.we.eq(1),
+                        bus.dat_w.eq((Mux(rmw, old, 0) & ~mask) | (value & mask)),
+                        finished.eq(bus.ack),
+                    ]
+            with m.Else():
+                m.d.comb += finished.eq(1)
+
+            return done, have_old, finished
+
+        with m.FSM():
+            with m.State("IDLE"):
+                m.d.comb += self.ready.eq(~self.start)
+                with m.If(self.start):
+                    m.d.sync += conf.eq(self.conf)
+                    m.next = "SETUP"
+
+            with m.State("SETUP"):
+                sx = self.fb_info.scissor_offset_x
+                sy = self.fb_info.scissor_offset_y
+                ex = sx + self.fb_info.scissor_width
+                ey = sy + self.fb_info.scissor_height
+
+                start_x = Mux(sx < 0, 0, sx)
+                start_y = Mux(sy < 0, 0, sy)
+                end_x = Mux(ex > self.fb_info.width, self.fb_info.width, ex)
+                end_y = Mux(ey > self.fb_info.height, self.fb_info.height, ey)
+
+                empty = (end_x <= start_x) | (end_y <= start_y)
+
+                m.d.comb += [
+                    self.hiz_clear_start.eq(conf.flags.depth_enable),
+                    self.hiz_clear.x0.eq(Mux(empty, 0, start_x)),
+                    self.hiz_clear.y0.eq(Mux(empty, 0, start_y)),
+                    self.hiz_clear.x1.eq(Mux(empty, 0, end_x)),
+                    self.hiz_clear.y1.eq(Mux(empty, 0, end_y)),
+                    self.hiz_clear.depth.eq(conf.depthstencil[0:16]),
+                    self.hiz_clear.address.eq(self.fb_info.depthstencil_address),
+                    self.hiz_clear.pitch.eq(self.fb_info.depthstencil_pitch),
+                ]
+
+                m.d.sync += [
+                    x0.eq(start_x),
+                    x1.eq(end_x),
+                    y1.eq(end_y),
+                    x.eq(start_x),
+                    y.eq(start_y),
+                    color_row.eq(self.fb_info.color_address[2:] + start_y * color_pitch),
+                    ds_row.eq(
+                        self.fb_info.depthstencil_address[2:] + start_y * ds_pitch
+                    ),
+                ]
+
+                with m.If(empty):
+                    m.next = "FINISH"
+                with m.Else():
+                    m.next = "PIXEL"
+
+            with m.State("PIXEL"):
+                color_done, color_have_old, color_finished = write_word(
+                    self.wb_color,
+                    issue=color_en & (~rgb565 | word_end),
+                    addr=color_row + Mux(rgb565, x[1:], x),
+                    mask=Mux(rgb565, half_mask, 0xFFFFFFFF),
+                    rmw=rgb565 & ~(low_in & high_in),
+                    value=Mux(rgb565, conf.color[0:16].replicate(2), conf.color),
+                )
+                ds_done, ds_have_old, ds_finished = write_word(
+                    self.wb_depthstencil,
+                    issue=ds_en & (~d16 | word_end),
+                    addr=ds_row + Mux(d16, x[1:], x),
+                    mask=Mux(d16, half_mask, ds_mask),
+                    rmw=Mux(d16, ~(low_in & high_in), ds_rmw),
+                    value=Mux(
+                        d16, conf.depthstencil[0:16].replicate(2), conf.depthstencil
+                    ),
+                )
+
+                with m.If(color_finished & ds_finished):
+                    m.d.sync += [
+                        color_done.eq(0),
+                        color_have_old.eq(0),
+                        ds_done.eq(0),
+                        ds_have_old.eq(0),
+                    ]
+
+                    with m.If(x + 1 < x1):
+                        m.d.sync += x.eq(x + 1)
+                    with m.Elif(y + 1 < y1):
+                        m.d.sync += [
+                            x.eq(x0),
+                            y.eq(y + 1),
+                            color_row.eq(color_row + color_pitch),
+                            ds_row.eq(ds_row + ds_pitch),
+                        ]
+                    with m.Else():
+                        m.next = "FINISH"
+                with m.Else():
+                    with m.If(color_finished):
+                        m.d.sync += color_done.eq(1)
+                    with m.If(ds_finished):
+                        m.d.sync += ds_done.eq(1)
+
+            with m.State("FINISH"):
+                with m.If(~self.hiz_busy):
+                    m.d.comb += self.done.eq(1)
+                    m.next = "IDLE"
+
+        return m
+
+
+tile_cache_line_words = 8
+
+
+class TileCache(wiring.Component):
+    """Write-back cache in front of a framebuffer bus.
+
+    A line is 8 consecutive words, one row of an 8x8 tile (the rasterizer walks
+    triangles tile by tile); the default 16 lines hold two tiles. Misses replace
+    lines round-robin: a dirty victim is written back and the line is filled, both
+    as 8-beat wrap bursts on ``mem_bus`` which the Avalon bridge issues as single
+    bursts. Hits are answered one cycle after the request.
+
+    ``flush`` writes all dirty lines back, ``invalidate`` also drops every line.
+    Both are strobes, served between accesses. ``clean`` is high when no line is
+    dirty. Memory written around the cache (fast clears, the host) must not be
+    cached, so it has to be invalidated before such memory is accessed again.
+    Writes are byte-selected (16-bit pixels), lines are always moved whole.
+    """
+
+    bus: In(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            granularity=wb_bus_granularity,
+        )
+    )
+    mem_bus: Out(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+    )
+
+    flush: In(1)
+    invalidate: In(1)
+    clean: Out(1)
+
+    lookups: Out(32)
+    misses: Out(32)
+
+    def __init__(self, num_lines: int = 16):
+        if num_lines & (num_lines - 1):
+            raise ValueError(f"num_lines must be a power of 2, not {num_lines}")
+        super().__init__()
+        self._num_lines = num_lines
+
+    def elaborate(self, platform):
+        m = Module()
+
+        num_lines = self._num_lines
+        line_bits = exact_log2(tile_cache_line_words)
+        bus = self.bus
+        mem = self.mem_bus
+
+        valid = Signal(num_lines)
+        dirty = Signal(num_lines)
+        tags = Array(
+            Signal(wb_bus_addr_width - line_bits, name=f"tag{i}")
+            for i in range(num_lines)
+        )
+
+        m.submodules.storage = storage = Memory(
+            shape=unsigned(wb_bus_data_width),
+            depth=num_lines * tile_cache_line_words,
+            init=[],
+        )
+        if len(bus.sel) > 1:
+            wr = storage.write_port(granularity=wb_bus_data_width // len(bus.sel))
+        else:
+            wr = storage.write_port()
+        rd = storage.read_port()
+
+        req_word = bus.adr[:line_bits]
+        req_tag = bus.adr[line_bits:]
+
+        hit = Signal()
+        hit_line = Signal(range(num_lines))
+        for i in range(num_lines):
+            with m.If(valid[i] & (tags[i] == req_tag)):
+                m.d.comb += [hit.eq(1), hit_line.eq(i)]
+
+        victim = Signal(range(num_lines))  # next line to replace
+        line = Signal(range(num_lines))  # line being written back or filled
+        beat = Signal(line_bits)
+        last_beat = Signal()
+        fill = Signal()  # the write-back makes room for a fill
+
+        flush_pending = Signal()
+        invalidate_pending = Signal()
+        scan = Signal(range(num_lines))
+        scan_invalidate = Signal()
+
+        m.d.comb += [
+            last_beat.eq(beat == tile_cache_line_words - 1),
+            rd.addr.eq(Cat(req_word, hit_line)),
+            bus.dat_r.eq(rd.data),
+            mem.sel.eq(~0),
+            mem.dat_w.eq(rd.data),
+            mem.cti.eq(
+                Mux(last_beat, wb.CycleType.END_OF_BURST, wb.CycleType.INCR_BURST)
+            ),
+            mem.bte.eq(wb.BurstTypeExt.WRAP_8),
+            self.clean.eq(~dirty.any()),
+        ]
+
+        with m.FSM():
+            with m.State("IDLE"):
+                with m.If(flush_pending | invalidate_pending):
+                    m.d.sync += [
+                        scan.eq(0),
+                        scan_invalidate.eq(invalidate_pending),
+                        flush_pending.eq(0),
+                        invalidate_pending.eq(0),
+                    ]
+                    m.next = "SCAN"
+                with m.Elif(bus.cyc & bus.stb & hit):
+                    with m.If(bus.we):
+                        m.d.comb += [
+                            wr.addr.eq(Cat(req_word, hit_line)),
+                            wr.data.eq(bus.dat_w),
+                            wr.en.eq(bus.sel),
+                        ]
+                        m.d.sync += dirty.bit_select(hit_line, 1).eq(1)
+                    m.next = "ACK"
+                with m.Elif(bus.cyc & bus.stb):
+                    m.d.sync += [
+                        line.eq(victim),
+                        victim.eq(victim + 1),
+                        beat.eq(0),
+                        valid.bit_select(victim, 1).eq(0),
+                        self.misses.eq(self.misses + 1),
+                    ]
+                    with m.If(dirty.bit_select(victim, 1)):
+                        m.d.sync += fill.eq(1)
+                        m.next = "WRITE_BACK_START"
+                    with m.Else():
+                        m.next = "FILL"
+
+            with m.State("ACK"):
+                # read data of the address looked up in IDLE (held by the initiator)
+                m.d.comb += bus.ack.eq(1)
+                m.d.sync += self.lookups.eq(self.lookups + 1)
+                m.next = "IDLE"
+
+            with m.State("SCAN"):
+                with m.If(dirty.bit_select(scan, 1)):
+                    m.d.sync += [line.eq(scan), beat.eq(0), fill.eq(0)]
+                    m.next = "WRITE_BACK_START"
+                with m.Else():
+                    with m.If(scan_invalidate):
+                        m.d.sync += valid.bit_select(scan, 1).eq(0)
+                    m.d.sync += scan.eq(scan + 1)
+                    with m.If(scan == num_lines - 1):
+                        m.next = "IDLE"
+
+            with m.State("WRITE_BACK_START"):
+                m.d.comb += rd.addr.eq(Cat(beat, line))
+                m.next = "WRITE_BACK"
+
+            with m.State("WRITE_BACK"):
+                # rd.data always holds the word of the current beat
+                m.d.comb += [
+                    mem.cyc.eq(1),
+                    mem.stb.eq(1),
+                    mem.we.eq(1),
+                    mem.adr.eq(Cat(beat, tags[line])),
+                    rd.addr.eq(Cat(Mux(mem.ack, beat + 1, beat)[:line_bits], line)),
+                ]
+                with m.If(mem.ack):
+                    m.d.sync += beat.eq(beat + 1)
+                    with m.If(last_beat):
+                        m.d.sync += dirty.bit_select(line, 1).eq(0)
+                        with m.If(fill):
+                            m.next = "FILL"
+                        with m.Else():
+                            m.next = "SCAN"
+
+            with m.State("FILL"):
+                m.d.comb += [
+                    mem.cyc.eq(1),
+                    mem.stb.eq(1),
+                    mem.adr.eq(Cat(beat, req_tag)),
+                ]
+                with m.If(mem.ack):
+                    m.d.comb += [
+                        wr.addr.eq(Cat(beat, line)),
+                        wr.data.eq(mem.dat_r),
+                        wr.en.eq(~0),
+                    ]
+                    m.d.sync += beat.eq(beat + 1)
+                    with m.If(last_beat):
+                        m.d.sync += [
+                            tags[line].eq(req_tag),
+                            valid.bit_select(line, 1).eq(1),
+                        ]
+                        # the request hits now
+                        m.next = "IDLE"
+
+        with m.If(self.flush):
+            m.d.sync += flush_pending.eq(1)
+        with m.If(self.invalidate):
+            m.d.sync += invalidate_pending.eq(1)
+
+        return m
+
+
+texture_cache_line_words = texture_tile_size * texture_tile_size
+
+
+class TextureCache(wiring.Component):
+    """Read-only set-associative cache in front of the texture bus.
+
+    A line is one 4x4 texel tile (16 words); by default there are 8 sets of 2
+    ways, enough for the 4 tiles a bilinear footprint can touch. Lines map to sets
+    by the low bits of their address, so horizontally adjacent tiles share no set.
+    Misses replace a way of the set round-robin, filling it with a 16-beat wrap
+    burst on ``mem_bus``. Hits are answered one cycle after the request.
+
+    ``invalidate`` drops every line, it is a strobe served between accesses. The
+    host writes textures around the cache, so it has to be invalidated before a
+    draw that may read rewritten memory.
+    """
+
+    bus: In(wb.Signature(addr_width=wb_bus_addr_width, data_width=wb_bus_data_width))
+    mem_bus: Out(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+    )
+
+    invalidate: In(1)
+
+    lookups: Out(32)
+    misses: Out(32)
+
+    def __init__(self, num_sets: int = 8, num_ways: int = 2):
+        if num_sets & (num_sets - 1):
+            raise ValueError(f"num_sets must be a power of 2, not {num_sets}")
+        if num_ways & (num_ways - 1):
+            raise ValueError(f"num_ways must be a power of 2, not {num_ways}")
+        super().__init__()
+        self._num_sets = num_sets
+        self._num_ways = num_ways
+
+    def elaborate(self, platform):
+        m = Module()
+
+        num_sets = self._num_sets
+        num_ways = self._num_ways
+        num_lines = num_sets * num_ways
+        line_bits = exact_log2(texture_cache_line_words)
+        set_bits = exact_log2(num_sets)
+        way_bits = exact_log2(num_ways)
+        bus = self.bus
+        mem = self.mem_bus
+
+        # line i is way i % num_ways of set i // num_ways
+        valid = Signal(num_lines)
+        tags = Array(
+            Signal(wb_bus_addr_width - line_bits - set_bits, name=f"tag{i}")
+            for i in range(num_lines)
+        )
+        victims = Array(
+            Signal(range(num_ways), name=f"victim{i}") for i in range(num_sets)
+        )
+
+        m.submodules.storage = storage = Memory(
+            shape=unsigned(wb_bus_data_width),
+            depth=num_lines * texture_cache_line_words,
+            init=[],
+        )
+        wr = storage.write_port()
+        rd = storage.read_port()
+
+        req_word = bus.adr[:line_bits]
+        req_set = bus.adr[line_bits : line_bits + set_bits]
+        req_tag = bus.adr[line_bits + set_bits :]
+
+        hit = Signal()
+        hit_way = Signal(range(num_ways))
+        for i in range(num_ways):
+            line_i = Cat(C(i, way_bits), req_set)
+            with m.If(valid.bit_select(line_i, 1) & (tags[line_i] == req_tag)):
+                m.d.comb += [hit.eq(1), hit_way.eq(i)]
+
+        line = Signal(range(num_lines))  # line being filled
+        beat = Signal(line_bits)
+        last_beat = Signal()
+
+        invalidate_pending = Signal()
+
+        m.d.comb += [
+            last_beat.eq(beat == texture_cache_line_words - 1),
+            rd.addr.eq(Cat(req_word, hit_way, req_set)),
+            bus.dat_r.eq(rd.data),
+            mem.sel.eq(~0),
+            mem.cti.eq(
+                Mux(last_beat, wb.CycleType.END_OF_BURST, wb.CycleType.INCR_BURST)
+            ),
+            mem.bte.eq(wb.BurstTypeExt.WRAP_16),
+        ]
+
+        with m.FSM():
+            with m.State("IDLE"):
+                with m.If(invalidate_pending):
+                    m.d.sync += [valid.eq(0), invalidate_pending.eq(0)]
+                with m.Elif(bus.cyc & bus.stb & hit):
+                    m.next = "ACK"
+                with m.Elif(bus.cyc & bus.stb):
+                    victim = victims[req_set]
+                    m.d.sync += [
+                        line.eq(Cat(victim, req_set)),
+                        victim.eq(victim + 1),
+                        beat.eq(0),
+                        valid.bit_select(Cat(victim, req_set), 1).eq(0),
+                        self.misses.eq(self.misses + 1),
+                    ]
+                    m.next = "FILL"
+
+            with m.State("ACK"):
+                # read data of the address looked up in IDLE (held by the initiator)
+                m.d.comb += bus.ack.eq(1)
+                m.d.sync += self.lookups.eq(self.lookups + 1)
+                m.next = "IDLE"
+
+            with m.State("FILL"):
+                m.d.comb += [
+                    mem.cyc.eq(1),
+                    mem.stb.eq(1),
+                    mem.adr.eq(Cat(beat, bus.adr[line_bits:])),
+                ]
+                with m.If(mem.ack):
+                    m.d.comb += [
+                        wr.addr.eq(Cat(beat, line)),
+                        wr.data.eq(mem.dat_r),
+                        wr.en.eq(1),
+                    ]
+                    m.d.sync += beat.eq(beat + 1)
+                    with m.If(last_beat):
+                        m.d.sync += [
+                            tags[line].eq(req_tag),
+                            valid.bit_select(line, 1).eq(1),
+                        ]
+                        # the request hits now
+                        m.next = "IDLE"
+
+        with m.If(self.invalidate):
+            m.d.sync += invalidate_pending.eq(1)
+
+        return m
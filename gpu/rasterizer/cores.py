@@ -1,9 +1,18 @@
+import amaranth_soc.wishbone.bus as wb
 from amaranth import *
 from amaranth.lib import data, stream, wiring
 from amaranth.lib.wiring import In, Out
 
 from gpu.utils.stream import WideStreamOutput
 
+from ..pixel_shading.cores import (
+    DepthTestConfig,
+    HiZBuffer,
+    HiZQuery,
+    StencilOp,
+    StencilOpConfig,
+    hiz_tile_size,
+)
 from ..utils import fixed
 from ..utils import math as gpu_math
 from ..utils.layouts import (
@@ -12,15 +21,29 @@ from ..utils.layouts import (
     RasterizerLayout,
     RasterizerLayoutNDC,
     num_textures,
+    wb_bus_addr_width,
+    wb_bus_data_width,
+    wb_bus_granularity,
 )
 from ..utils.stream import AnyDistributor, AnyRecombiner
 from ..utils.transactron_utils import max_value, min_value, popcount
-from ..utils.types import CullFace, FixedPoint, FixedPoint_fb, FrontFace, PrimitiveType
+from ..utils.types import (
+    CompareOp,
+    CullFace,
+    DepthStencilFormat,
+    FixedPoint,
+    FixedPoint_fb,
+    FixedPoint_ndc,
+    FrontFace,
+    PrimitiveType,
+)
 from .layouts import PrimitiveAssemblyConfigLayout
 
 _weight_shape = fixed.SQ(2 * FixedPoint_fb.i_bits + 1, FixedPoint_fb.f_bits)
 _area_recip_shape = fixed.SQ(_weight_shape.f_bits, _weight_shape.i_bits)
 _persp_div_shape = fixed.UQ(1, 17)
+# Screen-space edge deltas can span the whole guard band, one bit wider than coordinates
+_delta_shape = fixed.SQ(FixedPoint_fb.i_bits + 1, FixedPoint_fb.f_bits)
 
 
 class PrimitiveClipper(wiring.Component):
@@ -31,14 +54,34 @@ class PrimitiveClipper(wiring.Component):
     - Registers: primitive type (point/line/triangle), cull face, winding order.
     - Culling: applied for triangles only (front/back based on area sign and winding).
     - Clipping: trivial accept/reject against NDC cube.
+    - Guard band: triangles that only cross the x/y planes but stay within
+      ``2 ** guard_band`` times the clip volume are forwarded unclipped, TrianglePrep
+      clamps their bounding box to the scissor. 0 disables, 2 (4x) is the maximum.
+      Sutherland-Hodgman clipping is only needed for near/far and guard band
+      violations.
+    - Guard band limit: the screen coordinates of the guard band must fit in
+      FixedPoint_fb (about +-2048 pixels), so the guard band used is the widest one up
+      to ``guard_band`` whose edges stay in that range for the viewport in
+      ``fb_info``. With the viewport at the origin, 4x allows viewports of up to 819
+      pixels and 2x up to 1365.
+
+    ``trivial_accepts``, ``guard_band_accepts``, ``clipped`` and ``trivial_rejects``
+    count triangles, wrapping around.
     """
 
     i: In(stream.Signature(RasterizerLayout))
     o: Out(stream.Signature(RasterizerLayout))
 
     prim_type: In(PrimitiveType)
+    guard_band: In(2)
+    fb_info: In(FramebufferInfoLayout)
     ready: Out(1)
 
+    trivial_accepts: Out(32)
+    guard_band_accepts: Out(32)
+    clipped: Out(32)
+    trivial_rejects: Out(32)
+
     def elaborate(self, platform):
         m = Module()
         # Reciprocal unit for t computation (t = num / den = num * inv(den))
@@ -80,6 +123,25 @@ class PrimitiveClipper(wiring.Component):
         src_reg = Signal()
         dst_reg = Signal()
 
+        # Widest guard band (up to the configured one) that maps into FixedPoint_fb:
+        # ndc -2**shift..2**shift ends up at offset + size * (1 -+ 2**shift) / 2
+        def guard_band_fits(offset, size, shift):
+            lo = offset + size * fixed.Const((1 - 2**shift) / 2)
+            hi = offset + size * fixed.Const((1 + 2**shift) / 2)
+            return (lo >= FixedPoint_fb.min()) & (hi <= FixedPoint_fb.max())
+
+        def viewport_fits(shift):
+            fb = self.fb_info
+            x_fits = guard_band_fits(fb.viewport_x, fb.viewport_width, shift)
+            y_fits = guard_band_fits(fb.viewport_y, fb.viewport_height, shift)
+            return x_fits & y_fits
+
+        guard_band = Signal(2)
+        with m.If((self.guard_band >= 2) & viewport_fits(2)):
+            m.d.comb += guard_band.eq(2)
+        with m.Elif((self.guard_band >= 1) & viewport_fits(1)):
+            m.d.comb += guard_band.eq(1)
+
         # Primitive vertex count based on register
         with m.Switch(self.prim_type):
             with m.Case(PrimitiveType.POINTS):
@@ -123,9 +185,35 @@ class PrimitiveClipper(wiring.Component):
                     ]
                     return Cat(bits)
 
+                # x/y planes pushed out to the guard band
+                def compute_guard_band_code(vtx, shift):
+                    x, y, z, w = vtx.position_ndc
+                    gb_w = w << shift
+                    return Cat(x > gb_w, x < -gb_w, y > gb_w, y < -gb_w)
+
                 codes = Array(Signal(6) for _ in range(3))
+                gb_codes = Array(Signal(4) for _ in range(3))
                 for i in range(3):
                     m.d.comb += codes[i].eq(compute_clip_code(buf[i]))
+                    with m.Switch(guard_band):
+                        for shift in range(2):
+                            with m.Case(shift):
+                                m.d.comb += gb_codes[i].eq(
+                                    compute_guard_band_code(buf[i], shift)
+                                )
+                        with m.Default():
+                            m.d.comb += gb_codes[i].eq(
+                                compute_guard_band_code(buf[i], 2)
+                            )
+
+                any_codes = codes[0] | codes[1] | codes[2]
+                trivial_accept = any_codes == 0
+                # Near/far still need real clipping, w > 0 is implied by |z| <= w
+                guard_band_accept = (
+                    (needed == 3)
+                    & ((gb_codes[0] | gb_codes[1] | gb_codes[2]) == 0)
+                    & (any_codes[4:6] == 0)
+                )
 
                 m.d.sync += [
                     Print(
@@ -148,9 +236,11 @@ class PrimitiveClipper(wiring.Component):
                 with m.If((codes[0] & codes[1] & codes[2]) != 0):
                     m.d.sync += Print("Trivial reject")
                     # Fully outside; drop primitive.
+                    with m.If(needed == 3):
+                        m.d.sync += self.trivial_rejects.eq(self.trivial_rejects + 1)
                     m.next = "COLLECT"
-                with m.Elif((codes[0] | codes[1] | codes[2]) == 0):
-                    # Fully inside; forward primitive.
+                with m.Elif(trivial_accept | guard_band_accept):
+                    # Fully inside (or inside the guard band); forward primitive.
                     m.d.comb += [
                         w_out.i.p.data[0].eq(buf[0]),
                         w_out.i.p.data[1].eq(buf[1]),
@@ -159,10 +249,22 @@ class PrimitiveClipper(wiring.Component):
                         w_out.i.valid.eq(1),
                     ]
                     with m.If(w_out.i.ready):
-                        m.d.sync += Print("Trivial accept")
+                        with m.If(trivial_accept):
+                            m.d.sync += Print("Trivial accept")
+                            with m.If(needed == 3):
+                                m.d.sync += self.trivial_accepts.eq(
+                                    self.trivial_accepts + 1
+                                )
+                        with m.Else():
+                            m.d.sync += [
+                                Print("Guard band accept"),
+                                self.guard_band_accepts.eq(self.guard_band_accepts + 1),
+                            ]
                         m.next = "COLLECT"
                 with m.Else():
                     # Needs clipping (only triangles and lines should reach here).
+                    with m.If(needed == 3):
+                        m.d.sync += self.clipped.eq(self.clipped + 1)
                     m.next = "CLIP"
 
             with m.State("CLIP"):
@@ -564,7 +666,11 @@ class PerspectiveDivide(wiring.Component):
     """Perspective divide: divides NDC coordinates by w to produce perspective-divided values.
 
     Input: RasterizerLayout stream (position_ndc with x, y, z, w)
-    Output: RasterizerLayoutNDC stream (position_ndc with x/w, y/w, z/w, 1/w in UQ(1,17) format)
+    Output: RasterizerLayoutNDC stream (position_ndc with x/w, y/w, z/w remapped to
+    [0, 1] and 1/w)
+
+    x and y keep their sign and range for vertices in the clipper's guard band, z is
+    saturated to UQ(1,17).
     """
 
     ready: Out(1)
@@ -594,8 +700,8 @@ class PerspectiveDivide(wiring.Component):
         m.d.comb += mul_p.eq(mul_a * mul_b)
 
         # Output storage
-        div_x = Signal(persp_type)
-        div_y = Signal(persp_type)
+        div_x = Signal(FixedPoint_ndc)
+        div_y = Signal(FixedPoint_ndc)
         div_z = Signal(persp_type)
 
         m.submodules.inv = inv = gpu_math.FixedPointInv(
@@ -627,12 +733,12 @@ class PerspectiveDivide(wiring.Component):
 
             with m.State("DIVIDE_X"):
                 m.d.comb += [mul_a.eq(vtx_buf.position_ndc[0]), mul_b.eq(inv_w)]
-                m.d.sync += div_x.eq(((mul_p + 1) >> 1).saturate(persp_type))
+                m.d.sync += div_x.eq(((mul_p + 1) >> 1).saturate(FixedPoint_ndc))
                 m.next = "DIVIDE_Y"
 
             with m.State("DIVIDE_Y"):
                 m.d.comb += [mul_a.eq(vtx_buf.position_ndc[1]), mul_b.eq(inv_w)]
-                m.d.sync += div_y.eq(((mul_p + 1) >> 1).saturate(persp_type))
+                m.d.sync += div_y.eq(((mul_p + 1) >> 1).saturate(FixedPoint_ndc))
                 m.next = "DIVIDE_Z"
 
             with m.State("DIVIDE_Z"):
@@ -671,13 +777,42 @@ class TriangleContext(data.Struct):
     front_facing: unsigned(1)
 
 
+# Upper bound of triangles that TriangleRasterizer keeps resident at once
+max_resident_triangles = 4
+
+# Side of the pixel blocks tested against the edge functions as a whole
+coarse_block_size = 4
+
+# Edge function values at block corners
+_edge_shape = fixed.SQ(2 * _delta_shape.i_bits + 2, 2 * _delta_shape.f_bits)
+
+
 class PixelTask(data.Struct):
     px: unsigned(FixedPoint_fb.i_bits)
     py: unsigned(FixedPoint_fb.i_bits)
+    depth_addr: unsigned(wb_bus_addr_width)  # word address of the pixel's depth/stencil
+    slot: range(max_resident_triangles)  # resident triangle the pixel is tested against
+    accepted: unsigned(1)  # block of the pixel is inside the triangle, skip edge tests
+
+
+class ResidentTriangle(data.Struct):
+    """Triangle set up by TriangleRasterizer, with its edge and early test state."""
+
+    ctx: TriangleContext
+    d_x: data.ArrayLayout(_delta_shape, 3)
+    d_y: data.ArrayLayout(_delta_shape, 3)
+    winding_ccw: unsigned(1)
+    is_top_left: unsigned(3)
+    early_z: unsigned(1)
+    hiz: unsigned(1)
+    depth: unsigned(16)  # of the nearest vertex, quantized like the fragment depths
 
 
 class TrianglePrep(wiring.Component):
-    """Triangle setup: collects 3 vertices, applies viewport/scissor and outputs context."""
+    """Triangle setup: collects 3 vertices, applies viewport/scissor and outputs context.
+
+    ``culled`` counts triangles dropped by face culling, the scissor or a zero area.
+    """
 
     i: In(stream.Signature(RasterizerLayoutNDC))
     o: Out(stream.Signature(TriangleContext))
@@ -685,6 +820,7 @@ class TrianglePrep(wiring.Component):
     fb_info: In(FramebufferInfoLayout)
     pa_conf: In(PrimitiveAssemblyConfigLayout)
     ready: Out(1)
+    culled: Out(32)
 
     def __init__(self, inv_steps: int = 4):
         super().__init__()
@@ -698,8 +834,8 @@ class TrianglePrep(wiring.Component):
         recip_shape = _area_recip_shape
 
         # Single shared multiplier (time-multiplexed)
-        mul_a = Signal(s_fb_type)
-        mul_b = Signal(s_fb_type)
+        mul_a = Signal(_delta_shape)
+        mul_b = Signal(_delta_shape)
         mul_p = Signal(weight_shape)
         m.d.comb += mul_p.eq(mul_a * mul_b)
 
@@ -725,10 +861,10 @@ class TrianglePrep(wiring.Component):
         tri_front_facing = Signal()
 
         # Edge deltas for area calc using the shared multiplier
-        dx10 = Signal(s_fb_type)
-        dy10 = Signal(s_fb_type)
-        dx20 = Signal(s_fb_type)
-        dy20 = Signal(s_fb_type)
+        dx10 = Signal(_delta_shape)
+        dy10 = Signal(_delta_shape)
+        dx20 = Signal(_delta_shape)
+        dy20 = Signal(_delta_shape)
         area_temp = Signal(weight_shape)
 
         m.submodules.inv = inv = gpu_math.FixedPointInv(
@@ -849,16 +985,19 @@ class TrianglePrep(wiring.Component):
                     ff & ((self.pa_conf.cull & CullFace.FRONT) == CullFace.FRONT)
                 ):
                     m.d.sync += Print("Culling front face")
+                    m.d.sync += self.culled.eq(self.culled + 1)
                     m.next = "COLLECT"
                 with m.Elif(
                     ~ff & ((self.pa_conf.cull & CullFace.BACK) == CullFace.BACK)
                 ):
                     m.d.sync += Print("Culling back face")
+                    m.d.sync += self.culled.eq(self.culled + 1)
                     m.next = "COLLECT"
                 with m.Elif(outside_bits.any() | (area == 0)):
                     m.d.sync += Print("Culling triangle: outside scissor or zero area")
                     m.d.sync += Print("outside_bits: {}", outside_bits)
                     m.d.sync += Print("area: {}", area)
+                    m.d.sync += self.culled.eq(self.culled + 1)
                     m.next = "COLLECT"
                 with m.Else():
                     m.d.comb += [inv.i.valid.eq(1), inv.i.payload.eq(area)]
@@ -891,20 +1030,41 @@ class TrianglePrep(wiring.Component):
 
 
 class FragmentGenerator(wiring.Component):
-    """Fragment generator: barycentric test + interpolation for a single pixel."""
+    """Fragment generator: barycentric test + interpolation for a single pixel.
+
+    Pixels of an ``accepted`` task are inside without looking at the edge functions,
+    those are still computed as they double as the barycentric weights.
+
+    With ``early_z`` set, the linearly interpolated depth of a covered pixel is
+    tested against the depth buffer before the reciprocal and the attribute
+    interpolation; occluded pixels are dropped (``ez_reject``) right there. For D16
+    buffers ``depth_addr`` is the word holding the pixel pair.
+    """
 
     i: In(stream.Signature(PixelTask))
     o: Out(stream.Signature(FragmentLayout))
 
     ctx: In(TriangleContext)
 
-    d_x: In(data.ArrayLayout(FixedPoint_fb, 3))
-    d_y: In(data.ArrayLayout(FixedPoint_fb, 3))
+    d_x: In(data.ArrayLayout(_delta_shape, 3))
+    d_y: In(data.ArrayLayout(_delta_shape, 3))
 
     winding_ccw: In(1)
     is_top_left: In(3)
 
+    early_z: In(1)
+    depth_compare_op: In(CompareOp)
+    depthstencil_format: In(DepthStencilFormat)
+    ds_bus: Out(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            granularity=wb_bus_granularity,
+        )
+    )
+
     o_done: Out(1)
+    ez_reject: Out(1)
 
     def __init__(self, inv_steps: int = 4):
         super().__init__()
@@ -923,20 +1083,22 @@ class FragmentGenerator(wiring.Component):
 
         px_lat = Signal(unsigned(FixedPoint_fb.i_bits))
         py_lat = Signal(unsigned(FixedPoint_fb.i_bits))
+        depth_addr_lat = Signal(unsigned(wb_bus_addr_width))
+        accepted_lat = Signal()
         px_fp_reg = Signal(s_fb_type)
         py_fp_reg = Signal(s_fb_type)
 
         # Shared multiplier to reduce DSP usage
-        mul_a = Signal(s_fb_type)
-        mul_b = Signal(s_fb_type)
+        mul_a = Signal(_delta_shape)
+        mul_b = Signal(_delta_shape)
         mul_p = Signal.like(mul_a * mul_b)
         m.d.comb += mul_p.eq(mul_a * mul_b)
 
         w = Signal(data.ArrayLayout(mul_p.shape(), 3))
 
         # Edge computation intermediates (differences and partial products)
-        dp_x = Signal(data.ArrayLayout(s_fb_type, 3))
-        dp_y = Signal(data.ArrayLayout(s_fb_type, 3))
+        dp_x = Signal(data.ArrayLayout(_delta_shape, 3))
+        dp_y = Signal(data.ArrayLayout(_delta_shape, 3))
 
         weight_linear = Signal(data.ArrayLayout(fixed.UQ(1, 17), 3))
         weight_persp = Signal(data.ArrayLayout(fixed.UQ(1, 17), 3))
@@ -976,6 +1138,43 @@ class FragmentGenerator(wiring.Component):
         persp_pre = Signal(data.ArrayLayout(weight_shape, 2))
 
         edge_inside = Signal(3)
+        inside = Signal()
+
+        # Early depth test, quantized exactly like DepthStencilTest does
+        ez = Signal()
+        ez_frag = Signal(unsigned(16))
+        ez_stored = Signal(unsigned(16))
+        ez_passed = Signal()
+        op = self.depth_compare_op
+        m.d.comb += ez_passed.eq(
+            ((op & CompareOp.LESS == CompareOp.LESS) & (ez_frag < ez_stored))
+            | ((op & CompareOp.EQUAL == CompareOp.EQUAL) & (ez_frag == ez_stored))
+            | ((op & CompareOp.GREATER == CompareOp.GREATER) & (ez_frag > ez_stored))
+        )
+
+        # s and t of the textures are interpolated on the perspective multiplier while
+        # it is idle, one vertex per color interpolation state (r and q are not)
+        texcoord_states = [
+            "INTERP_COLOR_0_2",
+            *(f"INTERP_COLOR_{c}{k}" for c in range(1, 4) for k in ["", "_1", "_2"]),
+        ]
+        if 2 * 3 * num_textures > len(texcoord_states):
+            raise ValueError(f"Cannot interpolate texcoords of {num_textures} textures")
+        texcoord_sat = Signal(data.ArrayLayout(FixedPoint, 2 * num_textures))
+
+        def interp_texcoord(state):
+            step = texcoord_states.index(state)
+            if step >= 2 * 3 * num_textures:
+                return
+            comp, k = divmod(step, 3)
+            product = persp_mul_p >> 4  # weight in Q13.13 is 16x too big
+            m.d.comb += [
+                persp_mul_a.eq(self.ctx.vtx[k].texcoords[comp // 2][comp % 2]),
+                persp_mul_b.eq(weight_persp[k] << 4),
+            ]
+            m.d.sync += texcoord_sat[comp].eq(
+                product if k == 0 else texcoord_sat[comp] + product
+            )
 
         with m.FSM():
             with m.State("IDLE"):
@@ -984,6 +1183,8 @@ class FragmentGenerator(wiring.Component):
                     m.d.sync += [
                         px_lat.eq(self.i.payload.px),
                         py_lat.eq(self.i.payload.py),
+                        depth_addr_lat.eq(self.i.payload.depth_addr),
+                        accepted_lat.eq(self.i.payload.accepted),
                         px_fp_reg.eq(self.i.payload.px + fixed.Const(0.5)),
                         py_fp_reg.eq(self.i.payload.py + fixed.Const(0.5)),
                     ]
@@ -1073,6 +1274,7 @@ class FragmentGenerator(wiring.Component):
                     )
                     for i in range(3)
                 ]
+                m.d.comb += inside.eq(accepted_lat | edge_inside.all())
 
                 m.d.comb += [
                     persp_mul_a.eq(weight_linear[2] << 4),
@@ -1080,7 +1282,12 @@ class FragmentGenerator(wiring.Component):
                 ]
                 m.d.comb += inv.i.payload.eq(inv_w_sum + persp_mul_p)
 
-                with m.If(edge_inside.all()):
+                with m.If(inside & self.early_z):
+                    # the reciprocal is started only for pixels passing the depth test
+                    m.d.sync += [ez.eq(1), inv_w_sum.eq(inv_w_sum + persp_mul_p)]
+                    m.next = "GET_PRE_PERSP_0"
+                with m.Elif(inside):
+                    m.d.sync += ez.eq(0)
                     m.d.comb += inv.i.valid.eq(1)
                     with m.If(inv.i.ready):
                         m.next = "GET_PRE_PERSP_0"
@@ -1106,7 +1313,55 @@ class FragmentGenerator(wiring.Component):
                     (depth_sat + mul_p_interp).saturate(_persp_div_shape)
                 )
 
-                m.next = "INV_WAIT"
+                with m.If(ez):
+                    m.next = "EZ_DEPTH"
+                with m.Else():
+                    m.next = "INV_WAIT"
+
+            with m.State("EZ_DEPTH"):
+                m.d.comb += [
+                    mul_a_interp.eq(self.ctx.vtx[2].position_ndc[2]),
+                    mul_b_interp.eq(weight_linear[2]),
+                ]
+                m.d.sync += depth_sat.eq(
+                    (depth_sat + mul_p_interp).saturate(_persp_div_shape)
+                )
+
+                m.next = "EZ_READ"
+
+            with m.State("EZ_READ"):
+                depth_zero_one = depth_sat.clamp(zero, one)
+                m.d.sync += ez_frag.eq(
+                    ((depth_zero_one << 16) - depth_zero_one).round()
+                )
+
+                m.d.comb += [
+                    self.ds_bus.cyc.eq(1),
+                    self.ds_bus.stb.eq(1),
+                    self.ds_bus.adr.eq(depth_addr_lat),
+                    self.ds_bus.we.eq(0),
+                    self.ds_bus.sel.eq(~0),
+                ]
+                with m.If(self.ds_bus.ack):
+                    d16_high = (
+                        self.depthstencil_format == DepthStencilFormat.D16
+                    ) & px_lat[0]
+                    m.d.sync += ez_stored.eq(
+                        Mux(d16_high, self.ds_bus.dat_r[16:32], self.ds_bus.dat_r[0:16])
+                    )
+                    m.next = "EZ_TEST"
+
+            with m.State("EZ_TEST"):
+                with m.If(ez_passed):
+                    m.d.comb += [
+                        inv.i.valid.eq(1),
+                        inv.i.payload.eq(inv_w_sum),
+                    ]
+                    with m.If(inv.i.ready):
+                        m.next = "INV_WAIT"
+                with m.Else():
+                    m.d.comb += [self.o_done.eq(1), self.ez_reject.eq(1)]
+                    m.next = "IDLE"
 
             with m.State("INV_WAIT"):
                 m.d.comb += [
@@ -1116,9 +1371,10 @@ class FragmentGenerator(wiring.Component):
                 m.d.comb += inv.o.ready.eq(1)
                 with m.If(inv.o.valid):
                     m.d.sync += inv_w_sum_recip.eq(inv.o.payload)
-                    m.d.sync += depth_sat.eq(
-                        (depth_sat + mul_p_interp).saturate(_persp_div_shape)
-                    )
+                    with m.If(~ez):
+                        m.d.sync += depth_sat.eq(
+                            (depth_sat + mul_p_interp).saturate(_persp_div_shape)
+                        )
 
                     m.next = "PERSPECTIVE_W0_M1"
 
@@ -1159,6 +1415,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_0_2"
 
             with m.State("INTERP_COLOR_0_2"):
+                interp_texcoord("INTERP_COLOR_0_2")
                 m.d.sync += Print("Weights linear ", *weight_linear)
                 m.d.sync += Print("Weights persp ", *weight_persp)
 
@@ -1172,6 +1429,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_1"
 
             with m.State("INTERP_COLOR_1"):
+                interp_texcoord("INTERP_COLOR_1")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[0].color[1].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[0]),
@@ -1180,6 +1438,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_1_1"
 
             with m.State("INTERP_COLOR_1_1"):
+                interp_texcoord("INTERP_COLOR_1_1")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[1].color[1].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[1]),
@@ -1190,6 +1449,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_1_2"
 
             with m.State("INTERP_COLOR_1_2"):
+                interp_texcoord("INTERP_COLOR_1_2")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[2].color[1].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[2]),
@@ -1200,6 +1460,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_2"
 
             with m.State("INTERP_COLOR_2"):
+                interp_texcoord("INTERP_COLOR_2")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[0].color[2].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[0]),
@@ -1208,6 +1469,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_2_1"
 
             with m.State("INTERP_COLOR_2_1"):
+                interp_texcoord("INTERP_COLOR_2_1")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[1].color[2].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[1]),
@@ -1218,6 +1480,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_2_2"
 
             with m.State("INTERP_COLOR_2_2"):
+                interp_texcoord("INTERP_COLOR_2_2")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[2].color[2].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[2]),
@@ -1228,6 +1491,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_3"
 
             with m.State("INTERP_COLOR_3"):
+                interp_texcoord("INTERP_COLOR_3")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[0].color[3].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[0]),
@@ -1236,6 +1500,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_3_1"
 
             with m.State("INTERP_COLOR_3_1"):
+                interp_texcoord("INTERP_COLOR_3_1")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[1].color[3].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[1]),
@@ -1246,6 +1511,7 @@ class FragmentGenerator(wiring.Component):
                 m.next = "INTERP_COLOR_3_2"
 
             with m.State("INTERP_COLOR_3_2"):
+                interp_texcoord("INTERP_COLOR_3_2")
                 m.d.comb += [
                     mul_a_interp.eq(self.ctx.vtx[2].color[3].clamp(zero, one)),
                     mul_b_interp.eq(weight_persp[2]),
@@ -1266,6 +1532,13 @@ class FragmentGenerator(wiring.Component):
                     self.o.p.color[3].eq(color_sat[3].clamp(zero, one)),
                     self.o.p.front_facing.eq(self.ctx.front_facing),
                 ]
+                for t in range(num_textures):
+                    m.d.comb += [
+                        self.o.p.texcoords[t][0].eq(texcoord_sat[2 * t]),
+                        self.o.p.texcoords[t][1].eq(texcoord_sat[2 * t + 1]),
+                        self.o.p.texcoords[t][2].eq(0.0),
+                        self.o.p.texcoords[t][3].eq(1.0),
+                    ]
 
                 m.d.comb += self.o.valid.eq(1)
                 with m.If(self.o.ready):
@@ -1283,6 +1556,24 @@ class TriangleRasterizer(wiring.Component):
     Input: RasterizerLayout stream (3 vertices per triangle)
     Output: FragmentLayout stream (one per covered pixel)
 
+    Up to ``num_contexts`` triangles are resident at once: one is set up while
+    an older one is traversed and pixels of even older ones are still in the
+    fragment generators. Fragments of a pixel leave in triangle order, a pixel
+    is not handed out while a task of an older triangle for it is in flight.
+
+    Early depth test is used for a triangle whenever it gives the same result as
+    DepthStencilTest: the depth test is a LESS/GREATER(_OR_EQUAL) one, failing it
+    leaves the stencil unchanged, and no depth writes in the opposite direction
+    may still be on their way to memory (``pixel_drained`` clears that history).
+    A stale depth value is then at most too permissive, the late test stays exact.
+
+    The bounding box is traversed in hierarchical Z tiles. With a LESS(_OR_EQUAL)
+    early depth test on the tracked depth buffer, tiles whose depth bound is in
+    front of the nearest vertex are skipped without visiting their pixels.
+    Each tile is then visited in coarse blocks, tested against the edge functions
+    at their corners: blocks outside an edge are skipped, blocks inside all of
+    them are handed out as accepted and only the rest is tested per pixel.
+
     TODO: support for lines and points (for now only triangles)
     """
 
@@ -1293,114 +1584,432 @@ class TriangleRasterizer(wiring.Component):
     fb_info: In(FramebufferInfoLayout)
     ready: Out(1)
 
-    def __init__(self, inv_steps: int = 3, num_generators: int = 1):
+    # Depth/stencil state of the draw, for the early depth test
+    depth_conf: In(DepthTestConfig)
+    stencil_conf_front: In(StencilOpConfig)
+    stencil_conf_back: In(StencilOpConfig)
+    pixel_drained: In(1)  # no fragment between the rasterizer and depth writes
+    ds_bus: Out(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            granularity=wb_bus_granularity,
+        )
+    )
+    early_z_rejects: Out(32)
+
+    # Hierarchical Z (bound of the queried tile is valid in the next cycle)
+    hiz_buffer: In(HiZBuffer)
+    hiz_query: Out(HiZQuery)
+    hiz_bound: In(unsigned(16))
+    hiz_rejects: Out(32)
+    coarse_rejects: Out(32)
+
+    def __init__(
+        self,
+        inv_steps: int = 3,
+        num_generators: int = 1,
+        num_contexts: int = max_resident_triangles,
+    ):
         super().__init__()
+        assert 1 <= num_contexts <= max_resident_triangles
         self._inv_steps = inv_steps
         self._num_generators = num_generators
+        self._num_contexts = num_contexts
         self._subpixel_bits = FixedPoint_fb.f_bits
 
     def elaborate(self, platform):
         m = Module()
 
-        ctx_buf = Signal(TriangleContext)
-        inflight = Signal(
-            range(
-                FragmentGenerator.max_pipelined_elements() * self._num_generators * 2
-                + 1
-            )
+        num_contexts = self._num_contexts
+
+        def ring_next(ptr):
+            return Mux(ptr == num_contexts - 1, 0, ptr + 1)
+
+        # Resident triangles form a ring: head (oldest, waiting for its pixels to
+        # leave the generators), trav (being traversed) and tail (next to set up)
+        slots = Array(
+            Signal(ResidentTriangle, name=f"slot_{i}") for i in range(num_contexts)
         )
+        max_inflight = (
+            FragmentGenerator.max_pipelined_elements() * self._num_generators * 2
+        )
+        slot_inflight = Array(
+            Signal(range(max_inflight + 1), name=f"slot_{i}_inflight")
+            for i in range(num_contexts)
+        )
+        head = Signal(range(num_contexts))
+        trav = Signal(range(num_contexts))
+        tail = Signal(range(num_contexts))
+        num_resident = Signal(range(num_contexts + 1))
+        num_pending = Signal(range(num_contexts + 1))  # set up, not traversed yet
+
+        setup_commit = Signal()
+        trav_done = Signal()
+        retire = Signal()
+        m.d.comb += retire.eq(
+            (num_resident != num_pending) & (slot_inflight[head] == 0)
+        )
+        m.d.sync += [
+            num_resident.eq(num_resident + setup_commit - retire),
+            num_pending.eq(num_pending + setup_commit - trav_done),
+        ]
+        with m.If(retire):
+            m.d.sync += head.eq(ring_next(head))
 
         px = Signal(unsigned(FixedPoint_fb.i_bits))
         py = Signal(unsigned(FixedPoint_fb.i_bits))
 
-        d_x = Signal(data.ArrayLayout(FixedPoint_fb, 3))
-        d_y = Signal(data.ArrayLayout(FixedPoint_fb, 3))
+        # Depth/stencil word address of (tile_x0, py) and of (px, py)
+        ds_row_addr = Signal(unsigned(wb_bus_addr_width))
+        ds_addr = Signal(unsigned(wb_bus_addr_width))
+        ds_pitch = self.fb_info.depthstencil_pitch[2:]
+
+        # Directions in which depth values in flight may still move the stored
+        # ones: bit 0 - lower, bit 1 - raise
+        depth_op = self.depth_conf.compare_op
+        test_less = depth_op & CompareOp.LESS == CompareOp.LESS
+        test_greater = depth_op & CompareOp.GREATER == CompareOp.GREATER
+        draw_writes = Signal(2)
+        pending_writes = Signal(2)
+        m.d.comb += draw_writes.eq(
+            Mux(
+                self.depth_conf.write_enabled,
+                Mux(self.depth_conf.test_enabled, Cat(test_less, test_greater), 0b11),
+                0,
+            )
+        )
+        with m.If(self.pixel_drained):
+            m.d.sync += pending_writes.eq(draw_writes)
+        with m.Else():
+            m.d.sync += pending_writes.eq(pending_writes | draw_writes)
+
+        s_conf = Signal(StencilOpConfig)
+        m.d.comb += s_conf.eq(
+            Mux(
+                self.i.payload.front_facing,
+                self.stencil_conf_front,
+                self.stencil_conf_back,
+            )
+        )
+        d16 = self.fb_info.depthstencil_format == DepthStencilFormat.D16
+        stencil_kept = (
+            d16
+            | (s_conf.write_mask == 0)
+            | (
+                (s_conf.fail_op == StencilOp.KEEP)
+                & (s_conf.depth_fail_op == StencilOp.KEEP)
+            )
+        )
+
+        early_z_allowed = Signal()
+        m.d.comb += early_z_allowed.eq(
+            self.depth_conf.test_enabled
+            & (test_less ^ test_greater)
+            & stencil_kept
+            & Mux(test_less, ~pending_writes[1], ~pending_writes[0])
+        )
+
+        hiz_allowed = Signal()
+        m.d.comb += hiz_allowed.eq(
+            early_z_allowed
+            & test_less
+            & self.hiz_buffer.valid
+            & (self.hiz_buffer.address == self.fb_info.depthstencil_address)
+            & (self.hiz_buffer.pitch == self.fb_info.depthstencil_pitch)
+        )
+
+        # Triangle being set up, written to the tail slot once complete
+        setup = Signal(ResidentTriangle)
+        setup_done = Signal(ResidentTriangle)
+
+        # Depth of the nearest vertex, quantized like the fragment depths
+        zero = fixed.Const(0.0)
+        one = fixed.Const(1.0)
+        z = [setup.ctx.vtx[i].position_ndc[2] for i in range(3)]
+        z_01 = Signal(FixedPoint_ndc)
+        z_near = Signal(FixedPoint_ndc)
+        m.d.comb += [
+            z_01.eq(Mux(z[0] < z[1], z[0], z[1])),
+            z_near.eq(Mux(z_01 < z[2], z_01, z[2])),
+        ]
+        z_near_zero_one = z_near.clamp(zero, one)
+
+        with m.FSM(name="setup"):
+            with m.State("IDLE"):
+                m.d.comb += self.ready.eq(num_resident == 0)
+                m.d.comb += self.i.ready.eq(num_resident != num_contexts)
+                with m.If(self.i.valid & self.i.ready):
+                    m.d.sync += [
+                        setup.ctx.eq(self.i.payload),
+                        setup.winding_ccw.eq(self.i.payload.area > 0),
+                        setup.early_z.eq(early_z_allowed),
+                        setup.hiz.eq(hiz_allowed),
+                    ]
+                    m.next = "PREP_EDGES"
+
+            with m.State("PREP_EDGES"):
+                ctx = setup.ctx
+                m.d.sync += setup.depth.eq(
+                    ((z_near_zero_one << 16) - z_near_zero_one).round()
+                )
+                m.d.sync += [
+                    setup.d_x[0].eq(ctx.screen_x[2] - ctx.screen_x[1]),
+                    setup.d_y[0].eq(ctx.screen_y[2] - ctx.screen_y[1]),
+                    setup.d_x[1].eq(ctx.screen_x[0] - ctx.screen_x[2]),
+                    setup.d_y[1].eq(ctx.screen_y[0] - ctx.screen_y[2]),
+                    setup.d_x[2].eq(ctx.screen_x[1] - ctx.screen_x[0]),
+                    setup.d_y[2].eq(ctx.screen_y[1] - ctx.screen_y[0]),
+                ]
+                m.next = "CATEGORIZE_EDGES"
+
+            with m.State("CATEGORIZE_EDGES"):
+                d_x, d_y, winding_ccw = setup.d_x, setup.d_y, setup.winding_ccw
+                m.d.comb += setup_done.eq(setup)
+                for i in range(3):
+                    is_top = (d_y[i] == 0) & Mux(winding_ccw, d_x[i] > 0, d_x[i] < 0)
+                    is_left = Mux(winding_ccw, d_y[i] < 0, d_y[i] > 0)
+                    m.d.comb += setup_done.is_top_left[i].eq(is_top | is_left)
+
+                m.d.comb += setup_commit.eq(1)
+                m.d.sync += [slots[tail].eq(setup_done), tail.eq(ring_next(tail))]
+                m.next = "IDLE"
+
+        # Triangle being traversed
+        tri = Signal(ResidentTriangle)
+        m.d.comb += tri.eq(slots[trav])
+
+        # The bounding box is visited tile by tile, tile_* is its part in tile (tx, ty)
+        tile_bits = hiz_tile_size.bit_length() - 1
+        tx = Signal(unsigned(FixedPoint_fb.i_bits - tile_bits))
+        ty = Signal(unsigned(FixedPoint_fb.i_bits - tile_bits))
+        tile_x0 = Signal(unsigned(FixedPoint_fb.i_bits))
+        tile_y0 = Signal(unsigned(FixedPoint_fb.i_bits))
+        tile_x1 = Signal(unsigned(FixedPoint_fb.i_bits))
+        tile_y1 = Signal(unsigned(FixedPoint_fb.i_bits))
+
+        # and the tile part block by block, block_* is its part in block (bx, by)
+        block_bits = coarse_block_size.bit_length() - 1
+        bx = Signal(unsigned(FixedPoint_fb.i_bits - block_bits))
+        by = Signal(unsigned(FixedPoint_fb.i_bits - block_bits))
+        block_x0 = Signal(unsigned(FixedPoint_fb.i_bits))
+        block_x1 = Signal(unsigned(FixedPoint_fb.i_bits))
+        block_y1 = Signal(unsigned(FixedPoint_fb.i_bits))
+        block_accepted = Signal()
+
+        # Edge functions at the first pixel (center) of the block, as in generators
+        block_fp_x = Signal(FixedPoint_fb)
+        block_fp_y = Signal(FixedPoint_fb)
+        m.d.comb += [
+            block_fp_x.eq((bx << block_bits) + fixed.Const(0.5)),
+            block_fp_y.eq((by << block_bits) + fixed.Const(0.5)),
+        ]
+        block_dp_x = Signal(data.ArrayLayout(_delta_shape, 3))
+        block_dp_y = Signal(data.ArrayLayout(_delta_shape, 3))
+        block_w = Signal(data.ArrayLayout(_edge_shape, 3))
+
+        # An edge function is linear, so it is inside (outside) the whole block
+        # when it is at all four corners
+        corner_inside = []
+        for i in range(3):
+            step_x = tri.d_y[i] * (coarse_block_size - 1)
+            step_y = tri.d_x[i] * (coarse_block_size - 1)
+            corners = [
+                block_w[i],
+                block_w[i] - step_x,
+                block_w[i] + step_y,
+                block_w[i] + step_y - step_x,
+            ]
+            inside = Signal(4, name=f"edge{i}_corner_inside")
+            m.d.comb += [
+                inside[c].eq(
+                    Mux(tri.winding_ccw, w > 0, w < 0)
+                    | ((w == 0) & tri.is_top_left[i])
+                )
+                for c, w in enumerate(corners)
+            ]
+            corner_inside.append(inside)
 
-        winding_ccw = Signal()
-        is_top = Signal(3)
-        is_left = Signal(3)
+        block_inside = Signal()
+        block_outside = Signal()
+        m.d.comb += [
+            block_inside.eq(Cat(inside.all() for inside in corner_inside).all()),
+            block_outside.eq(Cat(~inside.any() for inside in corner_inside).any()),
+        ]
 
         task_last_x = Signal()
         task_last_y = Signal()
         m.d.comb += [
-            task_last_x.eq(px >= ctx_buf.max_x),
-            task_last_y.eq(py >= ctx_buf.max_y),
+            task_last_x.eq(px >= block_x1),
+            task_last_y.eq(py >= block_y1),
         ]
 
+        m.d.comb += [self.hiz_query.tx.eq(tx), self.hiz_query.ty.eq(ty)]
+
+        def next_tile():
+            with m.If(tx != tri.ctx.max_x >> tile_bits):
+                m.d.sync += tx.eq(tx + 1)
+                m.next = "TILE"
+            with m.Elif(ty != tri.ctx.max_y >> tile_bits):
+                m.d.sync += [tx.eq(tri.ctx.min_x >> tile_bits), ty.eq(ty + 1)]
+                m.next = "TILE"
+            with m.Else():
+                m.d.comb += trav_done.eq(1)
+                m.d.sync += trav.eq(ring_next(trav))
+                m.next = "IDLE"
+
+        def next_block():
+            with m.If(bx != tile_x1 >> block_bits):
+                m.d.sync += bx.eq(bx + 1)
+                m.next = "BLOCK"
+            with m.Elif(by != tile_y1 >> block_bits):
+                m.d.sync += [bx.eq(tile_x0 >> block_bits), by.eq(by + 1)]
+                m.next = "BLOCK"
+            with m.Else():
+                next_tile()
+
         m.submodules.distrib = distrib = AnyDistributor(PixelTask, self._num_generators)
         m.submodules.recomb = recomb = AnyRecombiner(
             FragmentLayout, self._num_generators
         )
 
-        inflight_reset = Signal()
-        inflight_inc = Signal()
+        # Tasks queued for or being processed by each generator
+        gen_tasks = [
+            Signal(PixelTask, name=f"fg_{idx}_task")
+            for idx in range(self._num_generators)
+        ]
+        gen_busy = Signal(self._num_generators)
 
-        with m.FSM():
+        def older_task_of_pixel(task):
+            return (task.slot != trav) & (task.px == px) & (task.py == py)
+
+        pixel_conflict = Signal()
+        m.d.comb += pixel_conflict.eq(
+            Cat(
+                Cat(
+                    gen_busy[idx] & older_task_of_pixel(gen_tasks[idx]),
+                    distrib.o[idx].valid & older_task_of_pixel(distrib.o[idx].p),
+                )
+                for idx in range(self._num_generators)
+            ).any()
+        )
+
+        dispatched = Signal()
+
+        with m.FSM(name="traverse"):
             with m.State("IDLE"):
-                m.d.comb += self.ready.eq(1)
-                m.d.comb += self.i.ready.eq(1)
-                with m.If(self.i.valid):
-                    m.d.comb += inflight_reset.eq(1)
+                with m.If(num_pending != 0):
                     m.d.sync += [
-                        ctx_buf.eq(self.i.payload),
-                        px.eq(self.i.payload.min_x),
-                        py.eq(self.i.payload.min_y),
-                        winding_ccw.eq(self.i.payload.area > 0),
+                        tx.eq(tri.ctx.min_x >> tile_bits),
+                        ty.eq(tri.ctx.min_y >> tile_bits),
                     ]
-                    m.next = "PREP_EDGES"
+                    m.next = "TILE"
 
-            with m.State("PREP_EDGES"):
+            with m.State("TILE"):
+                x0 = max_value(tri.ctx.min_x, tx << tile_bits)
+                y0 = max_value(tri.ctx.min_y, ty << tile_bits)
+                x1 = min_value(tri.ctx.max_x, (tx << tile_bits) | (hiz_tile_size - 1))
+                y1 = min_value(tri.ctx.max_y, (ty << tile_bits) | (hiz_tile_size - 1))
                 m.d.sync += [
-                    d_x[0].eq(ctx_buf.screen_x[2] - ctx_buf.screen_x[1]),
-                    d_y[0].eq(ctx_buf.screen_y[2] - ctx_buf.screen_y[1]),
-                    d_x[1].eq(ctx_buf.screen_x[0] - ctx_buf.screen_x[2]),
-                    d_y[1].eq(ctx_buf.screen_y[0] - ctx_buf.screen_y[2]),
-                    d_x[2].eq(ctx_buf.screen_x[1] - ctx_buf.screen_x[0]),
-                    d_y[2].eq(ctx_buf.screen_y[1] - ctx_buf.screen_y[0]),
+                    tile_x0.eq(x0),
+                    tile_y0.eq(y0),
+                    tile_x1.eq(x1),
+                    tile_y1.eq(y1),
+                    bx.eq(x0 >> block_bits),
+                    by.eq(y0 >> block_bits),
                 ]
-                m.next = "CATEGORIZE_EDGES"
+                with m.If(tri.hiz):
+                    m.next = "HIZ_TEST"
+                with m.Else():
+                    m.next = "BLOCK"
 
-            with m.State("CATEGORIZE_EDGES"):
-                for i in range(3):
-                    m.d.sync += [
-                        is_top[i].eq(
-                            (d_y[i] == 0)
-                            & Mux(
-                                winding_ccw,
-                                d_x[i] > 0,
-                                d_x[i] < 0,
-                            )
-                        ),
-                        is_left[i].eq(
-                            Mux(
-                                winding_ccw,
-                                d_y[i] < 0,
-                                d_y[i] > 0,
-                            )
-                        ),
-                    ]
-                m.next = "RASTERIZE"
+            with m.State("HIZ_TEST"):
+                # fragment depths may be a few LSBs below the vertex ones
+                with m.If(tri.depth >= self.hiz_bound + 2):
+                    m.d.sync += self.hiz_rejects.eq(self.hiz_rejects + 1)
+                    next_tile()
+                with m.Else():
+                    m.next = "BLOCK"
+
+            with m.State("BLOCK"):
+                x0 = max_value(tile_x0, bx << block_bits)
+                y0 = max_value(tile_y0, by << block_bits)
+                x1 = min_value(tile_x1, (bx << block_bits) | (coarse_block_size - 1))
+                y1 = min_value(tile_y1, (by << block_bits) | (coarse_block_size - 1))
+                block_addr = (
+                    self.fb_info.depthstencil_address[2:]
+                    + y0 * ds_pitch
+                    + Mux(d16, x0 >> 1, x0)
+                )
+                m.d.sync += [
+                    px.eq(x0),
+                    py.eq(y0),
+                    block_x0.eq(x0),
+                    block_x1.eq(x1),
+                    block_y1.eq(y1),
+                    ds_row_addr.eq(block_addr),
+                    ds_addr.eq(block_addr),
+                ]
+                m.d.sync += [
+                    block_dp_x[0].eq(block_fp_x - tri.ctx.screen_x[1]),
+                    block_dp_y[0].eq(block_fp_y - tri.ctx.screen_y[1]),
+                    block_dp_x[1].eq(block_fp_x - tri.ctx.screen_x[2]),
+                    block_dp_y[1].eq(block_fp_y - tri.ctx.screen_y[2]),
+                    block_dp_x[2].eq(block_fp_x - tri.ctx.screen_x[0]),
+                    block_dp_y[2].eq(block_fp_y - tri.ctx.screen_y[0]),
+                ]
+                m.next = "BLOCK_EDGES"
+
+            with m.State("BLOCK_EDGES"):
+                m.d.sync += [
+                    block_w[i].eq(
+                        tri.d_x[i] * block_dp_y[i] - tri.d_y[i] * block_dp_x[i]
+                    )
+                    for i in range(3)
+                ]
+                m.next = "BLOCK_TEST"
+
+            with m.State("BLOCK_TEST"):
+                with m.If(block_outside):
+                    m.d.sync += self.coarse_rejects.eq(self.coarse_rejects + 1)
+                    next_block()
+                with m.Else():
+                    m.d.sync += block_accepted.eq(block_inside)
+                    m.next = "RASTERIZE"
 
             with m.State("RASTERIZE"):
                 m.d.comb += [
-                    distrib.i.valid.eq(1),
+                    distrib.i.valid.eq(~pixel_conflict),
                     distrib.i.p.px.eq(px),
                     distrib.i.p.py.eq(py),
+                    distrib.i.p.depth_addr.eq(ds_addr),
+                    distrib.i.p.slot.eq(trav),
+                    distrib.i.p.accepted.eq(block_accepted),
                 ]
-                with m.If(distrib.i.ready):
-                    m.d.comb += inflight_inc.eq(1)
+                with m.If(distrib.i.valid & distrib.i.ready):
+                    m.d.comb += dispatched.eq(1)
                     with m.If(~task_last_x):
                         m.d.sync += px.eq(px + 1)
+                        # D16 pixel pairs share a word
+                        m.d.sync += ds_addr.eq(ds_addr + Mux(d16, px[0], 1))
                     with m.Elif(~task_last_y):
-                        m.d.sync += [px.eq(ctx_buf.min_x), py.eq(py + 1)]
+                        m.d.sync += [px.eq(block_x0), py.eq(py + 1)]
+                        m.d.sync += [
+                            ds_row_addr.eq(ds_row_addr + ds_pitch),
+                            ds_addr.eq(ds_row_addr + ds_pitch),
+                        ]
                     with m.Else():
-                        m.next = "WAIT_DONE"
-            with m.State("WAIT_DONE"):
-                with m.If(inflight == 0):
-                    m.next = "IDLE"
+                        next_block()
+
+        m.submodules.ds_arbiter = ds_arbiter = wb.Arbiter(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            granularity=wb_bus_granularity,
+        )
 
         fragments = []
         done_vec = Signal(self._num_generators)
+        reject_vec = Signal(self._num_generators)
         for idx in range(self._num_generators):
             m.submodules[f"fg_{idx}"] = fg = FragmentGenerator(
                 inv_steps=self._inv_steps
@@ -1408,20 +2017,41 @@ class TriangleRasterizer(wiring.Component):
             fragments.append(fg)
 
             wiring.connect(m, distrib.o[idx], fg.i)
-            m.d.comb += fg.ctx.eq(ctx_buf)
-            m.d.comb += fg.d_x.eq(d_x)
-            m.d.comb += fg.d_y.eq(d_y)
-            m.d.comb += fg.winding_ccw.eq(winding_ccw)
-            m.d.comb += fg.is_top_left.eq(is_top | is_left)
+            with m.If(fg.o_done):
+                m.d.sync += gen_busy[idx].eq(0)
+            with m.If(fg.i.valid & fg.i.ready):
+                m.d.sync += [gen_tasks[idx].eq(fg.i.payload), gen_busy[idx].eq(1)]
+
+            fg_tri = Signal(ResidentTriangle, name=f"fg_{idx}_tri")
+            m.d.comb += fg_tri.eq(slots[gen_tasks[idx].slot])
+            m.d.comb += fg.ctx.eq(fg_tri.ctx)
+            m.d.comb += fg.d_x.eq(fg_tri.d_x)
+            m.d.comb += fg.d_y.eq(fg_tri.d_y)
+            m.d.comb += fg.winding_ccw.eq(fg_tri.winding_ccw)
+            m.d.comb += fg.is_top_left.eq(fg_tri.is_top_left)
+            m.d.comb += fg.early_z.eq(fg_tri.early_z)
+            m.d.comb += fg.depth_compare_op.eq(depth_op)
+            m.d.comb += fg.depthstencil_format.eq(self.fb_info.depthstencil_format)
+            ds_arbiter.add(fg.ds_bus)
 
             wiring.connect(m, fg.o, recomb.i[idx])
             m.d.comb += done_vec[idx].eq(fg.o_done)
+            m.d.comb += reject_vec[idx].eq(fg.ez_reject)
 
-        with m.If(inflight_reset):
-            m.d.sync += inflight.eq(0)
-        with m.Else():
-            m.d.sync += inflight.eq(inflight + inflight_inc - popcount(done_vec))
+        for slot in range(num_contexts):
+            slot_done = Cat(
+                done_vec[idx] & (gen_tasks[idx].slot == slot)
+                for idx in range(self._num_generators)
+            )
+            m.d.sync += slot_inflight[slot].eq(
+                slot_inflight[slot]
+                + (dispatched & (trav == slot))
+                - popcount(slot_done)
+            )
+
+        m.d.sync += self.early_z_rejects.eq(self.early_z_rejects + popcount(reject_vec))
 
         wiring.connect(m, recomb.o, wiring.flipped(self.o))
+        wiring.connect(m, ds_arbiter.bus, wiring.flipped(self.ds_bus))
 
         return m
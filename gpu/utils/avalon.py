@@ -226,7 +226,12 @@ class Interface(wiring.PureInterface):
 
 
 class WishboneMasterToAvalonBridge(Component):
-    """Wishbone initiator to Avalon-MM master bridge."""
+    """Wishbone initiator to Avalon-MM master bridge.
+
+    With the CTI and BTE features, incrementing wrap bursts become Avalon bursts
+    (reads are then returned with ``readdatavalid``). A wrap burst must start on its
+    boundary, other cycles are issued as single-beat bursts.
+    """
 
     def __init__(self, bus: wb.Interface):
         if isinstance(bus, wiring.FlippedInterface):
@@ -237,9 +242,12 @@ class WishboneMasterToAvalonBridge(Component):
         if not isinstance(unflipped_bus, wb.Interface):
             raise TypeError(f"bus must be a Wishbone Interface, not {unflipped_bus!r}")
 
-        if not unflipped_bus.features.issubset({wb.Feature.STALL}):
+        if not unflipped_bus.features.issubset(
+            {wb.Feature.STALL, wb.Feature.CTI, wb.Feature.BTE}
+        ):
             raise ValueError(
-                "Wishbone features other than STALL are not supported by Avalon bridge",
+                "Wishbone features other than STALL, CTI and BTE are not supported by "
+                "Avalon bridge",
                 str(list(unflipped_bus.features)),
             )
 
@@ -257,11 +265,21 @@ class WishboneMasterToAvalonBridge(Component):
             )
 
         self._pipelined = wb.Feature.STALL in unflipped_bus.features
+        self._burst = wb.Feature.CTI in unflipped_bus.features
+
+        if self._burst and (
+            wb.Feature.BTE not in unflipped_bus.features or self._pipelined
+        ):
+            raise ValueError(
+                "Wishbone bursts need the BTE feature and are not supported with STALL"
+            )
 
         avl_signature = Signature(
             addr_width=self._addr_width + self._shift_bits,
             data_width=self._data_width,
+            burst_count_width=5 if self._burst else None,
             has_byte_enable=self._has_byte_enable,
+            has_readdatavalid=self._burst,
             pipelined=self._pipelined,
         )
 
@@ -286,7 +304,47 @@ class WishboneMasterToAvalonBridge(Component):
         if self._has_byte_enable:
             m.d.comb += avl.byteenable.eq(wb_bus.sel)
 
-        if not self._pipelined:
+        if self._burst:
+            burst_len = Signal(range(17))
+            m.d.comb += burst_len.eq(1)
+            with m.If(wb_bus.cti == wb.CycleType.INCR_BURST):
+                with m.Switch(wb_bus.bte):
+                    with m.Case(wb.BurstTypeExt.WRAP_4):
+                        m.d.comb += burst_len.eq(4)
+                    with m.Case(wb.BurstTypeExt.WRAP_8):
+                        m.d.comb += burst_len.eq(8)
+                    with m.Case(wb.BurstTypeExt.WRAP_16):
+                        m.d.comb += burst_len.eq(16)
+
+            # beats of the running Avalon burst still to be transferred; address and
+            # burst count are only sampled on the first beat
+            beats = Signal(range(17))
+            burst_count = Signal.like(burst_len)
+            in_burst = Signal()
+            m.d.comb += [
+                in_burst.eq(beats != 0),
+                avl.burstcount.eq(Mux(in_burst, burst_count, burst_len)),
+                # a read burst is requested once, its data arrives beat by beat
+                avl.read.eq(op_send & ~wb_bus.we & ~in_burst),
+            ]
+
+            write_beat = Signal()
+            m.d.comb += write_beat.eq(avl.write & ~avl.waitrequest)
+            with m.If(write_beat):
+                with m.If(in_burst):
+                    m.d.sync += beats.eq(beats - 1)
+                with m.Else():
+                    m.d.sync += [
+                        beats.eq(burst_len - 1),
+                        burst_count.eq(burst_len),
+                    ]
+            with m.If(avl.read & ~avl.waitrequest):
+                m.d.sync += beats.eq(burst_len)
+            with m.If(avl.readdatavalid):
+                m.d.sync += beats.eq(beats - 1)
+
+            m.d.comb += wb_bus.ack.eq(write_beat | avl.readdatavalid)
+        elif not self._pipelined:
             m.d.comb += wb_bus.ack.eq(~avl.waitrequest)
         else:
             m.d.comb += wb_bus.ack.eq(avl.readdatavalid | avl.writeresponsevalid)
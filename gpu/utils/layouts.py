@@ -3,9 +3,12 @@ from amaranth.lib import data
 
 from . import fixed
 from .types import (
+    ColorFormat,
+    DepthStencilFormat,
     FixedPoint,
     FixedPoint_depth,
     FixedPoint_fb,
+    FixedPoint_ndc,
     Vector3,
     Vector4,
     address_shape,
@@ -14,8 +17,8 @@ from .types import (
 )
 
 # Number of supported textures and lights
-num_textures = 0
-num_lights = 1
+num_textures = 1
+num_lights = 4
 
 texture_coords = data.ArrayLayout(Vector4, num_textures)
 texture_position = data.ArrayLayout(texture_coord_shape, 2)
@@ -55,11 +58,15 @@ class RasterizerLayout(data.Struct):
 
 
 class RasterizerLayoutNDC(data.Struct):
-    """Rasterizer layout with perspective-divided NDC coordinates (1:17 format for 18x18 multipliers)."""
+    """Rasterizer layout with perspective-divided NDC coordinates (3:17 format).
+
+    x and y may lie outside of [0, 1] for triangles accepted by the clipper's guard
+    band, z is always saturated to [0, 1].
+    """
 
     position_ndc: data.ArrayLayout(
-        fixed.UQ(1, 17), 3
-    )  # x/w, y/w, z/w (perspective-divided, UQ(1,17))
+        FixedPoint_ndc, 3
+    )  # x/w, y/w, z/w (perspective-divided, remapped to [0, 1])
     inv_w: FixedPoint  # 1/w in standard FixedPoint format
     texcoords: texture_coords
     color: Vector4
@@ -93,7 +100,11 @@ class FramebufferInfoLayout(data.Struct):
     scissor_width: unsigned(32)
     scissor_height: unsigned(32)
 
-    color_address: address_shape  # assume R8G8B8A8
+    # Buffers and their rows are word aligned, pixels are packed in the rows
+    color_address: address_shape
     color_pitch: stride_shape  # in bytes
-    depthstencil_address: address_shape  # D16_X8_S8 format (32-bit: [15:0]=depth, [23:16]=padding, [31:24]=stencil)
+    depthstencil_address: address_shape
     depthstencil_pitch: stride_shape  # in bytes
+
+    color_format: ColorFormat
+    depthstencil_format: DepthStencilFormat
@@ -1,9 +1,14 @@
+import amaranth_soc.wishbone.bus as wb
 from amaranth import *
-from amaranth.lib.wiring import Component, Out
+from amaranth.lib import fifo, stream, wiring
+from amaranth.lib.wiring import Component, In, Out
+from amaranth.utils import exact_log2
 from amaranth_soc.wishbone.bus import Interface, Signature
 from transactron import *
 from transactron.lib import Forwarder
 
+from .layouts import wb_bus_addr_width, wb_bus_data_width
+
 
 class MemorySystem(Component):
     """
@@ -90,3 +95,127 @@ class MemorySystem(Component):
             ]
 
         return m
+
+
+class StreamPrefetcher(Component):
+    """Reads consecutive words ahead of their consumer.
+
+    ``start`` (re)starts the stream at word ``address``, ``count`` words are read in
+    order into a ``depth`` word buffer and delivered on ``o``. Reads are bursts of
+    ``burst`` beats whenever the next address is aligned to a burst, at least a
+    burst is left and the buffer has room for it, single reads otherwise. Restarting
+    drops everything buffered, a burst in flight is completed and thrown away.
+
+    ``head`` is the address of the word at ``o``, ``left`` the number of words of the
+    stream that are not consumed yet (buffered, in flight or still to be read).
+    """
+
+    bus: Out(
+        wb.Signature(
+            addr_width=wb_bus_addr_width,
+            data_width=wb_bus_data_width,
+            features={wb.Feature.CTI, wb.Feature.BTE},
+        )
+    )
+
+    start: In(1)
+    address: In(wb_bus_addr_width)
+    count: In(32)
+
+    o: Out(stream.Signature(wb_bus_data_width))
+    head: Out(wb_bus_addr_width)
+    left: Out(32)
+
+    def __init__(self, depth: int = 16, burst: int = 8):
+        if burst not in (4, 8, 16) or depth < burst:
+            raise ValueError(f"unsupported burst {burst} for a depth of {depth}")
+        super().__init__()
+        self._depth = depth
+        self._burst = burst
+
+    def elaborate(self, platform):
+        m = Module()
+
+        depth = self._depth
+        burst = self._burst
+        bus = self.bus
+
+        buffer = fifo.SyncFIFOBuffered(width=wb_bus_data_width, depth=depth)
+        m.submodules.buffer = ResetInserter(self.start)(buffer)
+        wiring.connect(m, buffer.r_stream, wiring.flipped(self.o))
+
+        with m.If(self.o.valid & self.o.ready):
+            m.d.sync += [
+                self.head.eq(self.head + 1),
+                self.left.eq(self.left - 1),
+            ]
+
+        read_addr = Signal(wb_bus_addr_width)
+        to_read = Signal(32)
+        bursting = Signal()
+        beat = Signal(range(burst))
+        stale = Signal()  # the transfer in flight belongs to a previous stream
+        done = Signal()
+
+        bte = {
+            4: wb.BurstTypeExt.WRAP_4,
+            8: wb.BurstTypeExt.WRAP_8,
+            16: wb.BurstTypeExt.WRAP_16,
+        }[burst]
+
+        with m.FSM():
+            with m.State("IDLE"):
+                with m.If(~self.start & (to_read != 0)):
+                    with m.If(
+                        (read_addr[: exact_log2(burst)] == 0)
+                        & (to_read >= burst)
+                        & (buffer.w_level <= depth - burst)
+                    ):
+                        m.d.sync += [bursting.eq(1), beat.eq(0)]
+                        m.next = "READ"
+                    with m.Elif(buffer.w_rdy):
+                        m.d.sync += bursting.eq(0)
+                        m.next = "READ"
+
+            with m.State("READ"):
+                m.d.comb += [
+                    bus.cyc.eq(1),
+                    bus.stb.eq(1),
+                    bus.we.eq(0),
+                    bus.sel.eq(~0),
+                    bus.adr.eq(read_addr),
+                    bus.bte.eq(bte),
+                    done.eq(bus.ack & (~bursting | (beat == burst - 1))),
+                ]
+                with m.If(~bursting):
+                    m.d.comb += bus.cti.eq(wb.CycleType.CLASSIC)
+                with m.Elif(beat == burst - 1):
+                    m.d.comb += bus.cti.eq(wb.CycleType.END_OF_BURST)
+                with m.Else():
+                    m.d.comb += bus.cti.eq(wb.CycleType.INCR_BURST)
+
+                with m.If(bus.ack):
+                    m.d.sync += beat.eq(beat + 1)
+                    with m.If(~stale):
+                        m.d.comb += [
+                            buffer.w_data.eq(bus.dat_r),
+                            buffer.w_en.eq(1),
+                        ]
+                        m.d.sync += [
+                            read_addr.eq(read_addr + 1),
+                            to_read.eq(to_read - 1),
+                        ]
+                with m.If(done):
+                    m.d.sync += stale.eq(0)
+                    m.next = "IDLE"
+
+        with m.If(self.start):
+            m.d.sync += [
+                read_addr.eq(self.address),
+                to_read.eq(self.count),
+                self.head.eq(self.address),
+                self.left.eq(self.count),
+                stale.eq(bus.cyc & ~done),
+            ]
+
+        return m
@@ -0,0 +1,37 @@
+from amaranth import *
+from amaranth.lib import data, wiring
+from amaranth.lib.wiring import In, Out
+
+
+class CounterSnapshot(wiring.Component):
+    """Snapshot of free running counters, relative to their values at the last reset.
+
+    ``snapshot`` latches ``counters - base`` into ``values``, ``reset`` moves the base
+    to the current counters (values are left as they are). Counters wrap around, so
+    do the differences. When both are strobed in the same cycle the snapshot is taken
+    first.
+    """
+
+    def __init__(self, num_counters: int, width: int = 32):
+        self._num_counters = num_counters
+        super().__init__(
+            {
+                "counters": In(data.ArrayLayout(unsigned(width), num_counters)),
+                "snapshot": In(1),
+                "reset": In(1),
+                "values": Out(data.ArrayLayout(unsigned(width), num_counters)),
+            }
+        )
+
+    def elaborate(self, platform):
+        m = Module()
+
+        base = Signal.like(self.counters)
+
+        for i in range(self._num_counters):
+            with m.If(self.snapshot):
+                m.d.sync += self.values[i].eq(self.counters[i] - base[i])
+            with m.If(self.reset):
+                m.d.sync += base[i].eq(self.counters[i])
+
+        return m
@@ -22,6 +22,10 @@ Matrix3_mem = data.ArrayLayout(FixedPoint_mem, 9)
 # Framebuffer screen-space coordinates with subpixel precision
 FixedPoint_fb = fixed.SQ(12, 4)  # 16-bit signed with 4 bits subpixel precision
 
+# Perspective-divided coordinates remapped from [-1, 1] to [0, 1]; signed with
+# headroom for vertices inside the clipper's guard band (up to 4x the viewport)
+FixedPoint_ndc = fixed.SQ(3, 17)
+
 # Normalized depth (0.0..1.0) for viewport min/max depth
 FixedPoint_depth = fixed.UQ(
     1, 15
@@ -63,6 +67,20 @@ class InputTopology(enum.Enum, shape=4):
     PATCH_LIST = 10
 
 
+class ColorFormat(enum.Enum, shape=1):
+    """Color buffer formats (bytes in memory order)"""
+
+    B8G8R8A8 = 0
+    R5G6B5 = 1  # 16-bit: [4:0]=B, [10:5]=G, [15:11]=R, no alpha
+
+
+class DepthStencilFormat(enum.Enum, shape=1):
+    """Depth/stencil buffer formats"""
+
+    D16_X8_S8 = 0  # 32-bit: [15:0]=depth, [23:16]=padding, [31:24]=stencil
+    D16 = 1  # 16-bit depth, no stencil (the stencil test always passes)
+
+
 class PrimitiveType(enum.Enum, shape=2):
     POINTS = 0
     LINES = 1
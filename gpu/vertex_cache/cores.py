@@ -0,0 +1,406 @@
+from amaranth import *
+from amaranth.lib import data, stream, wiring
+from amaranth.lib.memory import Memory
+from amaranth.lib.wiring import In, Out
+
+from ..rasterizer.layouts import PrimitiveAssemblyConfigLayout
+from ..utils.layouts import PrimitiveAssemblyLayout, ShadingVertexLayout
+from ..utils.types import CullFace, FixedPoint, FrontFace, PrimitiveType, index_shape
+from .layouts import VertexCacheTicket, vertex_cache_entries
+
+__all__ = ["VertexCacheLookup", "EarlyCull", "VertexCacheMerge"]
+
+
+class VertexCacheLookup(wiring.Component):
+    """Post-transform vertex cache, tag side.
+
+    Sits in front of InputAssembly. Every incoming index is looked up in a small fully
+    associative tag array (round-robin replacement). Only misses are forwarded on ``o``
+    to be fetched and shaded, a ticket with the result is queued for VertexCacheMerge
+    for every index, so the merge can restore the original order.
+
+    ``flush`` (draw boundary) invalidates all tags and queues a marker ticket, it must
+    only be asserted while ``ready``.
+
+    ``lookups`` and ``hits`` count all indices and cache hits, wrapping around.
+    """
+
+    i: In(stream.Signature(index_shape))
+    o: Out(stream.Signature(index_shape))
+    tickets: Out(stream.Signature(VertexCacheTicket))
+
+    c_enable: In(1)
+    flush: In(1)
+    ready: Out(1)
+
+    lookups: Out(32)
+    hits: Out(32)
+
+    def elaborate(self, platform) -> Module:
+        m = Module()
+
+        tags = Array(
+            Signal(index_shape, name=f"tag_{i}") for i in range(vertex_cache_entries)
+        )
+        tag_valid = Signal(vertex_cache_entries)
+        next_slot = Signal(range(vertex_cache_entries))
+
+        matches = Signal(vertex_cache_entries)
+        m.d.comb += matches.eq(
+            Cat(
+                tag_valid[i] & (tags[i] == self.i.payload)
+                for i in range(vertex_cache_entries)
+            )
+        )
+
+        hit = Signal()
+        hit_slot = Signal(range(vertex_cache_entries))
+        m.d.comb += hit.eq(self.c_enable & matches.any())
+        for i in reversed(range(vertex_cache_entries)):
+            with m.If(matches[i]):
+                m.d.comb += hit_slot.eq(i)
+
+        with m.If(self.o.ready):
+            m.d.sync += self.o.valid.eq(0)
+        with m.If(self.tickets.ready):
+            m.d.sync += self.tickets.valid.eq(0)
+
+        output_next_free = ~self.o.valid | self.o.ready
+        ticket_next_free = ~self.tickets.valid | self.tickets.ready
+
+        m.d.comb += [
+            self.ready.eq(~self.tickets.valid),
+            self.i.ready.eq(output_next_free & ticket_next_free & ~self.flush),
+        ]
+
+        with m.If(self.flush):
+            m.d.sync += [
+                tag_valid.eq(0),
+                self.tickets.payload.marker.eq(1),
+                self.tickets.valid.eq(1),
+            ]
+        with m.Elif(self.i.valid & self.i.ready):
+            m.d.sync += [
+                self.tickets.payload.marker.eq(0),
+                self.tickets.payload.hit.eq(hit),
+                self.tickets.valid.eq(1),
+                self.lookups.eq(self.lookups + 1),
+            ]
+            with m.If(hit):
+                m.d.sync += [
+                    self.tickets.payload.slot.eq(hit_slot),
+                    self.hits.eq(self.hits + 1),
+                ]
+            with m.Else():
+                m.d.sync += [
+                    self.tickets.payload.slot.eq(next_slot),
+                    tags[next_slot].eq(self.i.payload),
+                    tag_valid.bit_select(next_slot, 1).eq(1),
+                    next_slot.eq(next_slot + 1),
+                    self.o.payload.eq(self.i.payload),
+                    self.o.valid.eq(1),
+                ]
+
+        return m
+
+
+class EarlyCull(wiring.Component):
+    """Face culling of whole triangles between VertexTransform and VertexShading.
+
+    Replays the tickets of VertexCacheLookup like VertexCacheMerge and keeps the
+    transformed vertices in its own copy of the cache slots. A vertex is only sent on
+    to be shaded (on ``o``, with a miss ticket on ``o_tickets``) once a primitive using
+    it survives, later uses of the slot become hits. The tickets of a culled triangle
+    are dropped, so its vertices are shaded only if another primitive needs them.
+
+    With ``c_enable`` the winding of a triangle is the sign of the homogeneous
+    determinant of the clip-space (x, y, w) of its vertices, which is the sign of its
+    screen-space area while all w are positive (``viewport_flip``: the viewport
+    mirrors one axis). Triangles with a vertex at w <= 0 or a zero determinant are
+    left to TrianglePrep, points and lines are never culled here.
+
+    ``ready`` and ``flush`` work like in VertexCacheMerge, the marker ticket is passed
+    on. ``culled`` counts dropped triangles, wrapping around.
+    """
+
+    i: In(stream.Signature(ShadingVertexLayout))
+    tickets: In(stream.Signature(VertexCacheTicket))
+    o: Out(stream.Signature(ShadingVertexLayout))
+    o_tickets: Out(stream.Signature(VertexCacheTicket))
+
+    c_enable: In(1)
+    pa_conf: In(PrimitiveAssemblyConfigLayout)
+    viewport_flip: In(1)
+
+    flush: In(1)
+    ready: Out(1)
+    culled: Out(32)
+
+    def elaborate(self, platform) -> Module:
+        m = Module()
+
+        # Two generations per slot: a triangle can reference a slot that one of its
+        # later vertices replaces, the old vertex is sent once the triangle survives
+        m.submodules.storage = storage = Memory(
+            shape=ShadingVertexLayout, depth=2 * vertex_cache_entries, init=[]
+        )
+        wr = storage.write_port()
+        rd = storage.read_port()
+
+        ticket = self.tickets.payload
+
+        generation = Signal(vertex_cache_entries)
+        # entries already sent to VertexCacheMerge since they were filled
+        shaded = Signal(2 * vertex_cache_entries)
+
+        hit_entry = Signal(range(2 * vertex_cache_entries))
+        miss_entry = Signal(range(2 * vertex_cache_entries))
+        slot_generation = generation.bit_select(ticket.slot, 1)
+        m.d.comb += [
+            hit_entry.eq(Cat(ticket.slot, slot_generation)),
+            miss_entry.eq(Cat(ticket.slot, ~slot_generation)),
+        ]
+
+        needed = Signal(range(4))
+        with m.Switch(self.pa_conf.type):
+            with m.Case(PrimitiveType.POINTS):
+                m.d.comb += needed.eq(1)
+            with m.Case(PrimitiveType.LINES):
+                m.d.comb += needed.eq(2)
+            with m.Default():
+                m.d.comb += needed.eq(3)
+
+        idx = Signal(range(3))
+        entries = Signal(data.ArrayLayout(range(2 * vertex_cache_entries), 3))
+        # clip-space x, y and w of the collected vertices
+        pos = Signal(data.ArrayLayout(data.ArrayLayout(FixedPoint, 3), 3))
+
+        # Exact determinant on a single shared multiplier: 2x2 cofactors of y and w
+        # are 2n+1 bits wide, multiplied by x and summed they need 3n+3 bits
+        coord_bits = FixedPoint.as_shape().width
+        mul_a = Signal(signed(coord_bits))
+        mul_b = Signal(signed(2 * coord_bits + 1))
+        mul_p = Signal(signed(3 * coord_bits + 1))
+        m.d.comb += mul_p.eq(mul_a * mul_b)
+        cofactor = Signal(signed(2 * coord_bits + 1))
+        det = Signal(signed(3 * coord_bits + 3))
+
+        def x(v):
+            return pos[v][0].as_value()
+
+        def y(v):
+            return pos[v][1].as_value()
+
+        def w(v):
+            return pos[v][2].as_value()
+
+        cull_front = (self.pa_conf.cull & CullFace.FRONT) == CullFace.FRONT
+        cull_back = (self.pa_conf.cull & CullFace.BACK) == CullFace.BACK
+        test = (
+            self.c_enable
+            & (self.pa_conf.type == PrimitiveType.TRIANGLES)
+            & (cull_front | cull_back)
+        )
+
+        def collected(vertex):
+            m.d.sync += [
+                pos[idx][0].eq(vertex.position_proj[0]),
+                pos[idx][1].eq(vertex.position_proj[1]),
+                pos[idx][2].eq(vertex.position_proj[3]),
+            ]
+            with m.If(idx == needed - 1):
+                m.d.sync += idx.eq(0)
+                with m.If(test):
+                    m.next = "DET_0_0"
+                with m.Else():
+                    m.next = "SEND_READ"
+            with m.Else():
+                m.d.sync += idx.eq(idx + 1)
+                m.next = "COLLECT"
+
+        with m.If(self.o.ready):
+            m.d.sync += self.o.valid.eq(0)
+        with m.If(self.o_tickets.ready):
+            m.d.sync += self.o_tickets.valid.eq(0)
+
+        outputs_next_free = (~self.o.valid | self.o.ready) & (
+            ~self.o_tickets.valid | self.o_tickets.ready
+        )
+
+        with m.FSM():
+            with m.State("COLLECT"):
+                m.d.comb += self.ready.eq(
+                    (idx == 0)
+                    & ~self.o_tickets.valid
+                    & (~self.tickets.valid | ticket.marker)
+                )
+
+                with m.If(self.flush & self.tickets.valid & ticket.marker):
+                    m.d.comb += self.tickets.ready.eq(1)
+                    m.d.sync += [
+                        shaded.eq(0),
+                        self.o_tickets.payload.eq(ticket),
+                        self.o_tickets.valid.eq(1),
+                    ]
+                with m.Elif(self.tickets.valid & ~ticket.marker):
+                    with m.If(ticket.hit):
+                        m.d.comb += [
+                            rd.addr.eq(hit_entry),
+                            self.tickets.ready.eq(1),
+                        ]
+                        m.d.sync += entries[idx].eq(hit_entry)
+                        m.next = "HIT_READ"
+                    with m.Elif(self.i.valid):
+                        m.d.comb += [
+                            wr.addr.eq(miss_entry),
+                            wr.data.eq(self.i.payload),
+                            wr.en.eq(1),
+                            self.i.ready.eq(1),
+                            self.tickets.ready.eq(1),
+                        ]
+                        m.d.sync += [
+                            entries[idx].eq(miss_entry),
+                            generation.bit_select(ticket.slot, 1).eq(~slot_generation),
+                            shaded.bit_select(miss_entry, 1).eq(0),
+                        ]
+                        collected(self.i.payload)
+
+            with m.State("HIT_READ"):
+                collected(rd.data)
+
+            # det = x0 * (y1 w2 - y2 w1) + x1 * (y2 w0 - y0 w2) + x2 * (y0 w1 - y1 w0)
+            for v in range(3):
+                a, b = (v + 1) % 3, (v + 2) % 3
+                with m.State(f"DET_{v}_0"):
+                    m.d.comb += [mul_a.eq(y(a)), mul_b.eq(w(b))]
+                    m.d.sync += cofactor.eq(mul_p)
+                    m.next = f"DET_{v}_1"
+                with m.State(f"DET_{v}_1"):
+                    m.d.comb += [mul_a.eq(y(b)), mul_b.eq(w(a))]
+                    m.d.sync += cofactor.eq(cofactor - mul_p)
+                    m.next = f"DET_{v}_2"
+                with m.State(f"DET_{v}_2"):
+                    m.d.comb += [mul_a.eq(x(v)), mul_b.eq(cofactor)]
+                    m.d.sync += det.eq(mul_p if v == 0 else det + mul_p)
+                    m.next = f"DET_{v + 1}_0" if v < 2 else "CULLING"
+
+            with m.State("CULLING"):
+                in_front = Signal()
+                ff = Signal()
+                m.d.comb += [
+                    in_front.eq(Cat(w(v) > 0 for v in range(3)).all()),
+                    ff.eq(
+                        (det > 0)
+                        ^ self.viewport_flip
+                        ^ (self.pa_conf.winding == FrontFace.CW)
+                    ),
+                ]
+                with m.If(
+                    (self.pa_conf.cull == CullFace.FRONT_AND_BACK)
+                    | (in_front & (det != 0) & Mux(ff, cull_front, cull_back))
+                ):
+                    m.d.sync += self.culled.eq(self.culled + 1)
+                    m.next = "COLLECT"
+                with m.Else():
+                    m.next = "SEND_READ"
+
+            with m.State("SEND_READ"):
+                m.d.comb += rd.addr.eq(entries[idx])
+                m.next = "SEND"
+
+            with m.State("SEND"):
+                entry = entries[idx]
+                hit = shaded.bit_select(entry, 1)
+                m.d.comb += rd.addr.eq(entry)
+                with m.If(outputs_next_free):
+                    m.d.sync += [
+                        self.o_tickets.payload.marker.eq(0),
+                        self.o_tickets.payload.hit.eq(hit),
+                        self.o_tickets.payload.slot.eq(entry[: len(ticket.slot)]),
+                        self.o_tickets.valid.eq(1),
+                        shaded.bit_select(entry, 1).eq(1),
+                    ]
+                    with m.If(~hit):
+                        m.d.sync += [
+                            self.o.payload.eq(rd.data),
+                            self.o.valid.eq(1),
+                        ]
+                    with m.If(idx == needed - 1):
+                        m.d.sync += idx.eq(0)
+                        m.next = "COLLECT"
+                    with m.Else():
+                        m.d.sync += idx.eq(idx + 1)
+                        m.next = "SEND_READ"
+
+        return m
+
+
+class VertexCacheMerge(wiring.Component):
+    """Post-transform vertex cache, data side.
+
+    Sits after VertexShading and replays the tickets of VertexCacheLookup in order: a miss
+    takes the next vertex of ``i`` and stores it in the ticket's slot, a hit reads the slot
+    instead. As tickets are consumed in the order the tags were updated, a slot always
+    holds the vertex it was tagged with when the ticket was created.
+
+    ``ready`` is set once all tickets in front of the next marker ticket are processed,
+    ``flush`` consumes that marker ticket.
+    """
+
+    i: In(stream.Signature(PrimitiveAssemblyLayout))
+    tickets: In(stream.Signature(VertexCacheTicket))
+    o: Out(stream.Signature(PrimitiveAssemblyLayout))
+
+    flush: In(1)
+    ready: Out(1)
+
+    def elaborate(self, platform) -> Module:
+        m = Module()
+
+        m.submodules.storage = storage = Memory(
+            shape=PrimitiveAssemblyLayout, depth=vertex_cache_entries, init=[]
+        )
+        wr = storage.write_port()
+        rd = storage.read_port()
+
+        ticket = self.tickets.payload
+
+        with m.If(self.o.ready):
+            m.d.sync += self.o.valid.eq(0)
+
+        output_next_free = ~self.o.valid | self.o.ready
+
+        with m.FSM():
+            with m.State("IDLE"):
+                m.d.comb += self.ready.eq(~self.tickets.valid | ticket.marker)
+
+                with m.If(self.flush & self.tickets.valid & ticket.marker):
+                    m.d.comb += self.tickets.ready.eq(1)
+                with m.Elif(self.tickets.valid & ~ticket.marker & output_next_free):
+                    with m.If(ticket.hit):
+                        m.d.comb += [
+                            rd.addr.eq(ticket.slot),
+                            self.tickets.ready.eq(1),
+                        ]
+                        m.next = "HIT_READ"
+                    with m.Elif(self.i.valid):
+                        m.d.comb += [
+                            wr.addr.eq(ticket.slot),
+                            wr.data.eq(self.i.payload),
+                            wr.en.eq(1),
+                            self.i.ready.eq(1),
+                            self.tickets.ready.eq(1),
+                        ]
+                        m.d.sync += [
+                            self.o.payload.eq(self.i.payload),
+                            self.o.valid.eq(1),
+                        ]
+
+            with m.State("HIT_READ"):
+                m.d.sync += [
+                    self.o.payload.eq(rd.data),
+                    self.o.valid.eq(1),
+                ]
+                m.next = "IDLE"
+
+        return m
@@ -0,0 +1,14 @@
+from amaranth.lib import data
+
+__all__ = ["VertexCacheTicket"]
+
+# replacement is round-robin, so a slot index is enough to address an entry
+vertex_cache_entries = 16
+
+
+class VertexCacheTicket(data.Struct):
+    """Lookup result passed from VertexCacheLookup to VertexCacheMerge, one per index"""
+
+    marker: 1  # draw boundary, matches the marker in the vertex stream
+    hit: 1  # vertex is read from `slot` instead of the shaded stream
+    slot: range(vertex_cache_entries)
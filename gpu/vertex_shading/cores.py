@@ -3,7 +3,7 @@ from amaranth.lib import data, stream, wiring
 from amaranth.lib.wiring import In, Out
 
 from ..utils.layouts import PrimitiveAssemblyLayout, ShadingVertexLayout
-from ..utils.types import FixedPoint, Vector3_mem, Vector4_mem
+from ..utils.types import FixedPoint, Vector3, Vector3_mem, Vector4_mem
 
 
 class LightPropertyLayout(data.Struct):
@@ -31,7 +31,7 @@ class VertexShading(wiring.Component):
     Outputs shaded vertices for rasterization stage.
 
     Input: ShadingVertexLayout
-    Output: ShadingVertexLayout
+    Output: PrimitiveAssemblyLayout
 
     Uses following wires for material properties:
     - material_ambient: Ambient color of the material (vec3)
@@ -41,18 +41,26 @@ class VertexShading(wiring.Component):
 
     Uses following wires for light properties:
     - light: array of light property structures
+    - light_enable: mask of the lights that contribute, disabled ones are skipped
+
+    Lights are evaluated by ``num_lanes`` pipelined lanes, each accepting one light
+    per cycle (12 multipliers per lane), so a vertex spends ceil(enabled / num_lanes)
+    cycles issuing lights plus the pipeline latency. Unlit vertices (empty mask) go
+    straight to the modulation by the vertex color, leaving black.
 
     TODO: for now only directional lights are supported
     """
 
-    def __init__(self, num_lights=1):
+    def __init__(self, num_lights=1, num_lanes=1):
         self._num_lights = num_lights
+        self._num_lanes = min(num_lanes, num_lights)
         super().__init__(
             {
                 "i": In(stream.Signature(ShadingVertexLayout)),
                 "o": Out(stream.Signature(PrimitiveAssemblyLayout)),
                 "material": In(MaterialPropertyLayout),
                 "lights": In(LightPropertyLayout).array(num_lights),
+                "light_enable": In(num_lights),
                 "ready": Out(1),
             }
         )
@@ -60,27 +68,90 @@ class VertexShading(wiring.Component):
     def elaborate(self, platform):
         m = Module()
 
-        # Cached vertex and light data
-        n = Array(Signal(FixedPoint) for _ in range(3))
-        v_color = Array(Signal.like(self.i.p.color[i]) for i in range(4))
+        def fixed_signal(value, name=None):
+            s = Signal(FixedPoint, name=name)
+            m.d.comb += s.eq(value)
+            return s
+
+        def mul(a, b):
+            return fixed_signal(fixed_signal(a) * fixed_signal(b))
+
+        # Cached vertex data
+        n = Signal.like(self.i.p.normal_view)
+        v_color = Signal.like(self.i.p.color)
         v_pos_ndc = Signal.like(self.i.p.position_proj)
         v_texcoords = Signal.like(self.i.p.texcoords)
 
-        # Single shared multiplier
-        mul_a = Signal(FixedPoint)
-        mul_b = Signal(FixedPoint)
-        mul_result = Signal(FixedPoint)
-        m.d.comb += mul_result.eq(mul_a * mul_b)
-
-        # Accumulators for dot product and shading
-        dot_accum = Signal(FixedPoint)
-        dp_clamped = Signal(FixedPoint)
-        amb_accum = Signal(FixedPoint)
-        dif_accum = Signal(FixedPoint)
+        # Lights still to be issued for the current vertex
+        remaining = Signal(self._num_lights)
 
         # Output color (accumulated across all lights)
         out_color = Signal.like(self.o.p.color)
 
+        issue = Signal()
+        lane_valids = []
+        contributions = []
+
+        # Every lane takes the lowest light left over by the previous lanes
+        mask = remaining
+        for lane in range(self._num_lanes):
+            pick = Signal(self._num_lights, name=f"pick_{lane}")
+            m.d.comb += pick.eq(mask & (~mask + 1))
+            mask = mask & ~pick
+
+            light = Signal(LightPropertyLayout, name=f"light_{lane}")
+            for l_idx in range(self._num_lights):
+                with m.If(pick[l_idx]):
+                    m.d.comb += light.eq(self.lights[l_idx])
+
+            # Stage 1: N.L terms, material * light colors
+            s1_valid = Signal(name=f"s1_valid_{lane}")
+            s1_dot = Signal(Vector3, name=f"s1_dot_{lane}")
+            s1_amb = Signal(Vector3, name=f"s1_amb_{lane}")
+            s1_dif = Signal(Vector3, name=f"s1_dif_{lane}")
+            m.d.sync += s1_valid.eq(issue & pick.any())
+            for k in range(3):
+                m.d.sync += [
+                    s1_dot[k].eq(mul(n[k], -light.position[k])),
+                    s1_amb[k].eq(mul(self.material.ambient[k], light.ambient[k])),
+                    s1_dif[k].eq(mul(self.material.diffuse[k], light.diffuse[k])),
+                ]
+
+            # Stage 2: clamped N.L
+            s2_valid = Signal(name=f"s2_valid_{lane}")
+            s2_dp = Signal(FixedPoint, name=f"s2_dp_{lane}")
+            s2_amb = Signal.like(s1_amb, name=f"s2_amb_{lane}")
+            s2_dif = Signal.like(s1_dif, name=f"s2_dif_{lane}")
+            dot = fixed_signal(s1_dot[0] + s1_dot[1] + s1_dot[2])
+            m.d.sync += [
+                s2_valid.eq(s1_valid),
+                s2_dp.eq(Mux(dot > 0, dot, 0)),
+                s2_amb.eq(s1_amb),
+                s2_dif.eq(s1_dif),
+            ]
+
+            # Stage 3: contribution of the light
+            s3_valid = Signal(name=f"s3_valid_{lane}")
+            s3_color = Signal(Vector3, name=f"s3_color_{lane}")
+            m.d.sync += s3_valid.eq(s2_valid)
+            for k in range(3):
+                m.d.sync += s3_color[k].eq(s2_amb[k] + mul(s2_dif[k], s2_dp))
+
+            lane_valids += [s1_valid, s2_valid, s3_valid]
+            contributions.append((s3_valid, s3_color))
+
+        lanes_busy = Signal()
+        m.d.comb += lanes_busy.eq(Cat(lane_valids).any())
+
+        # Accumulate the contributions leaving the lanes
+        for ch_idx in range(3):
+            total = out_color[ch_idx]
+            for valid, color in contributions:
+                term = Signal(FixedPoint)
+                m.d.comb += term.eq(Mux(valid, color[ch_idx], 0))
+                total = fixed_signal(total + term)
+            m.d.sync += out_color[ch_idx].eq(total)
+
         with m.FSM():
             with m.State("IDLE"):
                 m.d.comb += self.i.ready.eq(1)
@@ -89,113 +160,39 @@ class VertexShading(wiring.Component):
                 with m.If(self.i.valid):
                     # Capture input
                     m.d.sync += [
-                        n[0].eq(self.i.p.normal_view[0]),
-                        n[1].eq(self.i.p.normal_view[1]),
-                        n[2].eq(self.i.p.normal_view[2]),
-                    ] + [v_color[i].eq(self.i.p.color[i]) for i in range(4)]
-                    m.d.sync += [
+                        n.eq(self.i.p.normal_view),
+                        v_color.eq(self.i.p.color),
                         v_pos_ndc.eq(self.i.p.position_proj),
                         v_texcoords.eq(self.i.p.texcoords),
                         out_color.eq(0),  # Initialize accumulated color
+                        remaining.eq(self.light_enable),
                     ]
-                    m.d.sync += dot_accum.eq(0)
                     m.d.sync += Print("Shading vtx in: ", self.i.p)
-                    m.next = "DOT_0_LIGHT_0"
-
-            # Nested loops: for each light, compute dot product and per-channel shading
-            for light_idx in range(self._num_lights):
-                # Dot product computation for this light (3 cycles)
-                with m.State(f"DOT_0_LIGHT_{light_idx}"):
-                    m.d.comb += [
-                        mul_a.eq(n[0]),
-                        mul_b.eq(-self.lights[light_idx].position[0]),
-                    ]
-                    m.d.sync += dot_accum.eq(mul_result)
-                    m.next = f"DOT_1_LIGHT_{light_idx}"
-
-                with m.State(f"DOT_1_LIGHT_{light_idx}"):
-                    m.d.comb += [
-                        mul_a.eq(n[1]),
-                        mul_b.eq(-self.lights[light_idx].position[1]),
-                    ]
-                    m.d.sync += dot_accum.eq(dot_accum + mul_result)
-                    m.next = f"DOT_2_LIGHT_{light_idx}"
-
-                with m.State(f"DOT_2_LIGHT_{light_idx}"):
-                    m.d.comb += [
-                        mul_a.eq(n[2]),
-                        mul_b.eq(-self.lights[light_idx].position[2]),
-                    ]
-                    m.d.sync += dot_accum.eq(dot_accum + mul_result)
-                    m.d.sync += dp_clamped.eq(
-                        Mux(dot_accum + mul_result > 0, dot_accum + mul_result, 0)
-                    )
-                    m.next = f"COLOR_AMBIENT_0_LIGHT_{light_idx}"
-
-                # Per-channel shading for this light
+                    with m.If(self.light_enable.any()):
+                        m.next = "LIGHTS"
+                    with m.Else():
+                        m.next = "MODULATE_BY_VERTEX_COLOR"
+
+            with m.State("LIGHTS"):
+                m.d.comb += issue.eq(1)
+                m.d.sync += remaining.eq(mask)
+                with m.If(mask == 0):
+                    m.next = "DRAIN"
+
+            with m.State("DRAIN"):
+                with m.If(~lanes_busy):
+                    m.next = "MODULATE_BY_VERTEX_COLOR"
+
+            # Final modulation by vertex color, alpha is passed through
+            with m.State("MODULATE_BY_VERTEX_COLOR"):
                 for ch_idx in range(3):
-                    next_ch = ch_idx + 1
-                    if next_ch < 3:
-                        next_state_name = f"COLOR_AMBIENT_{next_ch}_LIGHT_{light_idx}"
-                    else:
-                        # Last channel of this light
-                        if light_idx + 1 < self._num_lights:
-                            # Move to next light
-                            next_state_name = f"DOT_0_LIGHT_{light_idx + 1}"
-                        else:
-                            # Last light, last channel -> go to MODULATE
-                            next_state_name = "MODULATE_BY_VERTEX_COLOR_0"
-
-                    with m.State(f"COLOR_AMBIENT_{ch_idx}_LIGHT_{light_idx}"):
-                        m.d.comb += [
-                            mul_a.eq(self.material.ambient[ch_idx]),
-                            mul_b.eq(self.lights[light_idx].ambient[ch_idx]),
-                        ]
-                        m.d.sync += amb_accum.eq(mul_result)
-                        m.next = f"COLOR_DIFFUSE_{ch_idx}_LIGHT_{light_idx}"
-
-                    with m.State(f"COLOR_DIFFUSE_{ch_idx}_LIGHT_{light_idx}"):
-                        m.d.comb += [
-                            mul_a.eq(self.material.diffuse[ch_idx]),
-                            mul_b.eq(self.lights[light_idx].diffuse[ch_idx]),
-                        ]
-                        m.d.sync += dif_accum.eq(mul_result)
-                        m.next = f"COLOR_DIFFUSE_MUL_{ch_idx}_LIGHT_{light_idx}"
-
-                    with m.State(f"COLOR_DIFFUSE_MUL_{ch_idx}_LIGHT_{light_idx}"):
-                        m.d.comb += [
-                            mul_a.eq(dif_accum),
-                            mul_b.eq(dp_clamped),
-                        ]
-                        m.d.sync += dif_accum.eq(mul_result)
-                        m.next = f"COLOR_ACCUMULATE_{ch_idx}_LIGHT_{light_idx}"
-
-                    with m.State(f"COLOR_ACCUMULATE_{ch_idx}_LIGHT_{light_idx}"):
-                        # Accumulate light contribution (add to out_color)
-                        m.d.sync += out_color[ch_idx].eq(
-                            out_color[ch_idx] + amb_accum + dif_accum
-                        )
-                        m.next = next_state_name
-
-            # Final modulation by vertex color (per-channel)
-            for ch_idx in range(3):
-                next_ch = ch_idx + 1
-                next_state_name = (
-                    f"MODULATE_BY_VERTEX_COLOR_{next_ch}" if next_ch < 3 else "SEND"
-                )
-
-                with m.State(f"MODULATE_BY_VERTEX_COLOR_{ch_idx}"):
-                    m.d.comb += [
-                        mul_a.eq(v_color[ch_idx]),
-                        mul_b.eq(out_color[ch_idx]),
-                    ]
                     m.d.sync += out_color[ch_idx].eq(
-                        mul_result.saturate(v_color[ch_idx].shape())
+                        mul(v_color[ch_idx], out_color[ch_idx]).saturate(
+                            v_color[ch_idx].shape()
+                        )
                     )
-                    if ch_idx == 2:
-                        # Last channel: preserve alpha
-                        m.d.sync += out_color[3].eq(v_color[3])
-                    m.next = next_state_name
+                m.d.sync += out_color[3].eq(v_color[3])
+                m.next = "SEND"
 
             with m.State("SEND"):
                 m.d.comb += [
@@ -32,6 +32,8 @@ class VertexTransform(wiring.Component):
     - normal_mv_inv_t: Inverse transpose of Model-View matrix (3x3)
     - texture_transforms: array of texture transformation matrices (4x4) for each texture
 
+    Texture coordinates pass through unchanged while their transform is disabled.
+
     TODO: support for configurable amount of multiplyer circuits (for now 4)
     """
 
@@ -71,6 +73,7 @@ class VertexTransform(wiring.Component):
                 "vector": i_data.position,
                 "enabled": C(1),
                 "dim": 4,
+                "passthrough": False,
             },
             {
                 "name": "POSITION_P",
@@ -79,6 +82,7 @@ class VertexTransform(wiring.Component):
                 "vector": o_data.position_view,
                 "enabled": C(1),
                 "dim": 4,
+                "passthrough": False,
             },
             {
                 "name": "NORMAL",
@@ -87,6 +91,7 @@ class VertexTransform(wiring.Component):
                 "vector": i_data.normal,
                 "enabled": self.enabled.normal,
                 "dim": 3,
+                "passthrough": False,
             },
         ] + [
             {
@@ -96,6 +101,7 @@ class VertexTransform(wiring.Component):
                 "vector": i_data.texcoords[i],
                 "enabled": self.enabled.texture[i],
                 "dim": 4,
+                "passthrough": True,
             }
             for i in range(num_textures)
         ]
@@ -127,9 +133,11 @@ class VertexTransform(wiring.Component):
                     with m.If(attr["enabled"]):
                         m.next = f"{base}_0_0"
                     with m.Else():
-                        # skip transformation - return 0,0,0,1 vector
-                        for j in range(len(attr["result"])):
-                            m.d.sync += attr["result"][j].eq(0.0 if j < 3 else 1.0)
+                        # skip transformation - keep the input (latched in IDLE) or
+                        # return 0,0,0,1 vector
+                        if not attr["passthrough"]:
+                            for j in range(len(attr["result"])):
+                                m.d.sync += attr["result"][j].eq(0.0 if j < 3 else 1.0)
                         m.next = next_state
 
                 for i in range(attr["dim"]):
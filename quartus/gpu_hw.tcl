@@ -86,6 +86,8 @@ add_interface_port avl_index avl_index__read read Output 1
 add_interface_port avl_index avl_index__writedata writedata Output 32
 add_interface_port avl_index avl_index__readdata readdata Input 32
 add_interface_port avl_index avl_index__waitrequest waitrequest Input 1
+add_interface_port avl_index avl_index__burstcount burstcount Output 5
+add_interface_port avl_index avl_index__readdatavalid readdatavalid Input 1
 
 
 #
@@ -121,6 +123,8 @@ add_interface_port avl_vertex avl_vertex__read read Output 1
 add_interface_port avl_vertex avl_vertex__writedata writedata Output 32
 add_interface_port avl_vertex avl_vertex__readdata readdata Input 32
 add_interface_port avl_vertex avl_vertex__waitrequest waitrequest Input 1
+add_interface_port avl_vertex avl_vertex__burstcount burstcount Output 5
+add_interface_port avl_vertex avl_vertex__readdatavalid readdatavalid Input 1
 
 
 #
@@ -156,6 +160,8 @@ add_interface_port avl_color avl_color__read read Output 1
 add_interface_port avl_color avl_color__writedata writedata Output 32
 add_interface_port avl_color avl_color__readdata readdata Input 32
 add_interface_port avl_color avl_color__waitrequest waitrequest Input 1
+add_interface_port avl_color avl_color__burstcount burstcount Output 5
+add_interface_port avl_color avl_color__readdatavalid readdatavalid Input 1
 
 
 #
@@ -191,6 +197,8 @@ add_interface_port avl_depthstencil avl_depthstencil__read read Output 1
 add_interface_port avl_depthstencil avl_depthstencil__writedata writedata Output 32
 add_interface_port avl_depthstencil avl_depthstencil__readdata readdata Input 32
 add_interface_port avl_depthstencil avl_depthstencil__waitrequest waitrequest Input 1
+add_interface_port avl_depthstencil avl_depthstencil__burstcount burstcount Output 5
+add_interface_port avl_depthstencil avl_depthstencil__readdatavalid readdatavalid Input 1
 
 
 #
@@ -208,21 +216,21 @@ add_interface_port clock clk clk Input 1
 
 
 #
-# connection point ready
+# connection point irq
 #
-add_interface ready interrupt end
-set_interface_property ready associatedAddressablePoint csr
-set_interface_property ready associatedClock clock
-set_interface_property ready associatedReset reset
-set_interface_property ready bridgedReceiverOffset ""
-set_interface_property ready bridgesToReceiver ""
-set_interface_property ready ENABLED true
-set_interface_property ready EXPORT_OF ""
-set_interface_property ready PORT_NAME_MAP ""
-set_interface_property ready CMSIS_SVD_VARIABLES ""
-set_interface_property ready SVD_ADDRESS_GROUP ""
+add_interface irq interrupt end
+set_interface_property irq associatedAddressablePoint csr
+set_interface_property irq associatedClock clock
+set_interface_property irq associatedReset reset
+set_interface_property irq bridgedReceiverOffset ""
+set_interface_property irq bridgesToReceiver ""
+set_interface_property irq ENABLED true
+set_interface_property irq EXPORT_OF ""
+set_interface_property irq PORT_NAME_MAP ""
+set_interface_property irq CMSIS_SVD_VARIABLES ""
+set_interface_property irq SVD_ADDRESS_GROUP ""
 
-add_interface_port ready ready irq Output 1
+add_interface_port irq irq irq Output 1
 
 
 #
@@ -3,22 +3,27 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+
+#include "graphics_pipeline_formats.h"
 
 /**
  * Capture a framebuffer to a PNG/PPM file
  *
- * Converts RGBA8 framebuffer data to PNG or PPM format and writes it to disk.
+ * Converts framebuffer data to PNG or PPM format and writes it to disk.
  * The filename extension determines the output format (.png or .ppm).
  *
  * @param filename    Output filename (e.g., "frame_001.png" or "frame_001.ppm")
- * @param buffer      Pointer to framebuffer data (RGBA8 format)
+ * @param buffer      Pointer to framebuffer data
  * @param width       Width in pixels
  * @param height      Height in pixels
  * @param stride      Bytes per scanline (may include padding)
+ * @param color_format Layout of the framebuffer (32-bit BGRA or RGB565)
  * @return            0 on success, -1 on failure
  */
 int frame_capture_rgba(const char *filename, const uint8_t *buffer,
-                       uint32_t width, uint32_t height, uint32_t stride);
+                       uint32_t width, uint32_t height, uint32_t stride,
+                       pixelforge_color_format_t color_format);
 
 /**
  * Generate a timestamped filename
@@ -36,4 +41,71 @@ int frame_capture_gen_filename(char *output, size_t maxlen,
                                const char *prefix, uint32_t frame_num,
                                const char *suffix);
 
+/* =============================
+ * Asynchronous capture
+ *
+ * frame_capture_submit() converts the frame into one of a few preallocated buffers on the
+ * calling thread (a single pass over the framebuffer, NEON vectorized on the HPS) and a
+ * worker thread encodes and writes it. When every buffer is still waiting for the worker
+ * the frame is dropped, so rendering never waits for the disk (unless block_when_full).
+ * ============================= */
+
+typedef enum {
+    FRAME_CAPTURE_PNG = 0,  /* <prefix>_<frame>.png */
+    FRAME_CAPTURE_PPM,      /* <prefix>_<frame>.ppm, uncompressed RGB */
+    FRAME_CAPTURE_RAW,      /* every frame appended to <prefix>.bgra, 32-bit BGRA */
+} frame_capture_format_t;
+
+typedef struct {
+    const char *prefix;
+    frame_capture_format_t format;
+    pixelforge_color_format_t color_format;     /* layout of the submitted frames */
+    uint32_t width;
+    uint32_t height;
+    uint32_t buffers;           /* frames that can be queued, 0 selects 4 */
+    bool block_when_full;       /* wait for a free buffer instead of dropping the frame */
+} frame_capture_config_t;
+
+typedef struct {
+    uint32_t submitted;         /* frames queued for the worker */
+    uint32_t dropped;           /* frames skipped because every buffer was in use */
+    uint32_t written;
+    uint32_t failed;            /* frames the worker could not write */
+} frame_capture_stats_t;
+
+typedef struct frame_capture frame_capture_t;
+
+/**
+ * Allocate the capture buffers and start the worker
+ *
+ * @return            Capture context, NULL on failure or for an unsupported color format
+ */
+frame_capture_t *frame_capture_start(const frame_capture_config_t *config);
+
+/**
+ * Queue a frame in the configured color format
+ *
+ * The frame is copied before returning, it has to be complete (draws retired) and
+ * visible to the CPU, see pixelforge_wait_presented_frame().
+ *
+ * @param frame_num   Frame number used in the file name
+ * @return            true if queued, false if dropped
+ */
+bool frame_capture_submit(frame_capture_t *capture, const uint8_t *buffer, uint32_t stride,
+                          uint32_t frame_num);
+
+/**
+ * Write out the queued frames, stop the worker and free the context
+ *
+ * @param stats       Filled with the totals of this capture if not NULL
+ */
+void frame_capture_stop(frame_capture_t *capture, frame_capture_stats_t *stats);
+
+/**
+ * Parse a format name ("png", "ppm" or "raw")
+ *
+ * @return            0 on success, -1 for an unknown name
+ */
+int frame_capture_parse_format(const char *name, frame_capture_format_t *format);
+
 #endif /* PIXELFORGE_FRAME_CAPTURE_H */
@@ -12,6 +12,8 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "graphics_pipeline_formats.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -28,6 +30,7 @@ typedef int32_t GLsizei;
 typedef int8_t GLbyte;
 typedef int16_t GLshort;
 typedef uint8_t GLubyte;
+typedef uint8_t GLboolean;
 typedef uint16_t GLushort;
 typedef float GLfloat;
 typedef float GLclampf;
@@ -99,6 +102,9 @@ typedef int32_t GLclampx;
 /* Lighting */
 #define GL_LIGHTING                       0x0B50
 #define GL_LIGHT0                         0x4000
+#define GL_LIGHT1                         0x4001
+#define GL_LIGHT2                         0x4002
+#define GL_LIGHT3                         0x4003
 #define GL_AMBIENT                        0x1200
 #define GL_DIFFUSE                        0x1201
 #define GL_SPECULAR                       0x1202
@@ -135,6 +141,34 @@ typedef int32_t GLclampx;
 #define GL_FALSE                          0
 #define GL_TRUE                           1
 
+/* Texturing */
+#define GL_TEXTURE_2D                     0x0DE1
+#define GL_ALPHA                          0x1906
+#define GL_RGB                            0x1907
+#define GL_RGBA                           0x1908
+#define GL_LUMINANCE                      0x1909
+#define GL_LUMINANCE_ALPHA                0x190A
+#define GL_NEAREST                        0x2600
+#define GL_LINEAR                         0x2601
+#define GL_NEAREST_MIPMAP_NEAREST         0x2700
+#define GL_LINEAR_MIPMAP_NEAREST          0x2701
+#define GL_NEAREST_MIPMAP_LINEAR          0x2702
+#define GL_LINEAR_MIPMAP_LINEAR           0x2703
+#define GL_TEXTURE_MAG_FILTER             0x2800
+#define GL_TEXTURE_MIN_FILTER             0x2801
+#define GL_TEXTURE_WRAP_S                 0x2802
+#define GL_TEXTURE_WRAP_T                 0x2803
+#define GL_REPEAT                         0x2901
+#define GL_CLAMP_TO_EDGE                  0x812F
+#define GL_TEXTURE_ENV                    0x2300
+#define GL_TEXTURE_ENV_MODE               0x2200
+#define GL_MODULATE                       0x2100
+#define GL_DECAL                          0x2101
+#define GL_ADD                            0x0104
+
+/* Display lists (desktop GL, not part of ES 1.1) */
+#define GL_COMPILE                        0x1300
+
 /* =========================================================================
  * PixelForge Buffer Objects (Opaque Handles)
  * ============================================================================ */
@@ -153,6 +187,11 @@ void glBufferSubData(GLenum target, size_t offset, size_t size, const void *data
  * Must be called before any other GL functions */
 bool glInit(void);
 
+/* glInit() with the choice of a stencil buffer; without one the depth buffer is
+ * 16 bits per pixel (halving its bandwidth) and the stencil test always passes.
+ * The color format follows the display (B8G8R8A8 or R5G6B5). */
+bool glInitPF(GLboolean stencil);
+
 /* Cleanup and destroy the OpenGL ES context */
 void glDestroy(void);
 
@@ -231,6 +270,23 @@ void glDisableClientState(GLenum array);
 void glVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer);
 void glNormalPointer(GLenum type, GLsizei stride, const GLvoid *pointer);
 void glColorPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer);
+void glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer);
+
+/* ============================================================================
+ * Texturing
+ *
+ * A single texture unit. Images are GL_UNSIGNED_BYTE with power-of-two sizes up to
+ * 1024x1024 and only level 0 is used; there are no mipmaps, so the magnification
+ * filter is also used for minification.
+ * ============================================================================ */
+
+void glGenTextures(GLsizei n, GLuint *textures);
+void glDeleteTextures(GLsizei n, const GLuint *textures);
+void glBindTexture(GLenum target, GLuint texture);
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                  GLint border, GLenum format, GLenum type, const GLvoid *pixels);
+void glTexParameteri(GLenum target, GLenum pname, GLint param);
+void glTexEnvi(GLenum target, GLenum pname, GLint param);
 
 /* ============================================================================
  * Drawing Commands
@@ -239,13 +295,54 @@ void glColorPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *point
 void glDrawArrays(GLenum mode, GLint first, GLsizei count);
 void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices);
 
+/* glFlush() submits the recorded commands, glFinish() also waits until they have executed */
+void glFlush(void);
+void glFinish(void);
+
 /* ============================================================================
  * Buffer Swap
  * ============================================================================ */
 
-/* Swap front and back buffers (implements the swap wait requirement) */
+/* Queue the frame for display once its draws retire; only blocks when no buffer is free */
 void glSwapBuffers(void);
 
+/* ============================================================================
+ * PixelForge Extensions
+ * ============================================================================ */
+
+/* Register words written to / skipped by the command ring since the last reset */
+void glGetCsrStatsPF(GLuint *written, GLuint *skipped, bool reset);
+
+/* Time the host spent waiting for the GPU (stage ready waits and fences) and number of waits */
+void glGetWaitStatsPF(uint64_t *wait_ns, GLuint *waits, bool reset);
+
+/* Frame pacing since the last reset: frames shown, shown more than one refresh after the
+ * previous one, dropped, and time glSwapBuffers() waited for a free buffer */
+void glGetPresentStatsPF(GLuint *presented, GLuint *late, GLuint *dropped, uint64_t *blocked_ns, bool reset);
+
+/* Hardware performance counters since the last reset, `perf` may be NULL to only reset them */
+void glGetPerfCountersPF(pixelforge_perf_counters_t *perf, bool reset);
+
+/* Batches of draws sharing all state, executed by the GPU after a single start.
+ * Like glDrawArrays()/glDrawElements() called once per entry; `basevertex` may be NULL. */
+void glMultiDrawArraysPF(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawcount);
+void glMultiDrawElementsPF(GLenum mode, const GLsizei *count, GLenum type,
+                           const GLvoid *const *indices, const GLint *basevertex, GLsizei drawcount);
+
+/* ============================================================================
+ * Display Lists
+ *
+ * Only GL_COMPILE. The draws of a list are recorded once as resolved command packets
+ * and replayed by the GPU; glCallList() only writes the matrices (the current modelview
+ * times the one recorded for each draw) and the framebuffer into the command ring.
+ * ============================================================================ */
+
+GLuint glGenLists(GLsizei range);
+void glDeleteLists(GLuint list, GLsizei range);
+GLboolean glIsList(GLuint list);
+void glNewList(GLuint list, GLenum mode);
+void glEndList(void);
+void glCallList(GLuint list);
 
 #ifdef __cplusplus
 }
@@ -28,33 +28,310 @@ typedef enum {
     PIXELFORGE_CSR_VTX_SH_0_LIGHT_AMBIENT = 0x01D0u,
     PIXELFORGE_CSR_VTX_SH_0_LIGHT_DIFFUSE = 0x01E0u,
     PIXELFORGE_CSR_VTX_SH_0_LIGHT_SPECULAR = 0x01F0u,
-    PIXELFORGE_CSR_PRIM_TYPE = 0x0200u,
-    PIXELFORGE_CSR_PRIM_CULL = 0x0204u,
-    PIXELFORGE_CSR_PRIM_WINDING = 0x0208u,
-    PIXELFORGE_CSR_FB_WIDTH = 0x020Cu,
-    PIXELFORGE_CSR_FB_HEIGHT = 0x0210u,
-    PIXELFORGE_CSR_FB_VIEWPORT_X = 0x0214u,
-    PIXELFORGE_CSR_FB_VIEWPORT_Y = 0x0218u,
-    PIXELFORGE_CSR_FB_VIEWPORT_WIDTH = 0x021Cu,
-    PIXELFORGE_CSR_FB_VIEWPORT_HEIGHT = 0x0220u,
-    PIXELFORGE_CSR_FB_VIEWPORT_MIN_DEPTH = 0x0224u,
-    PIXELFORGE_CSR_FB_VIEWPORT_MAX_DEPTH = 0x0228u,
-    PIXELFORGE_CSR_FB_SCISSOR_OFFSET_X = 0x022Cu,
-    PIXELFORGE_CSR_FB_SCISSOR_OFFSET_Y = 0x0230u,
-    PIXELFORGE_CSR_FB_SCISSOR_WIDTH = 0x0234u,
-    PIXELFORGE_CSR_FB_SCISSOR_HEIGHT = 0x0238u,
-    PIXELFORGE_CSR_FB_COLOR_ADDRESS = 0x023Cu,
-    PIXELFORGE_CSR_FB_COLOR_PITCH = 0x0240u,
-    PIXELFORGE_CSR_FB_DEPTHSTENCIL_ADDRESS = 0x0244u,
-    PIXELFORGE_CSR_FB_DEPTHSTENCIL_PITCH = 0x0248u,
-    PIXELFORGE_CSR_DS_STENCIL_FRONT = 0x0250u,
-    PIXELFORGE_CSR_DS_STENCIL_BACK = 0x0258u,
-    PIXELFORGE_CSR_DS_DEPTH = 0x0260u,
-    PIXELFORGE_CSR_BLEND_CONFIG = 0x0264u,
-    PIXELFORGE_CSR_READY = 0x0268u,
-    PIXELFORGE_CSR_READY_COMPONENTS = 0x026Cu,
-    PIXELFORGE_CSR_READY_VEC = 0x0270u,
+    PIXELFORGE_CSR_VTX_SH_1_LIGHT_POSITION = 0x0200u,
+    PIXELFORGE_CSR_VTX_SH_1_LIGHT_AMBIENT = 0x0210u,
+    PIXELFORGE_CSR_VTX_SH_1_LIGHT_DIFFUSE = 0x0220u,
+    PIXELFORGE_CSR_VTX_SH_1_LIGHT_SPECULAR = 0x0230u,
+    PIXELFORGE_CSR_VTX_SH_2_LIGHT_POSITION = 0x0240u,
+    PIXELFORGE_CSR_VTX_SH_2_LIGHT_AMBIENT = 0x0250u,
+    PIXELFORGE_CSR_VTX_SH_2_LIGHT_DIFFUSE = 0x0260u,
+    PIXELFORGE_CSR_VTX_SH_2_LIGHT_SPECULAR = 0x0270u,
+    PIXELFORGE_CSR_VTX_SH_3_LIGHT_POSITION = 0x0280u,
+    PIXELFORGE_CSR_VTX_SH_3_LIGHT_AMBIENT = 0x0290u,
+    PIXELFORGE_CSR_VTX_SH_3_LIGHT_DIFFUSE = 0x02A0u,
+    PIXELFORGE_CSR_VTX_SH_3_LIGHT_SPECULAR = 0x02B0u,
+    PIXELFORGE_CSR_PRIM_TYPE = 0x02C0u,
+    PIXELFORGE_CSR_PRIM_CULL = 0x02C4u,
+    PIXELFORGE_CSR_PRIM_WINDING = 0x02C8u,
+    PIXELFORGE_CSR_FB_WIDTH = 0x02CCu,
+    PIXELFORGE_CSR_FB_HEIGHT = 0x02D0u,
+    PIXELFORGE_CSR_FB_VIEWPORT_X = 0x02D4u,
+    PIXELFORGE_CSR_FB_VIEWPORT_Y = 0x02D8u,
+    PIXELFORGE_CSR_FB_VIEWPORT_WIDTH = 0x02DCu,
+    PIXELFORGE_CSR_FB_VIEWPORT_HEIGHT = 0x02E0u,
+    PIXELFORGE_CSR_FB_VIEWPORT_MIN_DEPTH = 0x02E4u,
+    PIXELFORGE_CSR_FB_VIEWPORT_MAX_DEPTH = 0x02E8u,
+    PIXELFORGE_CSR_FB_SCISSOR_OFFSET_X = 0x02ECu,
+    PIXELFORGE_CSR_FB_SCISSOR_OFFSET_Y = 0x02F0u,
+    PIXELFORGE_CSR_FB_SCISSOR_WIDTH = 0x02F4u,
+    PIXELFORGE_CSR_FB_SCISSOR_HEIGHT = 0x02F8u,
+    PIXELFORGE_CSR_FB_COLOR_ADDRESS = 0x02FCu,
+    PIXELFORGE_CSR_FB_COLOR_PITCH = 0x0300u,
+    PIXELFORGE_CSR_FB_DEPTHSTENCIL_ADDRESS = 0x0304u,
+    PIXELFORGE_CSR_FB_DEPTHSTENCIL_PITCH = 0x0308u,
+    PIXELFORGE_CSR_DS_STENCIL_FRONT = 0x0310u,
+    PIXELFORGE_CSR_DS_STENCIL_BACK = 0x0318u,
+    PIXELFORGE_CSR_DS_DEPTH = 0x0320u,
+    PIXELFORGE_CSR_BLEND_CONFIG = 0x0324u,
+    PIXELFORGE_CSR_READY = 0x0328u,
+    PIXELFORGE_CSR_READY_COMPONENTS = 0x032Cu,
+    PIXELFORGE_CSR_READY_VEC = 0x0330u,
+    PIXELFORGE_CSR_CMD_BASE = 0x0334u,
+    PIXELFORGE_CSR_CMD_SIZE = 0x0338u,
+    PIXELFORGE_CSR_CMD_WPTR = 0x033Cu,
+    PIXELFORGE_CSR_CMD_RPTR = 0x0340u,
+    PIXELFORGE_CSR_CMD_ENABLE = 0x0344u,
+    PIXELFORGE_CSR_FENCE_ISSUED = 0x0348u,
+    PIXELFORGE_CSR_FENCE_RETIRED = 0x034Cu,
+    PIXELFORGE_CSR_IRQ_ENABLE = 0x0350u,
+    PIXELFORGE_CSR_IRQ_STATUS = 0x0354u,
+    PIXELFORGE_CSR_CLEAR_FLAGS = 0x0358u,
+    PIXELFORGE_CSR_CLEAR_COLOR = 0x035Cu,
+    PIXELFORGE_CSR_CLEAR_DEPTHSTENCIL = 0x0360u,
+    PIXELFORGE_CSR_CLEAR_START = 0x0364u,
+    PIXELFORGE_CSR_MULTI_DRAW_COUNT = 0x0368u,
+    PIXELFORGE_CSR_VTX_CACHE_ENABLE = 0x036Cu,
+    PIXELFORGE_CSR_VTX_CACHE_LOOKUPS = 0x0370u,
+    PIXELFORGE_CSR_VTX_CACHE_HITS = 0x0374u,
+    PIXELFORGE_CSR_CLIP_GUARD_BAND = 0x0378u,
+    PIXELFORGE_CSR_CLIP_TRIVIAL_ACCEPTS = 0x037Cu,
+    PIXELFORGE_CSR_CLIP_GUARD_BAND_ACCEPTS = 0x0380u,
+    PIXELFORGE_CSR_CLIP_CLIPPED = 0x0384u,
+    PIXELFORGE_CSR_HIZ_ENABLE = 0x0388u,
+    PIXELFORGE_CSR_PERF_SNAPSHOT = 0x038Cu,
+    PIXELFORGE_CSR_PERF_RESET = 0x0390u,
+    PIXELFORGE_CSR_PERF_PENDING = 0x0394u,
+    PIXELFORGE_CSR_PERF_TRIANGLES_IN = 0x0398u,
+    PIXELFORGE_CSR_PERF_TRIANGLES_CLIPPED = 0x039Cu,
+    PIXELFORGE_CSR_PERF_TRIANGLES_CULLED = 0x03A0u,
+    PIXELFORGE_CSR_PERF_TRIANGLES_RASTERIZED = 0x03A4u,
+    PIXELFORGE_CSR_PERF_HIZ_TILE_REJECTS = 0x03A8u,
+    PIXELFORGE_CSR_PERF_COARSE_BLOCK_REJECTS = 0x03ACu,
+    PIXELFORGE_CSR_PERF_FRAGMENTS_GENERATED = 0x03B0u,
+    PIXELFORGE_CSR_PERF_FRAGMENTS_EARLY_Z_REJECTED = 0x03B4u,
+    PIXELFORGE_CSR_PERF_FRAGMENTS_STENCIL_FAILED = 0x03B8u,
+    PIXELFORGE_CSR_PERF_FRAGMENTS_DEPTH_FAILED = 0x03BCu,
+    PIXELFORGE_CSR_PERF_FRAGMENTS_WRITTEN = 0x03C0u,
+    PIXELFORGE_CSR_PERF_FIFO_IDX_TO_TOPO_STALL = 0x03C4u,
+    PIXELFORGE_CSR_PERF_FIFO_IDX_TO_TOPO_STARVE = 0x03C8u,
+    PIXELFORGE_CSR_PERF_FIFO_IDX_TO_TOPO_DRAWS_STALL = 0x03CCu,
+    PIXELFORGE_CSR_PERF_FIFO_IDX_TO_TOPO_DRAWS_STARVE = 0x03D0u,
+    PIXELFORGE_CSR_PERF_FIFO_TOPO_TO_IA_STALL = 0x03D4u,
+    PIXELFORGE_CSR_PERF_FIFO_TOPO_TO_IA_STARVE = 0x03D8u,
+    PIXELFORGE_CSR_PERF_FIFO_VC_TO_IA_STALL = 0x03DCu,
+    PIXELFORGE_CSR_PERF_FIFO_VC_TO_IA_STARVE = 0x03E0u,
+    PIXELFORGE_CSR_PERF_FIFO_VC_TICKETS_STALL = 0x03E4u,
+    PIXELFORGE_CSR_PERF_FIFO_VC_TICKETS_STARVE = 0x03E8u,
+    PIXELFORGE_CSR_PERF_FIFO_IA_TO_VTX_XF_STALL = 0x03ECu,
+    PIXELFORGE_CSR_PERF_FIFO_IA_TO_VTX_XF_STARVE = 0x03F0u,
+    PIXELFORGE_CSR_PERF_FIFO_VTX_XF_TO_CULL_STALL = 0x03F4u,
+    PIXELFORGE_CSR_PERF_FIFO_VTX_XF_TO_CULL_STARVE = 0x03F8u,
+    PIXELFORGE_CSR_PERF_FIFO_CULL_TO_VTX_SH_STALL = 0x03FCu,
+    PIXELFORGE_CSR_PERF_FIFO_CULL_TO_VTX_SH_STARVE = 0x0400u,
+    PIXELFORGE_CSR_PERF_FIFO_CULL_TICKETS_STALL = 0x0404u,
+    PIXELFORGE_CSR_PERF_FIFO_CULL_TICKETS_STARVE = 0x0408u,
+    PIXELFORGE_CSR_PERF_FIFO_VTX_SH_TO_CLIP_STALL = 0x040Cu,
+    PIXELFORGE_CSR_PERF_FIFO_VTX_SH_TO_CLIP_STARVE = 0x0410u,
+    PIXELFORGE_CSR_PERF_FIFO_VC_TO_CLIP_STALL = 0x0414u,
+    PIXELFORGE_CSR_PERF_FIFO_VC_TO_CLIP_STARVE = 0x0418u,
+    PIXELFORGE_CSR_PERF_FIFO_CLIP_TO_DIV_STALL = 0x041Cu,
+    PIXELFORGE_CSR_PERF_FIFO_CLIP_TO_DIV_STARVE = 0x0420u,
+    PIXELFORGE_CSR_PERF_FIFO_DIV_TO_TRI_PREP_STALL = 0x0424u,
+    PIXELFORGE_CSR_PERF_FIFO_DIV_TO_TRI_PREP_STARVE = 0x0428u,
+    PIXELFORGE_CSR_PERF_FIFO_TRI_PREP_TO_RAST_STALL = 0x042Cu,
+    PIXELFORGE_CSR_PERF_FIFO_TRI_PREP_TO_RAST_STARVE = 0x0430u,
+    PIXELFORGE_CSR_PERF_FIFO_RAST_TO_TEX_STALL = 0x0434u,
+    PIXELFORGE_CSR_PERF_FIFO_RAST_TO_TEX_STARVE = 0x0438u,
+    PIXELFORGE_CSR_PERF_FIFO_TEX_TO_DS_STALL = 0x043Cu,
+    PIXELFORGE_CSR_PERF_FIFO_TEX_TO_DS_STARVE = 0x0440u,
+    PIXELFORGE_CSR_PERF_FIFO_DS_TO_SC_STALL = 0x0444u,
+    PIXELFORGE_CSR_PERF_FIFO_DS_TO_SC_STARVE = 0x0448u,
+    PIXELFORGE_CSR_PERF_BUS_INDEX_READ_BEATS = 0x044Cu,
+    PIXELFORGE_CSR_PERF_BUS_INDEX_WRITE_BEATS = 0x0450u,
+    PIXELFORGE_CSR_PERF_BUS_INDEX_WAIT_CYCLES = 0x0454u,
+    PIXELFORGE_CSR_PERF_BUS_VERTEX_READ_BEATS = 0x0458u,
+    PIXELFORGE_CSR_PERF_BUS_VERTEX_WRITE_BEATS = 0x045Cu,
+    PIXELFORGE_CSR_PERF_BUS_VERTEX_WAIT_CYCLES = 0x0460u,
+    PIXELFORGE_CSR_PERF_BUS_DEPTHSTENCIL_READ_BEATS = 0x0464u,
+    PIXELFORGE_CSR_PERF_BUS_DEPTHSTENCIL_WRITE_BEATS = 0x0468u,
+    PIXELFORGE_CSR_PERF_BUS_DEPTHSTENCIL_WAIT_CYCLES = 0x046Cu,
+    PIXELFORGE_CSR_PERF_BUS_COLOR_READ_BEATS = 0x0470u,
+    PIXELFORGE_CSR_PERF_BUS_COLOR_WRITE_BEATS = 0x0474u,
+    PIXELFORGE_CSR_PERF_BUS_COLOR_WAIT_CYCLES = 0x0478u,
+    PIXELFORGE_CSR_PERF_CACHE_DEPTHSTENCIL_LOOKUPS = 0x047Cu,
+    PIXELFORGE_CSR_PERF_CACHE_DEPTHSTENCIL_MISSES = 0x0480u,
+    PIXELFORGE_CSR_PERF_CACHE_COLOR_LOOKUPS = 0x0484u,
+    PIXELFORGE_CSR_PERF_CACHE_COLOR_MISSES = 0x0488u,
+    PIXELFORGE_CSR_PERF_CACHE_TEXTURE_LOOKUPS = 0x048Cu,
+    PIXELFORGE_CSR_PERF_CACHE_TEXTURE_MISSES = 0x0490u,
+    PIXELFORGE_CSR_LIGHTING_ENABLE = 0x0494u,
+    PIXELFORGE_CSR_FB_FORMAT_COLOR = 0x0498u,
+    PIXELFORGE_CSR_FB_FORMAT_DEPTHSTENCIL = 0x049Cu,
+    PIXELFORGE_CSR_TEX_0_ATTR_MODE = 0x04A0u,
+    PIXELFORGE_CSR_TEX_0_ATTR_INFO = 0x04B0u,
+    PIXELFORGE_CSR_TEX_0_TRANSFORM = 0x04C0u,
+    PIXELFORGE_CSR_TEX_ADDRESS = 0x0500u,
+    PIXELFORGE_CSR_TEX_CONFIG = 0x0504u,
+    PIXELFORGE_CSR_EARLY_CULL_ENABLE = 0x0508u,
+    PIXELFORGE_CSR_EARLY_CULL_CULLED = 0x050Cu,
 } pixelforge_csr_offsets_t;
 
+#define PIXELFORGE_CSR_MAP_SIZE 0x0510u
+
+/* X(name, byte address, byte size, shadow) */
+#define PIXELFORGE_CSR_REGISTERS(X) \
+    X(IDX_ADDRESS, 0x0000u, 4u, 1) \
+    X(IDX_COUNT, 0x0004u, 4u, 1) \
+    X(IDX_KIND, 0x0008u, 4u, 1) \
+    X(IDX_START, 0x000Cu, 4u, 0) \
+    X(TOPO_INPUT_TOPOLOGY, 0x0010u, 4u, 1) \
+    X(TOPO_PRIMITIVE_RESTART_ENABLE, 0x0014u, 4u, 1) \
+    X(TOPO_PRIMITIVE_RESTART_INDEX, 0x0018u, 4u, 1) \
+    X(TOPO_BASE_VERTEX, 0x001Cu, 4u, 1) \
+    X(IA_POS_MODE, 0x0020u, 4u, 1) \
+    X(IA_POS_INFO, 0x0030u, 16u, 1) \
+    X(IA_NORM_MODE, 0x0040u, 4u, 1) \
+    X(IA_NORM_INFO, 0x0050u, 16u, 1) \
+    X(IA_COL_MODE, 0x0060u, 4u, 1) \
+    X(IA_COL_INFO, 0x0070u, 16u, 1) \
+    X(VTX_XF_ENABLED, 0x0080u, 4u, 1) \
+    X(VTX_XF_POSITION_MV, 0x00C0u, 64u, 1) \
+    X(VTX_XF_POSITION_P, 0x0100u, 64u, 1) \
+    X(VTX_XF_NORMAL_MV_INV_T, 0x0140u, 64u, 1) \
+    X(VTX_SH_MATERIAL_AMBIENT, 0x0180u, 16u, 1) \
+    X(VTX_SH_MATERIAL_DIFFUSE, 0x0190u, 16u, 1) \
+    X(VTX_SH_MATERIAL_SPECULAR, 0x01A0u, 16u, 1) \
+    X(VTX_SH_MATERIAL_SHININESS, 0x01B0u, 4u, 1) \
+    X(VTX_SH_0_LIGHT_POSITION, 0x01C0u, 16u, 1) \
+    X(VTX_SH_0_LIGHT_AMBIENT, 0x01D0u, 16u, 1) \
+    X(VTX_SH_0_LIGHT_DIFFUSE, 0x01E0u, 16u, 1) \
+    X(VTX_SH_0_LIGHT_SPECULAR, 0x01F0u, 16u, 1) \
+    X(VTX_SH_1_LIGHT_POSITION, 0x0200u, 16u, 1) \
+    X(VTX_SH_1_LIGHT_AMBIENT, 0x0210u, 16u, 1) \
+    X(VTX_SH_1_LIGHT_DIFFUSE, 0x0220u, 16u, 1) \
+    X(VTX_SH_1_LIGHT_SPECULAR, 0x0230u, 16u, 1) \
+    X(VTX_SH_2_LIGHT_POSITION, 0x0240u, 16u, 1) \
+    X(VTX_SH_2_LIGHT_AMBIENT, 0x0250u, 16u, 1) \
+    X(VTX_SH_2_LIGHT_DIFFUSE, 0x0260u, 16u, 1) \
+    X(VTX_SH_2_LIGHT_SPECULAR, 0x0270u, 16u, 1) \
+    X(VTX_SH_3_LIGHT_POSITION, 0x0280u, 16u, 1) \
+    X(VTX_SH_3_LIGHT_AMBIENT, 0x0290u, 16u, 1) \
+    X(VTX_SH_3_LIGHT_DIFFUSE, 0x02A0u, 16u, 1) \
+    X(VTX_SH_3_LIGHT_SPECULAR, 0x02B0u, 16u, 1) \
+    X(PRIM_TYPE, 0x02C0u, 4u, 1) \
+    X(PRIM_CULL, 0x02C4u, 4u, 1) \
+    X(PRIM_WINDING, 0x02C8u, 4u, 1) \
+    X(FB_WIDTH, 0x02CCu, 4u, 1) \
+    X(FB_HEIGHT, 0x02D0u, 4u, 1) \
+    X(FB_VIEWPORT_X, 0x02D4u, 4u, 1) \
+    X(FB_VIEWPORT_Y, 0x02D8u, 4u, 1) \
+    X(FB_VIEWPORT_WIDTH, 0x02DCu, 4u, 1) \
+    X(FB_VIEWPORT_HEIGHT, 0x02E0u, 4u, 1) \
+    X(FB_VIEWPORT_MIN_DEPTH, 0x02E4u, 4u, 1) \
+    X(FB_VIEWPORT_MAX_DEPTH, 0x02E8u, 4u, 1) \
+    X(FB_SCISSOR_OFFSET_X, 0x02ECu, 4u, 1) \
+    X(FB_SCISSOR_OFFSET_Y, 0x02F0u, 4u, 1) \
+    X(FB_SCISSOR_WIDTH, 0x02F4u, 4u, 1) \
+    X(FB_SCISSOR_HEIGHT, 0x02F8u, 4u, 1) \
+    X(FB_COLOR_ADDRESS, 0x02FCu, 4u, 1) \
+    X(FB_COLOR_PITCH, 0x0300u, 4u, 1) \
+    X(FB_DEPTHSTENCIL_ADDRESS, 0x0304u, 4u, 1) \
+    X(FB_DEPTHSTENCIL_PITCH, 0x0308u, 4u, 1) \
+    X(DS_STENCIL_FRONT, 0x0310u, 8u, 1) \
+    X(DS_STENCIL_BACK, 0x0318u, 8u, 1) \
+    X(DS_DEPTH, 0x0320u, 4u, 1) \
+    X(BLEND_CONFIG, 0x0324u, 4u, 1) \
+    X(READY, 0x0328u, 4u, 0) \
+    X(READY_COMPONENTS, 0x032Cu, 4u, 0) \
+    X(READY_VEC, 0x0330u, 4u, 0) \
+    X(CMD_BASE, 0x0334u, 4u, 1) \
+    X(CMD_SIZE, 0x0338u, 4u, 1) \
+    X(CMD_WPTR, 0x033Cu, 4u, 1) \
+    X(CMD_RPTR, 0x0340u, 4u, 0) \
+    X(CMD_ENABLE, 0x0344u, 4u, 1) \
+    X(FENCE_ISSUED, 0x0348u, 4u, 0) \
+    X(FENCE_RETIRED, 0x034Cu, 4u, 0) \
+    X(IRQ_ENABLE, 0x0350u, 4u, 1) \
+    X(IRQ_STATUS, 0x0354u, 4u, 0) \
+    X(CLEAR_FLAGS, 0x0358u, 4u, 1) \
+    X(CLEAR_COLOR, 0x035Cu, 4u, 1) \
+    X(CLEAR_DEPTHSTENCIL, 0x0360u, 4u, 1) \
+    X(CLEAR_START, 0x0364u, 4u, 0) \
+    X(MULTI_DRAW_COUNT, 0x0368u, 4u, 1) \
+    X(VTX_CACHE_ENABLE, 0x036Cu, 4u, 1) \
+    X(VTX_CACHE_LOOKUPS, 0x0370u, 4u, 0) \
+    X(VTX_CACHE_HITS, 0x0374u, 4u, 0) \
+    X(CLIP_GUARD_BAND, 0x0378u, 4u, 1) \
+    X(CLIP_TRIVIAL_ACCEPTS, 0x037Cu, 4u, 0) \
+    X(CLIP_GUARD_BAND_ACCEPTS, 0x0380u, 4u, 0) \
+    X(CLIP_CLIPPED, 0x0384u, 4u, 0) \
+    X(HIZ_ENABLE, 0x0388u, 4u, 1) \
+    X(PERF_SNAPSHOT, 0x038Cu, 4u, 0) \
+    X(PERF_RESET, 0x0390u, 4u, 0) \
+    X(PERF_PENDING, 0x0394u, 4u, 0) \
+    X(PERF_TRIANGLES_IN, 0x0398u, 4u, 0) \
+    X(PERF_TRIANGLES_CLIPPED, 0x039Cu, 4u, 0) \
+    X(PERF_TRIANGLES_CULLED, 0x03A0u, 4u, 0) \
+    X(PERF_TRIANGLES_RASTERIZED, 0x03A4u, 4u, 0) \
+    X(PERF_HIZ_TILE_REJECTS, 0x03A8u, 4u, 0) \
+    X(PERF_COARSE_BLOCK_REJECTS, 0x03ACu, 4u, 0) \
+    X(PERF_FRAGMENTS_GENERATED, 0x03B0u, 4u, 0) \
+    X(PERF_FRAGMENTS_EARLY_Z_REJECTED, 0x03B4u, 4u, 0) \
+    X(PERF_FRAGMENTS_STENCIL_FAILED, 0x03B8u, 4u, 0) \
+    X(PERF_FRAGMENTS_DEPTH_FAILED, 0x03BCu, 4u, 0) \
+    X(PERF_FRAGMENTS_WRITTEN, 0x03C0u, 4u, 0) \
+    X(PERF_FIFO_IDX_TO_TOPO_STALL, 0x03C4u, 4u, 0) \
+    X(PERF_FIFO_IDX_TO_TOPO_STARVE, 0x03C8u, 4u, 0) \
+    X(PERF_FIFO_IDX_TO_TOPO_DRAWS_STALL, 0x03CCu, 4u, 0) \
+    X(PERF_FIFO_IDX_TO_TOPO_DRAWS_STARVE, 0x03D0u, 4u, 0) \
+    X(PERF_FIFO_TOPO_TO_IA_STALL, 0x03D4u, 4u, 0) \
+    X(PERF_FIFO_TOPO_TO_IA_STARVE, 0x03D8u, 4u, 0) \
+    X(PERF_FIFO_VC_TO_IA_STALL, 0x03DCu, 4u, 0) \
+    X(PERF_FIFO_VC_TO_IA_STARVE, 0x03E0u, 4u, 0) \
+    X(PERF_FIFO_VC_TICKETS_STALL, 0x03E4u, 4u, 0) \
+    X(PERF_FIFO_VC_TICKETS_STARVE, 0x03E8u, 4u, 0) \
+    X(PERF_FIFO_IA_TO_VTX_XF_STALL, 0x03ECu, 4u, 0) \
+    X(PERF_FIFO_IA_TO_VTX_XF_STARVE, 0x03F0u, 4u, 0) \
+    X(PERF_FIFO_VTX_XF_TO_CULL_STALL, 0x03F4u, 4u, 0) \
+    X(PERF_FIFO_VTX_XF_TO_CULL_STARVE, 0x03F8u, 4u, 0) \
+    X(PERF_FIFO_CULL_TO_VTX_SH_STALL, 0x03FCu, 4u, 0) \
+    X(PERF_FIFO_CULL_TO_VTX_SH_STARVE, 0x0400u, 4u, 0) \
+    X(PERF_FIFO_CULL_TICKETS_STALL, 0x0404u, 4u, 0) \
+    X(PERF_FIFO_CULL_TICKETS_STARVE, 0x0408u, 4u, 0) \
+    X(PERF_FIFO_VTX_SH_TO_CLIP_STALL, 0x040Cu, 4u, 0) \
+    X(PERF_FIFO_VTX_SH_TO_CLIP_STARVE, 0x0410u, 4u, 0) \
+    X(PERF_FIFO_VC_TO_CLIP_STALL, 0x0414u, 4u, 0) \
+    X(PERF_FIFO_VC_TO_CLIP_STARVE, 0x0418u, 4u, 0) \
+    X(PERF_FIFO_CLIP_TO_DIV_STALL, 0x041Cu, 4u, 0) \
+    X(PERF_FIFO_CLIP_TO_DIV_STARVE, 0x0420u, 4u, 0) \
+    X(PERF_FIFO_DIV_TO_TRI_PREP_STALL, 0x0424u, 4u, 0) \
+    X(PERF_FIFO_DIV_TO_TRI_PREP_STARVE, 0x0428u, 4u, 0) \
+    X(PERF_FIFO_TRI_PREP_TO_RAST_STALL, 0x042Cu, 4u, 0) \
+    X(PERF_FIFO_TRI_PREP_TO_RAST_STARVE, 0x0430u, 4u, 0) \
+    X(PERF_FIFO_RAST_TO_TEX_STALL, 0x0434u, 4u, 0) \
+    X(PERF_FIFO_RAST_TO_TEX_STARVE, 0x0438u, 4u, 0) \
+    X(PERF_FIFO_TEX_TO_DS_STALL, 0x043Cu, 4u, 0) \
+    X(PERF_FIFO_TEX_TO_DS_STARVE, 0x0440u, 4u, 0) \
+    X(PERF_FIFO_DS_TO_SC_STALL, 0x0444u, 4u, 0) \
+    X(PERF_FIFO_DS_TO_SC_STARVE, 0x0448u, 4u, 0) \
+    X(PERF_BUS_INDEX_READ_BEATS, 0x044Cu, 4u, 0) \
+    X(PERF_BUS_INDEX_WRITE_BEATS, 0x0450u, 4u, 0) \
+    X(PERF_BUS_INDEX_WAIT_CYCLES, 0x0454u, 4u, 0) \
+    X(PERF_BUS_VERTEX_READ_BEATS, 0x0458u, 4u, 0) \
+    X(PERF_BUS_VERTEX_WRITE_BEATS, 0x045Cu, 4u, 0) \
+    X(PERF_BUS_VERTEX_WAIT_CYCLES, 0x0460u, 4u, 0) \
+    X(PERF_BUS_DEPTHSTENCIL_READ_BEATS, 0x0464u, 4u, 0) \
+    X(PERF_BUS_DEPTHSTENCIL_WRITE_BEATS, 0x0468u, 4u, 0) \
+    X(PERF_BUS_DEPTHSTENCIL_WAIT_CYCLES, 0x046Cu, 4u, 0) \
+    X(PERF_BUS_COLOR_READ_BEATS, 0x0470u, 4u, 0) \
+    X(PERF_BUS_COLOR_WRITE_BEATS, 0x0474u, 4u, 0) \
+    X(PERF_BUS_COLOR_WAIT_CYCLES, 0x0478u, 4u, 0) \
+    X(PERF_CACHE_DEPTHSTENCIL_LOOKUPS, 0x047Cu, 4u, 0) \
+    X(PERF_CACHE_DEPTHSTENCIL_MISSES, 0x0480u, 4u, 0) \
+    X(PERF_CACHE_COLOR_LOOKUPS, 0x0484u, 4u, 0) \
+    X(PERF_CACHE_COLOR_MISSES, 0x0488u, 4u, 0) \
+    X(PERF_CACHE_TEXTURE_LOOKUPS, 0x048Cu, 4u, 0) \
+    X(PERF_CACHE_TEXTURE_MISSES, 0x0490u, 4u, 0) \
+    X(LIGHTING_ENABLE, 0x0494u, 4u, 1) \
+    X(FB_FORMAT_COLOR, 0x0498u, 4u, 1) \
+    X(FB_FORMAT_DEPTHSTENCIL, 0x049Cu, 4u, 1) \
+    X(TEX_0_ATTR_MODE, 0x04A0u, 4u, 1) \
+    X(TEX_0_ATTR_INFO, 0x04B0u, 16u, 1) \
+    X(TEX_0_TRANSFORM, 0x04C0u, 64u, 1) \
+    X(TEX_ADDRESS, 0x0500u, 4u, 1) \
+    X(TEX_CONFIG, 0x0504u, 4u, 1) \
+    X(EARLY_CULL_ENABLE, 0x0508u, 4u, 1) \
+    X(EARLY_CULL_CULLED, 0x050Cu, 4u, 0) \
+
 
 #endif /* PIXELFORGE_CSR_H */
@@ -24,6 +24,33 @@ static inline uint32_t pf_csr_read32(volatile uint8_t *base, uint32_t offset) {
     __sync_synchronize();
 }
 
+/* Writes `count` consecutive 32-bit registers starting at `offset` (one barrier pair for the batch) */
+void pf_csr_write_regs(volatile uint8_t *base, uint32_t offset, const uint32_t *values, uint32_t count);
+
+/* =============================
+ * Register Shadow
+ *
+ * Host-side copy of the plain storage registers (`shadow` in PIXELFORGE_CSR_REGISTERS).
+ * Whole-register writes that would not change the value are skipped. Strobes, status
+ * registers and partial writes of multi-word registers are always written.
+ * ============================= */
+#define PF_CSR_SHADOW_WORDS (PIXELFORGE_CSR_MAP_SIZE / 4)
+
+typedef struct {
+    uint32_t value[PF_CSR_SHADOW_WORDS];
+    uint8_t valid[PF_CSR_SHADOW_WORDS];  /* value[] is known to match the GPU */
+    uint32_t hits;                       /* register words skipped as unchanged */
+    uint32_t misses;                     /* register words written */
+} pixelforge_csr_shadow_t;
+
+/* Forget all mirrored values, needed after registers were written around the shadow */
+void pf_csr_shadow_invalidate(pixelforge_csr_shadow_t *s);
+void pf_csr_shadow_reset_stats(pixelforge_csr_shadow_t *s);
+
+/* pf_csr_write_regs() that skips registers the shadow already holds */
+void pf_csr_write_regs_shadowed(volatile uint8_t *base, pixelforge_csr_shadow_t *s,
+                                uint32_t offset, const uint32_t *values, uint32_t count);
+
 /* =============================
  * Index Generator
  * ============================= */
@@ -38,7 +65,7 @@ void pf_csr_set_topology(volatile uint8_t *base, const pixelforge_topo_config_t
 void pf_csr_get_topology(volatile uint8_t *base, pixelforge_topo_config_t *cfg);
 
 /* =============================
- * Input Attributes (position/normal/color)
+ * Input Attributes (position/normal/color/texcoord)
  * ============================= */
 void pf_csr_set_attr_position(volatile uint8_t *base, const pixelforge_input_attr_t *attr);
 void pf_csr_get_attr_position(volatile uint8_t *base, pixelforge_input_attr_t *attr);
@@ -58,6 +85,12 @@ void pf_csr_get_attr_texcoord(volatile uint8_t *base, uint32_t unit, pixelforge_
 void pf_csr_set_vtx_xf(volatile uint8_t *base, const pixelforge_vtx_xf_config_t *cfg);
 void pf_csr_get_vtx_xf(volatile uint8_t *base, pixelforge_vtx_xf_config_t *cfg);
 
+/* =============================
+ * Texturing
+ * ============================= */
+void pf_csr_set_texture(volatile uint8_t *base, const pixelforge_texture_config_t *cfg);
+void pf_csr_get_texture(volatile uint8_t *base, pixelforge_texture_config_t *cfg);
+
 /* =============================
  * Material & Lights
  * ============================= */
@@ -66,6 +99,9 @@ void pf_csr_get_material(volatile uint8_t *base, pixelforge_material_t *mat);
 
 void pf_csr_set_light(volatile uint8_t *base, uint32_t light_idx, const pixelforge_light_t *lit);
 void pf_csr_get_light(volatile uint8_t *base, uint32_t light_idx, pixelforge_light_t *lit);
+/* Bit i enables light i, disabled lights are skipped (only light 0 is enabled after reset) */
+void pf_csr_set_light_enable(volatile uint8_t *base, uint32_t mask);
+uint32_t pf_csr_get_light_enable(volatile uint8_t *base);
 
 /* =============================
  * Primitive Assembly
@@ -94,6 +130,13 @@ void pf_csr_get_depth(volatile uint8_t *base, pixelforge_depth_test_config_t *c)
 void pf_csr_set_blend(volatile uint8_t *base, const pixelforge_blend_config_t *c);
 void pf_csr_get_blend(volatile uint8_t *base, pixelforge_blend_config_t *c);
 
+/* =============================
+ * Fast Clear
+ * ============================= */
+/* Clears the scissor rectangle of the configured framebuffer; counts as one fence sequence number */
+void pf_csr_set_clear(volatile uint8_t *base, const pixelforge_clear_config_t *c);
+void pf_csr_clear_start(volatile uint8_t *base);
+
 /* =============================
  * Status
  * ============================= */
@@ -101,6 +144,130 @@ uint32_t pf_csr_get_ready(volatile uint8_t *base);
 uint32_t pf_csr_get_ready_components(volatile uint8_t *base);
 uint32_t pf_csr_get_ready_vec(volatile uint8_t *base);
 
+/* Number of draws started / fully retired so far (both wrap around) */
+uint32_t pf_csr_get_fence_issued(volatile uint8_t *base);
+uint32_t pf_csr_get_fence_retired(volatile uint8_t *base);
+
+/* The post-transform vertex cache is invalidated at every draw, the counters give its hit rate */
+void pf_csr_set_vtx_cache_enable(volatile uint8_t *base, bool enable);
+void pf_csr_get_vtx_cache_stats(volatile uint8_t *base, pixelforge_vtx_cache_stats_t *stats);
+
+/* Face culls triangles before vertex shading (with the draw's cull mode), the counter gives
+ * the number of triangles dropped there */
+void pf_csr_set_early_cull_enable(volatile uint8_t *base, bool enable);
+uint32_t pf_csr_get_early_culled(volatile uint8_t *base);
+
+/* Guard band is global state, only change it while the pipeline is idle */
+void pf_csr_set_guard_band(volatile uint8_t *base, pixelforge_guard_band_t guard_band);
+pixelforge_guard_band_t pf_csr_get_guard_band(volatile uint8_t *base);
+void pf_csr_get_clip_stats(volatile uint8_t *base, pixelforge_clip_stats_t *stats);
+
+/* The performance counters run continuously. pf_perf_reset() restarts them, pf_perf_read()
+ * takes a consistent snapshot of all of them (both wait for the GPU to acknowledge) */
+extern const char *const pf_perf_fifo_names[PIXELFORGE_PERF_NUM_FIFOS];
+extern const char *const pf_perf_bus_names[PIXELFORGE_PERF_NUM_BUSES];
+void pf_perf_reset(volatile uint8_t *base);
+void pf_perf_read(volatile uint8_t *base, pixelforge_perf_counters_t *perf);
+
+/* Hierarchical Z starts tracking a depth buffer at its next depth fast clear. While enabled,
+ * the host must not write that depth buffer itself (or has to fast clear it afterwards) */
+void pf_csr_set_hiz_enable(volatile uint8_t *base, bool enable);
+
+void pf_csr_set_irq_enable(volatile uint8_t *base, uint32_t mask);
+uint32_t pf_csr_get_irq_status(volatile uint8_t *base);
+void pf_csr_clear_irq_status(volatile uint8_t *base, uint32_t mask);
+
+/* =============================
+ * Command Ring
+ *
+ * Packets are appended to a ring in VRAM and replayed by the GPU command processor.
+ * Nothing is visible to the GPU until pf_cmdbuf_kick() publishes the new write pointer.
+ * While commands are pending the stages report not-ready, so pixelforge_wait_for_gpu_ready()
+ * also waits for everything that has been kicked.
+ * ============================= */
+/* Recorded command list, replayed from the ring with a single CALL packet.
+ * While a list is being recorded (pf_cmdbuf_begin_list) all pf_cmdbuf_* packets go into
+ * the list instead of the ring. Register writes are elided against the list's own shadow,
+ * so a list does not depend on the register state it is called in. */
+typedef struct {
+    volatile uint32_t *words;   /* CPU mapping of the packets */
+    uint32_t phys;              /* GPU address of the packets */
+    uint32_t capacity;          /* bytes available at words */
+    uint32_t size;              /* bytes recorded */
+    uint32_t draws;             /* draws started by one call */
+    bool overflow;              /* packets were dropped, the list must not be called */
+    pixelforge_csr_shadow_t shadow;        /* register values as left by the list */
+    uint8_t written[PF_CSR_SHADOW_WORDS];  /* registers the list writes */
+} pixelforge_cmdlist_t;
+
+typedef struct {
+    volatile uint8_t *csr_base;
+    volatile uint32_t *ring;    /* CPU mapping of the ring (write-combined or uncached) */
+    uint32_t ring_phys;
+    uint32_t size;              /* ring size in bytes */
+    uint32_t head;              /* next byte offset to be written */
+    uint32_t wptr;              /* last write pointer published to the GPU */
+    uint32_t tail;              /* last read pointer observed from the GPU */
+    uint32_t draws;             /* fence.issued value once all recorded draws have started */
+    uint32_t state_wait;        /* stage mask of the open state group, see pf_cmdbuf_begin_state() */
+    pixelforge_csr_shadow_t shadow; /* register values as left by the recorded packets */
+    pixelforge_cmdlist_t *list; /* list being recorded, NULL while recording into the ring */
+} pixelforge_cmdbuf_t;
+
+void pf_cmdbuf_init(pixelforge_cmdbuf_t *cb, volatile uint8_t *csr_base, void *ring_virt, uint32_t ring_phys, uint32_t size);
+void pf_cmdbuf_fini(pixelforge_cmdbuf_t *cb);
+
+void pf_cmdbuf_kick(pixelforge_cmdbuf_t *cb);
+uint32_t pf_cmdbuf_get_rptr(const pixelforge_cmdbuf_t *cb);
+bool pf_cmdbuf_idle(const pixelforge_cmdbuf_t *cb);
+
+void pf_cmdbuf_write_regs(pixelforge_cmdbuf_t *cb, uint32_t offset, const uint32_t *values, uint32_t count);
+void pf_cmdbuf_write32(pixelforge_cmdbuf_t *cb, uint32_t offset, uint32_t value);
+/* Stall command processing until all stages in `stage_mask` (ready_components bits) are ready */
+void pf_cmdbuf_wait_ready(pixelforge_cmdbuf_t *cb, uint32_t stage_mask);
+void pf_cmdbuf_start(pixelforge_cmdbuf_t *cb);
+
+/* Register writes are elided against cb->shadow. Between begin/end the WAIT_READY for
+ * `stage_mask` is only recorded in front of the first write that changes a register,
+ * so re-uploading unchanged state neither costs ring space nor drains the pipeline. */
+void pf_cmdbuf_begin_state(pixelforge_cmdbuf_t *cb, uint32_t stage_mask);
+void pf_cmdbuf_end_state(pixelforge_cmdbuf_t *cb);
+
+/* `virt`/`phys` must stay valid (and unmodified) until the GPU is done with every call */
+void pf_cmdlist_init(pixelforge_cmdlist_t *list, void *virt, uint32_t phys, uint32_t capacity);
+/* Copies the recorded packets to new storage of at least list->size bytes, e.g. from a
+ * host-side scratch buffer into VRAM once the final size is known */
+void pf_cmdlist_move(pixelforge_cmdlist_t *list, void *virt, uint32_t phys);
+
+/* Redirect recording into `list`. With `after` set, the list continues from the register
+ * state `after` leaves behind and must always be called right after it; registers written
+ * from the ring between the two calls must not be written by either list. */
+void pf_cmdbuf_begin_list(pixelforge_cmdbuf_t *cb, pixelforge_cmdlist_t *list, const pixelforge_cmdlist_t *after);
+/* Returns false if the list ran out of space */
+bool pf_cmdbuf_end_list(pixelforge_cmdbuf_t *cb);
+/* Record a CALL of `list` and account for its draws and register writes */
+void pf_cmdbuf_call_list(pixelforge_cmdbuf_t *cb, const pixelforge_cmdlist_t *list);
+
+void pf_cmdbuf_set_idx(pixelforge_cmdbuf_t *cb, const pixelforge_idx_config_t *cfg);
+void pf_cmdbuf_set_topology(pixelforge_cmdbuf_t *cb, const pixelforge_topo_config_t *cfg);
+void pf_cmdbuf_set_attr_position(pixelforge_cmdbuf_t *cb, const pixelforge_input_attr_t *attr);
+void pf_cmdbuf_set_attr_normal(pixelforge_cmdbuf_t *cb, const pixelforge_input_attr_t *attr);
+void pf_cmdbuf_set_attr_color(pixelforge_cmdbuf_t *cb, const pixelforge_input_attr_t *attr);
+void pf_cmdbuf_set_attr_texcoord(pixelforge_cmdbuf_t *cb, uint32_t unit, const pixelforge_input_attr_t *attr);
+void pf_cmdbuf_set_vtx_xf(pixelforge_cmdbuf_t *cb, const pixelforge_vtx_xf_config_t *cfg);
+void pf_cmdbuf_set_texture(pixelforge_cmdbuf_t *cb, const pixelforge_texture_config_t *cfg);
+void pf_cmdbuf_set_material(pixelforge_cmdbuf_t *cb, const pixelforge_material_t *mat);
+void pf_cmdbuf_set_light(pixelforge_cmdbuf_t *cb, uint32_t light_idx, const pixelforge_light_t *lit);
+void pf_cmdbuf_set_light_enable(pixelforge_cmdbuf_t *cb, uint32_t mask);
+void pf_cmdbuf_set_prim(pixelforge_cmdbuf_t *cb, const pixelforge_prim_config_t *cfg);
+void pf_cmdbuf_set_fb(pixelforge_cmdbuf_t *cb, const pixelforge_framebuffer_config_t *cfg);
+void pf_cmdbuf_set_stencil_front(pixelforge_cmdbuf_t *cb, const pixelforge_stencil_op_config_t *c);
+void pf_cmdbuf_set_stencil_back(pixelforge_cmdbuf_t *cb, const pixelforge_stencil_op_config_t *c);
+void pf_cmdbuf_set_depth(pixelforge_cmdbuf_t *cb, const pixelforge_depth_test_config_t *c);
+void pf_cmdbuf_set_blend(pixelforge_cmdbuf_t *cb, const pixelforge_blend_config_t *c);
+void pf_cmdbuf_set_clear(pixelforge_cmdbuf_t *cb, const pixelforge_clear_config_t *c);
+void pf_cmdbuf_clear(pixelforge_cmdbuf_t *cb);
+
 #ifdef __cplusplus
 }
 #endif
@@ -27,8 +27,10 @@ typedef uint16_t pixelforge_index_t;     /* index_shape:   unsigned(16) */
 
 #define PIXELFORGE_MAX_TEXTURE_DIM     4096  /* 12-bit texture coords */
 #define PIXELFORGE_TEXTURE_COORD_WIDTH 12
-#define PIXELFORGE_NUM_TEXTURES        0
-#define PIXELFORGE_NUM_LIGHTS          1
+#define PIXELFORGE_NUM_TEXTURES        1
+#define PIXELFORGE_MAX_TEXTURE_LOG2    10    /* textures up to 1024x1024 texels */
+#define PIXELFORGE_TEXTURE_TILE_SIZE   4     /* textures are stored in 4x4 texel tiles */
+#define PIXELFORGE_NUM_LIGHTS          4
 
 /* ============================================================================
  * Enumerations
@@ -88,6 +90,18 @@ typedef enum {
     PIXELFORGE_WINDING_CW = 1,
 } pixelforge_front_face_t;
 
+/* Color buffer format (bytes in memory order) */
+typedef enum {
+    PIXELFORGE_COLOR_B8G8R8A8 = 0,
+    PIXELFORGE_COLOR_R5G6B5 = 1,    /* 16 bits: [4:0]=B, [10:5]=G, [15:11]=R, no alpha */
+} pixelforge_color_format_t;
+
+/* Depth/stencil buffer format */
+typedef enum {
+    PIXELFORGE_DS_D16_X8_S8 = 0,    /* 32 bits: [15:0]=depth, [31:24]=stencil */
+    PIXELFORGE_DS_D16 = 1,          /* 16 bits, no stencil (the stencil test always passes) */
+} pixelforge_depthstencil_format_t;
+
 /* Depth/stencil comparison operator */
 typedef enum {
     PIXELFORGE_CMP_NEVER = 0,
@@ -135,23 +149,141 @@ typedef enum {
     PIXELFORGE_BLEND_ONE_MINUS_DST_ALPHA = 9,
 } pixelforge_blend_factor_t;
 
+/* Texture filter (minification and magnification) */
+typedef enum {
+    PIXELFORGE_TEXTURE_NEAREST = 0,
+    PIXELFORGE_TEXTURE_LINEAR = 1,
+} pixelforge_texture_filter_t;
+
+/* Texture coordinate wrap mode */
+typedef enum {
+    PIXELFORGE_TEXTURE_REPEAT = 0,
+    PIXELFORGE_TEXTURE_CLAMP_TO_EDGE = 1,
+} pixelforge_texture_wrap_t;
+
+/* Texture environment function (texel combined with the fragment color) */
+typedef enum {
+    PIXELFORGE_TEXENV_MODULATE = 0,
+    PIXELFORGE_TEXENV_REPLACE = 1,
+    PIXELFORGE_TEXENV_DECAL = 2,
+    PIXELFORGE_TEXENV_ADD = 3,
+} pixelforge_texture_env_mode_t;
+
 /* Input vertex attribute mode */
 typedef enum {
     PIXELFORGE_ATTR_CONSTANT = 0,
     PIXELFORGE_ATTR_PER_VERTEX = 1,
 } pixelforge_input_mode_t;
 
+/* Per-vertex attribute component type (matches ComponentType) */
+typedef enum {
+    PIXELFORGE_COMPONENT_FIXED = 0,  /* SQ(16,16), 4 bytes */
+    PIXELFORGE_COMPONENT_S8 = 1,
+    PIXELFORGE_COMPONENT_U8 = 2,
+    PIXELFORGE_COMPONENT_S16 = 3,
+    PIXELFORGE_COMPONENT_U16 = 4,
+} pixelforge_component_type_t;
+
+/* Command ring packet opcodes (gpu/command_processor/layouts.py) */
+typedef enum {
+    PIXELFORGE_CMD_NOP = 0,         /* header + arg words skipped */
+    PIXELFORGE_CMD_WRITE_REGS = 1,  /* header + CSR byte offset + arg data words */
+    PIXELFORGE_CMD_WAIT_READY = 2,  /* header, arg = ready_components mask */
+    PIXELFORGE_CMD_CALL = 3,        /* header (arg = 2) + list address + list size in bytes */
+} pixelforge_cmd_opcode_t;
+
+/* CommandHeader: opcode[7:0], reserved[15:8], arg[31:16] */
+#define PIXELFORGE_CMD_HEADER(opcode, arg) \
+    (((uint32_t)(opcode) & 0xFFu) | (((uint32_t)(arg) & 0xFFFFu) << 16))
+#define PIXELFORGE_CMD_MAX_ARG 0xFFFFu
+
+/* irq.enable / irq.status bits */
+#define PIXELFORGE_IRQ_STAGE_READY(stage) (1u << (stage))  /* stage and all prior stages became ready */
+#define PIXELFORGE_IRQ_RETIRED (1u << 4)                    /* fence.retired advanced */
+
 /* ============================================================================
  * Structures
  * ============================================================================ */
 
 /* Index generator configuration */
 typedef struct {
-    uint32_t address;   /* Start address in index buffer (addr_shape: u32) */
-    uint32_t count;     /* Number of indices (u32) */
+    uint32_t address;   /* Start address in index buffer, or of the draw records (addr_shape: u32) */
+    uint32_t count;     /* Number of indices (u32), unused for multi-draw */
     pixelforge_index_kind_t kind;
+    uint32_t draw_count; /* Number of pixelforge_indirect_draw_t records at address, 0 for a single draw */
 } pixelforge_idx_config_t;
 
+/* Multi-draw record in VRAM (matches IndirectDrawRecord), must be word aligned.
+ * Every record restarts the primitive topology and replaces topo.base_vertex. */
+typedef struct {
+    uint32_t address;     /* Start address in index buffer (ignored for NOT_INDEXED) */
+    uint32_t count;       /* Number of indices, empty records are skipped */
+    uint32_t base_vertex; /* Added to every index (first vertex for NOT_INDEXED) */
+} pixelforge_indirect_draw_t;
+
+/* Post-transform vertex cache counters (both wrap around) */
+typedef struct {
+    uint32_t lookups;   /* indices looked up, one per vertex of every primitive */
+    uint32_t hits;      /* vertices reused without fetch and shading */
+} pixelforge_vtx_cache_stats_t;
+
+/* Clipper guard band, relative to the clip volume. Triangles crossing only the x/y planes
+ * inside it are rasterized unclipped. The clipper narrows it to keep screen coordinates in the
+ * rasterizer's SQ(12,4) range: 4X is used for viewports (at the origin) up to 819 pixels, 2X
+ * up to 1365. */
+typedef enum {
+    PIXELFORGE_GUARD_BAND_OFF = 0,
+    PIXELFORGE_GUARD_BAND_2X = 1,
+    PIXELFORGE_GUARD_BAND_4X = 2,
+} pixelforge_guard_band_t;
+
+/* Clipper counters, in triangles (all wrap around) */
+typedef struct {
+    uint32_t trivial_accepts;       /* fully inside the clip volume */
+    uint32_t guard_band_accepts;    /* crossing x/y planes, inside the guard band */
+    uint32_t clipped;               /* sent through full clipping (near/far or guard band) */
+} pixelforge_clip_stats_t;
+
+/* Performance counter bank, restarted by pf_perf_reset(). FIFOs are listed in pipeline order
+ * (pf_perf_fifo_names), buses are index, vertex, depth/stencil and color */
+#define PIXELFORGE_PERF_NUM_FIFOS 17
+#define PIXELFORGE_PERF_NUM_BUSES 4
+
+typedef struct {
+    uint32_t stall;         /* cycles the producer had data the consumer did not take */
+    uint32_t starve;        /* cycles the consumer was ready but the FIFO was empty */
+} pixelforge_perf_fifo_t;
+
+typedef struct {
+    uint32_t read_beats;
+    uint32_t write_beats;
+    uint32_t wait_cycles;   /* cycles a request waited for the memory (including read latency) */
+} pixelforge_perf_bus_t;
+
+typedef struct {
+    uint32_t lookups;
+    uint32_t misses;
+} pixelforge_perf_cache_t;
+
+typedef struct {
+    uint32_t triangles_in;                  /* assembled triangles, including early culled ones */
+    uint32_t triangles_clipped;
+    uint32_t triangles_culled;              /* early culled, trivially rejected, face culled or empty */
+    uint32_t triangles_rasterized;
+    uint32_t hiz_tile_rejects;
+    uint32_t coarse_block_rejects;
+    uint32_t fragments_generated;
+    uint32_t fragments_early_z_rejected;    /* per-fragment early depth rejects, tiles: hiz_tile_rejects */
+    uint32_t fragments_stencil_failed;
+    uint32_t fragments_depth_failed;
+    uint32_t fragments_written;             /* fragments reaching the color output */
+    pixelforge_perf_fifo_t fifo[PIXELFORGE_PERF_NUM_FIFOS];
+    pixelforge_perf_bus_t bus[PIXELFORGE_PERF_NUM_BUSES];
+    pixelforge_perf_cache_t depthstencil_cache;
+    pixelforge_perf_cache_t color_cache;
+    pixelforge_perf_cache_t texture_cache;
+} pixelforge_perf_counters_t;
+
 /* Topology configuration */
 typedef struct {
     pixelforge_input_topology_t input_topology;
@@ -164,6 +296,8 @@ typedef struct {
  * info is a union in RTL; use the larger constant_value payload (4x FixedPoint_mem)
  * to cover both modes. When mode == CONSTANT, fill constant_value[4].
  * When mode == PER_VERTEX, fill per_vertex.address/stride and ignore constant_value.
+ * A zeroed per_vertex.format reads all components as SQ(16,16). Components must be
+ * naturally aligned, components not in memory (size) default to (0, 0, 0, 1).
  */
 typedef struct {
     pixelforge_input_mode_t mode;
@@ -174,13 +308,19 @@ typedef struct {
         struct {
             uint32_t address;    /* addr_shape: u32 */
             uint16_t stride;     /* stride_shape: u16 */
+            struct {
+                pixelforge_component_type_t type;
+                bool normalized; /* integers to [-1, 1] / [0, 1] instead of their value */
+                uint8_t size;    /* components in memory 1-4, 0 - all */
+            } format;            /* AttrFormat */
         } per_vertex;
     } info;
 } pixelforge_input_attr_t;
 
-/* Vertex transform enablement (num_textures currently 0) */
+/* Vertex transform enablement, texture coordinates pass through unless enabled */
 typedef struct {
     bool normal_enable;
+    bool texture_enable[PIXELFORGE_NUM_TEXTURES];
 } pixelforge_vtx_enable_t;
 
 /* Vertex transform configuration */
@@ -240,6 +380,29 @@ typedef struct {
     uint8_t color_write_mask;  /* RGBA mask */
 } pixelforge_blend_config_t;
 
+/* Texture unit configuration (TextureConfig, 16 bits) and texture address
+ * Textures are B8G8R8A8 with power-of-two sizes, stored in 4x4 texel tiles of 16 words
+ * (pf_texture_texel_offset). The address is 64-byte aligned. */
+typedef struct {
+    bool enabled;
+    pixelforge_texture_filter_t filter;
+    pixelforge_texture_wrap_t wrap_s;
+    pixelforge_texture_wrap_t wrap_t;
+    pixelforge_texture_env_mode_t env_mode;
+    uint8_t width_log2;     /* up to PIXELFORGE_MAX_TEXTURE_LOG2 */
+    uint8_t height_log2;
+    uint32_t address;
+} pixelforge_texture_config_t;
+
+/* Fast clear configuration (ClearConfig) */
+typedef struct {
+    bool color_enable;
+    bool depth_enable;
+    uint8_t stencil_mask;   /* stencil bits to overwrite, 0 leaves stencil untouched */
+    uint32_t color;         /* B8G8R8A8 as stored in memory */
+    uint32_t depthstencil;  /* D16_X8_S8 as stored in memory */
+} pixelforge_clear_config_t;
+
 /* Primitive assembly configuration (5 bits used) */
 typedef struct {
     pixelforge_primitive_type_t type;
@@ -266,10 +429,37 @@ typedef struct {
     uint32_t scissor_width;
     uint32_t scissor_height;
 
+    /* word aligned buffers and pitches */
     uint32_t color_address;
     uint16_t color_pitch;
-    uint32_t depthstencil_address;  /* combined D16_X8_S8 packed buffer */
-    uint16_t depthstencil_pitch;    /* bytes per row (4 bytes per pixel) */
+    uint32_t depthstencil_address;
+    uint16_t depthstencil_pitch;    /* bytes per row */
+
+    uint8_t color_format;           /* pixelforge_color_format_t */
+    uint8_t depthstencil_format;    /* pixelforge_depthstencil_format_t */
 } pixelforge_framebuffer_config_t;
 
+/* Bytes per pixel of the formats */
+static inline uint32_t pf_color_format_size(uint8_t format) {
+    return format == PIXELFORGE_COLOR_R5G6B5 ? 2u : 4u;
+}
+static inline uint32_t pf_depthstencil_format_size(uint8_t format) {
+    return format == PIXELFORGE_DS_D16 ? 2u : 4u;
+}
+
+/* Word offset of texel (x, y) in a tiled texture: tiles are stored row by row, the
+ * texels of a tile row by row (a texture narrower than a tile still has one per row) */
+static inline uint32_t pf_texture_texel_offset(uint32_t x, uint32_t y, uint8_t width_log2) {
+    uint32_t row_log2 = width_log2 > 2 ? width_log2 - 2u : 0u;
+    uint32_t tile = ((y >> 2) << row_log2) | (x >> 2);
+    return (tile << 4) | ((y & 3u) << 2) | (x & 3u);
+}
+
+/* Bytes of a tiled texture */
+static inline uint32_t pf_texture_size(uint8_t width_log2, uint8_t height_log2) {
+    uint32_t tiles_x = width_log2 > 2 ? 1u << (width_log2 - 2u) : 1u;
+    uint32_t tiles_y = height_log2 > 2 ? 1u << (height_log2 - 2u) : 1u;
+    return tiles_x * tiles_y * 64u;
+}
+
 #endif /* PIXELFORGE_FORMATS_H */
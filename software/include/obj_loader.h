@@ -46,4 +46,35 @@ void obj_free(obj_model *model);
 /* Get bounding box of model */
 void obj_get_bounds(const obj_model *model, vec3f *min, vec3f *max);
 
+/* Entries of the GPU post-transform vertex cache (FIFO replacement) */
+#define OBJ_VERTEX_CACHE_SIZE 16
+
+typedef struct {
+    vec3f position;
+    vec3f normal;       /* (0, 0, 1) if not present */
+    vec2f texcoord;     /* (0, 0) if not present */
+} obj_vertex;
+
+/* Shared-vertex triangle list */
+typedef struct {
+    obj_vertex *vertices;   /* in order of first use by the index buffer */
+    size_t num_vertices;
+    void *indices;          /* uint8_t or uint16_t, see index_size */
+    size_t num_indices;     /* Number of triangles * 3 */
+    size_t index_size;      /* 1 if num_vertices <= 256, else 2 */
+} obj_indexed_mesh;
+
+/* Build an indexed mesh from the model: face corners with the same position/texcoord/normal
+ * are merged, triangles are reordered for the vertex cache (Tipsify) and vertices follow their
+ * first use, so vertex fetch is mostly sequential.
+ * Returns 0 on success, -1 on failure (allocation failure or more than 65536 vertices) */
+int obj_build_indexed_mesh(const obj_model *model, obj_indexed_mesh *mesh);
+
+/* Free indexed mesh data */
+void obj_free_indexed_mesh(obj_indexed_mesh *mesh);
+
+/* Average vertex cache misses per triangle for a FIFO cache of `cache_size` entries
+ * (3.0 without any reuse, about 0.6-0.7 for a well-ordered closed mesh) */
+float obj_mesh_acmr(const obj_indexed_mesh *mesh, size_t cache_size);
+
 #endif /* OBJ_LOADER_H */
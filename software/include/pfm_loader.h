@@ -0,0 +1,67 @@
+#ifndef PFM_LOADER_H
+#define PFM_LOADER_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/* PixelForge mesh (.pfm): vertex and index data preconverted offline (obj2pfm) to the formats
+ * input assembly reads, so loading is an mmap and a copy into VRAM.
+ *
+ * File layout (little endian): pfm_header_t, interleaved vertex stream at vertex_offset,
+ * index buffer at index_offset. Both offsets are 16 byte aligned. */
+
+#define PFM_MAGIC 0x314D4650u   /* "PFM1" */
+#define PFM_VERSION 1u
+
+typedef struct {
+    uint32_t offset;        /* byte offset inside a vertex */
+    uint8_t type;           /* pixelforge_component_type_t */
+    uint8_t size;           /* components in memory, 0 - attribute not present */
+    uint8_t normalized;
+    uint8_t _pad;
+} pfm_attribute_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertex_count;
+    uint32_t vertex_stride;
+    uint32_t vertex_offset;     /* file offset of the vertex stream */
+    uint32_t index_count;       /* Number of triangles * 3 (triangle list) */
+    uint32_t index_size;        /* 1 (U8) or 2 (U16) bytes */
+    uint32_t index_offset;      /* file offset of the index buffer */
+    pfm_attribute_t position;
+    pfm_attribute_t normal;
+    pfm_attribute_t texcoord;
+    pfm_attribute_t color;
+    /* object space position = stored position * position_scale + position_bias,
+     * (1, 0) unless positions are quantized */
+    float position_scale[3];
+    float position_bias[3];
+    float bounds_min[3];        /* object space bounding box */
+    float bounds_max[3];
+} pfm_header_t;
+
+/* Mesh mapped from a .pfm file, pointers are valid until pfm_close() */
+typedef struct {
+    const pfm_header_t *header;
+    const void *vertices;       /* vertex_count * vertex_stride bytes */
+    size_t vertex_bytes;
+    const void *indices;        /* index_count * index_size bytes */
+    size_t index_bytes;
+
+    void *map;
+    size_t map_size;
+} pfm_mesh;
+
+/* Map and validate a .pfm file. Returns 0 on success, -1 on failure */
+int pfm_open(const char *filename, pfm_mesh *mesh);
+
+/* Unmap the file */
+void pfm_close(pfm_mesh *mesh);
+
+/* Write a .pfm file from a header (offsets and the magic are filled in) and the streams.
+ * Returns 0 on success, -1 on failure */
+int pfm_write(const char *filename, const pfm_header_t *header, const void *vertices, const void *indices);
+
+#endif /* PFM_LOADER_H */
@@ -9,19 +9,49 @@
 #include "vram_alloc.h"
 #include "vga_dma.h"
 #include "udma_alloc.h"
+#include "graphics_pipeline_csr_access.h"
 
 /* GPU CSR mapping parameters from soc_system.h */
 #define PF_CSR_BASE_PHYS GPU_BASE
 #define PF_CSR_MAP_SIZE GPU_SPAN
 
 /* VRAM allocation parameters */
-#define PF_VRAM_SIZE (64 << 20) /* 64 MB VRAM size */
+#define PF_VRAM_SIZE (56 << 20) /* 56 MB VRAM size, the rest of the DMA memory is left for other regions */
 
-#define FB_DATA_WIDTH 4u  /* Bytes per pixel (32-bit BGRA) */
+
+/* UIO device (/sys/class/uio/uioN/name) delivering the GPU interrupt */
+#define PF_UIO_NAME "pixelforge"
+
+/* Display refresh rate, a frame shown more than one refresh after the previous one is late */
+#define PF_REFRESH_HZ 60u
+
+/* Fences - completion of all draws recorded before pf_fence_insert() */
+typedef struct {
+    uint32_t seq;   /* fence.issued value to be retired */
+} pixelforge_fence_t;
+
+/* Ownership of the three color buffers, see pixelforge_present() */
+typedef enum {
+    PF_BUFFER_FREE = 0,
+    PF_BUFFER_RENDERING,    /* dev->render_buffer */
+    PF_BUFFER_QUEUED,       /* presented, waiting for its draws and for the display */
+    PF_BUFFER_SWAPPING,     /* handed to the VGA DMA, becomes visible at the next vsync */
+    PF_BUFFER_DISPLAYED,    /* being scanned out */
+} pixelforge_buffer_state_t;
+
+/* Frame pacing since the last reset */
+typedef struct {
+    uint32_t presented;     /* frames handed to the display */
+    uint32_t late;          /* frames shown more than one refresh after the previous one */
+    uint32_t dropped;       /* frames replaced by a newer one before being shown (no vsync) */
+    uint32_t blocked;       /* presents that had to wait for a free buffer */
+    uint64_t blocked_ns;    /* time spent waiting for a free buffer */
+} pixelforge_present_stats_t;
 
 typedef struct {
     int memfd;
-    struct udma_buffer vram_dma;  /* DMA-backed VRAM allocation */
+    int uio_fd;                     /* GPU interrupt, -1 if unavailable (falls back to polling) */
+    struct udma_buffer vram_dma;  /* DMA-backed VRAM allocation (cached, see udma_alloc.h) */
     volatile uint8_t *csr_base;
     volatile struct vga_dma_regs *vga_dma_regs;
     struct vram_allocator vram;
@@ -30,21 +60,46 @@ typedef struct {
     uint32_t vram_size;
     uint8_t *buffers[3];
     uint32_t buffer_phys[3];
-    int old_display_buffer;         /* Buffer previously displayed (possibly still being scanned out) */
     int current_display_buffer;     /* Buffer currently being displayed */
     int render_buffer;              /* Buffer being rendered to */
+    uint8_t buffer_state[3];        /* pixelforge_buffer_state_t */
+    pixelforge_fence_t buffer_fence[3]; /* draws into a queued buffer */
+    bool buffer_vsync[3];           /* queued buffer must be shown, even if a newer one is ready */
+    int present_queue[3];           /* queued buffers, oldest first */
+    int present_count;
+    int swapping_buffer;            /* buffer handed to the VGA DMA, -1 if none */
+    int presented_buffer;           /* buffer of the latest pixelforge_present(), -1 before the first */
+    uint64_t last_flip_ns;          /* when the last swap was seen completed */
+    pixelforge_present_stats_t present_stats;
     uint8_t *depthstencil_buffer;
     uint32_t depthstencil_buffer_phys;
     uint32_t x_resolution;
     uint32_t y_resolution;
-    uint32_t data_width;
+    uint8_t color_format;                /* pixelforge_color_format_t, as scanned out by the VGA DMA */
+    uint8_t depthstencil_format;         /* pixelforge_depthstencil_format_t */
+    uint32_t data_width;                 /* Color bytes per pixel */
     size_t buffer_stride;                /* Line pitch in bytes */
     size_t buffer_size;                  /* Single buffer size in bytes */
+    size_t depthstencil_stride;
+    size_t depthstencil_size;
+    uint64_t wait_ns;               /* Time spent in GPU waits (stages ready and fences), for profiling */
+    uint32_t wait_count;            /* Number of such waits */
 } pixelforge_dev;
 
-pixelforge_dev* pixelforge_open_dev(void);
+/* The color format is the one the VGA DMA was generated with (Qsys color_space, reported
+ * in its status register), the depth/stencil format is chosen by the application: D16
+ * halves the depth traffic and footprint when no stencil is needed. */
+pixelforge_dev* pixelforge_open_dev(void);  /* D16_X8_S8 */
+pixelforge_dev* pixelforge_open_dev_ds(pixelforge_depthstencil_format_t depthstencil_format);
 void pixelforge_close_dev(pixelforge_dev *dev);
 
+/* VRAM is mapped cacheable: sync a range for the device after the CPU wrote it (uploads,
+ * CPU clears) and before the GPU or the display reads it, and for the CPU after the GPU
+ * wrote it and before the CPU reads it (frame readback). Both do nothing for uncached VRAM. */
+void pixelforge_vram_sync_for_device(pixelforge_dev *dev, const void *virt, size_t size);
+void pixelforge_vram_sync_for_cpu(pixelforge_dev *dev, const void *virt, size_t size);
+
+/* Present the render buffer after everything drawn into it so far (the caller already waited) */
 void pixelforge_swap_buffers(pixelforge_dev *dev);
 void pixelforge_swap_buffers_novsync(pixelforge_dev *dev);
 
@@ -60,4 +115,28 @@ enum gpu_stage {
 
 bool pixelforge_wait_for_gpu_ready(pixelforge_dev *dev, enum gpu_stage stage, volatile bool *keep_running);
 
+/* Publishes the recorded commands and returns a fence for all draws among them */
+pixelforge_fence_t pf_fence_insert(pixelforge_cmdbuf_t *cb);
+bool pf_fence_poll(pixelforge_dev *dev, pixelforge_fence_t fence);
+/* Sleeps until the fence is retired (or keep_running is cleared) */
+bool pf_fence_wait(pixelforge_dev *dev, pixelforge_fence_t fence, volatile bool *keep_running);
+
+/* Present queue
+ *
+ * pixelforge_present() queues the render buffer to be shown once `fence` retires and the
+ * previous swap has completed, then continues with a free buffer. It only blocks when all
+ * three buffers are queued or on screen. Without `vsync` a queued frame is dropped as soon
+ * as a newer one is ready. The VGA DMA has no interrupt, so retired frames and completed
+ * swaps are picked up whenever the driver waits for the GPU or calls into the queue
+ * (pixelforge_present_poll(), also done by the GLES wrapper on every draw).
+ * pixelforge_close_dev() flushes the queue. */
+void pixelforge_present(pixelforge_dev *dev, pixelforge_fence_t fence, bool vsync);
+void pixelforge_present_poll(pixelforge_dev *dev);
+/* Waits until every queued frame is on screen */
+void pixelforge_present_flush(pixelforge_dev *dev);
+/* Waits for the draws of the latest presented frame and syncs it for the CPU (frame capture).
+ * It stays intact until the next present, NULL if nothing has been presented yet. */
+const uint8_t* pixelforge_wait_presented_frame(pixelforge_dev *dev);
+void pixelforge_get_present_stats(pixelforge_dev *dev, pixelforge_present_stats_t *stats, bool reset);
+
 #endif /* PIXELFORGE_UTILS_H */
@@ -1,20 +1,38 @@
 #ifndef SMALL_ALLOC_H
 #define SMALL_ALLOC_H
 
-// not so optimized but simple malloc implementation for VRAM allocations
+// TLSF-style (two-level segregated fit) allocator for VRAM allocations
 // only supports static memory region for backing storage
+//
+// Block metadata lives in cached CPU memory outside of the managed region,
+// so allocation and free never touch the VRAM itself.
+// malloc, free and in-place realloc are O(1) apart from amortized metadata growth.
 
-// all allocations are aligned to 16 bytes
+// all allocations are aligned to the pool alignment (at least 16 bytes)
 
 #include <stddef.h>
 
 typedef struct pool_t pool_t;
 
-pool_t* small_init(void *memory, size_t size);
+typedef struct {
+    size_t total;           /* bytes managed by the pool */
+    size_t used;            /* bytes in live allocations (after rounding) */
+    size_t high_water;      /* peak of `used` since small_init() */
+    size_t free;            /* bytes in free blocks */
+    size_t largest_free;    /* largest free block, bounds the biggest possible allocation */
+    size_t used_blocks;
+    size_t free_blocks;
+    float fragmentation;    /* 1 - largest_free / free, 0 when all free memory is contiguous */
+} small_stats_t;
+
+// `alignment` must be a power of two, 0 selects the default of 16 bytes
+pool_t* small_init(void *memory, size_t size, size_t alignment);
 void small_destroy(pool_t *pool);
 void *small_malloc(pool_t *pool, size_t size);
+void *small_memalign(pool_t *pool, size_t alignment, size_t size);
 void *small_calloc(pool_t *pool, size_t n, size_t size);
 void *small_realloc(pool_t *pool, void *ptr, size_t size);
 void small_free(pool_t *pool, void* ptr);
+void small_stats(const pool_t *pool, small_stats_t *stats);
 
 #endif /* SMALL_ALLOC_H */
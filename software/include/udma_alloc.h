@@ -1,19 +1,50 @@
 #pragma once
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+/*
+ * Physically contiguous memory shared with the GPU
+ *
+ * Regions are carved out of the buffers of the u-dma-buf kernel driver (/dev/udmabufN,
+ * reserved by the kernel at module load, e.g. `insmod u-dma-buf.ko udmabuf0=0x4000000`).
+ * Every allocation is an independent, page aligned region with its own mapping.
+ *
+ * Cached mappings are not coherent with the FPGA, ownership is handed over explicitly:
+ *  - udma_sync_for_device() after the CPU wrote a range, before the GPU reads or writes it
+ *  - udma_sync_for_cpu() after the GPU wrote a range, before the CPU reads it
+ *
+ * Without the driver the regions come from the memory reserved at UDMA_DEVMEM_PHYS and
+ * are mapped uncached through /dev/mem, the syncs do nothing then.
+ */
+
+#define UDMA_DEVMEM_PHYS 0x3C000000u
+#define UDMA_DEVMEM_SIZE (64u << 20)
+
+typedef enum {
+    UDMA_CACHED = 0,
+    UDMA_WRITE_COMBINED,    /* written by the CPU only (command rings), needs no syncs */
+} udma_mapping_t;
+
+struct udma_pool;
+
 struct udma_buffer {
     uint8_t *virt;
     uint32_t phys;
     size_t size;
-    int dmafd;      /* fd returned by udmabuf ioctl */
-    int memfd;      /* backing memfd */
-    int ctrl_fd;    /* /dev/udmabuf control fd */
+    size_t offset;          /* from the start of the pool */
+    bool cached;            /* GPU accesses need udma_sync_* */
+    struct udma_pool *pool;
 };
 
-int udma_alloc(size_t size, struct udma_buffer *buf);
+int udma_alloc(size_t size, struct udma_buffer *buf);  /* UDMA_CACHED */
+int udma_alloc_mapping(size_t size, udma_mapping_t mapping, struct udma_buffer *buf);
 int udma_free(struct udma_buffer *buf);
 uint32_t udma_get_phys(const struct udma_buffer *buf);
 uint8_t* udma_get_virt(const struct udma_buffer *buf);
 size_t udma_get_size(const struct udma_buffer *buf);
+
+/* `offset` and `size` select a range of the buffer, the cost is proportional to its size */
+int udma_sync_for_device(const struct udma_buffer *buf, size_t offset, size_t size);
+int udma_sync_for_cpu(const struct udma_buffer *buf, size_t offset, size_t size);
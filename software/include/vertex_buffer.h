@@ -58,6 +58,17 @@ static inline int vertex_buffer_free_dma(struct vertex_buffer *vbuf) {
     return ret;
 }
 
+/**
+ * Hand the CPU writes to the GPU, after filling the buffer and before drawing from it
+ *
+ * Returns:
+ *   0 on success, -1 on failure
+ */
+static inline int vertex_buffer_sync_for_device(const struct vertex_buffer *vbuf) {
+    if (!vbuf) return -1;
+    return udma_sync_for_device(&vbuf->buffer, 0, vbuf->buffer.size);
+}
+
 /**
  * Get virtual address of vertex buffer for CPU access
  */
@@ -154,6 +154,7 @@ static void configure_gpu(
     light.ambient[1] = fp16_16(1.0f);
     light.ambient[2] = fp16_16(1.0f);
     pf_csr_set_light(csr, 0, &light);
+    pf_csr_set_light_enable(csr, 1u);
 
     pixelforge_prim_config_t prim = {
         .type = PIXELFORGE_PRIM_TRIANGLES,
@@ -222,10 +223,13 @@ struct layer {
 int main(int argc, char **argv) {
     int frames = 240;
     bool capture_frames = false;
+    frame_capture_format_t capture_format = FRAME_CAPTURE_PNG;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--verbose")) g_verbose = true;
         else if (!strcmp(argv[i], "--capture-frames")) capture_frames = true;
+        else if (!strcmp(argv[i], "--capture-format") && i + 1 < argc)
+            capture_frames = frame_capture_parse_format(argv[++i], &capture_format) == 0;
         else if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames = atoi(argv[++i]);
     }
 
@@ -262,6 +266,7 @@ int main(int argc, char **argv) {
     }
 
     memcpy(vb_block.virt, vertices, QUAD_VERTS * sizeof(vertex));
+    pixelforge_vram_sync_for_device(dev, vb_block.virt, QUAD_VERTS * sizeof(vertex));
     free(vertices);
 
     float p[16];
@@ -294,12 +299,25 @@ int main(int argc, char **argv) {
     printf("PixelForge Alpha Blending Demo\n");
     printf("Rendering %d frames...\n", frames);
 
+    frame_capture_t *capture = NULL;
+    if (capture_frames) {
+        frame_capture_config_t capture_config = {
+            .prefix = "alpha",
+            .format = capture_format,
+            .color_format = dev->color_format,
+            .width = dev->x_resolution,
+            .height = dev->y_resolution,
+        };
+        capture = frame_capture_start(&capture_config);
+    }
+
     for (int frame = 0; frame < frames && keep_running; frame++) {
         float t = (float)frame / 60.0f;
 
         uint8_t *buffer = pixelforge_get_back_buffer(dev);
 
         fill_gradient(buffer, dev);
+        pixelforge_vram_sync_for_device(dev, buffer, dev->buffer_size);
 
         const int layer_count = 6;
         struct layer layers[layer_count];
@@ -349,18 +367,14 @@ int main(int argc, char **argv) {
 
         pixelforge_swap_buffers(dev);
 
-        if (capture_frames) {
-            char filename[256];
-            if (frame_capture_gen_filename(filename, sizeof(filename), "alpha", frame, ".png") == 0) {
-                uint8_t *display_buffer = pixelforge_get_front_buffer(dev);
-                frame_capture_rgba(filename, display_buffer, dev->x_resolution,
-                                 dev->y_resolution, dev->buffer_stride);
-            }
+        if (capture) {
+            frame_capture_submit(capture, pixelforge_wait_presented_frame(dev), dev->buffer_stride, frame);
         }
 
         printf("Frame %d/%d rendered (alpha blend)\n", frame + 1, frames);
     }
 
+    frame_capture_stop(capture, NULL);
     pixelforge_close_dev(dev);
     printf("Done!\n");
     return 0;
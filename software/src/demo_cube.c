@@ -124,6 +124,7 @@ static void configure_gpu(pixelforge_dev *dev, uint32_t idx_addr, uint32_t idx_c
     light.specular[1] = fp16_16(0.0f);
     light.specular[2] = fp16_16(0.0f);
     pf_csr_set_light(csr, 0, &light);
+    pf_csr_set_light_enable(csr, 1u);
 
     /* No face culling; using depth testing instead */
     pixelforge_prim_config_t prim = {
@@ -188,10 +189,13 @@ volatile uint32_t data[1024 * 1024];
 int main(int argc, char **argv) {
     int frames = 90;
     bool capture_frames = false;
+    frame_capture_format_t capture_format = FRAME_CAPTURE_PNG;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--verbose")) g_verbose = true;
         else if (!strcmp(argv[i], "--capture-frames")) capture_frames = true;
+        else if (!strcmp(argv[i], "--capture-format") && i + 1 < argc)
+            capture_frames = frame_capture_parse_format(argv[++i], &capture_format) == 0;
         else if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames = atoi(argv[++i]);
     }
 
@@ -219,6 +223,7 @@ int main(int argc, char **argv) {
     uint16_t *indices = (uint16_t*)(vb_block.virt + sizeof(vertex) * 24);
     uint32_t idx_count;
     demo_create_cube(vertices, indices, &idx_count);
+    pixelforge_vram_sync_for_device(dev, vb_block.virt, VB_REGION_SIZE);
 
     uint32_t idx_addr = vb_block.phys + sizeof(vertex) * 24;
     uint32_t pos_addr = vb_block.phys + offsetof(vertex, pos);
@@ -230,6 +235,18 @@ int main(int argc, char **argv) {
     float p[16];
     mat4_perspective(p, 45.0f * M_PI / 180.0f, (float)dev->x_resolution / (float)dev->y_resolution, 0.5f, 5.0f);
 
+    frame_capture_t *capture = NULL;
+    if (capture_frames) {
+        frame_capture_config_t capture_config = {
+            .prefix = "cube",
+            .format = capture_format,
+            .color_format = dev->color_format,
+            .width = dev->x_resolution,
+            .height = dev->y_resolution,
+        };
+        capture = frame_capture_start(&capture_config);
+    }
+
     /* Animation loop */
     for (int frame = 0; frame < frames && keep_running; frame++) {
         float t = (float)frame / 30.0f;
@@ -239,6 +256,7 @@ int main(int argc, char **argv) {
         uint32_t buffer_phys = dev->buffer_phys[dev->render_buffer];
 
         memset(buffer, 0x10, dev->buffer_size);  /* Dark gray background */
+        pixelforge_vram_sync_for_device(dev, buffer, dev->buffer_size);
 
         /* Build model-view matrix (rotate on all axes + translate back) */
         float rot[16], trans[16], mv[16];
@@ -259,16 +277,12 @@ int main(int argc, char **argv) {
 
         pixelforge_swap_buffers(dev);
 
-        if (capture_frames) {
-            char filename[256];
-            if (frame_capture_gen_filename(filename, sizeof(filename), "cube", frame, ".png") == 0) {
-                uint8_t *display_buffer = pixelforge_get_front_buffer(dev);
-                frame_capture_rgba(filename, display_buffer, dev->x_resolution,
-                                 dev->y_resolution, dev->buffer_stride);
-            }
+        if (capture) {
+            frame_capture_submit(capture, pixelforge_wait_presented_frame(dev), dev->buffer_stride, frame);
         }
     }
 
+    frame_capture_stop(capture, NULL);
     pixelforge_close_dev(dev);
     printf("Done!\n");
     return 0;
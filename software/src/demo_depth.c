@@ -129,6 +129,7 @@ static void configure_gpu(pixelforge_dev *dev, uint32_t idx_addr, uint32_t idx_c
     light.specular[1] = fp16_16(0.0f);
     light.specular[2] = fp16_16(0.0f);
     pf_csr_set_light(csr, 0, &light);
+    pf_csr_set_light_enable(csr, 1u);
 
     pixelforge_prim_config_t prim = {
         .type = PIXELFORGE_PRIM_TRIANGLES,
@@ -191,10 +192,13 @@ static void configure_gpu(pixelforge_dev *dev, uint32_t idx_addr, uint32_t idx_c
 int main(int argc, char **argv) {
     int frames = 120;
     bool capture_frames = false;
+    frame_capture_format_t capture_format = FRAME_CAPTURE_PNG;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--verbose")) g_verbose = true;
         else if (!strcmp(argv[i], "--capture-frames")) capture_frames = true;
+        else if (!strcmp(argv[i], "--capture-format") && i + 1 < argc)
+            capture_frames = frame_capture_parse_format(argv[++i], &capture_format) == 0;
         else if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames = atoi(argv[++i]);
     }
 
@@ -242,11 +246,24 @@ int main(int argc, char **argv) {
         indices[i] = (uint16_t*)(vb_block.virt + 4 * vert_region + i * idx_region);
         demo_create_cube(cubes[i], indices[i], &idx_count);
     }
+    pixelforge_vram_sync_for_device(dev, vb_block.virt, VB_REGION_SIZE);
 
     /* Projection matrix */
     float p[16];
     mat4_perspective(p, 60.0f * M_PI / 180.0f, (float)dev->x_resolution / (float)dev->y_resolution, 0.1f, 10.0f);
 
+    frame_capture_t *capture = NULL;
+    if (capture_frames) {
+        frame_capture_config_t capture_config = {
+            .prefix = "depth",
+            .format = capture_format,
+            .color_format = dev->color_format,
+            .width = dev->x_resolution,
+            .height = dev->y_resolution,
+        };
+        capture = frame_capture_start(&capture_config);
+    }
+
     /* Animation loop */
     for (int frame = 0; frame < frames && keep_running; frame++) {
         float t = (float)frame / 30.0f;
@@ -258,6 +275,8 @@ int main(int argc, char **argv) {
         /* Clear buffers */
         memset(buffer, 0x00, dev->buffer_size);
         memset(ds_block.virt, 0x00, dev->x_resolution * dev->y_resolution * 4);
+        pixelforge_vram_sync_for_device(dev, buffer, dev->buffer_size);
+        pixelforge_vram_sync_for_device(dev, ds_block.virt, dev->x_resolution * dev->y_resolution * 4);
 
         /* Render 4 cubes orbiting in a circle at varying depths
          * They circle around the camera at z=-2.5, creating occlusion */
@@ -307,18 +326,14 @@ int main(int argc, char **argv) {
         }
         pixelforge_swap_buffers(dev);
 
-        if (capture_frames) {
-            char filename[256];
-            if (frame_capture_gen_filename(filename, sizeof(filename), "depth", frame, ".png") == 0) {
-                uint8_t *display_buffer = pixelforge_get_front_buffer(dev);
-                frame_capture_rgba(filename, display_buffer, dev->x_resolution,
-                                 dev->y_resolution, dev->buffer_stride);
-            }
+        if (capture) {
+            frame_capture_submit(capture, pixelforge_wait_presented_frame(dev), dev->buffer_stride, frame);
         }
 
         printf("Frame %d/%d rendered\n", frame + 1, frames);
     }
 
+    frame_capture_stop(capture, NULL);
     pixelforge_close_dev(dev);
     printf("Done!\n");
     return 0;
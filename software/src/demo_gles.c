@@ -262,8 +262,12 @@ int main(int argc, char **argv) {
          */
         glSwapBuffers();
 
+        GLuint csr_written, csr_skipped;
+        glGetCsrStatsPF(&csr_written, &csr_skipped, true);
+
         if (frame % 30 == 0) {
-            printf("Rendered frame %d/%d\n", frame, frames);
+            printf("Rendered frame %d/%d (CSR words: %u written, %u skipped)\n",
+                   frame, frames, csr_written, csr_skipped);
         }
     }
 
@@ -2,7 +2,7 @@
  * PixelForge Demo: OBJ Model Viewer
  *
  * This demo showcases:
- * - Loading 3D models from OBJ files
+ * - Loading 3D models from OBJ files or preconverted .pfm meshes (obj2pfm)
  * - Automatic model scaling and centering
  * - Rotation animation
  * - Optional depth testing with loaded geometry
@@ -18,6 +18,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -29,6 +30,7 @@
 #include "pixelforge_utils.h"
 #include "demo_utils.h"
 #include "obj_loader.h"
+#include "pfm_loader.h"
 #include "frame_capture.h"
 
 #define PAGE_SIZE       4096u
@@ -57,8 +59,9 @@ struct vertex {
     int32_t col[4];
 };
 
-/* Convert OBJ model to GPU vertex format, duplicating vertices for per-face normals */
-static size_t convert_obj_to_vertices(const obj_model *model, struct vertex **out_vertices,
+/* Convert the indexed mesh of an OBJ model to GPU vertex format */
+static size_t convert_obj_to_vertices(const obj_model *model, const obj_indexed_mesh *mesh,
+                                      struct vertex **out_vertices,
                                       vec3f *model_center, float *model_scale) {
     /* Get bounding box and compute center + scale */
     vec3f min, max;
@@ -80,9 +83,7 @@ static size_t convert_obj_to_vertices(const obj_model *model, struct vertex **ou
     printf("Model center: (%.2f,%.2f,%.2f), scale: %.2f\n",
            model_center->x, model_center->y, model_center->z, *model_scale);
 
-    /* Duplicate vertices for each face to handle per-face normals correctly */
-    size_t num_triangles = model->num_faces / 3;
-    size_t num_vertices = model->num_faces;  /* One unique vertex per face-vertex */
+    size_t num_vertices = mesh->num_vertices;
 
     *out_vertices = malloc(num_vertices * sizeof(struct vertex));
 
@@ -90,38 +91,23 @@ static size_t convert_obj_to_vertices(const obj_model *model, struct vertex **ou
         return 0;
     }
 
-    /* Create a unique vertex for each face-vertex combination */
-    for (size_t i = 0; i < model->num_faces; i++) {
-        const face_vertex *fv = &model->faces[i];
+    for (size_t i = 0; i < num_vertices; i++) {
+        const obj_vertex *mv = &mesh->vertices[i];
         struct vertex *v = &(*out_vertices)[i];
 
-        /* Get position and transform it */
-        if ((size_t)fv->v_idx < model->num_positions) {
-            const vec3f *pos = &model->positions[fv->v_idx];
+        /* Center and scale model */
+        float x = (mv->position.x - model_center->x) * (*model_scale);
+        float y = (mv->position.y - model_center->y) * (*model_scale);
+        float z = (mv->position.z - model_center->z) * (*model_scale);
 
-            /* Center and scale model */
-            float x = (pos->x - model_center->x) * (*model_scale);
-            float y = (pos->y - model_center->y) * (*model_scale);
-            float z = (pos->z - model_center->z) * (*model_scale);
+        v->pos[0] = fp16_16(x);
+        v->pos[1] = fp16_16(y);
+        v->pos[2] = fp16_16(z);
+        v->pos[3] = fp16_16(1.0f);
 
-            v->pos[0] = fp16_16(x);
-            v->pos[1] = fp16_16(y);
-            v->pos[2] = fp16_16(z);
-            v->pos[3] = fp16_16(1.0f);
-        }
-
-        /* Set normal if available */
-        if (fv->vn_idx >= 0 && (size_t)fv->vn_idx < model->num_normals) {
-            const vec3f *n = &model->normals[fv->vn_idx];
-            v->norm[0] = fp16_16(n->x);
-            v->norm[1] = fp16_16(n->y);
-            v->norm[2] = fp16_16(n->z);
-        } else {
-            /* Default normal if not specified */
-            v->norm[0] = fp16_16(0.0f);
-            v->norm[1] = fp16_16(0.0f);
-            v->norm[2] = fp16_16(1.0f);
-        }
+        v->norm[0] = fp16_16(mv->normal.x);
+        v->norm[1] = fp16_16(mv->normal.y);
+        v->norm[2] = fp16_16(mv->normal.z);
 
         /* Default white color */
         v->col[0] = fp16_16(0.8f);
@@ -130,22 +116,32 @@ static size_t convert_obj_to_vertices(const obj_model *model, struct vertex **ou
         v->col[3] = fp16_16(1.0f);
     }
 
-    printf("Converted to %zu vertices (duplicated for per-face normals), %zu triangles\n",
-           num_vertices, num_triangles);
+    printf("Converted to %zu shared vertices, %zu triangles\n",
+           num_vertices, mesh->num_indices / 3);
 
     return num_vertices;  /* Return number of vertices */
 }
 
-static void configure_gpu(pixelforge_dev *dev, uint32_t vertex_count,
-                         uint32_t pos_addr, uint32_t norm_addr, uint32_t col_addr,
-                         uint16_t stride, uint32_t color_addr, uint32_t ds_addr,
+/* Geometry in VRAM, attribute addresses are absolute */
+struct gpu_mesh {
+    uint32_t index_addr;
+    uint32_t index_count;
+    pixelforge_index_kind_t index_kind;
+    pixelforge_input_attr_t position;
+    pixelforge_input_attr_t normal;
+    pixelforge_input_attr_t color;
+    float model[16];        /* stored positions to the fitted ~2 unit box */
+};
+
+static void configure_gpu(pixelforge_dev *dev, const struct gpu_mesh *mesh,
+                         uint32_t color_addr, uint32_t ds_addr,
                          bool depth_enabled, const float mv[16], const float p[16]) {
     volatile uint8_t *csr = dev->csr_base;
 
     pixelforge_idx_config_t idx_cfg = {
-        .address = 0,
-        .count = vertex_count,
-        .kind = PIXELFORGE_INDEX_NOT_INDEXED,
+        .address = mesh->index_addr,
+        .count = mesh->index_count,
+        .kind = mesh->index_kind,
     };
     pf_csr_set_idx(csr, &idx_cfg);
 
@@ -157,23 +153,18 @@ static void configure_gpu(pixelforge_dev *dev, uint32_t vertex_count,
     };
     pf_csr_set_topology(csr, &topo);
 
-    pixelforge_input_attr_t attr = {
-        .mode = PIXELFORGE_ATTR_PER_VERTEX,
-        .info.per_vertex = { .address = pos_addr, .stride = stride },
-    };
-    pf_csr_set_attr_position(csr, &attr);
-    attr.info.per_vertex.address = norm_addr;
-    pf_csr_set_attr_normal(csr, &attr);
-    attr.info.per_vertex.address = col_addr;
-    pf_csr_set_attr_color(csr, &attr);
+    pf_csr_set_attr_position(csr, &mesh->position);
+    pf_csr_set_attr_normal(csr, &mesh->normal);
+    pf_csr_set_attr_color(csr, &mesh->color);
 
-    /* Set transforms */
-    float nm[9];
+    /* Set transforms, normals are stored in object space so only positions see the model matrix */
+    float nm[9], position_mv[16];
     mat3_from_mat4(nm, mv);
+    mat4_multiply(position_mv, mesh->model, mv);
 
     pixelforge_vtx_xf_config_t xf = {0};
     xf.enabled.normal_enable = true;
-    mat4_to_fp16_16(xf.position_mv, mv);
+    mat4_to_fp16_16(xf.position_mv, position_mv);
     mat4_to_fp16_16(xf.position_p, p);
     mat3_to_fp16_16(xf.normal_mv_inv_t, nm);
     pf_csr_set_vtx_xf(csr, &xf);
@@ -208,6 +199,7 @@ static void configure_gpu(pixelforge_dev *dev, uint32_t vertex_count,
     light.specular[1] = fp16_16(0.5f);
     light.specular[2] = fp16_16(0.5f);
     pf_csr_set_light(csr, 0, &light);
+    pf_csr_set_light_enable(csr, 1u);
 
     pixelforge_prim_config_t prim = {
         .type = PIXELFORGE_PRIM_TRIANGLES,
@@ -304,6 +296,7 @@ static void set_stencil_outline_mode(pixelforge_dev *dev) {
         .specular = { fp16_16(0.0f), fp16_16(0.0f), fp16_16(0.0f) },
     };
     pf_csr_set_light(csr, 0, &light);
+    pf_csr_set_light_enable(csr, 1u);
 
     pixelforge_material_t mat = {
         .ambient = { fp16_16(1.0f), fp16_16(1.0f), fp16_16(1.0f) },
@@ -324,16 +317,147 @@ static void set_object_color(pixelforge_dev *dev, float r, float g, float b, flo
     pf_csr_set_attr_color(csr, &attr);
 }
 
+/* Model data in CPU memory, attribute addresses are offsets into the vertex data */
+struct host_mesh {
+    const void *vertices;
+    size_t vertex_bytes;
+    const void *indices;
+    size_t index_bytes;
+    struct gpu_mesh gpu;
+
+    struct vertex *obj_vertices;
+    obj_indexed_mesh obj_mesh;
+    pfm_mesh pfm;
+};
+
+static bool has_extension(const char *path, const char *ext) {
+    size_t len = strlen(path), ext_len = strlen(ext);
+    return len >= ext_len && !strcasecmp(path + len - ext_len, ext);
+}
+
+static void set_fixed_attr(pixelforge_input_attr_t *attr, uint32_t offset) {
+    *attr = (pixelforge_input_attr_t){
+        .mode = PIXELFORGE_ATTR_PER_VERTEX,
+        .info.per_vertex = { .address = offset, .stride = sizeof(struct vertex) },
+    };
+}
+
+static int load_obj_mesh(const char *filename, struct host_mesh *hm) {
+    obj_model model;
+    if (obj_load(filename, &model) != 0) {
+        fprintf(stderr, "Failed to load OBJ file: %s\n", filename);
+        return -1;
+    }
+
+    /* Share vertices between faces and order them for the vertex cache */
+    if (obj_build_indexed_mesh(&model, &hm->obj_mesh) != 0) {
+        fprintf(stderr, "Failed to build indexed mesh\n");
+        obj_free(&model);
+        return -1;
+    }
+
+    /* Convert to GPU format */
+    vec3f center;
+    float scale;
+    size_t vertex_count = convert_obj_to_vertices(&model, &hm->obj_mesh, &hm->obj_vertices, &center, &scale);
+    obj_free(&model);
+
+    if (vertex_count == 0) {
+        fprintf(stderr, "Failed to convert model\n");
+        return -1;
+    }
+
+    hm->vertices = hm->obj_vertices;
+    hm->vertex_bytes = vertex_count * sizeof(struct vertex);
+    hm->indices = hm->obj_mesh.indices;
+    hm->index_bytes = hm->obj_mesh.num_indices * hm->obj_mesh.index_size;
+
+    hm->gpu.index_count = (uint32_t)hm->obj_mesh.num_indices;
+    hm->gpu.index_kind = hm->obj_mesh.index_size == 1 ? PIXELFORGE_INDEX_U8 : PIXELFORGE_INDEX_U16;
+    set_fixed_attr(&hm->gpu.position, offsetof(struct vertex, pos));
+    set_fixed_attr(&hm->gpu.normal, offsetof(struct vertex, norm));
+    set_fixed_attr(&hm->gpu.color, offsetof(struct vertex, col));
+    mat4_identity(hm->gpu.model);  /* positions are already centered and scaled */
+    return 0;
+}
+
+static void set_pfm_attr(pixelforge_input_attr_t *attr, const pfm_attribute_t *pa, uint32_t stride,
+                         float x, float y, float z, float w) {
+    if (pa->size == 0) {
+        *attr = (pixelforge_input_attr_t){
+            .mode = PIXELFORGE_ATTR_CONSTANT,
+            .info.constant_value.value = { fp16_16(x), fp16_16(y), fp16_16(z), fp16_16(w) },
+        };
+        return;
+    }
+
+    *attr = (pixelforge_input_attr_t){
+        .mode = PIXELFORGE_ATTR_PER_VERTEX,
+        .info.per_vertex = {
+            .address = pa->offset,
+            .stride = (uint16_t)stride,
+            .format = {
+                .type = (pixelforge_component_type_t)pa->type,
+                .normalized = pa->normalized,
+                .size = pa->size,
+            },
+        },
+    };
+}
+
+/* The streams are used as stored, only the header is interpreted */
+static int load_pfm_mesh(const char *filename, struct host_mesh *hm) {
+    if (pfm_open(filename, &hm->pfm) != 0) return -1;
+
+    const pfm_header_t *h = hm->pfm.header;
+    hm->vertices = hm->pfm.vertices;
+    hm->vertex_bytes = hm->pfm.vertex_bytes;
+    hm->indices = hm->pfm.indices;
+    hm->index_bytes = hm->pfm.index_bytes;
+
+    hm->gpu.index_count = h->index_count;
+    hm->gpu.index_kind = h->index_size == 1 ? PIXELFORGE_INDEX_U8 : PIXELFORGE_INDEX_U16;
+    set_pfm_attr(&hm->gpu.position, &h->position, h->vertex_stride, 0.0f, 0.0f, 0.0f, 1.0f);
+    set_pfm_attr(&hm->gpu.normal, &h->normal, h->vertex_stride, 0.0f, 0.0f, 1.0f, 0.0f);
+    set_pfm_attr(&hm->gpu.color, &h->color, h->vertex_stride, 0.8f, 0.8f, 0.8f, 1.0f);
+
+    /* Dequantize, then center and scale to fit in ~2 unit box */
+    float max_size = 0.0f, fit, center[3];
+    for (int c = 0; c < 3; c++) {
+        float size = h->bounds_max[c] - h->bounds_min[c];
+        max_size = size > max_size ? size : max_size;
+        center[c] = (h->bounds_min[c] + h->bounds_max[c]) * 0.5f;
+    }
+    fit = max_size > 0.0f ? 2.0f / max_size : 1.0f;
+
+    float scale_m[16], trans_m[16];
+    mat4_scale(scale_m, h->position_scale[0] * fit, h->position_scale[1] * fit, h->position_scale[2] * fit);
+    mat4_translate(trans_m, (h->position_bias[0] - center[0]) * fit,
+                   (h->position_bias[1] - center[1]) * fit, (h->position_bias[2] - center[2]) * fit);
+    mat4_multiply(hm->gpu.model, scale_m, trans_m);
+    return 0;
+}
+
+static void free_host_mesh(struct host_mesh *hm) {
+    free(hm->obj_vertices);
+    obj_free_indexed_mesh(&hm->obj_mesh);
+    pfm_close(&hm->pfm);
+    memset(hm, 0, sizeof(*hm));
+}
+
 int main(int argc, char **argv) {
     int frames = 120;
     const char *obj_file = NULL;
     bool stencil_outline = false;
     bool use_depth = false;
     bool capture_frames = false;
+    frame_capture_format_t capture_format = FRAME_CAPTURE_PNG;
 
     for (int i = 1; i < argc; i++) {
         if (!strcmp(argv[i], "--verbose")) g_verbose = true;
         else if (!strcmp(argv[i], "--capture-frames")) capture_frames = true;
+        else if (!strcmp(argv[i], "--capture-format") && i + 1 < argc)
+            capture_frames = frame_capture_parse_format(argv[++i], &capture_format) == 0;
         else if (!strcmp(argv[i], "--frames") && i + 1 < argc) frames = atoi(argv[++i]);
         else if (!strcmp(argv[i], "--stencil-outline")) stencil_outline = true;
         else if (!strcmp(argv[i], "--use-depth")) use_depth = true;
@@ -344,36 +468,24 @@ int main(int argc, char **argv) {
     if (stencil_outline) use_depth = true;
 
     if (!obj_file) {
-        fprintf(stderr, "Usage: %s [--verbose] [--frames N] [--stencil-outline] [--use-depth] <model.obj>\n", argv[0]);
+        fprintf(stderr, "Usage: %s [--verbose] [--frames N] [--stencil-outline] [--use-depth] <model.obj|model.pfm>\n", argv[0]);
         return 1;
     }
 
     signal(SIGINT, handle_sigint);
 
-    /* Load OBJ model */
-    obj_model model;
-    if (obj_load(obj_file, &model) != 0) {
-        fprintf(stderr, "Failed to load OBJ file: %s\n", obj_file);
-        return 1;
-    }
-
-    /* Convert to GPU format */
-    struct vertex *vertices = NULL;
-    vec3f center;
-    float scale;
-    size_t vertex_count = convert_obj_to_vertices(&model, &vertices, &center, &scale);
-
-    if (vertex_count == 0) {
-        fprintf(stderr, "Failed to convert model\n");
-        obj_free(&model);
+    /* Load model */
+    struct host_mesh hm = {0};
+    int loaded = has_extension(obj_file, ".pfm") ? load_pfm_mesh(obj_file, &hm) : load_obj_mesh(obj_file, &hm);
+    if (loaded != 0) {
+        free_host_mesh(&hm);
         return 1;
     }
 
     pixelforge_dev *dev = pixelforge_open_dev();
     if (!dev) {
         fprintf(stderr, "Failed to open device\n");
-        free(vertices);
-        obj_free(&model);
+        free_host_mesh(&hm);
         return 1;
     }
 
@@ -381,30 +493,50 @@ int main(int argc, char **argv) {
     printf("Rendering %d frames...\n", frames);
 
     /* Calculate buffer sizes */
-    size_t vb_size = vertex_count * sizeof(struct vertex);
-    vb_size = (vb_size + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);  /* Align to page */
+    size_t vb_size = (hm.vertex_bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);  /* Align to page */
+    size_t ib_size = (hm.index_bytes + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
 
     /* Allocate buffers */
-    struct vram_block vb_block, ds_block;
+    struct vram_block vb_block, ib_block, ds_block;
     if (vram_alloc(&dev->vram, vb_size, PAGE_SIZE, &vb_block) ||
+        vram_alloc(&dev->vram, ib_size, PAGE_SIZE, &ib_block) ||
         vram_alloc(&dev->vram, dev->x_resolution * dev->y_resolution * 4, PAGE_SIZE, &ds_block)) {
         fprintf(stderr, "VRAM allocation failed\n");
         pixelforge_close_dev(dev);
-        free(vertices);
-        obj_free(&model);
+        free_host_mesh(&hm);
         return 1;
     }
 
     /* Copy geometry to VRAM */
-    memcpy(vb_block.virt, vertices, vertex_count * sizeof(struct vertex));
+    memcpy(vb_block.virt, hm.vertices, hm.vertex_bytes);
+    memcpy(ib_block.virt, hm.indices, hm.index_bytes);
+    pixelforge_vram_sync_for_device(dev, vb_block.virt, hm.vertex_bytes);
+    pixelforge_vram_sync_for_device(dev, ib_block.virt, hm.index_bytes);
 
-    free(vertices);
-    obj_free(&model);
+    struct gpu_mesh gpu = hm.gpu;
+    gpu.index_addr = ib_block.phys;
+    if (gpu.position.mode == PIXELFORGE_ATTR_PER_VERTEX) gpu.position.info.per_vertex.address += vb_block.phys;
+    if (gpu.normal.mode == PIXELFORGE_ATTR_PER_VERTEX) gpu.normal.info.per_vertex.address += vb_block.phys;
+    if (gpu.color.mode == PIXELFORGE_ATTR_PER_VERTEX) gpu.color.info.per_vertex.address += vb_block.phys;
+
+    free_host_mesh(&hm);
 
     /* Projection matrix */
     float p[16];
     mat4_perspective(p, 60.0f * M_PI / 180.0f, (float)dev->x_resolution / (float)dev->y_resolution, 0.1f, 100.0f);
 
+    frame_capture_t *capture = NULL;
+    if (capture_frames) {
+        frame_capture_config_t capture_config = {
+            .prefix = "obj",
+            .format = capture_format,
+            .color_format = dev->color_format,
+            .width = dev->x_resolution,
+            .height = dev->y_resolution,
+        };
+        capture = frame_capture_start(&capture_config);
+    }
+
     /* Animation loop */
     for (int frame = 0; frame < frames && keep_running; frame++) {
         float t = (float)frame / 30.0f;
@@ -416,6 +548,8 @@ int main(int argc, char **argv) {
         /* Clear buffers */
         memset(buffer, 0x00, dev->buffer_size);
         memset(ds_block.virt, 0x00, dev->x_resolution * dev->y_resolution * 4);
+        pixelforge_vram_sync_for_device(dev, buffer, dev->buffer_size);
+        pixelforge_vram_sync_for_device(dev, ds_block.virt, dev->x_resolution * dev->y_resolution * 4);
 
         /* Modelview matrix: rotate model */
         float mv[16], rot[16], trans[16];
@@ -424,19 +558,11 @@ int main(int argc, char **argv) {
         mat4_multiply(mv, rot, trans);
 
         if (!stencil_outline) {
-            configure_gpu(dev, vertex_count,
-                         vb_block.phys + offsetof(struct vertex, pos),
-                         vb_block.phys + offsetof(struct vertex, norm),
-                         vb_block.phys + offsetof(struct vertex, col),
-                         sizeof(struct vertex), buffer_phys, ds_block.phys, use_depth, mv, p);
+            configure_gpu(dev, &gpu, buffer_phys, ds_block.phys, use_depth, mv, p);
             pf_csr_start(dev->csr_base);
         } else {
             /* Pass 1: draw model and write stencil */
-            configure_gpu(dev, vertex_count,
-                         vb_block.phys + offsetof(struct vertex, pos),
-                         vb_block.phys + offsetof(struct vertex, norm),
-                         vb_block.phys + offsetof(struct vertex, col),
-                         sizeof(struct vertex), buffer_phys, ds_block.phys, use_depth, mv, p);
+            configure_gpu(dev, &gpu, buffer_phys, ds_block.phys, use_depth, mv, p);
             set_stencil_write_mode(dev);
             pf_csr_start(dev->csr_base);
             if (!pixelforge_wait_for_gpu_ready(dev, GPU_STAGE_PER_PIXEL, &keep_running)) {
@@ -449,11 +575,7 @@ int main(int argc, char **argv) {
             mat4_scale(scale_m, 1.15f, 1.15f, 1.15f);
             mat4_multiply(mv_outline, scale_m, mv);
 
-            configure_gpu(dev, vertex_count,
-                         vb_block.phys + offsetof(struct vertex, pos),
-                         vb_block.phys + offsetof(struct vertex, norm),
-                         vb_block.phys + offsetof(struct vertex, col),
-                         sizeof(struct vertex), buffer_phys, ds_block.phys, false, mv_outline, p);
+            configure_gpu(dev, &gpu, buffer_phys, ds_block.phys, false, mv_outline, p);
             set_stencil_outline_mode(dev);
             set_object_color(dev, 1.0f, 0.8f, 0.0f, 1.0f);
 
@@ -472,19 +594,15 @@ int main(int argc, char **argv) {
         }
         pixelforge_swap_buffers(dev);
 
-        if (capture_frames) {
-            char filename[256];
-            if (frame_capture_gen_filename(filename, sizeof(filename), "obj", frame, ".png") == 0) {
-                uint8_t *display_buffer = pixelforge_get_front_buffer(dev);
-                frame_capture_rgba(filename, display_buffer, dev->x_resolution,
-                                 dev->y_resolution, dev->buffer_stride);
-            }
+        if (capture) {
+            frame_capture_submit(capture, pixelforge_wait_presented_frame(dev), dev->buffer_stride, frame);
         }
 
         if (stencil_outline) printf("Frame %d/%d rendered (stencil-outline)\n", frame + 1, frames);
         else printf("Frame %d/%d rendered\n", frame + 1, frames);
     }
 
+    frame_capture_stop(capture, NULL);
     pixelforge_close_dev(dev);
     printf("Done!\n");
     return 0;
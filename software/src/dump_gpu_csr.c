@@ -1,4 +1,5 @@
 #include <fcntl.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -51,6 +52,7 @@ static void dump_idx_config(volatile uint8_t *csr) {
         case PIXELFORGE_INDEX_U32: printf("(U32)\n"); break;
         default: printf("(unknown)\n");
     }
+    printf("  draws:    %u%s\n", cfg.draw_count, cfg.draw_count ? " (multi-draw)" : "");
 }
 
 static void dump_topology_config(volatile uint8_t *csr) {
@@ -86,6 +88,17 @@ static const char *attr_mode_str(uint32_t mode) {
     }
 }
 
+static const char *component_type_str(uint32_t type) {
+    switch (type) {
+        case PIXELFORGE_COMPONENT_FIXED: return "FIXED";
+        case PIXELFORGE_COMPONENT_S8: return "S8";
+        case PIXELFORGE_COMPONENT_U8: return "U8";
+        case PIXELFORGE_COMPONENT_S16: return "S16";
+        case PIXELFORGE_COMPONENT_U16: return "U16";
+        default: return "unknown";
+    }
+}
+
 static void dump_input_attr(volatile uint8_t *csr, const char *name,
                             void (*getter)(volatile uint8_t *, pixelforge_input_attr_t *)) {
     pixelforge_input_attr_t attr;
@@ -104,14 +117,23 @@ static void dump_input_attr(volatile uint8_t *csr, const char *name,
         printf("    per_vertex:\n");
         printf("      address: 0x%08x\n", attr.info.per_vertex.address);
         printf("      stride:  %u\n", attr.info.per_vertex.stride);
+        printf("      format:  %s%s x%u\n",
+            component_type_str(attr.info.per_vertex.format.type),
+            attr.info.per_vertex.format.normalized ? " normalized" : "",
+            attr.info.per_vertex.format.size);
     }
 }
 
+static void get_attr_texcoord0(volatile uint8_t *csr, pixelforge_input_attr_t *attr) {
+    pf_csr_get_attr_texcoord(csr, 0, attr);
+}
+
 static void dump_input_assembly(volatile uint8_t *csr) {
     printf("\n[INPUT ASSEMBLY]\n");
     dump_input_attr(csr, "POSITION", pf_csr_get_attr_position);
     dump_input_attr(csr, "NORMAL", pf_csr_get_attr_normal);
     dump_input_attr(csr, "COLOR", pf_csr_get_attr_color);
+    dump_input_attr(csr, "TEXCOORD0", get_attr_texcoord0);
 }
 
 static void dump_vertex_transform(volatile uint8_t *csr) {
@@ -121,6 +143,9 @@ static void dump_vertex_transform(volatile uint8_t *csr) {
     printf("\n[VERTEX TRANSFORM]\n");
     printf("  enabled:\n");
     printf("    normal:       %u\n", cfg.enabled.normal_enable);
+    for (int t = 0; t < PIXELFORGE_NUM_TEXTURES; ++t) {
+        printf("    texture[%d]:   %u\n", t, cfg.enabled.texture_enable[t]);
+    }
 
     printf("  position_mv (4x4):\n");
     for (int i = 0; i < 4; ++i) {
@@ -148,6 +173,17 @@ static void dump_vertex_transform(volatile uint8_t *csr) {
         }
         printf("\n");
     }
+
+    for (int t = 0; t < PIXELFORGE_NUM_TEXTURES; ++t) {
+        printf("  texture_transform[%d] (4x4):\n", t);
+        for (int i = 0; i < 4; ++i) {
+            printf("    [%d] ", i);
+            for (int j = 0; j < 4; ++j) {
+                printf("%10.4f ", fp16_16_to_float(cfg.texture_transform[t][i * 4 + j]));
+            }
+            printf("\n");
+        }
+    }
 }
 
 static void dump_material(volatile uint8_t *csr) {
@@ -269,10 +305,12 @@ static void dump_framebuffer(volatile uint8_t *csr) {
     printf("  color buffer:\n");
     printf("    address: 0x%08x\n", cfg.color_address);
     printf("    pitch:   %u bytes/line\n", cfg.color_pitch);
+    printf("    format:  %s\n", cfg.color_format == PIXELFORGE_COLOR_R5G6B5 ? "R5G6B5" : "B8G8R8A8");
 
     printf("  depth/stencil buffer:\n");
     printf("    address: 0x%08x\n", cfg.depthstencil_address);
     printf("    pitch:   %u bytes/line\n", cfg.depthstencil_pitch);
+    printf("    format:  %s\n", cfg.depthstencil_format == PIXELFORGE_DS_D16 ? "D16" : "D16_X8_S8");
 }
 
 static const char *cmp_op_str(uint32_t op) {
@@ -382,8 +420,24 @@ static void dump_blending(volatile uint8_t *csr) {
     printf("  color_write_mask: 0x%x\n", cfg.color_write_mask);
 }
 
+static void dump_texturing(volatile uint8_t *csr) {
+    static const char *env_modes[] = {"MODULATE", "REPLACE", "DECAL", "ADD"};
+    pixelforge_texture_config_t cfg;
+    pf_csr_get_texture(csr, &cfg);
+
+    printf("  [TEXTURE 0]\n");
+    printf("    enabled:  %u\n", cfg.enabled);
+    printf("    address:  0x%08x\n", cfg.address);
+    printf("    size:     %ux%u\n", 1u << cfg.width_log2, 1u << cfg.height_log2);
+    printf("    filter:   %s\n", cfg.filter == PIXELFORGE_TEXTURE_LINEAR ? "LINEAR" : "NEAREST");
+    printf("    wrap_s:   %s\n", cfg.wrap_s == PIXELFORGE_TEXTURE_CLAMP_TO_EDGE ? "CLAMP_TO_EDGE" : "REPEAT");
+    printf("    wrap_t:   %s\n", cfg.wrap_t == PIXELFORGE_TEXTURE_CLAMP_TO_EDGE ? "CLAMP_TO_EDGE" : "REPEAT");
+    printf("    env_mode: %s\n", env_modes[cfg.env_mode & 0x3]);
+}
+
 static void dump_pixel_shading(volatile uint8_t *csr) {
     printf("\n[PIXEL SHADING]\n");
+    dump_texturing(csr);
     dump_blending(csr);
     dump_output_merger(csr);
 }
@@ -401,11 +455,74 @@ static void dump_status(volatile uint8_t *csr) {
     printf("  pix:     (%s)\n", ready_components & 8 ? "ready" : "busy");
 
     printf("  ready vector:  %0b\n", ready_vec);
+
+    printf("  fence issued:  %u\n", pf_csr_get_fence_issued(csr));
+    printf("  fence retired: %u\n", pf_csr_get_fence_retired(csr));
+    pixelforge_vtx_cache_stats_t vc;
+    pf_csr_get_vtx_cache_stats(csr, &vc);
+    printf("  vertex cache:  %s, %u/%u hits (%.1f%%)\n",
+        pf_csr_read32(csr, PIXELFORGE_CSR_VTX_CACHE_ENABLE) & 1 ? "enabled" : "disabled",
+        vc.hits, vc.lookups, vc.lookups ? 100.0 * vc.hits / vc.lookups : 0.0);
+    printf("  early cull:    %s, %u triangles culled\n",
+        pf_csr_read32(csr, PIXELFORGE_CSR_EARLY_CULL_ENABLE) & 1 ? "enabled" : "disabled",
+        pf_csr_get_early_culled(csr));
+    pixelforge_clip_stats_t clip;
+    pf_csr_get_clip_stats(csr, &clip);
+    printf("  guard band:    %ux\n", 1u << pf_csr_get_guard_band(csr));
+    printf("  clipper:       %u trivial, %u guard band, %u clipped\n",
+        clip.trivial_accepts, clip.guard_band_accepts, clip.clipped);
+    printf("  hier. Z:       %s\n",
+        pf_csr_read32(csr, PIXELFORGE_CSR_HIZ_ENABLE) & 1 ? "enabled" : "disabled");
+    printf("  irq enable:    0x%02x\n", pf_csr_read32(csr, PIXELFORGE_CSR_IRQ_ENABLE));
+    printf("  irq status:    0x%02x\n", pf_csr_get_irq_status(csr));
+}
+
+static void dump_perf_cache(const char *name, const pixelforge_perf_cache_t *c) {
+    printf("  %-14s %u lookups, %u misses (%.1f%% hits)\n", name, c->lookups, c->misses,
+        c->lookups ? 100.0 * (c->lookups - c->misses) / c->lookups : 0.0);
+}
+
+static void dump_perf(volatile uint8_t *csr) {
+    pixelforge_perf_counters_t perf;
+    pf_perf_read(csr, &perf);
+
+    printf("\n[PERFORMANCE COUNTERS]\n");
+    printf("  triangles:     %u in, %u clipped, %u culled, %u rasterized\n",
+        perf.triangles_in, perf.triangles_clipped, perf.triangles_culled,
+        perf.triangles_rasterized);
+    printf("  rejects:       %u hier. Z tiles, %u coarse blocks\n",
+        perf.hiz_tile_rejects, perf.coarse_block_rejects);
+    printf("  fragments:     %u generated, %u early Z rejected, %u stencil failed, "
+        "%u depth failed, %u written\n",
+        perf.fragments_generated, perf.fragments_early_z_rejected,
+        perf.fragments_stencil_failed, perf.fragments_depth_failed, perf.fragments_written);
+
+    printf("  %-18s %10s %10s\n", "fifo", "stall", "starve");
+    for (int i = 0; i < PIXELFORGE_PERF_NUM_FIFOS; i++) {
+        printf("  %-18s %10u %10u\n", pf_perf_fifo_names[i], perf.fifo[i].stall,
+            perf.fifo[i].starve);
+    }
+    printf("  %-18s %10s %10s %10s\n", "bus", "reads", "writes", "wait");
+    for (int i = 0; i < PIXELFORGE_PERF_NUM_BUSES; i++) {
+        printf("  %-18s %10u %10u %10u\n", pf_perf_bus_names[i], perf.bus[i].read_beats,
+            perf.bus[i].write_beats, perf.bus[i].wait_cycles);
+    }
+    dump_perf_cache("ds cache:", &perf.depthstencil_cache);
+    dump_perf_cache("color cache:", &perf.color_cache);
+    dump_perf_cache("texture cache:", &perf.texture_cache);
 }
 
 int main(int argc, char **argv) {
-    (void)argc;
-    (void)argv;
+    bool perf = false;
+    bool perf_reset = false;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--perf")) perf = true;
+        else if (!strcmp(argv[i], "--perf-reset")) perf_reset = true;
+        else {
+            fprintf(stderr, "Usage: %s [--perf] [--perf-reset]\n", argv[0]);
+            return 1;
+        }
+    }
 
     int memfd = open("/dev/mem", O_RDWR | O_SYNC);
     if (memfd < 0) {
@@ -432,6 +549,8 @@ int main(int argc, char **argv) {
     dump_framebuffer(csr);
     dump_pixel_shading(csr);
     dump_status(csr);
+    if (perf) dump_perf(csr);
+    if (perf_reset) pf_perf_reset(csr);
 
     printf("\n================================================================================\n");
 
@@ -4,69 +4,192 @@
 #include <string.h>
 #include <stdint.h>
 #include <time.h>
+#include <pthread.h>
 #include <sys/time.h>
 
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FRAME_CAPTURE_NEON 1
+#endif
+
 #include "frame_capture.h"
 
 /* STB_IMAGE_WRITE implementation - must be defined before include */
 #define STB_IMAGE_WRITE_IMPLEMENTATION
 #include "stb/stb_image_write.h"
 
+#define DEFAULT_CAPTURE_BUFFERS 4
+
+/* =============================
+ * Pixel conversion
+ * ============================= */
+
+/* Hardware format is BGRA, bytes 0 and 2 swap places */
+static void convert_row_rgba(uint8_t *dst, const uint8_t *src, uint32_t width) {
+    uint32_t x = 0;
+#ifdef FRAME_CAPTURE_NEON
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(src + x * 4);
+        uint8x16_t b = px.val[0];
+        px.val[0] = px.val[2];
+        px.val[2] = b;
+        vst4q_u8(dst + x * 4, px);
+    }
+#endif
+    for (; x < width; x++) {
+        uint32_t v;
+        memcpy(&v, src + x * 4, 4);
+        v = (v & 0xFF00FF00u) | ((v >> 16) & 0xFFu) | ((v & 0xFFu) << 16);
+        memcpy(dst + x * 4, &v, 4);
+    }
+}
+
+/* Alpha is dropped */
+static void convert_row_rgb(uint8_t *dst, const uint8_t *src, uint32_t width) {
+    uint32_t x = 0;
+#ifdef FRAME_CAPTURE_NEON
+    for (; x + 16 <= width; x += 16) {
+        uint8x16x4_t px = vld4q_u8(src + x * 4);
+        uint8x16x3_t rgb = { { px.val[2], px.val[1], px.val[0] } };
+        vst3q_u8(dst + x * 3, rgb);
+    }
+#endif
+    for (; x < width; x++) {
+        dst[x * 3 + 0] = src[x * 4 + 2];
+        dst[x * 3 + 1] = src[x * 4 + 1];
+        dst[x * 3 + 2] = src[x * 4 + 0];
+    }
+}
+
+/* Channels widened to 8 bits by repeating their top bits. bytes is 3 (no alpha) or 4 (opaque),
+ * bgr keeps the hardware byte order */
+static void convert_row_rgb565(uint8_t *dst, const uint8_t *src, uint32_t width, uint32_t bytes, bool bgr) {
+    uint32_t x = 0;
+#ifdef FRAME_CAPTURE_NEON
+    for (; x + 8 <= width; x += 8) {
+        uint16x8_t px = vreinterpretq_u16_u8(vld1q_u8(src + x * 2));
+        uint8x8_t r = vand_u8(vshrn_n_u16(px, 8), vdup_n_u8(0xF8));
+        uint8x8_t g = vand_u8(vshrn_n_u16(px, 3), vdup_n_u8(0xFC));
+        uint8x8_t b = vmovn_u16(vshlq_n_u16(px, 3));
+        r = vorr_u8(r, vshr_n_u8(r, 5));
+        g = vorr_u8(g, vshr_n_u8(g, 6));
+        b = vorr_u8(b, vshr_n_u8(b, 5));
+        if (bytes == 4) {
+            uint8x8x4_t out = { { bgr ? b : r, g, bgr ? r : b, vdup_n_u8(0xFF) } };
+            vst4_u8(dst + x * 4, out);
+        } else {
+            uint8x8x3_t out = { { bgr ? b : r, g, bgr ? r : b } };
+            vst3_u8(dst + x * 3, out);
+        }
+    }
+#endif
+    for (; x < width; x++) {
+        uint16_t v;
+        memcpy(&v, src + x * 2, 2);
+        uint8_t r = (uint8_t)((v >> 8) & 0xF8);
+        uint8_t g = (uint8_t)((v >> 3) & 0xFC);
+        uint8_t b = (uint8_t)(v << 3);
+        r |= r >> 5;
+        g |= g >> 6;
+        b |= b >> 5;
+
+        uint8_t *out = dst + x * bytes;
+        out[0] = bgr ? b : r;
+        out[1] = g;
+        out[2] = bgr ? r : b;
+        if (bytes == 4) out[3] = 0xFF;
+    }
+}
+
+static uint32_t format_pixel_bytes(frame_capture_format_t format) {
+    return format == FRAME_CAPTURE_PPM ? 3 : 4;
+}
+
+static bool color_format_supported(pixelforge_color_format_t color_format) {
+    return color_format == PIXELFORGE_COLOR_B8G8R8A8 || color_format == PIXELFORGE_COLOR_R5G6B5;
+}
+
+/* Converts a strided framebuffer into a packed image in the output format, RAW is 32-bit BGRA */
+static void convert_frame(frame_capture_format_t format, pixelforge_color_format_t color_format, uint8_t *dst,
+                          const uint8_t *src, uint32_t width, uint32_t height, uint32_t stride) {
+    size_t pitch = (size_t)width * format_pixel_bytes(format);
+    for (uint32_t y = 0; y < height; y++) {
+        const uint8_t *src_row = src + (size_t)y * stride;
+        uint8_t *dst_row = dst + y * pitch;
+
+        if (color_format == PIXELFORGE_COLOR_R5G6B5) {
+            convert_row_rgb565(dst_row, src_row, width, format_pixel_bytes(format), format == FRAME_CAPTURE_RAW);
+            continue;
+        }
+
+        switch (format) {
+            case FRAME_CAPTURE_PNG: convert_row_rgba(dst_row, src_row, width); break;
+            case FRAME_CAPTURE_PPM: convert_row_rgb(dst_row, src_row, width); break;
+            case FRAME_CAPTURE_RAW: memcpy(dst_row, src_row, pitch); break;
+        }
+    }
+}
+
+static int write_ppm(const char *filename, const uint8_t *rgb, uint32_t width, uint32_t height) {
+    FILE *f = fopen(filename, "wb");
+    if (!f) return 0;
+
+    size_t bytes = (size_t)width * height * 3;
+    int ok = fprintf(f, "P6\n%u %u\n255\n", width, height) > 0 && fwrite(rgb, 1, bytes, f) == bytes;
+    return fclose(f) == 0 && ok;
+}
+
+static int write_image(frame_capture_format_t format, const char *filename, const uint8_t *data,
+                       uint32_t width, uint32_t height) {
+    if (format == FRAME_CAPTURE_PPM) return write_ppm(filename, data, width, height);
+    return stbi_write_png(filename, width, height, 4, data, width * 4);
+}
+
 /**
- * Capture an RGBA framebuffer to PNG file
+ * Capture an RGBA framebuffer to PNG or PPM file
  *
- * Handles conversion from hardware format (32-bit BGRA with stride)
+ * Handles conversion from hardware format (32-bit BGRA or RGB565 with stride)
  * to standard RGBA format expected by stb_image_write.
  */
 int frame_capture_rgba(const char *filename, const uint8_t *buffer,
-                       uint32_t width, uint32_t height, uint32_t stride)
+                       uint32_t width, uint32_t height, uint32_t stride,
+                       pixelforge_color_format_t color_format)
 {
     if (!filename || !buffer) {
         fprintf(stderr, "frame_capture_rgba: invalid arguments\n");
         return -1;
     }
-
-    /* Allocate temporary RGBA buffer for conversion */
-    uint8_t *rgb_buffer = malloc(width * height * 4);
-    if (!rgb_buffer) {
-        fprintf(stderr, "frame_capture_rgba: failed to allocate buffer\n");
+    if (!color_format_supported(color_format)) {
+        fprintf(stderr, "frame_capture_rgba: unsupported color format %d\n", (int)color_format);
         return -1;
     }
 
-    /* Convert from hardware format (BGRA with stride) to linear RGBA */
-    for (uint32_t y = 0; y < height; y++) {
-        const uint8_t *src_row = buffer + (y * stride);
-        uint8_t *dst_row = rgb_buffer + (y * width * 4);
-
-        for (uint32_t x = 0; x < width; x++) {
-            /* Hardware format: BGRA */
-            uint8_t b = src_row[x * 4 + 0];
-            uint8_t g = src_row[x * 4 + 1];
-            uint8_t r = src_row[x * 4 + 2];
-            uint8_t a = src_row[x * 4 + 3];
-
-            /* Output format: RGBA */
-            dst_row[x * 4 + 0] = r;
-            dst_row[x * 4 + 1] = g;
-            dst_row[x * 4 + 2] = b;
-            dst_row[x * 4 + 3] = a;
-        }
-    }
-
     const char *ext = strrchr(filename, '.');
     if (!ext) {
         fprintf(stderr, "frame_capture_rgba: filename '%s' has no extension\n", filename);
-        free(rgb_buffer);
         return -1;
     }
-    if (strcmp(ext, ".png") != 0) {
-        fprintf(stderr, "frame_capture_rgba: unsupported file extension '%s', only .png supported\n", ext);
-        free(rgb_buffer);
+
+    frame_capture_format_t format;
+    if (!strcmp(ext, ".png")) {
+        format = FRAME_CAPTURE_PNG;
+    } else if (!strcmp(ext, ".ppm")) {
+        format = FRAME_CAPTURE_PPM;
+    } else {
+        fprintf(stderr, "frame_capture_rgba: unsupported file extension '%s', only .png and .ppm supported\n", ext);
+        return -1;
+    }
+
+    /* Allocate temporary buffer for conversion */
+    uint8_t *image = malloc((size_t)width * height * format_pixel_bytes(format));
+    if (!image) {
+        fprintf(stderr, "frame_capture_rgba: failed to allocate buffer\n");
         return -1;
     }
 
-    int result = stbi_write_png(filename, width, height, 4, rgb_buffer, width * 4);
-    free(rgb_buffer);
+    convert_frame(format, color_format, image, buffer, width, height, stride);
+    int result = write_image(format, filename, image, width, height);
+    free(image);
 
     if (result) {
         printf("Frame captured: %s (%ux%u)\n", filename, width, height);
@@ -101,3 +224,214 @@ int frame_capture_gen_filename(char *output, size_t maxlen,
 
     return 0;
 }
+
+int frame_capture_parse_format(const char *name, frame_capture_format_t *format) {
+    if (!name || !format) return -1;
+
+    if (!strcmp(name, "png")) *format = FRAME_CAPTURE_PNG;
+    else if (!strcmp(name, "ppm")) *format = FRAME_CAPTURE_PPM;
+    else if (!strcmp(name, "raw")) *format = FRAME_CAPTURE_RAW;
+    else {
+        fprintf(stderr, "Unknown capture format '%s' (png, ppm or raw)\n", name);
+        return -1;
+    }
+    return 0;
+}
+
+/* =============================
+ * Asynchronous capture
+ * ============================= */
+
+struct frame_capture {
+    frame_capture_config_t config;
+    char *prefix;
+    size_t frame_bytes;
+    uint8_t *memory;            /* config.buffers frames of frame_bytes */
+    uint32_t *frame_nums;       /* frame number of every buffer */
+    FILE *stream;               /* FRAME_CAPTURE_RAW output */
+
+    pthread_t worker;
+    pthread_mutex_t lock;
+    pthread_cond_t queued;      /* a frame was queued or the capture is stopping */
+    pthread_cond_t released;    /* the worker returned a buffer */
+
+    /* protected by lock */
+    uint32_t *free_slots;       /* stack of buffers available to submit */
+    uint32_t free_count;
+    uint32_t *queue;            /* buffers waiting for the worker, oldest at queue_head */
+    uint32_t queue_head;
+    uint32_t queue_count;
+    bool stopping;
+    frame_capture_stats_t stats;
+};
+
+static uint8_t *slot_data(frame_capture_t *capture, uint32_t slot) {
+    return capture->memory + (size_t)slot * capture->frame_bytes;
+}
+
+static bool write_slot(frame_capture_t *capture, uint32_t slot) {
+    const frame_capture_config_t *config = &capture->config;
+    const uint8_t *data = slot_data(capture, slot);
+
+    if (config->format == FRAME_CAPTURE_RAW) {
+        return fwrite(data, 1, capture->frame_bytes, capture->stream) == capture->frame_bytes;
+    }
+
+    char filename[256];
+    if (frame_capture_gen_filename(filename, sizeof(filename), capture->prefix, capture->frame_nums[slot],
+                                   config->format == FRAME_CAPTURE_PPM ? ".ppm" : ".png") != 0) {
+        return false;
+    }
+    return write_image(config->format, filename, data, config->width, config->height);
+}
+
+static void *capture_worker(void *arg) {
+    frame_capture_t *capture = arg;
+
+    pthread_mutex_lock(&capture->lock);
+    while (true) {
+        while (capture->queue_count == 0 && !capture->stopping) {
+            pthread_cond_wait(&capture->queued, &capture->lock);
+        }
+        /* everything queued before the stop is still written */
+        if (capture->queue_count == 0) break;
+
+        uint32_t slot = capture->queue[capture->queue_head];
+        capture->queue_head = (capture->queue_head + 1) % capture->config.buffers;
+        capture->queue_count--;
+        pthread_mutex_unlock(&capture->lock);
+
+        bool ok = write_slot(capture, slot);
+
+        pthread_mutex_lock(&capture->lock);
+        if (ok) capture->stats.written++;
+        else capture->stats.failed++;
+        capture->free_slots[capture->free_count++] = slot;
+        pthread_cond_signal(&capture->released);
+    }
+    pthread_mutex_unlock(&capture->lock);
+    return NULL;
+}
+
+static void capture_free(frame_capture_t *capture) {
+    if (capture->stream) fclose(capture->stream);
+    free(capture->prefix);
+    free(capture->memory);
+    free(capture->frame_nums);
+    free(capture->free_slots);
+    free(capture->queue);
+    free(capture);
+}
+
+frame_capture_t *frame_capture_start(const frame_capture_config_t *config) {
+    if (!config || config->width == 0 || config->height == 0) return NULL;
+    if (!color_format_supported(config->color_format)) {
+        fprintf(stderr, "frame_capture_start: unsupported color format %d\n", (int)config->color_format);
+        return NULL;
+    }
+
+    frame_capture_t *capture = calloc(1, sizeof(*capture));
+    if (!capture) return NULL;
+
+    capture->config = *config;
+    if (capture->config.buffers == 0) capture->config.buffers = DEFAULT_CAPTURE_BUFFERS;
+    uint32_t buffers = capture->config.buffers;
+
+    capture->prefix = strdup(config->prefix ? config->prefix : "frame");
+    capture->frame_bytes = (size_t)config->width * config->height * format_pixel_bytes(config->format);
+    capture->memory = malloc(capture->frame_bytes * buffers);
+    capture->frame_nums = calloc(buffers, sizeof(uint32_t));
+    capture->free_slots = calloc(buffers, sizeof(uint32_t));
+    capture->queue = calloc(buffers, sizeof(uint32_t));
+    if (!capture->prefix || !capture->memory || !capture->frame_nums || !capture->free_slots || !capture->queue) {
+        fprintf(stderr, "frame_capture_start: failed to allocate %u buffers\n", buffers);
+        capture_free(capture);
+        return NULL;
+    }
+
+    /* touch the buffers now, so the first captures do not fault their pages in */
+    memset(capture->memory, 0, capture->frame_bytes * buffers);
+    for (uint32_t i = 0; i < buffers; i++) capture->free_slots[i] = buffers - 1 - i;
+    capture->free_count = buffers;
+
+    if (config->format == FRAME_CAPTURE_RAW) {
+        char filename[256];
+        snprintf(filename, sizeof(filename), "%s.bgra", capture->prefix);
+        capture->stream = fopen(filename, "wb");
+        if (!capture->stream) {
+            fprintf(stderr, "frame_capture_start: cannot open %s\n", filename);
+            capture_free(capture);
+            return NULL;
+        }
+    }
+
+    pthread_mutex_init(&capture->lock, NULL);
+    pthread_cond_init(&capture->queued, NULL);
+    pthread_cond_init(&capture->released, NULL);
+    if (pthread_create(&capture->worker, NULL, capture_worker, capture) != 0) {
+        fprintf(stderr, "frame_capture_start: cannot start the worker thread\n");
+        pthread_mutex_destroy(&capture->lock);
+        pthread_cond_destroy(&capture->queued);
+        pthread_cond_destroy(&capture->released);
+        capture_free(capture);
+        return NULL;
+    }
+
+    return capture;
+}
+
+bool frame_capture_submit(frame_capture_t *capture, const uint8_t *buffer, uint32_t stride,
+                          uint32_t frame_num) {
+    if (!capture || !buffer) return false;
+
+    pthread_mutex_lock(&capture->lock);
+    while (capture->free_count == 0 && capture->config.block_when_full) {
+        pthread_cond_wait(&capture->released, &capture->lock);
+    }
+    if (capture->free_count == 0) {
+        capture->stats.dropped++;
+        pthread_mutex_unlock(&capture->lock);
+        return false;
+    }
+    uint32_t slot = capture->free_slots[--capture->free_count];
+    pthread_mutex_unlock(&capture->lock);
+
+    /* the buffer is owned by this thread until it is queued */
+    convert_frame(capture->config.format, capture->config.color_format, slot_data(capture, slot), buffer,
+                  capture->config.width, capture->config.height, stride);
+    capture->frame_nums[slot] = frame_num;
+
+    pthread_mutex_lock(&capture->lock);
+    uint32_t tail = (capture->queue_head + capture->queue_count) % capture->config.buffers;
+    capture->queue[tail] = slot;
+    capture->queue_count++;
+    capture->stats.submitted++;
+    pthread_cond_signal(&capture->queued);
+    pthread_mutex_unlock(&capture->lock);
+    return true;
+}
+
+void frame_capture_stop(frame_capture_t *capture, frame_capture_stats_t *stats) {
+    if (!capture) {
+        if (stats) memset(stats, 0, sizeof(*stats));
+        return;
+    }
+
+    pthread_mutex_lock(&capture->lock);
+    capture->stopping = true;
+    pthread_cond_signal(&capture->queued);
+    pthread_mutex_unlock(&capture->lock);
+    pthread_join(capture->worker, NULL);
+
+    if (capture->stream && fflush(capture->stream) != 0) {
+        fprintf(stderr, "frame_capture_stop: failed to write %s.bgra\n", capture->prefix);
+    }
+    printf("Frames captured: %u written, %u dropped, %u failed\n",
+           capture->stats.written, capture->stats.dropped, capture->stats.failed);
+    if (stats) *stats = capture->stats;
+
+    pthread_mutex_destroy(&capture->lock);
+    pthread_cond_destroy(&capture->queued);
+    pthread_cond_destroy(&capture->released);
+    capture_free(capture);
+}
@@ -23,8 +23,15 @@
 #define MAX_PROJECTION_STACK_DEPTH 2
 #define MAX_TEXTURE_STACK_DEPTH    2
 
-#define NUM_TEXTURES 0
-#define MAX_LIGHTS 1
+#define NUM_TEXTURES PIXELFORGE_NUM_TEXTURES
+#define MAX_LIGHTS PIXELFORGE_NUM_LIGHTS
+
+#define CMD_RING_SIZE (64 * 1024)
+
+/* Display lists are recorded into a host buffer and copied to VRAM part by part */
+#define LIST_SCRATCH_SIZE (64 * 1024)
+/* A new part is started before a draw once less room than this is left */
+#define LIST_PART_RESERVE (4 * 1024)
 
 /* ============================================================================
  * Dirty Flags - Track what needs to be uploaded to GPU
@@ -41,6 +48,8 @@ typedef enum {
     DIRTY_CULL             = (1 << 7),
     DIRTY_VERTEX_ARRAYS    = (1 << 8),
     DIRTY_FRAMEBUFFER      = (1 << 9),
+    DIRTY_TEXTURE          = (1 << 10),
+    DIRTY_ALL              = (1 << 11) - 1,
 } dirty_flags_t;
 
 /* ============================================================================
@@ -84,16 +93,78 @@ typedef struct {
     GLint size;
     GLenum type;
     GLsizei stride;
+    bool normalized;    /* integer components map to [-1, 1] / [0, 1] */
+    uint32_t phys;      /* cached GPU address of `offset`, 0 if it is outside of the storage */
 } attribute_config_t;
 
+/* Buffer handles: handle table slot + 1 in the low bits, slot generation above,
+ * so a handle of a deleted buffer never resolves to the slot's next occupant */
+#define BUFFER_SLOT_BITS 20
+#define BUFFER_SLOT_MASK ((1u << BUFFER_SLOT_BITS) - 1)
+#define BUFFER_GENERATION_MASK ((1u << (32 - BUFFER_SLOT_BITS)) - 1)
+#define NO_BUFFER_SLOT UINT32_MAX
+
 typedef struct {
     GLuint id;
+    uint32_t generation;
+    uint32_t next_free_slot;        /* free slot list link while not alive */
     void *virt;
     uint32_t phys;
     size_t size;
     bool alive;
+    GLenum usage;
+    bool in_flight;                 /* referenced by a draw that may not have retired yet */
+    pixelforge_fence_t last_use;    /* fence of the last draw reading this buffer */
 } gl_buffer_t;
 
+/* Storage of an orphaned or deleted buffer, freed once its last draw retires */
+typedef struct {
+    void *virt;
+    pixelforge_fence_t last_use;
+    bool texture;               /* read by texturing, not just by input assembly */
+} retired_storage_t;
+
+/* Texture objects, name n is textures[n - 1]. Texels are stored as B8G8R8A8 in the
+ * tiled layout of the texturing unit. */
+typedef struct {
+    bool reserved;              /* name is in use (glGenTextures() or glBindTexture()) */
+    void *virt;
+    uint32_t phys;
+    uint8_t width_log2;
+    uint8_t height_log2;
+    GLenum format;              /* base format of the uploaded image */
+    GLenum min_filter;
+    GLenum mag_filter;
+    GLenum wrap_s;
+    GLenum wrap_t;
+    bool in_flight;             /* sampled by a draw that may not have retired yet */
+    pixelforge_fence_t last_use;
+} gl_texture_t;
+
+/* Packets of a display list recorded under one modelview matrix. Matrices and the
+ * framebuffer are not recorded, glCallList() writes them from the ring in front of
+ * every part, so the list follows the current transform and render buffer. */
+typedef struct {
+    pixelforge_cmdlist_t cmds;
+    void *storage;              /* VRAM copy of the packets */
+    float modelview[16];        /* relative to the modelview matrix at glCallList() */
+} list_part_t;
+
+typedef struct {
+    bool reserved;              /* name is in use (glGenLists() or glNewList()) */
+    bool defined;               /* glNewList() / glEndList() was called for it */
+    list_part_t *parts;
+    size_t part_count;
+    GLuint *buffers;            /* buffers read by the recorded draws */
+    size_t buffer_count;
+    GLuint *textures;           /* textures sampled by the recorded draws */
+    size_t texture_count;
+    void **records;             /* multi-draw records owned by the list */
+    size_t record_count;
+    bool in_flight;             /* called by draws that may not have retired yet */
+    pixelforge_fence_t last_use;
+} display_list_t;
+
 /* ============================================================================
  * Global State Structure
  * ============================================================================ */
@@ -107,6 +178,10 @@ typedef struct {
     void *gpu_pool_virt;        /* Virtual address of pool backing memory */
     uint32_t gpu_pool_phys;     /* Physical address of pool backing memory */
 
+    /* Command ring consumed by the GPU command processor */
+    pixelforge_cmdbuf_t cmdbuf;
+    struct udma_buffer ring_dma;    /* write-combined, unlike VRAM the ring is never synced */
+
     /* Dirty flags */
     uint32_t dirty;
 
@@ -164,13 +239,35 @@ typedef struct {
     attribute_config_t color_array;
     attribute_config_t texcoord_arrays[NUM_TEXTURES];
 
+    /* Texture state (single texture unit) */
+    bool texture_2d_enabled;
+    GLenum tex_env_mode;
+    GLuint texture_binding;
+    gl_texture_t *textures;
+    size_t texture_count;
+
     /* Buffer objects */
     gl_buffer_t *buffers;
     size_t buffer_count;
     size_t buffer_capacity;
-    GLuint next_buffer_id;
+    uint32_t free_buffer_slot;  /* head of the list of reusable slots */
     GLuint array_buffer_binding;
     GLuint element_array_buffer_binding;
+
+    /* Buffer storage waiting for the GPU to stop reading it */
+    retired_storage_t *retired_storage;
+    size_t retired_storage_count;
+    size_t retired_storage_capacity;
+
+    /* Display lists, name n is lists[n - 1] */
+    display_list_t *lists;
+    size_t list_count;
+    GLuint compiling;               /* list between glNewList() and glEndList(), 0 if none */
+    bool compile_failed;            /* out of memory while compiling, the list ends up empty */
+    float compile_modelview[16];    /* modelview matrix at glNewList() */
+    float part_modelview[16];       /* modelview matrix of the part being recorded */
+    pixelforge_cmdlist_t compile_cmds;
+    uint32_t *list_scratch;
 } gles_context_t;
 
 static gles_context_t *g_ctx = NULL;
@@ -200,34 +297,376 @@ static void mat4_copy(float *dst, const float *src) {
     memcpy(dst, src, 16 * sizeof(float));
 }
 
+static bool mat4_is_identity(const float *m) {
+    float id[16];
+    mat4_identity(id);
+    return memcmp(m, id, sizeof(id)) == 0;
+}
+
 static gl_buffer_t* get_buffer_by_id(gles_context_t *ctx, GLuint id) {
     if (!ctx || id == 0) return NULL;
-    for (size_t i = 0; i < ctx->buffer_count; i++) {
-        gl_buffer_t *buf = &ctx->buffers[i];
-        if (buf->alive && buf->id == id) {
-            return buf;
-        }
-    }
-    return NULL;
+
+    size_t slot = (id & BUFFER_SLOT_MASK) - 1;
+    if (slot >= ctx->buffer_count) return NULL;
+
+    gl_buffer_t *buf = &ctx->buffers[slot];
+    // a stale handle carries an old generation
+    if (!buf->alive || buf->id != id) return NULL;
+    return buf;
 }
 
-static gl_buffer_t* create_buffer(gles_context_t *ctx, GLuint id) {
+static gl_buffer_t* create_buffer(gles_context_t *ctx) {
     if (!ctx) return NULL;
-    if (ctx->buffer_count == ctx->buffer_capacity) {
-        size_t new_capacity = ctx->buffer_capacity == 0 ? 16 : ctx->buffer_capacity * 2;
-        gl_buffer_t *new_buffers = realloc(ctx->buffers, new_capacity * sizeof(gl_buffer_t));
-        if (!new_buffers) return NULL;
-        ctx->buffers = new_buffers;
-        ctx->buffer_capacity = new_capacity;
+
+    uint32_t slot = ctx->free_buffer_slot;
+    if (slot != NO_BUFFER_SLOT) {
+        ctx->free_buffer_slot = ctx->buffers[slot].next_free_slot;
+    } else {
+        if (ctx->buffer_count == BUFFER_SLOT_MASK) return NULL;
+        if (ctx->buffer_count == ctx->buffer_capacity) {
+            size_t new_capacity = ctx->buffer_capacity == 0 ? 16 : ctx->buffer_capacity * 2;
+            gl_buffer_t *new_buffers = realloc(ctx->buffers, new_capacity * sizeof(gl_buffer_t));
+            if (!new_buffers) return NULL;
+            ctx->buffers = new_buffers;
+            ctx->buffer_capacity = new_capacity;
+        }
+        slot = (uint32_t)ctx->buffer_count++;
+        ctx->buffers[slot].generation = 0;
     }
 
-    gl_buffer_t *buf = &ctx->buffers[ctx->buffer_count++];
+    gl_buffer_t *buf = &ctx->buffers[slot];
+    uint32_t generation = (buf->generation + 1) & BUFFER_GENERATION_MASK;
     memset(buf, 0, sizeof(*buf));
-    buf->id = id;
+    buf->generation = generation;
+    buf->id = (generation << BUFFER_SLOT_BITS) | (slot + 1);
     buf->alive = true;
+    buf->usage = GL_STATIC_DRAW;
     return buf;
 }
 
+static void destroy_buffer(gles_context_t *ctx, gl_buffer_t *buf) {
+    buf->alive = false;
+    buf->next_free_slot = ctx->free_buffer_slot;
+    ctx->free_buffer_slot = (buf->id & BUFFER_SLOT_MASK) - 1;
+}
+
+static void resolve_attribute(gles_context_t *ctx, attribute_config_t *attr) {
+    gl_buffer_t *buf = get_buffer_by_id(ctx, attr->buffer);
+    attr->phys = buf && buf->virt && attr->offset < buf->size
+        ? buf->phys + (uint32_t)attr->offset
+        : 0;
+}
+
+static void bind_attribute(gles_context_t *ctx, attribute_config_t *attr, const GLvoid *pointer) {
+    attr->buffer = ctx->array_buffer_binding;
+    attr->offset = (size_t)(uintptr_t)pointer;
+    resolve_attribute(ctx, attr);
+}
+
+/* Maps a GL component type to the input assembly format, false if it is not supported */
+static bool component_type(GLenum type, pixelforge_component_type_t *out, size_t *bytes) {
+    switch (type) {
+        case GL_BYTE:           *out = PIXELFORGE_COMPONENT_S8;    *bytes = 1; return true;
+        case GL_UNSIGNED_BYTE:  *out = PIXELFORGE_COMPONENT_U8;    *bytes = 1; return true;
+        case GL_SHORT:          *out = PIXELFORGE_COMPONENT_S16;   *bytes = 2; return true;
+        case GL_UNSIGNED_SHORT: *out = PIXELFORGE_COMPONENT_U16;   *bytes = 2; return true;
+        case GL_FIXED:          *out = PIXELFORGE_COMPONENT_FIXED; *bytes = 4; return true;
+        default: return false;
+    }
+}
+
+static void set_per_vertex_attr(pixelforge_input_attr_t *attr, const attribute_config_t *cfg) {
+    pixelforge_component_type_t type = PIXELFORGE_COMPONENT_FIXED;
+    size_t bytes;
+    component_type(cfg->type, &type, &bytes);
+
+    attr->mode = PIXELFORGE_ATTR_PER_VERTEX;
+    attr->info.per_vertex.address = cfg->phys;
+    attr->info.per_vertex.stride = cfg->stride;
+    attr->info.per_vertex.format.type = type;
+    attr->info.per_vertex.format.normalized = cfg->normalized;
+    attr->info.per_vertex.format.size = (uint8_t)cfg->size;
+}
+
+/* Refreshes the cached addresses of the attributes reading `buf` after its storage moved */
+static void buffer_storage_changed(gles_context_t *ctx, gl_buffer_t *buf) {
+    attribute_config_t *attrs[] = { &ctx->vertex_array, &ctx->normal_array, &ctx->color_array };
+    for (size_t i = 0; i < sizeof(attrs) / sizeof(attrs[0]); i++) {
+        if (attrs[i]->buffer == buf->id) resolve_attribute(ctx, attrs[i]);
+    }
+    for (int t = 0; t < NUM_TEXTURES; t++) {
+        if (ctx->texcoord_arrays[t].buffer == buf->id) resolve_attribute(ctx, &ctx->texcoord_arrays[t]);
+    }
+}
+
+static bool fence_pending(gles_context_t *ctx, pixelforge_fence_t fence) {
+    if (pf_fence_poll(ctx->dev, fence)) return false;
+
+    // vertex and index data is only read by input assembly, once it is done
+    // (with an empty command ring) the buffer is free even if the draw has not retired
+    return !(pf_csr_get_ready_components(ctx->dev->csr_base) & 1u);
+}
+
+static bool buffer_in_use(gles_context_t *ctx, gl_buffer_t *buf) {
+    if (buf->in_flight && !fence_pending(ctx, buf->last_use)) {
+        buf->in_flight = false;
+    }
+    return buf->in_flight;
+}
+
+static void wait_buffer_idle(gles_context_t *ctx, gl_buffer_t *buf) {
+    if (!buffer_in_use(ctx, buf)) return;
+
+    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_IA, NULL);
+    buf->in_flight = false;
+}
+
+/* Textures are read until the draw has retired, input assembly being done is not enough */
+static bool texture_in_use(gles_context_t *ctx, gl_texture_t *tex) {
+    if (tex->in_flight && pf_fence_poll(ctx->dev, tex->last_use)) {
+        tex->in_flight = false;
+    }
+    return tex->in_flight;
+}
+
+static void reclaim_retired_storage(gles_context_t *ctx) {
+    size_t kept = 0;
+    for (size_t i = 0; i < ctx->retired_storage_count; i++) {
+        retired_storage_t *rs = &ctx->retired_storage[i];
+        bool pending = rs->texture ? !pf_fence_poll(ctx->dev, rs->last_use) : fence_pending(ctx, rs->last_use);
+        if (pending) {
+            ctx->retired_storage[kept++] = *rs;
+        } else {
+            small_free(ctx->gpu_buffer_pool, rs->virt);
+        }
+    }
+    ctx->retired_storage_count = kept;
+}
+
+static bool defer_free_any(gles_context_t *ctx, void *virt, pixelforge_fence_t last_use, bool texture) {
+    if (ctx->retired_storage_count == ctx->retired_storage_capacity) {
+        size_t new_capacity = ctx->retired_storage_capacity == 0 ? 16 : ctx->retired_storage_capacity * 2;
+        retired_storage_t *new_storage = realloc(ctx->retired_storage, new_capacity * sizeof(retired_storage_t));
+        if (!new_storage) return false;
+        ctx->retired_storage = new_storage;
+        ctx->retired_storage_capacity = new_capacity;
+    }
+
+    ctx->retired_storage[ctx->retired_storage_count++] = (retired_storage_t){
+        .virt = virt,
+        .last_use = last_use,
+        .texture = texture,
+    };
+    return true;
+}
+
+static bool defer_free(gles_context_t *ctx, void *virt, pixelforge_fence_t last_use) {
+    return defer_free_any(ctx, virt, last_use, false);
+}
+
+/* Detaches the storage from `buf`, it is freed once the GPU stops reading it */
+static void release_buffer_storage(gles_context_t *ctx, gl_buffer_t *buf) {
+    if (!buf->virt) return;
+
+    if (!buffer_in_use(ctx, buf) || !defer_free(ctx, buf->virt, buf->last_use)) {
+        // without bookkeeping space we have to wait for the GPU instead
+        wait_buffer_idle(ctx, buf);
+        small_free(ctx->gpu_buffer_pool, buf->virt);
+    }
+
+    buf->virt = NULL;
+    buf->phys = 0;
+    buf->size = 0;
+    buf->in_flight = false;
+}
+
+static void *alloc_buffer_storage(gles_context_t *ctx, size_t size) {
+    void *ptr = small_malloc(ctx->gpu_buffer_pool, size);
+    if (!ptr && ctx->retired_storage_count > 0) {
+        // out of memory, wait for orphaned storage to be released and retry
+        pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_IA, NULL);
+        reclaim_retired_storage(ctx);
+        ptr = small_malloc(ctx->gpu_buffer_pool, size);
+    }
+    return ptr;
+}
+
+static uint32_t buffer_phys(gles_context_t *ctx, const void *virt) {
+    return ctx->gpu_pool_phys + (uint32_t)((uintptr_t)virt - (uintptr_t)ctx->gpu_pool_virt);
+}
+
+static gl_texture_t *get_texture(gles_context_t *ctx, GLuint name) {
+    if (!ctx || name == 0 || name > ctx->texture_count) return NULL;
+    gl_texture_t *tex = &ctx->textures[name - 1];
+    return tex->reserved ? tex : NULL;
+}
+
+/* Grows the texture table to hold names up to `count` */
+static bool reserve_textures(gles_context_t *ctx, size_t count) {
+    if (count <= ctx->texture_count) return true;
+
+    gl_texture_t *new_textures = realloc(ctx->textures, count * sizeof(gl_texture_t));
+    if (!new_textures) return false;
+    memset(new_textures + ctx->texture_count, 0, (count - ctx->texture_count) * sizeof(gl_texture_t));
+    ctx->textures = new_textures;
+    ctx->texture_count = count;
+    return true;
+}
+
+static void init_texture(gl_texture_t *tex) {
+    memset(tex, 0, sizeof(*tex));
+    tex->reserved = true;
+    tex->min_filter = GL_NEAREST_MIPMAP_LINEAR;
+    tex->mag_filter = GL_LINEAR;
+    tex->wrap_s = GL_REPEAT;
+    tex->wrap_t = GL_REPEAT;
+}
+
+/* Detaches the texel storage, it is freed once the last draw sampling it retires */
+static void release_texture_storage(gles_context_t *ctx, gl_texture_t *tex) {
+    if (!tex->virt) return;
+
+    if (!texture_in_use(ctx, tex) || !defer_free_any(ctx, tex->virt, tex->last_use, true)) {
+        if (tex->in_flight) pf_fence_wait(ctx->dev, tex->last_use, NULL);
+        small_free(ctx->gpu_buffer_pool, tex->virt);
+    }
+
+    tex->virt = NULL;
+    tex->phys = 0;
+    tex->in_flight = false;
+}
+
+static display_list_t *get_list(gles_context_t *ctx, GLuint name) {
+    if (!ctx || name == 0 || name > ctx->list_count) return NULL;
+    return &ctx->lists[name - 1];
+}
+
+/* Grows the list table to hold names up to `count` */
+static bool reserve_lists(gles_context_t *ctx, size_t count) {
+    if (count <= ctx->list_count) return true;
+
+    display_list_t *new_lists = realloc(ctx->lists, count * sizeof(display_list_t));
+    if (!new_lists) return false;
+    memset(new_lists + ctx->list_count, 0, (count - ctx->list_count) * sizeof(display_list_t));
+    ctx->lists = new_lists;
+    ctx->list_count = count;
+    return true;
+}
+
+static void free_list_storage(gles_context_t *ctx, display_list_t *list, void *virt) {
+    if (list->in_flight && !defer_free(ctx, virt, list->last_use)) {
+        pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_IA, NULL);
+        list->in_flight = false;
+    }
+    if (!list->in_flight) small_free(ctx->gpu_buffer_pool, virt);
+}
+
+/* Drops the recorded contents, the name stays reserved */
+static void clear_display_list(gles_context_t *ctx, display_list_t *list) {
+    if (list->in_flight && !fence_pending(ctx, list->last_use)) list->in_flight = false;
+
+    for (size_t i = 0; i < list->part_count; i++) {
+        free_list_storage(ctx, list, list->parts[i].storage);
+    }
+    for (size_t i = 0; i < list->record_count; i++) {
+        free_list_storage(ctx, list, list->records[i]);
+    }
+    free(list->parts);
+    free(list->buffers);
+    free(list->textures);
+    free(list->records);
+
+    bool reserved = list->reserved;
+    memset(list, 0, sizeof(*list));
+    list->reserved = reserved;
+}
+
+static void begin_list_part(gles_context_t *ctx, display_list_t *list) {
+    // parts are always called in order, so each one continues from the state of the previous
+    const pixelforge_cmdlist_t *after = list->part_count > 0 ? &list->parts[list->part_count - 1].cmds : NULL;
+
+    pf_cmdlist_init(&ctx->compile_cmds, ctx->list_scratch, 0, LIST_SCRATCH_SIZE);
+    pf_cmdbuf_begin_list(&ctx->cmdbuf, &ctx->compile_cmds, after);
+    mat4_copy(ctx->part_modelview, ctx->modelview_stack.matrices[ctx->modelview_stack.depth]);
+}
+
+/* Moves the recorded part from the scratch buffer to VRAM */
+static void end_list_part(gles_context_t *ctx, display_list_t *list) {
+    pixelforge_cmdlist_t *cmds = &ctx->compile_cmds;
+
+    if (!pf_cmdbuf_end_list(&ctx->cmdbuf)) ctx->compile_failed = true;
+    if (ctx->compile_failed || cmds->size == 0) return;
+
+    list_part_t *new_parts = realloc(list->parts, (list->part_count + 1) * sizeof(list_part_t));
+    void *storage = new_parts ? alloc_buffer_storage(ctx, cmds->size) : NULL;
+    if (new_parts) list->parts = new_parts;
+    if (!storage) {
+        ctx->compile_failed = true;
+        return;
+    }
+
+    pf_cmdlist_move(cmds, storage, buffer_phys(ctx, storage));
+    pixelforge_vram_sync_for_device(ctx->dev, storage, cmds->size);
+
+    list_part_t *part = &list->parts[list->part_count++];
+    part->cmds = *cmds;
+    part->storage = storage;
+    mat4_copy(part->modelview, ctx->part_modelview);
+}
+
+/* Called in front of every recorded draw instead of uploading the matrices */
+static void split_list_part(gles_context_t *ctx, display_list_t *list) {
+    pixelforge_cmdlist_t *cmds = &ctx->compile_cmds;
+    bool full = cmds->capacity - cmds->size < LIST_PART_RESERVE;
+
+    if (!(ctx->dirty & DIRTY_MATRICES) && !full) return;
+
+    if (cmds->draws > 0 || full) {
+        end_list_part(ctx, list);
+        begin_list_part(ctx, list);
+    } else {
+        // nothing drawn with the old matrix yet
+        mat4_copy(ctx->part_modelview, ctx->modelview_stack.matrices[ctx->modelview_stack.depth]);
+    }
+    ctx->dirty &= ~DIRTY_MATRICES;
+}
+
+static void list_use_buffer(gles_context_t *ctx, display_list_t *list, GLuint id) {
+    for (size_t i = 0; i < list->buffer_count; i++) {
+        if (list->buffers[i] == id) return;
+    }
+
+    GLuint *new_buffers = realloc(list->buffers, (list->buffer_count + 1) * sizeof(GLuint));
+    if (!new_buffers) {
+        ctx->compile_failed = true;
+        return;
+    }
+    list->buffers = new_buffers;
+    list->buffers[list->buffer_count++] = id;
+}
+
+static void list_use_texture(gles_context_t *ctx, display_list_t *list, GLuint name) {
+    for (size_t i = 0; i < list->texture_count; i++) {
+        if (list->textures[i] == name) return;
+    }
+
+    GLuint *new_textures = realloc(list->textures, (list->texture_count + 1) * sizeof(GLuint));
+    if (!new_textures) {
+        ctx->compile_failed = true;
+        return;
+    }
+    list->textures = new_textures;
+    list->textures[list->texture_count++] = name;
+}
+
+static bool list_own_records(display_list_t *list, void *records) {
+    void **new_records = realloc(list->records, (list->record_count + 1) * sizeof(void *));
+    if (!new_records) return false;
+    list->records = new_records;
+    list->records[list->record_count++] = records;
+    return true;
+}
+
 static void init_matrix_stack(matrix_stack_t *stack) {
     stack->depth = 0;
     mat4_identity(stack->matrices[0]);
@@ -310,6 +749,29 @@ static pixelforge_input_topology_t gl_mode_to_topology(GLenum mode) {
     }
 }
 
+static pixelforge_texture_wrap_t gl_wrap_to_pf_wrap(GLenum wrap) {
+    return wrap == GL_CLAMP_TO_EDGE ? PIXELFORGE_TEXTURE_CLAMP_TO_EDGE : PIXELFORGE_TEXTURE_REPEAT;
+}
+
+/* The texturing unit only knows RGBA texels, so the modes that differ per base format
+ * are mapped onto the one giving the same result for the expanded texels */
+static pixelforge_texture_env_mode_t gl_tex_env_to_pf(GLenum mode, GLenum format) {
+    bool has_alpha = format == GL_RGBA || format == GL_LUMINANCE_ALPHA;
+    switch (mode) {
+        case GL_MODULATE: return PIXELFORGE_TEXENV_MODULATE;
+        case GL_DECAL:    return PIXELFORGE_TEXENV_DECAL;
+        case GL_REPLACE:
+            // RGB keeps the fragment alpha, ALPHA (stored as 1,1,1,A) keeps the fragment color
+            if (format == GL_ALPHA) return PIXELFORGE_TEXENV_MODULATE;
+            return has_alpha ? PIXELFORGE_TEXENV_REPLACE : PIXELFORGE_TEXENV_DECAL;
+        case GL_ADD:
+            return format == GL_ALPHA ? PIXELFORGE_TEXENV_MODULATE : PIXELFORGE_TEXENV_ADD;
+        default:
+            assert(false && "Invalid texture environment mode");
+            return PIXELFORGE_TEXENV_MODULATE;
+    }
+}
+
 static pixelforge_cull_face_t gl_cull_to_pf_cull(GLenum mode) {
     switch (mode) {
         case GL_FRONT: return PIXELFORGE_CULL_FRONT;
@@ -323,17 +785,22 @@ static pixelforge_cull_face_t gl_cull_to_pf_cull(GLenum mode) {
 
 /* ============================================================================
  * State Upload Functions - Only upload what's dirty
+ *
+ * State is recorded into the command ring. The GPU latches matrices, lighting,
+ * cull, framebuffer and per-fragment state when a draw starts, so it can be
+ * rewritten while earlier draws are still in flight; only the input assembly
+ * wait before each draw remains. Registers that already hold the uploaded
+ * value are skipped by the command ring shadow.
  * ============================================================================ */
 
-static void upload_matrices(gles_context_t *ctx) {
-    if (!(ctx->dirty & DIRTY_MATRICES)) return;
-
-    // wait for vertex transform stage to be idle before uploading matrices
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_VTX_TRANSFORM, NULL);
+static uint32_t gpu_stage_mask(enum gpu_stage stage) {
+    // a stage is ready only if all prior stages are also ready
+    return (1u << (stage + 1)) - 1;
+}
 
-    volatile uint8_t *csr = ctx->dev->csr_base;
+static void upload_vtx_xf(gles_context_t *ctx, const float *mv) {
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
-    float *mv = ctx->modelview_stack.matrices[ctx->modelview_stack.depth];
     float *p = ctx->projection_stack.matrices[ctx->projection_stack.depth];
 
     pixelforge_vtx_xf_config_t xf = {0};
@@ -346,19 +813,27 @@ static void upload_matrices(gles_context_t *ctx) {
     mat3_from_mat4(nm, mv);
     mat3_to_fp16_16(xf.normal_mv_inv_t, nm);
 
-    // TODO: Texture matrix
+    // texture coordinates pass through unless the texture matrix does something
+    for (int i = 0; i < NUM_TEXTURES; i++) {
+        const float *t = ctx->texture_stack.matrices[ctx->texture_stack.depth];
+        xf.enabled.texture_enable[i] = !mat4_is_identity(t);
+        mat4_to_fp16_16(xf.texture_transform[i], t);
+    }
+
+    pf_cmdbuf_set_vtx_xf(cb, &xf);
+}
+
+static void upload_matrices(gles_context_t *ctx) {
+    if (!(ctx->dirty & DIRTY_MATRICES)) return;
 
-    pf_csr_set_vtx_xf(csr, &xf);
+    upload_vtx_xf(ctx, ctx->modelview_stack.matrices[ctx->modelview_stack.depth]);
     ctx->dirty &= ~DIRTY_MATRICES;
 }
 
 static void upload_material(gles_context_t *ctx) {
     if (!(ctx->dirty & DIRTY_MATERIAL)) return;
 
-    // wait for vertex transform stage to be idle before uploading material
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_VTX_TRANSFORM, NULL);
-
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
     pixelforge_material_t mat = {0};
     set_fp_vec_v(mat.ambient, ctx->material.ambient, 3);
@@ -366,52 +841,46 @@ static void upload_material(gles_context_t *ctx) {
     set_fp_vec_v(mat.specular, ctx->material.specular, 3);
     set_fp_vec_v(&mat.shininess, &ctx->material.shininess, 1);
 
-    pf_csr_set_material(csr, &mat);
+    pf_cmdbuf_set_material(cb, &mat);
     ctx->dirty &= ~DIRTY_MATERIAL;
 }
 
 static void upload_lights(gles_context_t *ctx) {
     if (!(ctx->dirty & DIRTY_LIGHTS)) return;
 
-    // wait for vertex transform stage to be idle before uploading matrices
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_VTX_TRANSFORM, NULL);
-
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
+    uint32_t enable_mask = 0;
 
     if (ctx->lighting_enabled) {
+        /* disabled lights are skipped by the GPU, no need to upload them */
         for (int i = 0; i < MAX_LIGHTS; ++i) {
-            pixelforge_light_t light = {0};
-
-            if (ctx->lights[i].enabled) {
-                set_fp_vec_v(light.position, ctx->lights[i].position, 4);
-                set_fp_vec_v(light.ambient, ctx->lights[i].ambient, 3);
-                set_fp_vec_v(light.diffuse, ctx->lights[i].diffuse, 3);
-                set_fp_vec_v(light.specular, ctx->lights[i].specular, 3);
-            }
+            if (!ctx->lights[i].enabled) continue;
 
-            pf_csr_set_light(csr, i, &light);
+            pixelforge_light_t light = {0};
+            set_fp_vec_v(light.position, ctx->lights[i].position, 4);
+            set_fp_vec_v(light.ambient, ctx->lights[i].ambient, 3);
+            set_fp_vec_v(light.diffuse, ctx->lights[i].diffuse, 3);
+            set_fp_vec_v(light.specular, ctx->lights[i].specular, 3);
+            pf_cmdbuf_set_light(cb, i, &light);
+            enable_mask |= 1u << i;
         }
     } else {
         // add a single ambient light if lighting is disabled to ensure we get some color output
         pixelforge_light_t light = {0};
         set_fp_vec_v(light.ambient, (float[]){1.0f, 1.0f, 1.0f}, 3);
-        pf_csr_set_light(csr, 0, &light);
-        for (int i = 1; i < MAX_LIGHTS; ++i) {
-            pixelforge_light_t off_light = {0};
-            pf_csr_set_light(csr, i, &off_light);
-        }
+        pf_cmdbuf_set_light(cb, 0, &light);
+        enable_mask = 1u;
     }
 
+    pf_cmdbuf_set_light_enable(cb, enable_mask);
+
     ctx->dirty &= ~DIRTY_LIGHTS;
 }
 
 static void upload_depth(gles_context_t *ctx) {
     if (!(ctx->dirty & DIRTY_DEPTH)) return;
 
-    // wait for depth test stage to be idle before uploading depth state
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_PER_PIXEL, NULL);
-
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
     pixelforge_depth_test_config_t depth = {
         .test_enabled = ctx->depth_test_enabled,
@@ -419,17 +888,14 @@ static void upload_depth(gles_context_t *ctx) {
         .compare_op = gl_compare_to_pf_compare(ctx->depth_func),
     };
 
-    pf_csr_set_depth(csr, &depth);
+    pf_cmdbuf_set_depth(cb, &depth);
     ctx->dirty &= ~DIRTY_DEPTH;
 }
 
 static void upload_blend(gles_context_t *ctx) {
     if (!(ctx->dirty & DIRTY_BLEND)) return;
 
-    // wait for blend stage to be idle before uploading blend state
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_PER_PIXEL, NULL);
-
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
     pixelforge_blend_config_t blend = {
         .enabled = ctx->blend_enabled,
@@ -442,17 +908,14 @@ static void upload_blend(gles_context_t *ctx) {
         .color_write_mask = 0xF,
     };
 
-    pf_csr_set_blend(csr, &blend);
+    pf_cmdbuf_set_blend(cb, &blend);
     ctx->dirty &= ~DIRTY_BLEND;
 }
 
 static void upload_stencil(gles_context_t *ctx) {
     if (!(ctx->dirty & DIRTY_STENCIL)) return;
 
-    // wait for stencil stage to be idle before uploading stencil state
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_PER_PIXEL, NULL);
-
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
     pixelforge_stencil_op_config_t stencil_front = {
         .compare_op = gl_compare_to_pf_compare(ctx->stencil_front.func),
@@ -473,8 +936,8 @@ static void upload_stencil(gles_context_t *ctx) {
         .pass_op = gl_stencil_op_to_pf(ctx->stencil_back.zpass_op),
     };
 
-    pf_csr_set_stencil_front(csr, &stencil_front);
-    pf_csr_set_stencil_back(csr, &stencil_back);
+    pf_cmdbuf_set_stencil_front(cb, &stencil_front);
+    pf_cmdbuf_set_stencil_back(cb, &stencil_back);
 
     ctx->dirty &= ~DIRTY_STENCIL;
 }
@@ -482,10 +945,7 @@ static void upload_stencil(gles_context_t *ctx) {
 static void upload_cull(gles_context_t *ctx) {
     if (!(ctx->dirty & DIRTY_CULL)) return;
 
-    // wait for rasterizer stage to be idle before uploading cull state
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_PREP_RASTER, NULL);
-
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
     pixelforge_prim_config_t prim = {
         .type = PIXELFORGE_PRIM_TRIANGLES,
@@ -493,17 +953,38 @@ static void upload_cull(gles_context_t *ctx) {
         .winding = ctx->front_face == GL_CCW ? PIXELFORGE_WINDING_CCW : PIXELFORGE_WINDING_CW,
     };
 
-    pf_csr_set_prim(csr, &prim);
+    pf_cmdbuf_set_prim(cb, &prim);
     ctx->dirty &= ~DIRTY_CULL;
 }
 
+static void upload_texture(gles_context_t *ctx) {
+    if (!(ctx->dirty & DIRTY_TEXTURE)) return;
+
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
+
+    // texturing is off for an unbound texture or one without an image
+    pixelforge_texture_config_t conf = {0};
+    gl_texture_t *tex = get_texture(ctx, ctx->texture_binding);
+    if (ctx->texture_2d_enabled && tex && tex->virt) {
+        conf.enabled = true;
+        // there are no mipmaps, the magnification filter is used for minification too
+        conf.filter = tex->mag_filter == GL_LINEAR ? PIXELFORGE_TEXTURE_LINEAR : PIXELFORGE_TEXTURE_NEAREST;
+        conf.wrap_s = gl_wrap_to_pf_wrap(tex->wrap_s);
+        conf.wrap_t = gl_wrap_to_pf_wrap(tex->wrap_t);
+        conf.env_mode = gl_tex_env_to_pf(ctx->tex_env_mode, tex->format);
+        conf.width_log2 = tex->width_log2;
+        conf.height_log2 = tex->height_log2;
+        conf.address = tex->phys;
+    }
+
+    pf_cmdbuf_set_texture(cb, &conf);
+    ctx->dirty &= ~DIRTY_TEXTURE;
+}
+
 static void upload_framebuffer(gles_context_t *ctx) {
     if (!(ctx->dirty & DIRTY_FRAMEBUFFER)) return;
 
-    // wait for per pixel ops to end before changing framebuffer configuration
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_PER_PIXEL, NULL);
-
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
     pixelforge_framebuffer_config_t fb = {0};
     fb.width = ctx->dev->x_resolution;
@@ -521,9 +1002,11 @@ static void upload_framebuffer(gles_context_t *ctx) {
     fb.color_address = ctx->dev->buffer_phys[ctx->dev->render_buffer];
     fb.color_pitch = ctx->dev->buffer_stride;
     fb.depthstencil_address = ctx->dev->depthstencil_buffer_phys;
-    fb.depthstencil_pitch = ctx->dev->buffer_stride;
+    fb.depthstencil_pitch = ctx->dev->depthstencil_stride;
+    fb.color_format = ctx->dev->color_format;
+    fb.depthstencil_format = ctx->dev->depthstencil_format;
 
-    pf_csr_set_fb(csr, &fb);
+    pf_cmdbuf_set_fb(cb, &fb);
     ctx->dirty &= ~DIRTY_FRAMEBUFFER;
 }
 
@@ -532,10 +1015,14 @@ static void upload_framebuffer(gles_context_t *ctx) {
  * ============================================================================ */
 
 static void wait_for_draw(gles_context_t *ctx) {
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_PER_PIXEL, NULL);
+    pf_fence_wait(ctx->dev, pf_fence_insert(&ctx->cmdbuf), NULL);
 }
 
 bool glInit(void) {
+    return glInitPF(GL_TRUE);
+}
+
+bool glInitPF(GLboolean stencil) {
     if (g_ctx) {
         return false;  /* Already initialized */
     }
@@ -543,7 +1030,7 @@ bool glInit(void) {
     g_ctx = calloc(1, sizeof(gles_context_t));
     if (!g_ctx) return false;
 
-    g_ctx->dev = pixelforge_open_dev();
+    g_ctx->dev = pixelforge_open_dev_ds(stencil ? PIXELFORGE_DS_D16_X8_S8 : PIXELFORGE_DS_D16);
     if (!g_ctx->dev) {
         free(g_ctx);
         g_ctx = NULL;
@@ -562,7 +1049,7 @@ bool glInit(void) {
     /* Initialize GPU buffer memory pool using allocated memory */
     g_ctx->gpu_pool_virt = pool_block.virt;
     g_ctx->gpu_pool_phys = pool_block.phys;
-    g_ctx->gpu_buffer_pool = small_init(pool_block.virt, 16 * 1024 * 1024);
+    g_ctx->gpu_buffer_pool = small_init(pool_block.virt, 16 * 1024 * 1024, 0);
     if (!g_ctx->gpu_buffer_pool) {
         pixelforge_close_dev(g_ctx->dev);
         free(g_ctx);
@@ -570,6 +1057,16 @@ bool glInit(void) {
         return false;
     }
 
+    /* Allocate command ring, packets are written word by word and published by every kick */
+    if (udma_alloc_mapping(CMD_RING_SIZE, UDMA_WRITE_COMBINED, &g_ctx->ring_dma) != 0) {
+        small_destroy(g_ctx->gpu_buffer_pool);
+        pixelforge_close_dev(g_ctx->dev);
+        free(g_ctx);
+        g_ctx = NULL;
+        return false;
+    }
+    pf_cmdbuf_init(&g_ctx->cmdbuf, g_ctx->dev->csr_base, g_ctx->ring_dma.virt, g_ctx->ring_dma.phys, CMD_RING_SIZE);
+
     /* Initialize matrix stacks */
     init_matrix_stack(&g_ctx->modelview_stack);
     init_matrix_stack(&g_ctx->projection_stack);
@@ -583,13 +1080,14 @@ bool glInit(void) {
     set_vec4(g_ctx->material.specular, 0.0f, 0.0f, 0.0f, 1.0f);
     g_ctx->material.shininess = 0.0f;
 
-    /* Initialize default light */
+    /* Initialize default lights (only GL_LIGHT0 is white by default) */
     for (int i = 0; i < MAX_LIGHTS; i++) {
+        float c = i == 0 ? 1.0f : 0.0f;
         g_ctx->lights[i].enabled = false;
         set_vec4(g_ctx->lights[i].position, 0.0f, 0.0f, 1.0f, 0.0f);
         set_vec4(g_ctx->lights[i].ambient, 0.0f, 0.0f, 0.0f, 1.0f);
-        set_vec4(g_ctx->lights[i].diffuse, 1.0f, 1.0f, 1.0f, 1.0f);
-        set_vec4(g_ctx->lights[i].specular, 1.0f, 1.0f, 1.0f, 1.0f);
+        set_vec4(g_ctx->lights[i].diffuse, c, c, c, 1.0f);
+        set_vec4(g_ctx->lights[i].specular, c, c, c, 1.0f);
     }
 
     /* Initialize default state */
@@ -632,7 +1130,11 @@ bool glInit(void) {
     g_ctx->clear_depth = 1.0f;
     g_ctx->clear_stencil = 0;
 
-    g_ctx->next_buffer_id = 1;
+    g_ctx->texture_2d_enabled = false;
+    g_ctx->tex_env_mode = GL_MODULATE;
+    g_ctx->texture_binding = 0;
+
+    g_ctx->free_buffer_slot = NO_BUFFER_SLOT;
     g_ctx->array_buffer_binding = 0;
     g_ctx->element_array_buffer_binding = 0;
 
@@ -645,12 +1147,25 @@ bool glInit(void) {
 void glDestroy(void) {
     if (!g_ctx) return;
 
-    /* Wait for any in-flight draws */
+    if (g_ctx->compiling) glEndList();
+
+    /* Wait for any in-flight draws and show the queued frames */
     wait_for_draw(g_ctx);
+    pixelforge_present_flush(g_ctx->dev);
+    pf_cmdbuf_fini(&g_ctx->cmdbuf);
+    udma_free(&g_ctx->ring_dma);
+
+    for (size_t i = 0; i < g_ctx->list_count; i++) {
+        clear_display_list(g_ctx, &g_ctx->lists[i]);
+    }
 
     pixelforge_close_dev(g_ctx->dev);
     small_destroy(g_ctx->gpu_buffer_pool);
+    free(g_ctx->retired_storage);
     free(g_ctx->buffers);
+    free(g_ctx->textures);
+    free(g_ctx->lists);
+    free(g_ctx->list_scratch);
     free(g_ctx);
     g_ctx = NULL;
 }
@@ -683,6 +1198,10 @@ void glEnable(GLenum cap) {
             g_ctx->lighting_enabled = true;
             g_ctx->dirty |= DIRTY_MATERIAL | DIRTY_LIGHTS;
             break;
+        case GL_TEXTURE_2D:
+            g_ctx->texture_2d_enabled = true;
+            g_ctx->dirty |= DIRTY_TEXTURE;
+            break;
     }
 
     if (cap >= GL_LIGHT0 && cap < GL_LIGHT0 + MAX_LIGHTS) {
@@ -716,6 +1235,10 @@ void glDisable(GLenum cap) {
             g_ctx->lighting_enabled = false;
             g_ctx->dirty |= DIRTY_MATERIAL | DIRTY_LIGHTS;
             break;
+        case GL_TEXTURE_2D:
+            g_ctx->texture_2d_enabled = false;
+            g_ctx->dirty |= DIRTY_TEXTURE;
+            break;
     }
 
     if (cap >= GL_LIGHT0 && cap < GL_LIGHT0 + MAX_LIGHTS) {
@@ -746,50 +1269,48 @@ void glClearStencil(GLint s) {
 void glClear(GLbitfield mask) {
     if (!g_ctx) return;
 
-    /* Wait for GPU before clearing */
-    wait_for_draw(g_ctx);
-
-    uint8_t *buffer = pixelforge_get_back_buffer(g_ctx->dev);
-
     bool clear_color = (mask & GL_COLOR_BUFFER_BIT) != 0;
     bool clear_depth = (mask & GL_DEPTH_BUFFER_BIT) != 0;
     bool clear_stencil = (mask & GL_STENCIL_BUFFER_BIT) != 0;
+    if (!clear_color && !clear_depth && !clear_stencil) return;
+
+    /* clears are not recorded into display lists */
+    if (g_ctx->compiling) return;
+
+    pixelforge_cmdbuf_t *cb = &g_ctx->cmdbuf;
+
+    /* the clear covers the scissor rectangle of the current framebuffer */
+    upload_framebuffer(g_ctx);
 
-    if (clear_color) {
+    uint32_t color;
+    if (g_ctx->dev->color_format == PIXELFORGE_COLOR_R5G6B5) {
+        uint32_t r = (uint32_t)(g_ctx->clear_color[0] * 31.0f + 0.5f);
+        uint32_t g = (uint32_t)(g_ctx->clear_color[1] * 63.0f + 0.5f);
+        uint32_t b = (uint32_t)(g_ctx->clear_color[2] * 31.0f + 0.5f);
+        color = (r << 11) | (g << 5) | b;
+    } else {
         uint8_t r = (uint8_t)(g_ctx->clear_color[0] * 255.0f);
         uint8_t g = (uint8_t)(g_ctx->clear_color[1] * 255.0f);
         uint8_t b = (uint8_t)(g_ctx->clear_color[2] * 255.0f);
         uint8_t a = (uint8_t)(g_ctx->clear_color[3] * 255.0f);
-        uint32_t color = (a << 24) | (r << 16) | (g << 8) | b;
-
-        for (size_t i = 0; i < g_ctx->dev->buffer_size / 4; i++) {
-            ((uint32_t*)buffer)[i] = color;
-        }
+        color = ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
     }
 
-    if (clear_depth && clear_stencil) {
-        // Depth-Stencil is in D16_X8_S8 format
-        uint32_t depth_stencil_value = (uint32_t)(g_ctx->clear_depth * 65535.0f) | ((g_ctx->clear_stencil & 0xFF) << 24);
-        uint32_t *depth_stencil_buffer = (uint32_t*)(g_ctx->dev->depthstencil_buffer);
-
-        for (size_t i = 0; i < g_ctx->dev->buffer_size / 4; i++) {
-            depth_stencil_buffer[i] = depth_stencil_value;
-        }
-    } else if (clear_depth) {
-        uint32_t depth_value = (uint32_t)(g_ctx->clear_depth * 65535.0f); // Stencil bits are preserved
-        uint32_t *depth_stencil_buffer = (uint32_t*)(g_ctx->dev->depthstencil_buffer);
-
-        for (size_t i = 0; i < g_ctx->dev->buffer_size / 4; i++) {
-            depth_stencil_buffer[i] = depth_value | (depth_stencil_buffer[i] & 0xFF000000);
-        }
-    } else if (clear_stencil) {
-        uint32_t stencil_value = (g_ctx->clear_stencil & 0xFF) << 24; // Depth bits are preserved
-        uint32_t *depth_stencil_buffer = (uint32_t*)(g_ctx->dev->depthstencil_buffer);
+    pixelforge_clear_config_t clear = {
+        .color_enable = clear_color,
+        .depth_enable = clear_depth,
+        .stencil_mask = clear_stencil ? 0xFF : 0x00,
+        .color = color,
+        // D16_X8_S8 layout, a D16 buffer only takes the depth
+        .depthstencil = (uint32_t)(g_ctx->clear_depth * 65535.0f) | ((uint32_t)(g_ctx->clear_stencil & 0xFF) << 24),
+    };
 
-        for (size_t i = 0; i < g_ctx->dev->buffer_size / 4; i++) {
-            depth_stencil_buffer[i] = (depth_stencil_buffer[i] & 0x00FFFFFF) | stencil_value;
-        }
-    }
+    // earlier draws must finish writing the framebuffer before it is overwritten,
+    // later draws are held back by the GPU until the clear is done
+    pf_cmdbuf_wait_ready(cb, gpu_stage_mask(GPU_STAGE_PER_PIXEL));
+    pf_cmdbuf_set_clear(cb, &clear);
+    pf_cmdbuf_clear(cb);
+    pf_cmdbuf_kick(cb);
 }
 
 void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
@@ -1143,6 +1664,10 @@ void glEnableClientState(GLenum array) {
             g_ctx->color_array.enabled = true;
             g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
             break;
+        case GL_TEXTURE_COORD_ARRAY:
+            g_ctx->texcoord_arrays[0].enabled = true;
+            g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
+            break;
     }
 }
 
@@ -1162,60 +1687,92 @@ void glDisableClientState(GLenum array) {
             g_ctx->color_array.enabled = false;
             g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
             break;
+        case GL_TEXTURE_COORD_ARRAY:
+            g_ctx->texcoord_arrays[0].enabled = false;
+            g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
+            break;
     }
 }
 
 void glVertexPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer) {
     if (!g_ctx) return;
 
-    assert(size == 4);
-    assert(type == GL_FIXED);
+    pixelforge_component_type_t component;
+    size_t bytes;
+    if (size < 2 || size > 4 || type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_SHORT ||
+        !component_type(type, &component, &bytes)) return;
 
-    if (stride == 0) stride = size * sizeof(uint32_t); // fp16_16
+    if (stride == 0) stride = size * bytes;
 
     if (g_ctx->array_buffer_binding == 0) return;
 
-    g_ctx->vertex_array.buffer = g_ctx->array_buffer_binding;
-    g_ctx->vertex_array.offset = (size_t)(uintptr_t)pointer;
+    bind_attribute(g_ctx, &g_ctx->vertex_array, pointer);
     g_ctx->vertex_array.size = size;
     g_ctx->vertex_array.type = type;
     g_ctx->vertex_array.stride = stride;
+    g_ctx->vertex_array.normalized = false;
     g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
 }
 
 void glNormalPointer(GLenum type, GLsizei stride, const GLvoid *pointer) {
     if (!g_ctx) return;
 
-    assert(type == GL_FIXED);
+    pixelforge_component_type_t component;
+    size_t bytes;
+    if (type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_SHORT ||
+        !component_type(type, &component, &bytes)) return;
 
     GLint size = 3;  /* Normals are always 3 components */
-    if (stride == 0) stride = size * sizeof(uint32_t); // fp16_16
+    if (stride == 0) stride = size * bytes;
 
     if (g_ctx->array_buffer_binding == 0) return;
 
-    g_ctx->normal_array.buffer = g_ctx->array_buffer_binding;
-    g_ctx->normal_array.offset = (size_t)(uintptr_t)pointer;
+    bind_attribute(g_ctx, &g_ctx->normal_array, pointer);
     g_ctx->normal_array.size = size;
     g_ctx->normal_array.type = type;
     g_ctx->normal_array.stride = stride;
+    g_ctx->normal_array.normalized = type != GL_FIXED;  /* byte and short normals are normalized */
     g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
 }
 
 void glColorPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer) {
     if (!g_ctx) return;
 
-    assert(size == 4);
-    assert(type == GL_FIXED);
+    pixelforge_component_type_t component;
+    size_t bytes;
+    if (size != 4 || (type != GL_UNSIGNED_BYTE && type != GL_FIXED) ||
+        !component_type(type, &component, &bytes)) return;
 
-    if (stride == 0) stride = size * sizeof(uint32_t); // fp16_16
+    if (stride == 0) stride = size * bytes;
 
     if (g_ctx->array_buffer_binding == 0) return;
 
-    g_ctx->color_array.buffer = g_ctx->array_buffer_binding;
-    g_ctx->color_array.offset = (size_t)(uintptr_t)pointer;
+    bind_attribute(g_ctx, &g_ctx->color_array, pointer);
     g_ctx->color_array.size = size;
     g_ctx->color_array.type = type;
     g_ctx->color_array.stride = stride;
+    g_ctx->color_array.normalized = true;  /* no effect on GL_FIXED */
+    g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
+}
+
+void glTexCoordPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *pointer) {
+    if (!g_ctx) return;
+
+    pixelforge_component_type_t component;
+    size_t bytes;
+    if (size < 2 || size > 4 || type == GL_UNSIGNED_BYTE || type == GL_UNSIGNED_SHORT ||
+        !component_type(type, &component, &bytes)) return;
+
+    if (stride == 0) stride = size * bytes;
+
+    if (g_ctx->array_buffer_binding == 0) return;
+
+    attribute_config_t *texcoord = &g_ctx->texcoord_arrays[0];
+    bind_attribute(g_ctx, texcoord, pointer);
+    texcoord->size = size;
+    texcoord->type = type;
+    texcoord->stride = stride;
+    texcoord->normalized = false;
     g_ctx->dirty |= DIRTY_VERTEX_ARRAYS;
 }
 
@@ -1223,38 +1780,77 @@ void glColorPointer(GLint size, GLenum type, GLsizei stride, const GLvoid *point
  * Drawing Commands
  * ============================================================================ */
 
+/* One draw of a draw_generic() batch, `offset` is into the bound element buffer */
+typedef struct {
+    size_t offset;
+    GLsizei count;
+    GLint base_vertex;
+} draw_range_t;
+
+/* Draws that are empty or start outside of the element buffer are skipped */
+static bool draw_range_valid(const draw_range_t *draw, const gl_buffer_t *idx_buffer) {
+    if (draw->count <= 0) return false;
+    return !idx_buffer || draw->offset < idx_buffer->size;
+}
+
 static void draw_generic(
     gles_context_t *ctx,
     bool indexed,
     GLenum mode,
-    GLsizei base_vertex, GLsizei count,
     GLenum idx_type,
-    const void *indices) {
-    if (!ctx || count <= 0) return;
+    const draw_range_t *draws, GLsizei draw_count) {
+    if (!ctx || draw_count <= 0) return;
 
-    /* Upload all dirty state */
-    upload_matrices(ctx);
+    gl_buffer_t *idx_buffer = NULL;
+    if (indexed) {
+        if (ctx->element_array_buffer_binding == 0) return;
+        idx_buffer = get_buffer_by_id(ctx, ctx->element_array_buffer_binding);
+        if (!idx_buffer) return;
+    }
+
+    GLsizei valid_count = 0;
+    const draw_range_t *first_valid = NULL;
+    for (GLsizei i = 0; i < draw_count; i++) {
+        if (!draw_range_valid(&draws[i], idx_buffer)) continue;
+        if (!first_valid) first_valid = &draws[i];
+        valid_count++;
+    }
+    if (valid_count == 0) return;
+
+    // a single draw is programmed directly, batches are walked by the GPU from VRAM records
+    bool multi_draw = valid_count > 1;
+
+    /* Upload all dirty state, a display list gets matrices and framebuffer from glCallList() */
+    display_list_t *compiling = get_list(ctx, ctx->compiling);
+    if (compiling) {
+        split_list_part(ctx, compiling);
+    } else {
+        /* frames queued by glSwapBuffers() go on screen as soon as their draws retire */
+        pixelforge_present_poll(ctx->dev);
+        upload_matrices(ctx);
+        upload_framebuffer(ctx);
+    }
     upload_material(ctx);
     upload_lights(ctx);
     upload_depth(ctx);
     upload_blend(ctx);
     upload_stencil(ctx);
     upload_cull(ctx);
-    upload_framebuffer(ctx);
+    upload_texture(ctx);
 
-    // wait for input assembly for the per-draw state to be applied before configuring vertex attributes
-    pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_IA, NULL);
+    // wait for input assembly (and a free state slot) before configuring vertex attributes
+    pf_cmdbuf_wait_ready(&ctx->cmdbuf, gpu_stage_mask(GPU_STAGE_IA));
 
-    volatile uint8_t *csr = ctx->dev->csr_base;
+    pixelforge_cmdbuf_t *cb = &ctx->cmdbuf;
 
     /* Set topology */
     pixelforge_topo_config_t topo = {
         .input_topology = gl_mode_to_topology(mode),
         .primitive_restart_enable = false,
         .primitive_restart_index = 0,
-        .base_vertex = base_vertex,
+        .base_vertex = multi_draw ? 0 : (uint32_t)first_valid->base_vertex,
     };
-    pf_csr_set_topology(csr, &topo);
+    pf_cmdbuf_set_topology(cb, &topo);
 
     /* Determine index type */
     pixelforge_index_kind_t idx_kind = PIXELFORGE_INDEX_NOT_INDEXED;
@@ -1266,39 +1862,28 @@ static void draw_generic(
         }
     }
 
-    /* Set index config - indices pointer is expected to be offset into bound element buffer */
-    pixelforge_idx_config_t idx_cfg = {
-        .address = 0,
-        .count = count,
-        .kind = idx_kind,
-    };
-
-    if (indexed) {
-        if (g_ctx->element_array_buffer_binding == 0) return;
-        gl_buffer_t *idx_buffer = get_buffer_by_id(ctx, g_ctx->element_array_buffer_binding);
-        if (!idx_buffer) return;
+    /* Buffers read by this draw */
+    gl_buffer_t *used_buffers[4 + NUM_TEXTURES];
+    int used_count = 0;
 
-        size_t idx_offset = (size_t)(uintptr_t)indices;
-        if (idx_offset >= idx_buffer->size) return;
+    gl_texture_t *sampled = get_texture(ctx, ctx->texture_binding);
+    if (!ctx->texture_2d_enabled || (sampled && !sampled->virt)) sampled = NULL;
 
-        idx_cfg.address = idx_buffer->phys + (uint32_t)idx_offset;
+    if (idx_buffer) {
+        used_buffers[used_count++] = idx_buffer;
     }
 
-    pf_csr_set_idx(csr, &idx_cfg);
-
     /* Configure vertex attributes */
     pixelforge_input_attr_t attr = {0};
 
     if (g_ctx->vertex_array.enabled) {
         if (g_ctx->vertex_array.buffer != 0) {
             gl_buffer_t *pos_buffer = get_buffer_by_id(ctx, g_ctx->vertex_array.buffer);
-            if (!pos_buffer) return;
-            if (g_ctx->vertex_array.offset >= pos_buffer->size) return;
+            if (!pos_buffer || !g_ctx->vertex_array.phys) return;
+            used_buffers[used_count++] = pos_buffer;
 
-            attr.mode = PIXELFORGE_ATTR_PER_VERTEX;
-            attr.info.per_vertex.address = pos_buffer->phys + (uint32_t)g_ctx->vertex_array.offset;
-            attr.info.per_vertex.stride = g_ctx->vertex_array.stride;
-            pf_csr_set_attr_position(csr, &attr);
+            set_per_vertex_attr(&attr, &g_ctx->vertex_array);
+            pf_cmdbuf_set_attr_position(cb, &attr);
         } else {
             // set constant positions 0,0,0,1
             attr.mode = PIXELFORGE_ATTR_CONSTANT;
@@ -1306,20 +1891,18 @@ static void draw_generic(
             attr.info.constant_value.value[1] = fp16_16(0.0f);
             attr.info.constant_value.value[2] = fp16_16(0.0f);
             attr.info.constant_value.value[3] = fp16_16(1.0f);
-            pf_csr_set_attr_position(csr, &attr);
+            pf_cmdbuf_set_attr_position(cb, &attr);
         }
     }
 
     if (g_ctx->normal_array.enabled) {
         if (g_ctx->normal_array.buffer != 0) {
             gl_buffer_t *norm_buffer = get_buffer_by_id(ctx, g_ctx->normal_array.buffer);
-            if (!norm_buffer) return;
-            if (g_ctx->normal_array.offset >= norm_buffer->size) return;
+            if (!norm_buffer || !g_ctx->normal_array.phys) return;
+            used_buffers[used_count++] = norm_buffer;
 
-            attr.mode = PIXELFORGE_ATTR_PER_VERTEX;
-            attr.info.per_vertex.address = norm_buffer->phys + (uint32_t)g_ctx->normal_array.offset;
-            attr.info.per_vertex.stride = g_ctx->normal_array.stride;
-            pf_csr_set_attr_normal(csr, &attr);
+            set_per_vertex_attr(&attr, &g_ctx->normal_array);
+            pf_cmdbuf_set_attr_normal(cb, &attr);
         } else {
             // set constant normal 0,0,1,0
             attr.mode = PIXELFORGE_ATTR_CONSTANT;
@@ -1327,20 +1910,18 @@ static void draw_generic(
             attr.info.constant_value.value[1] = fp16_16(0.0f);
             attr.info.constant_value.value[2] = fp16_16(1.0f);
             attr.info.constant_value.value[3] = fp16_16(0.0f);
-            pf_csr_set_attr_normal(csr, &attr);
+            pf_cmdbuf_set_attr_normal(cb, &attr);
         }
     }
 
     if (g_ctx->color_array.enabled) {
         if (g_ctx->color_array.buffer != 0) {
             gl_buffer_t *color_buffer = get_buffer_by_id(ctx, g_ctx->color_array.buffer);
-            if (!color_buffer) return;
-            if (g_ctx->color_array.offset >= color_buffer->size) return;
+            if (!color_buffer || !g_ctx->color_array.phys) return;
+            used_buffers[used_count++] = color_buffer;
 
-            attr.mode = PIXELFORGE_ATTR_PER_VERTEX;
-            attr.info.per_vertex.address = color_buffer->phys + (uint32_t)g_ctx->color_array.offset;
-            attr.info.per_vertex.stride = g_ctx->color_array.stride;
-            pf_csr_set_attr_color(csr, &attr);
+            set_per_vertex_attr(&attr, &g_ctx->color_array);
+            pf_cmdbuf_set_attr_color(cb, &attr);
         } else {
             // set constant color 1,1,1,1
             attr.mode = PIXELFORGE_ATTR_CONSTANT;
@@ -1348,7 +1929,7 @@ static void draw_generic(
             attr.info.constant_value.value[1] = fp16_16(1.0f);
             attr.info.constant_value.value[2] = fp16_16(1.0f);
             attr.info.constant_value.value[3] = fp16_16(1.0f);
-            pf_csr_set_attr_color(csr, &attr);
+            pf_cmdbuf_set_attr_color(cb, &attr);
         }
     }
 
@@ -1357,13 +1938,11 @@ static void draw_generic(
             if (g_ctx->texcoord_arrays[i].buffer == 0) return;
 
             gl_buffer_t *tex_buffer = get_buffer_by_id(ctx, g_ctx->texcoord_arrays[i].buffer);
-            if (!tex_buffer) return;
-            if (g_ctx->texcoord_arrays[i].offset >= tex_buffer->size) return;
+            if (!tex_buffer || !g_ctx->texcoord_arrays[i].phys) return;
+            used_buffers[used_count++] = tex_buffer;
 
-            attr.mode = PIXELFORGE_ATTR_PER_VERTEX;
-            attr.info.per_vertex.address = tex_buffer->phys + (uint32_t)g_ctx->texcoord_arrays[i].offset;
-            attr.info.per_vertex.stride = g_ctx->texcoord_arrays[i].stride;
-            pf_csr_set_attr_texcoord(csr, i, &attr);
+            set_per_vertex_attr(&attr, &g_ctx->texcoord_arrays[i]);
+            pf_cmdbuf_set_attr_texcoord(cb, i, &attr);
         } else {
             // set constant texture coordinates 0,0,0,1
             attr.mode = PIXELFORGE_ATTR_CONSTANT;
@@ -1371,20 +1950,97 @@ static void draw_generic(
             attr.info.constant_value.value[1] = fp16_16(0.0f);
             attr.info.constant_value.value[2] = fp16_16(0.0f);
             attr.info.constant_value.value[3] = fp16_16(1.0f);
-            pf_csr_set_attr_texcoord(csr, i, &attr);
+            pf_cmdbuf_set_attr_texcoord(cb, i, &attr);
+        }
+    }
+
+    /* Set index config - offsets are into the bound element buffer */
+    pixelforge_idx_config_t idx_cfg = {
+        .address = 0,
+        .count = (uint32_t)first_valid->count,
+        .kind = idx_kind,
+        .draw_count = 0,
+    };
+    if (idx_buffer && !multi_draw) {
+        idx_cfg.address = idx_buffer->phys + (uint32_t)first_valid->offset;
+    }
+
+    pixelforge_indirect_draw_t *records = NULL;
+    if (multi_draw) {
+        records = alloc_buffer_storage(ctx, (size_t)valid_count * sizeof(*records));
+        if (!records) return;
+
+        GLsizei n = 0;
+        for (GLsizei i = 0; i < draw_count; i++) {
+            if (!draw_range_valid(&draws[i], idx_buffer)) continue;
+            records[n++] = (pixelforge_indirect_draw_t){
+                .address = idx_buffer ? idx_buffer->phys + (uint32_t)draws[i].offset : 0,
+                .count = (uint32_t)draws[i].count,
+                .base_vertex = (uint32_t)draws[i].base_vertex,
+            };
         }
+
+        pixelforge_vram_sync_for_device(ctx->dev, records, (size_t)n * sizeof(*records));
+        idx_cfg.address = buffer_phys(ctx, records);
+        idx_cfg.draw_count = (uint32_t)valid_count;
     }
 
+    pf_cmdbuf_set_idx(cb, &idx_cfg);
+
     // start the draw
-    pf_csr_start(csr);
+    pf_cmdbuf_start(cb);
+
+    if (compiling) {
+        // buffers are marked in flight and records freed when the list is called / deleted
+        for (int i = 0; i < used_count; i++) {
+            list_use_buffer(ctx, compiling, used_buffers[i]->id);
+        }
+        if (sampled) list_use_texture(ctx, compiling, ctx->texture_binding);
+        if (records && !list_own_records(compiling, records)) {
+            small_free(ctx->gpu_buffer_pool, records);
+            ctx->compile_failed = true;
+        }
+        return;
+    }
+
+    /* Remember the draw in every buffer it reads */
+    pixelforge_fence_t fence = pf_fence_insert(cb);
+    for (int i = 0; i < used_count; i++) {
+        used_buffers[i]->in_flight = true;
+        used_buffers[i]->last_use = fence;
+    }
+    if (sampled) {
+        sampled->in_flight = true;
+        sampled->last_use = fence;
+    }
+
+    /* Records are only read by the index generator, release them with the draw */
+    if (records && !defer_free(ctx, records, fence)) {
+        pixelforge_wait_for_gpu_ready(ctx->dev, GPU_STAGE_IA, NULL);
+        small_free(ctx->gpu_buffer_pool, records);
+    }
 }
 
 void glDrawArrays(GLenum mode, GLint first, GLsizei count) {
-    draw_generic(g_ctx, false, mode, first, count, 0, NULL);
+    draw_range_t draw = { .offset = 0, .count = count, .base_vertex = first };
+    draw_generic(g_ctx, false, mode, 0, &draw, 1);
 }
 
 void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indices) {
-    draw_generic(g_ctx, true, mode, 0, count, type, indices);
+    draw_range_t draw = { .offset = (size_t)(uintptr_t)indices, .count = count, .base_vertex = 0 };
+    draw_generic(g_ctx, true, mode, type, &draw, 1);
+}
+
+void glFlush(void) {
+    if (!g_ctx) return;
+    pf_cmdbuf_kick(&g_ctx->cmdbuf);
+    pixelforge_present_poll(g_ctx->dev);
+}
+
+void glFinish(void) {
+    if (!g_ctx) return;
+    wait_for_draw(g_ctx);
+    pixelforge_present_flush(g_ctx->dev);
 }
 
 /* ============================================================================
@@ -1394,16 +2050,222 @@ void glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid *indic
 void glSwapBuffers(void) {
     if (!g_ctx) return;
 
-    /* Wait for any in-flight draw operations before swapping */
-    wait_for_draw(g_ctx);
+    /* The frame is shown once its last draw retires, rendering continues into a free buffer */
+    pixelforge_present(g_ctx->dev, pf_fence_insert(&g_ctx->cmdbuf), true);
 
-    /* Swap buffers using existing implementation */
-    pixelforge_swap_buffers(g_ctx->dev);
+    /* Release orphaned buffer storage whose draws have retired */
+    reclaim_retired_storage(g_ctx);
 
     /* Framebuffer address changed, mark as dirty for next draw */
     g_ctx->dirty |= DIRTY_FRAMEBUFFER;
 }
 
+/* =========================================================================
+ * PixelForge Extensions
+ * ============================================================================ */
+
+void glGetCsrStatsPF(GLuint *written, GLuint *skipped, bool reset) {
+    if (!g_ctx) return;
+
+    pixelforge_csr_shadow_t *shadow = &g_ctx->cmdbuf.shadow;
+    if (written) *written = shadow->misses;
+    if (skipped) *skipped = shadow->hits;
+    if (reset) pf_csr_shadow_reset_stats(shadow);
+}
+
+void glGetWaitStatsPF(uint64_t *wait_ns, GLuint *waits, bool reset) {
+    if (!g_ctx) return;
+
+    pixelforge_dev *dev = g_ctx->dev;
+    if (wait_ns) *wait_ns = dev->wait_ns;
+    if (waits) *waits = dev->wait_count;
+    if (reset) {
+        dev->wait_ns = 0;
+        dev->wait_count = 0;
+    }
+}
+
+void glGetPresentStatsPF(GLuint *presented, GLuint *late, GLuint *dropped, uint64_t *blocked_ns, bool reset) {
+    if (!g_ctx) return;
+
+    pixelforge_present_stats_t stats;
+    pixelforge_get_present_stats(g_ctx->dev, &stats, reset);
+    if (presented) *presented = stats.presented;
+    if (late) *late = stats.late;
+    if (dropped) *dropped = stats.dropped;
+    if (blocked_ns) *blocked_ns = stats.blocked_ns;
+}
+
+void glGetPerfCountersPF(pixelforge_perf_counters_t *perf, bool reset) {
+    if (!g_ctx) return;
+
+    if (perf) pf_perf_read(g_ctx->dev->csr_base, perf);
+    if (reset) pf_perf_reset(g_ctx->dev->csr_base);
+}
+
+/* Batches larger than this are split, so the ranges can live on the stack */
+#define MULTI_DRAW_BATCH 64
+
+void glMultiDrawArraysPF(GLenum mode, const GLint *first, const GLsizei *count, GLsizei drawcount) {
+    if (!first || !count) return;
+
+    draw_range_t draws[MULTI_DRAW_BATCH];
+    for (GLsizei base = 0; base < drawcount; base += MULTI_DRAW_BATCH) {
+        GLsizei n = drawcount - base < MULTI_DRAW_BATCH ? drawcount - base : MULTI_DRAW_BATCH;
+        for (GLsizei i = 0; i < n; i++) {
+            draws[i] = (draw_range_t){
+                .offset = 0,
+                .count = count[base + i],
+                .base_vertex = first[base + i],
+            };
+        }
+        draw_generic(g_ctx, false, mode, 0, draws, n);
+    }
+}
+
+void glMultiDrawElementsPF(GLenum mode, const GLsizei *count, GLenum type,
+                           const GLvoid *const *indices, const GLint *basevertex, GLsizei drawcount) {
+    if (!count || !indices) return;
+
+    draw_range_t draws[MULTI_DRAW_BATCH];
+    for (GLsizei base = 0; base < drawcount; base += MULTI_DRAW_BATCH) {
+        GLsizei n = drawcount - base < MULTI_DRAW_BATCH ? drawcount - base : MULTI_DRAW_BATCH;
+        for (GLsizei i = 0; i < n; i++) {
+            draws[i] = (draw_range_t){
+                .offset = (size_t)(uintptr_t)indices[base + i],
+                .count = count[base + i],
+                .base_vertex = basevertex ? basevertex[base + i] : 0,
+            };
+        }
+        draw_generic(g_ctx, true, mode, type, draws, n);
+    }
+}
+
+/* =========================================================================
+ * Display Lists
+ * ============================================================================ */
+
+GLuint glGenLists(GLsizei range) {
+    if (!g_ctx || range <= 0) return 0;
+
+    // first run of `range` free names, the table grows if there is none
+    size_t first = 0;
+    size_t run = 0;
+    for (size_t i = 0; i < g_ctx->list_count && run < (size_t)range; i++) {
+        if (g_ctx->lists[i].reserved) {
+            run = 0;
+            first = i + 1;
+        } else {
+            run++;
+        }
+    }
+    if (first + (size_t)range > UINT32_MAX || !reserve_lists(g_ctx, first + (size_t)range)) return 0;
+
+    for (size_t i = first; i < first + (size_t)range; i++) {
+        g_ctx->lists[i].reserved = true;
+    }
+    return (GLuint)first + 1;
+}
+
+void glDeleteLists(GLuint list, GLsizei range) {
+    if (!g_ctx || range <= 0) return;
+
+    for (GLsizei i = 0; i < range; i++) {
+        display_list_t *dl = get_list(g_ctx, list + (GLuint)i);
+        if (!dl || list + (GLuint)i == g_ctx->compiling) continue;
+
+        clear_display_list(g_ctx, dl);
+        dl->reserved = false;
+    }
+}
+
+GLboolean glIsList(GLuint list) {
+    display_list_t *dl = get_list(g_ctx, list);
+    return dl && dl->defined ? GL_TRUE : GL_FALSE;
+}
+
+void glNewList(GLuint list, GLenum mode) {
+    if (!g_ctx || list == 0 || g_ctx->compiling) return;
+    if (mode != GL_COMPILE) return;
+
+    if (!g_ctx->list_scratch) {
+        g_ctx->list_scratch = malloc(LIST_SCRATCH_SIZE);
+        if (!g_ctx->list_scratch) return;
+    }
+    if (!reserve_lists(g_ctx, list)) return;
+
+    display_list_t *dl = get_list(g_ctx, list);
+    clear_display_list(g_ctx, dl);
+    dl->reserved = true;
+    dl->defined = true;
+
+    // the list records modelview changes relative to the matrix it is called with
+    float *mv = g_ctx->modelview_stack.matrices[g_ctx->modelview_stack.depth];
+    mat4_copy(g_ctx->compile_modelview, mv);
+    mat4_identity(mv);
+
+    g_ctx->compiling = list;
+    g_ctx->compile_failed = false;
+
+    // the list must not depend on state uploaded before it, record all of it
+    g_ctx->dirty |= DIRTY_ALL;
+    begin_list_part(g_ctx, dl);
+}
+
+void glEndList(void) {
+    if (!g_ctx || !g_ctx->compiling) return;
+
+    display_list_t *dl = get_list(g_ctx, g_ctx->compiling);
+    end_list_part(g_ctx, dl);
+    if (g_ctx->compile_failed) clear_display_list(g_ctx, dl);
+    dl->defined = true;
+
+    mat4_copy(g_ctx->modelview_stack.matrices[g_ctx->modelview_stack.depth], g_ctx->compile_modelview);
+    g_ctx->compiling = 0;
+
+    // uploads consumed by the recording never reached the ring
+    g_ctx->dirty |= DIRTY_ALL;
+}
+
+void glCallList(GLuint list) {
+    if (!g_ctx || g_ctx->compiling) return;
+
+    display_list_t *dl = get_list(g_ctx, list);
+    if (!dl || dl->part_count == 0) return;
+
+    pixelforge_cmdbuf_t *cb = &g_ctx->cmdbuf;
+    const float *mv = g_ctx->modelview_stack.matrices[g_ctx->modelview_stack.depth];
+
+    pixelforge_present_poll(g_ctx->dev);
+    upload_framebuffer(g_ctx);
+    for (size_t i = 0; i < dl->part_count; i++) {
+        float part_mv[16];
+        mat4_multiply(part_mv, mv, dl->parts[i].modelview);
+        upload_vtx_xf(g_ctx, part_mv);
+        pf_cmdbuf_call_list(cb, &dl->parts[i].cmds);
+    }
+
+    pixelforge_fence_t fence = pf_fence_insert(cb);
+    for (size_t i = 0; i < dl->buffer_count; i++) {
+        gl_buffer_t *buf = get_buffer_by_id(g_ctx, dl->buffers[i]);
+        if (!buf) continue;
+        buf->in_flight = true;
+        buf->last_use = fence;
+    }
+    for (size_t i = 0; i < dl->texture_count; i++) {
+        gl_texture_t *tex = get_texture(g_ctx, dl->textures[i]);
+        if (!tex) continue;
+        tex->in_flight = true;
+        tex->last_use = fence;
+    }
+    dl->in_flight = true;
+    dl->last_use = fence;
+
+    // the list leaves its own state behind, ours is re-uploaded in front of the next draw
+    // (only registers the list changed are actually written again)
+    g_ctx->dirty |= DIRTY_ALL;
+}
+
 /* =========================================================================
  * Buffer Objects (Handle-Based)
  * ============================================================================ */
@@ -1412,13 +2274,8 @@ void glGenBuffers(GLsizei n, GLuint *buffers) {
     if (!g_ctx || !buffers || n <= 0) return;
 
     for (GLsizei i = 0; i < n; i++) {
-        GLuint id = g_ctx->next_buffer_id++;
-        gl_buffer_t *buf = create_buffer(g_ctx, id);
-        if (!buf) {
-            buffers[i] = 0;
-            continue;
-        }
-        buffers[i] = id;
+        gl_buffer_t *buf = create_buffer(g_ctx);
+        buffers[i] = buf ? buf->id : 0;
     }
 }
 
@@ -1456,10 +2313,8 @@ void glDeleteBuffers(GLsizei n, const GLuint *buffers) {
             }
         }
 
-        buf->alive = false;
-        buf->virt = NULL;
-        buf->phys = 0;
-        buf->size = 0;
+        release_buffer_storage(g_ctx, buf);
+        destroy_buffer(g_ctx, buf);
     }
 }
 
@@ -1483,7 +2338,6 @@ void glBindBuffer(GLenum target, GLuint buffer) {
 }
 
 void glBufferData(GLenum target, size_t size, const void *data, GLenum usage) {
-    (void)usage;
     if (!g_ctx) return;
 
     GLuint bound = 0;
@@ -1498,12 +2352,21 @@ void glBufferData(GLenum target, size_t size, const void *data, GLenum usage) {
     gl_buffer_t *buf = get_buffer_by_id(g_ctx, bound);
     if (!buf) return;
 
-    if (buf->phys != 0) {
-        // Wait for GPU to be idle before modifying or freeing existing buffer memory
-        pixelforge_wait_for_gpu_ready(g_ctx->dev, GPU_STAGE_IA, NULL);
+    buf->usage = usage;
+    reclaim_retired_storage(g_ctx);
+
+    if (buffer_in_use(g_ctx, buf)) {
+        if (usage == GL_DYNAMIC_DRAW) {
+            // orphan the storage still read by the GPU instead of waiting for it
+            release_buffer_storage(g_ctx, buf);
+        } else {
+            // Wait for GPU to stop reading the buffer before modifying or freeing its memory
+            wait_buffer_idle(g_ctx, buf);
+        }
     }
 
-    void *new_data = small_realloc(g_ctx->gpu_buffer_pool, buf->virt, size);
+    void *new_data = buf->virt ? small_realloc(g_ctx->gpu_buffer_pool, buf->virt, size)
+                               : alloc_buffer_storage(g_ctx, size);
     if (!new_data && size > 0) {
         assert(false && "GPU buffer pool out of memory");
         return; // Allocation failed, keep old buffer
@@ -1511,15 +2374,16 @@ void glBufferData(GLenum target, size_t size, const void *data, GLenum usage) {
 
     buf->size = size;
     buf->virt = new_data;
-    buf->phys = g_ctx->gpu_pool_phys + (uint32_t)((uintptr_t)new_data - (uintptr_t)g_ctx->gpu_pool_virt);
-
+    buf->phys = new_data ? buffer_phys(g_ctx, new_data) : 0;
+    buffer_storage_changed(g_ctx, buf);
 
     if (data) {
         // copy the provided data into the buffer
-        // we don't need to wait here since if the buffer was used before then it had to have non-zero
-        // physical address, and we have already waited for the GPU to be idle if that was the case
+        // the storage is not used by the GPU anymore (or is a fresh allocation)
         memcpy(buf->virt, data, size);
     }
+    // the copy (and a moving realloc) went through the CPU caches
+    if (new_data) pixelforge_vram_sync_for_device(g_ctx->dev, new_data, size);
 }
 
 void glBufferSubData(GLenum target, size_t offset, size_t size, const void *data) {
@@ -1538,6 +2402,189 @@ void glBufferSubData(GLenum target, size_t offset, size_t size, const void *data
     if (!buf || !buf->virt) return;
     if (offset > buf->size || size > buf->size - offset) return;
 
-    pixelforge_wait_for_gpu_ready(g_ctx->dev, GPU_STAGE_IA, NULL);
+    size_t sync_offset = offset;
+    size_t sync_size = size;
+    if (buffer_in_use(g_ctx, buf)) {
+        void *renamed = NULL;
+        if (buf->usage == GL_DYNAMIC_DRAW) {
+            reclaim_retired_storage(g_ctx);
+            renamed = small_malloc(g_ctx->gpu_buffer_pool, buf->size);
+        }
+
+        if (renamed) {
+            // rename the buffer: the GPU keeps reading the old copy, we update the new one
+            if (offset > 0 || size < buf->size) {
+                memcpy(renamed, buf->virt, buf->size);
+                sync_offset = 0;
+                sync_size = buf->size;
+            }
+
+            size_t buf_size = buf->size;
+            release_buffer_storage(g_ctx, buf);
+            buf->virt = renamed;
+            buf->phys = buffer_phys(g_ctx, renamed);
+            buf->size = buf_size;
+            buffer_storage_changed(g_ctx, buf);
+        } else {
+            wait_buffer_idle(g_ctx, buf);
+        }
+    }
+
     memcpy((uint8_t*)buf->virt + offset, data, size);
+    pixelforge_vram_sync_for_device(g_ctx->dev, (uint8_t*)buf->virt + sync_offset, sync_size);
+}
+
+/* =========================================================================
+ * Texture Objects
+ * ============================================================================ */
+
+void glGenTextures(GLsizei n, GLuint *textures) {
+    if (!g_ctx || !textures || n <= 0) return;
+
+    size_t next = 0;
+    for (GLsizei i = 0; i < n; i++) {
+        while (next < g_ctx->texture_count && g_ctx->textures[next].reserved) next++;
+        if (next == g_ctx->texture_count && !reserve_textures(g_ctx, next + 1)) {
+            textures[i] = 0;
+            continue;
+        }
+        init_texture(&g_ctx->textures[next]);
+        textures[i] = (GLuint)++next;
+    }
+}
+
+void glDeleteTextures(GLsizei n, const GLuint *textures) {
+    if (!g_ctx || !textures || n <= 0) return;
+
+    for (GLsizei i = 0; i < n; i++) {
+        gl_texture_t *tex = get_texture(g_ctx, textures[i]);
+        if (!tex) continue;
+
+        if (g_ctx->texture_binding == textures[i]) {
+            g_ctx->texture_binding = 0;
+            g_ctx->dirty |= DIRTY_TEXTURE;
+        }
+
+        release_texture_storage(g_ctx, tex);
+        tex->reserved = false;
+    }
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+    if (!g_ctx || target != GL_TEXTURE_2D) return;
+
+    // like in GL, binding an unused name creates the texture
+    if (texture != 0 && !get_texture(g_ctx, texture)) {
+        if (!reserve_textures(g_ctx, texture)) return;
+        init_texture(&g_ctx->textures[texture - 1]);
+    }
+
+    g_ctx->texture_binding = texture;
+    g_ctx->dirty |= DIRTY_TEXTURE;
+}
+
+/* Bytes per texel of a GL_UNSIGNED_BYTE image, 0 for unsupported formats */
+static int texel_bytes(GLenum format) {
+    switch (format) {
+        case GL_RGBA:            return 4;
+        case GL_RGB:             return 3;
+        case GL_LUMINANCE_ALPHA: return 2;
+        case GL_LUMINANCE:       return 1;
+        case GL_ALPHA:           return 1;
+        default:                 return 0;
+    }
+}
+
+/* Expands a texel to B8G8R8A8 as read by the texturing unit */
+static uint32_t texel_to_bgra(GLenum format, const uint8_t *p) {
+    uint8_t r, g, b, a;
+    switch (format) {
+        case GL_RGBA:            r = p[0]; g = p[1]; b = p[2]; a = p[3]; break;
+        case GL_RGB:             r = p[0]; g = p[1]; b = p[2]; a = 0xFF; break;
+        case GL_LUMINANCE_ALPHA: r = g = b = p[0]; a = p[1]; break;
+        case GL_LUMINANCE:       r = g = b = p[0]; a = 0xFF; break;
+        default:                 r = g = b = 0xFF; a = p[0]; break;  /* GL_ALPHA */
+    }
+    return ((uint32_t)a << 24) | ((uint32_t)r << 16) | ((uint32_t)g << 8) | b;
+}
+
+static int size_log2(GLsizei size) {
+    for (int i = 0; i <= PIXELFORGE_MAX_TEXTURE_LOG2; i++) {
+        if (size == (1 << i)) return i;
+    }
+    return -1;
+}
+
+void glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height,
+                  GLint border, GLenum format, GLenum type, const GLvoid *pixels) {
+    if (!g_ctx || target != GL_TEXTURE_2D) return;
+
+    // only the base level is sampled
+    if (level != 0 || border != 0 || type != GL_UNSIGNED_BYTE) return;
+    if ((GLenum)internalformat != format || texel_bytes(format) == 0) return;
+
+    int width_log2 = size_log2(width);
+    int height_log2 = size_log2(height);
+    if (width_log2 < 0 || height_log2 < 0) return;
+
+    gl_texture_t *tex = get_texture(g_ctx, g_ctx->texture_binding);
+    if (!tex) return;
+
+    // the old image may still be sampled, it is freed once those draws retire
+    reclaim_retired_storage(g_ctx);
+    release_texture_storage(g_ctx, tex);
+
+    uint32_t size = pf_texture_size((uint8_t)width_log2, (uint8_t)height_log2);
+    uint32_t *texels = small_memalign(g_ctx->gpu_buffer_pool, 64, size);
+    if (!texels) {
+        assert(false && "GPU buffer pool out of memory");
+        return;
+    }
+
+    tex->virt = texels;
+    tex->phys = buffer_phys(g_ctx, texels);
+    tex->width_log2 = (uint8_t)width_log2;
+    tex->height_log2 = (uint8_t)height_log2;
+    tex->format = format;
+    g_ctx->dirty |= DIRTY_TEXTURE;
+
+    if (!pixels) {
+        memset(texels, 0, size);
+        pixelforge_vram_sync_for_device(g_ctx->dev, texels, size);
+        return;
+    }
+
+    // rows are GL_UNPACK_ALIGNMENT (4) aligned, the image is swizzled into 4x4 texel tiles
+    int bytes = texel_bytes(format);
+    size_t row_pitch = ((size_t)width * bytes + 3) & ~(size_t)3;
+    for (GLsizei y = 0; y < height; y++) {
+        const uint8_t *row = (const uint8_t *)pixels + (size_t)y * row_pitch;
+        for (GLsizei x = 0; x < width; x++) {
+            texels[pf_texture_texel_offset(x, y, tex->width_log2)] = texel_to_bgra(format, row + x * bytes);
+        }
+    }
+    pixelforge_vram_sync_for_device(g_ctx->dev, texels, size);
+}
+
+void glTexParameteri(GLenum target, GLenum pname, GLint param) {
+    if (!g_ctx || target != GL_TEXTURE_2D) return;
+
+    gl_texture_t *tex = get_texture(g_ctx, g_ctx->texture_binding);
+    if (!tex) return;
+
+    switch (pname) {
+        case GL_TEXTURE_MIN_FILTER: tex->min_filter = (GLenum)param; break;
+        case GL_TEXTURE_MAG_FILTER: tex->mag_filter = (GLenum)param; break;
+        case GL_TEXTURE_WRAP_S:     tex->wrap_s = (GLenum)param; break;
+        case GL_TEXTURE_WRAP_T:     tex->wrap_t = (GLenum)param; break;
+        default: return;
+    }
+    g_ctx->dirty |= DIRTY_TEXTURE;
+}
+
+void glTexEnvi(GLenum target, GLenum pname, GLint param) {
+    if (!g_ctx || target != GL_TEXTURE_ENV || pname != GL_TEXTURE_ENV_MODE) return;
+
+    g_ctx->tex_env_mode = (GLenum)param;
+    g_ctx->dirty |= DIRTY_TEXTURE;
 }
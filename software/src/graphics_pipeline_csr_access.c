@@ -1,19 +1,314 @@
 #include "graphics_pipeline_csr_access.h"
 #include <assert.h>
+#include <string.h>
+
+/* =============================
+ * Register packing
+ *
+ * Each packer fills the words of one contiguous CSR range in ascending address
+ * order, so the same data can either be written over MMIO or recorded into the
+ * command ring (multi-word registers commit on their last word).
+ * ============================= */
+#define PF_IDX_WORDS       3
+#define PF_TOPO_WORDS      4
+#define PF_ATTR_INFO_WORDS 4
+#define PF_VTX_XF_WORDS    (3 * 16)
+#define PF_MATERIAL_WORDS  13
+#define PF_LIGHT_WORDS     16
+#define PF_PRIM_WORDS      3
+#define PF_FB_WORDS        16
+#define PF_FB_FORMAT_WORDS 2
+#define PF_STENCIL_WORDS   2
+#define PF_CLEAR_WORDS     3
+#define PF_TEXTURE_WORDS   2
+
+_Static_assert(PIXELFORGE_CSR_IDX_KIND - PIXELFORGE_CSR_IDX_ADDRESS == (PF_IDX_WORDS - 1) * 4,
+               "idx registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_TOPO_BASE_VERTEX - PIXELFORGE_CSR_TOPO_INPUT_TOPOLOGY == (PF_TOPO_WORDS - 1) * 4,
+               "topology registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_VTX_XF_NORMAL_MV_INV_T - PIXELFORGE_CSR_VTX_XF_POSITION_MV == 2 * 16 * 4,
+               "vertex transform matrices must be contiguous");
+_Static_assert(PIXELFORGE_CSR_VTX_SH_MATERIAL_SHININESS - PIXELFORGE_CSR_VTX_SH_MATERIAL_AMBIENT == (PF_MATERIAL_WORDS - 1) * 4,
+               "material registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_VTX_SH_0_LIGHT_SPECULAR - PIXELFORGE_CSR_VTX_SH_0_LIGHT_POSITION == 3 * 4 * 4,
+               "light registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_PRIM_WINDING - PIXELFORGE_CSR_PRIM_TYPE == (PF_PRIM_WORDS - 1) * 4,
+               "primitive registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_FB_DEPTHSTENCIL_PITCH - PIXELFORGE_CSR_FB_WIDTH == (PF_FB_WORDS - 1) * 4,
+               "framebuffer registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_FB_FORMAT_DEPTHSTENCIL - PIXELFORGE_CSR_FB_FORMAT_COLOR == (PF_FB_FORMAT_WORDS - 1) * 4,
+               "framebuffer format registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_CLEAR_DEPTHSTENCIL - PIXELFORGE_CSR_CLEAR_FLAGS == (PF_CLEAR_WORDS - 1) * 4,
+               "clear registers must be contiguous");
+_Static_assert(PIXELFORGE_CSR_TEX_CONFIG - PIXELFORGE_CSR_TEX_ADDRESS == (PF_TEXTURE_WORDS - 1) * 4,
+               "texture registers must be contiguous");
+
+static void pf_pack_idx(const pixelforge_idx_config_t *cfg, uint32_t *w) {
+    w[0] = cfg->address;
+    w[1] = cfg->count;
+    w[2] = (uint32_t)cfg->kind;
+}
+
+static void pf_pack_topology(const pixelforge_topo_config_t *cfg, uint32_t *w) {
+    w[0] = (uint32_t)cfg->input_topology;
+    w[1] = (uint32_t)cfg->primitive_restart_enable;
+    w[2] = cfg->primitive_restart_index;
+    w[3] = cfg->base_vertex;
+}
+
+static void pf_pack_attr_info(const pixelforge_input_attr_t *attr, uint32_t *w) {
+    if (attr->mode == PIXELFORGE_ATTR_CONSTANT) {
+        for (int i = 0; i < 4; ++i) w[i] = (uint32_t)attr->info.constant_value.value[i];
+    } else {
+        w[0] = attr->info.per_vertex.address;
+        w[1] = (uint32_t)attr->info.per_vertex.stride
+             | (((uint32_t)attr->info.per_vertex.format.type & 0x7) << 16)
+             | ((uint32_t)attr->info.per_vertex.format.normalized << 19)
+             | (((uint32_t)attr->info.per_vertex.format.size & 0x7) << 20);
+        w[2] = 0;
+        w[3] = 0;
+    }
+}
+
+static uint32_t pf_pack_vtx_xf_enabled(const pixelforge_vtx_xf_config_t *cfg) {
+    uint32_t enabled = 0;
+    enabled |= (uint32_t)cfg->enabled.normal_enable << 0;
+    for (int i = 0; i < PIXELFORGE_NUM_TEXTURES; ++i)
+        enabled |= (uint32_t)cfg->enabled.texture_enable[i] << (1 + i);
+    return enabled;
+}
+
+static void pf_pack_vtx_xf_matrices(const pixelforge_vtx_xf_config_t *cfg, uint32_t *w) {
+    for (int i = 0; i < 16; ++i) w[i] = (uint32_t)cfg->position_mv[i];
+    for (int i = 0; i < 16; ++i) w[16 + i] = (uint32_t)cfg->position_p[i];
+    for (int i = 0; i < 9; ++i) w[32 + i] = (uint32_t)cfg->normal_mv_inv_t[i];
+    for (int i = 9; i < 16; ++i) w[32 + i] = 0;
+}
+
+static const uint32_t tex_attr_bases[PIXELFORGE_NUM_TEXTURES][2] = {
+    {PIXELFORGE_CSR_TEX_0_ATTR_MODE, PIXELFORGE_CSR_TEX_0_ATTR_INFO},
+};
+
+static const uint32_t tex_transform_bases[PIXELFORGE_NUM_TEXTURES] = {
+    PIXELFORGE_CSR_TEX_0_TRANSFORM,
+};
+
+static void pf_pack_texture(const pixelforge_texture_config_t *cfg, uint32_t *w) {
+    w[0] = cfg->address;
+    w[1] = ((uint32_t)cfg->enabled << 0)
+         | (((uint32_t)cfg->filter & 0x1) << 1)
+         | (((uint32_t)cfg->wrap_s & 0x1) << 2)
+         | (((uint32_t)cfg->wrap_t & 0x1) << 3)
+         | (((uint32_t)cfg->env_mode & 0x3) << 4)
+         | (((uint32_t)cfg->width_log2 & 0xF) << 8)
+         | (((uint32_t)cfg->height_log2 & 0xF) << 12);
+}
+
+static void pf_pack_material(const pixelforge_material_t *mat, uint32_t *w) {
+    for (int i = 0; i < 3; ++i) w[i] = (uint32_t)mat->ambient[i];
+    w[3] = 0;
+    for (int i = 0; i < 3; ++i) w[4 + i] = (uint32_t)mat->diffuse[i];
+    w[7] = 0;
+    for (int i = 0; i < 3; ++i) w[8 + i] = (uint32_t)mat->specular[i];
+    w[11] = 0;
+    w[12] = (uint32_t)mat->shininess;
+}
+
+static void pf_pack_light(const pixelforge_light_t *lit, uint32_t *w) {
+    for (int i = 0; i < 4; ++i) w[i] = (uint32_t)lit->position[i];
+    for (int i = 0; i < 3; ++i) w[4 + i] = (uint32_t)lit->ambient[i];
+    w[7] = 0;
+    for (int i = 0; i < 3; ++i) w[8 + i] = (uint32_t)lit->diffuse[i];
+    w[11] = 0;
+    for (int i = 0; i < 3; ++i) w[12 + i] = (uint32_t)lit->specular[i];
+    w[15] = 0;
+}
+
+static void pf_pack_prim(const pixelforge_prim_config_t *cfg, uint32_t *w) {
+    w[0] = (uint32_t)cfg->type;
+    w[1] = (uint32_t)cfg->cull;
+    w[2] = (uint32_t)cfg->winding;
+}
+
+static void pf_pack_fb(const pixelforge_framebuffer_config_t *cfg, uint32_t *w) {
+    w[0]  = (uint32_t)cfg->width;
+    w[1]  = (uint32_t)cfg->height;
+    w[2]  = (uint32_t)cfg->viewport_x;
+    w[3]  = (uint32_t)cfg->viewport_y;
+    w[4]  = (uint32_t)cfg->viewport_width;
+    w[5]  = (uint32_t)cfg->viewport_height;
+    w[6]  = (uint32_t)cfg->viewport_min_depth;
+    w[7]  = (uint32_t)cfg->viewport_max_depth;
+    w[8]  = (uint32_t)cfg->scissor_offset_x;
+    w[9]  = (uint32_t)cfg->scissor_offset_y;
+    w[10] = (uint32_t)cfg->scissor_width;
+    w[11] = (uint32_t)cfg->scissor_height;
+    w[12] = cfg->color_address;
+    w[13] = (uint32_t)cfg->color_pitch;
+    w[14] = cfg->depthstencil_address;
+    w[15] = (uint32_t)cfg->depthstencil_pitch;
+}
+
+static void pf_pack_fb_format(const pixelforge_framebuffer_config_t *cfg, uint32_t *w) {
+    w[0] = (uint32_t)cfg->color_format;
+    w[1] = (uint32_t)cfg->depthstencil_format;
+}
+
+static void pf_pack_stencil_conf(const pixelforge_stencil_op_config_t *c, uint32_t *w) {
+    w[0] = 0;
+    w[0] |= ((uint32_t)c->compare_op & 0x7) << 0;
+    w[0] |= ((uint32_t)c->pass_op    & 0x7) << 3;
+    w[0] |= ((uint32_t)c->fail_op    & 0x7) << 6;
+    w[0] |= ((uint32_t)c->depth_fail_op & 0x7) << 9;
+    w[0] |= ((uint32_t)c->reference  & 0xFF) << 16;
+    w[0] |= ((uint32_t)c->mask       & 0xFF) << 24;
+    w[1] = ((uint32_t)c->write_mask & 0xFF);
+}
+
+static uint32_t pf_pack_depth_test(const pixelforge_depth_test_config_t *c) {
+    uint32_t w = 0;
+    w |= ((uint32_t)c->test_enabled  & 0x1) << 0;
+    w |= ((uint32_t)c->write_enabled & 0x1) << 1;
+    w |= ((uint32_t)c->compare_op    & 0x7) << 2;
+    return w;
+}
+
+static uint32_t pf_pack_blend_config(const pixelforge_blend_config_t *c) {
+    uint32_t w = 0;
+    w |= ((uint32_t)c->src_factor   & 0xF) << 0;
+    w |= ((uint32_t)c->dst_factor   & 0xF) << 4;
+    w |= ((uint32_t)c->src_a_factor & 0xF) << 8;
+    w |= ((uint32_t)c->dst_a_factor & 0xF) << 12;
+    w |= ((uint32_t)c->enabled      & 0x1) << 16;
+    w |= ((uint32_t)c->blend_op     & 0x7) << 17;
+    w |= ((uint32_t)c->blend_a_op   & 0x7) << 20;
+    w |= ((uint32_t)c->color_write_mask & 0xF) << 24;
+    return w;
+}
+
+static void pf_pack_clear(const pixelforge_clear_config_t *c, uint32_t *w) {
+    w[0] = 0;
+    w[0] |= ((uint32_t)c->color_enable & 0x1) << 0;
+    w[0] |= ((uint32_t)c->depth_enable & 0x1) << 1;
+    w[0] |= ((uint32_t)c->stencil_mask & 0xFF) << 2;
+    w[1] = c->color;
+    w[2] = c->depthstencil;
+}
+
+static inline void pf_csr_store_regs(volatile uint8_t *base, uint32_t offset, const uint32_t *values, uint32_t count) {
+    /* stores to the device mapping are not reordered among themselves */
+    for (uint32_t i = 0; i < count; ++i) {
+        *(volatile uint32_t *)(base + offset + i * 4) = values[i];
+    }
+}
+
+void pf_csr_write_regs(volatile uint8_t *base, uint32_t offset, const uint32_t *values, uint32_t count) {
+    __sync_synchronize();
+    pf_csr_store_regs(base, offset, values, count);
+    __sync_synchronize();
+}
+
+/* =============================
+ * Register Shadow
+ * ============================= */
+#define PF_REG_SHADOW 0x80u
+
+/* size in words at the first word of each register (0 elsewhere), PF_REG_SHADOW if mirrored */
+static const uint8_t pf_reg_info[PF_CSR_SHADOW_WORDS] = {
+#define PF_REG_INFO(name, addr, size, shadow) [(addr) / 4] = (uint8_t)((size) / 4 | ((shadow) ? PF_REG_SHADOW : 0)),
+    PIXELFORGE_CSR_REGISTERS(PF_REG_INFO)
+#undef PF_REG_INFO
+};
+
+void pf_csr_shadow_invalidate(pixelforge_csr_shadow_t *s) {
+    memset(s->valid, 0, sizeof(s->valid));
+}
+
+void pf_csr_shadow_reset_stats(pixelforge_csr_shadow_t *s) {
+    s->hits = 0;
+    s->misses = 0;
+}
+
+/* Returns the length of the leading run of whole registers that either all have to be
+ * written (*dirty) or are all unchanged, and updates the shadow for them. */
+static uint32_t pf_csr_shadow_run(pixelforge_csr_shadow_t *s, uint32_t offset, const uint32_t *values,
+                                  uint32_t count, bool *dirty) {
+    assert((offset % 4) == 0);
+
+    uint32_t n = 0;
+    bool run_dirty = true;
+
+    while (n < count) {
+        uint32_t word = offset / 4 + n;
+        uint32_t info = word < PF_CSR_SHADOW_WORDS ? pf_reg_info[word] : 0;
+        uint32_t words = info & ~PF_REG_SHADOW;
+        bool mirrored = (info & PF_REG_SHADOW) != 0;
+        bool reg_dirty = true;
+
+        if (words == 0 || n + words > count) {
+            /* not the start of a register, or only part of it: the value is no longer known */
+            words = 1;
+            mirrored = false;
+            if (word < PF_CSR_SHADOW_WORDS) s->valid[word] = 0;
+        } else if (mirrored) {
+            reg_dirty = false;
+            for (uint32_t i = 0; i < words; ++i) {
+                if (!s->valid[word + i] || s->value[word + i] != values[n + i]) {
+                    reg_dirty = true;
+                    break;
+                }
+            }
+        }
+
+        if (n > 0 && reg_dirty != run_dirty) break;
+        run_dirty = reg_dirty;
+
+        if (mirrored) {
+            for (uint32_t i = 0; i < words; ++i) {
+                s->value[word + i] = values[n + i];
+                s->valid[word + i] = 1;
+            }
+        }
+        n += words;
+    }
+
+    if (run_dirty) s->misses += n;
+    else s->hits += n;
+
+    *dirty = run_dirty;
+    return n;
+}
+
+void pf_csr_write_regs_shadowed(volatile uint8_t *base, pixelforge_csr_shadow_t *s,
+                                uint32_t offset, const uint32_t *values, uint32_t count) {
+    __sync_synchronize();
+    while (count > 0) {
+        bool dirty;
+        uint32_t n = pf_csr_shadow_run(s, offset, values, count, &dirty);
+        if (dirty) pf_csr_store_regs(base, offset, values, n);
+
+        offset += n * 4;
+        values += n;
+        count -= n;
+    }
+    __sync_synchronize();
+}
 
 /* =============================
  * Index Generator
  * ============================= */
 void pf_csr_set_idx(volatile uint8_t *base, const pixelforge_idx_config_t *cfg) {
-    pf_csr_write32(base, PIXELFORGE_CSR_IDX_ADDRESS, cfg->address);
-    pf_csr_write32(base, PIXELFORGE_CSR_IDX_COUNT, cfg->count);
-    pf_csr_write32(base, PIXELFORGE_CSR_IDX_KIND, (uint32_t)cfg->kind);
+    uint32_t w[PF_IDX_WORDS];
+    pf_pack_idx(cfg, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_IDX_ADDRESS, w, PF_IDX_WORDS);
+    pf_csr_write32(base, PIXELFORGE_CSR_MULTI_DRAW_COUNT, cfg->draw_count);
 }
 
 void pf_csr_get_idx(volatile uint8_t *base, pixelforge_idx_config_t *cfg) {
     cfg->address = pf_csr_read32(base, PIXELFORGE_CSR_IDX_ADDRESS);
     cfg->count = pf_csr_read32(base, PIXELFORGE_CSR_IDX_COUNT);
     cfg->kind = (uint8_t)pf_csr_read32(base, PIXELFORGE_CSR_IDX_KIND);
+    cfg->draw_count = pf_csr_read32(base, PIXELFORGE_CSR_MULTI_DRAW_COUNT);
 }
 
 void pf_csr_start(volatile uint8_t *base) {
@@ -24,10 +319,9 @@ void pf_csr_start(volatile uint8_t *base) {
  * Topology
  * ============================= */
 void pf_csr_set_topology(volatile uint8_t *base, const pixelforge_topo_config_t *cfg) {
-    pf_csr_write32(base, PIXELFORGE_CSR_TOPO_INPUT_TOPOLOGY, (uint32_t)cfg->input_topology);
-    pf_csr_write32(base, PIXELFORGE_CSR_TOPO_PRIMITIVE_RESTART_ENABLE, (uint32_t)cfg->primitive_restart_enable);
-    pf_csr_write32(base, PIXELFORGE_CSR_TOPO_PRIMITIVE_RESTART_INDEX, cfg->primitive_restart_index);
-    pf_csr_write32(base, PIXELFORGE_CSR_TOPO_BASE_VERTEX, cfg->base_vertex);
+    uint32_t w[PF_TOPO_WORDS];
+    pf_pack_topology(cfg, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_TOPO_INPUT_TOPOLOGY, w, PF_TOPO_WORDS);
 }
 
 void pf_csr_get_topology(volatile uint8_t *base, pixelforge_topo_config_t *cfg) {
@@ -38,11 +332,11 @@ void pf_csr_get_topology(volatile uint8_t *base, pixelforge_topo_config_t *cfg)
 }
 
 /* Helpers for attribute unions */
-static inline void pf_write_attr_constant(volatile uint8_t *base, uint32_t base_off, const pixelforge_input_attr_t *attr) {
-    pf_csr_write32(base, base_off,     (uint32_t)attr->info.constant_value.value[0]);
-    pf_csr_write32(base, base_off+4,   (uint32_t)attr->info.constant_value.value[1]);
-    pf_csr_write32(base, base_off+8,   (uint32_t)attr->info.constant_value.value[2]);
-    pf_csr_write32(base, base_off+12,  (uint32_t)attr->info.constant_value.value[3]);
+static void pf_csr_set_attr(volatile uint8_t *base, uint32_t mode_off, uint32_t info_off, const pixelforge_input_attr_t *attr) {
+    uint32_t w[PF_ATTR_INFO_WORDS];
+    pf_pack_attr_info(attr, w);
+    pf_csr_write32(base, mode_off, (uint32_t)attr->mode);
+    pf_csr_write_regs(base, info_off, w, PF_ATTR_INFO_WORDS);
 }
 static inline void pf_read_attr_constant(volatile uint8_t *base, uint32_t base_off, pixelforge_input_attr_t *attr) {
     attr->info.constant_value.value[0] = (int32_t)pf_csr_read32(base, base_off);
@@ -50,27 +344,20 @@ static inline void pf_read_attr_constant(volatile uint8_t *base, uint32_t base_o
     attr->info.constant_value.value[2] = (int32_t)pf_csr_read32(base, base_off+8);
     attr->info.constant_value.value[3] = (int32_t)pf_csr_read32(base, base_off+12);
 }
-static inline void pf_write_attr_per_vertex(volatile uint8_t *base, uint32_t base_off, const pixelforge_input_attr_t *attr) {
-    pf_csr_write32(base, base_off,     attr->info.per_vertex.address);
-    pf_csr_write32(base, base_off+4,   (uint32_t)attr->info.per_vertex.stride);
-    pf_csr_write32(base, base_off+8,   0);
-    pf_csr_write32(base, base_off+12,   0);
-}
 static inline void pf_read_attr_per_vertex(volatile uint8_t *base, uint32_t base_off, pixelforge_input_attr_t *attr) {
     attr->info.per_vertex.address = pf_csr_read32(base, base_off);
-    attr->info.per_vertex.stride = (uint16_t)pf_csr_read32(base, base_off+4);
+    uint32_t w1 = pf_csr_read32(base, base_off+4);
+    attr->info.per_vertex.stride = (uint16_t)w1;
+    attr->info.per_vertex.format.type = (pixelforge_component_type_t)((w1 >> 16) & 0x7);
+    attr->info.per_vertex.format.normalized = (w1 >> 19) & 0x1;
+    attr->info.per_vertex.format.size = (uint8_t)((w1 >> 20) & 0x7);
 }
 
 /* =============================
  * Input Attributes
  * ============================= */
 void pf_csr_set_attr_position(volatile uint8_t *base, const pixelforge_input_attr_t *attr) {
-    pf_csr_write32(base, PIXELFORGE_CSR_IA_POS_MODE, (uint32_t)attr->mode);
-    if (attr->mode == PIXELFORGE_ATTR_CONSTANT) {
-        pf_write_attr_constant(base, PIXELFORGE_CSR_IA_POS_INFO, attr);
-    } else {
-        pf_write_attr_per_vertex(base, PIXELFORGE_CSR_IA_POS_INFO, attr);
-    }
+    pf_csr_set_attr(base, PIXELFORGE_CSR_IA_POS_MODE, PIXELFORGE_CSR_IA_POS_INFO, attr);
 }
 void pf_csr_get_attr_position(volatile uint8_t *base, pixelforge_input_attr_t *attr) {
     attr->mode = pf_csr_read32(base, PIXELFORGE_CSR_IA_POS_MODE);
@@ -82,12 +369,7 @@ void pf_csr_get_attr_position(volatile uint8_t *base, pixelforge_input_attr_t *a
 }
 
 void pf_csr_set_attr_normal(volatile uint8_t *base, const pixelforge_input_attr_t *attr) {
-    pf_csr_write32(base, PIXELFORGE_CSR_IA_NORM_MODE, (uint32_t)attr->mode);
-    if (attr->mode == PIXELFORGE_ATTR_CONSTANT) {
-        pf_write_attr_constant(base, PIXELFORGE_CSR_IA_NORM_INFO, attr);
-    } else {
-        pf_write_attr_per_vertex(base, PIXELFORGE_CSR_IA_NORM_INFO, attr);
-    }
+    pf_csr_set_attr(base, PIXELFORGE_CSR_IA_NORM_MODE, PIXELFORGE_CSR_IA_NORM_INFO, attr);
 }
 void pf_csr_get_attr_normal(volatile uint8_t *base, pixelforge_input_attr_t *attr) {
     attr->mode = pf_csr_read32(base, PIXELFORGE_CSR_IA_NORM_MODE);
@@ -99,12 +381,7 @@ void pf_csr_get_attr_normal(volatile uint8_t *base, pixelforge_input_attr_t *att
 }
 
 void pf_csr_set_attr_color(volatile uint8_t *base, const pixelforge_input_attr_t *attr) {
-    pf_csr_write32(base, PIXELFORGE_CSR_IA_COL_MODE, (uint32_t)attr->mode);
-    if (attr->mode == PIXELFORGE_ATTR_CONSTANT) {
-        pf_write_attr_constant(base, PIXELFORGE_CSR_IA_COL_INFO, attr);
-    } else {
-        pf_write_attr_per_vertex(base, PIXELFORGE_CSR_IA_COL_INFO, attr);
-    }
+    pf_csr_set_attr(base, PIXELFORGE_CSR_IA_COL_MODE, PIXELFORGE_CSR_IA_COL_INFO, attr);
 }
 void pf_csr_get_attr_color(volatile uint8_t *base, pixelforge_input_attr_t *attr) {
     attr->mode = pf_csr_read32(base, PIXELFORGE_CSR_IA_COL_MODE);
@@ -116,52 +393,71 @@ void pf_csr_get_attr_color(volatile uint8_t *base, pixelforge_input_attr_t *attr
 }
 
 void pf_csr_set_attr_texcoord(volatile uint8_t *base, uint32_t unit, const pixelforge_input_attr_t *attr) {
-    (void)base;
-    (void)unit;
-    (void)attr;
-
-    assert(false && "not implemented");
+    assert(unit < PIXELFORGE_NUM_TEXTURES);
+    pf_csr_set_attr(base, tex_attr_bases[unit][0], tex_attr_bases[unit][1], attr);
 }
 void pf_csr_get_attr_texcoord(volatile uint8_t *base, uint32_t unit, pixelforge_input_attr_t *attr) {
-    (void)base;
-    (void)unit;
-    (void)attr;
-
-    assert(false && "not implemented");
+    assert(unit < PIXELFORGE_NUM_TEXTURES);
+    attr->mode = pf_csr_read32(base, tex_attr_bases[unit][0]);
+    if (attr->mode == PIXELFORGE_ATTR_CONSTANT) {
+        pf_read_attr_constant(base, tex_attr_bases[unit][1], attr);
+    } else {
+        pf_read_attr_per_vertex(base, tex_attr_bases[unit][1], attr);
+    }
 }
 
 /* =============================
  * Vertex Transform
  * ============================= */
 void pf_csr_set_vtx_xf(volatile uint8_t *base, const pixelforge_vtx_xf_config_t *cfg) {
-    uint32_t enabled = 0;
-    enabled |= (uint32_t)cfg->enabled.normal_enable << 0;
-    pf_csr_write32(base, PIXELFORGE_CSR_VTX_XF_ENABLED, enabled);
-    for (int i = 0; i < 16; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_XF_POSITION_MV + i*4, (uint32_t)cfg->position_mv[i]);
-    for (int i = 0; i < 16; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_XF_POSITION_P  + i*4, (uint32_t)cfg->position_p[i]);
-    for (int i = 0; i < 9; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_XF_NORMAL_MV_INV_T + i*4, (uint32_t)cfg->normal_mv_inv_t[i]);
-    for (int i = 9; i < 16; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_XF_NORMAL_MV_INV_T + i*4, 0);
+    uint32_t w[PF_VTX_XF_WORDS];
+    pf_pack_vtx_xf_matrices(cfg, w);
+    pf_csr_write32(base, PIXELFORGE_CSR_VTX_XF_ENABLED, pf_pack_vtx_xf_enabled(cfg));
+    pf_csr_write_regs(base, PIXELFORGE_CSR_VTX_XF_POSITION_MV, w, PF_VTX_XF_WORDS);
+    for (int t = 0; t < PIXELFORGE_NUM_TEXTURES; ++t)
+        pf_csr_write_regs(base, tex_transform_bases[t], (const uint32_t *)cfg->texture_transform[t], 16);
 }
 
 void pf_csr_get_vtx_xf(volatile uint8_t *base, pixelforge_vtx_xf_config_t *cfg) {
     uint32_t enabled = pf_csr_read32(base, PIXELFORGE_CSR_VTX_XF_ENABLED);
     cfg->enabled.normal_enable = (uint8_t)((enabled >> 0) & 0x1);
+    for (int t = 0; t < PIXELFORGE_NUM_TEXTURES; ++t)
+        cfg->enabled.texture_enable[t] = (uint8_t)((enabled >> (1 + t)) & 0x1);
     for (int i = 0; i < 16; ++i) cfg->position_mv[i] = (int32_t)pf_csr_read32(base, PIXELFORGE_CSR_VTX_XF_POSITION_MV + i*4);
     for (int i = 0; i < 16; ++i) cfg->position_p[i]  = (int32_t)pf_csr_read32(base, PIXELFORGE_CSR_VTX_XF_POSITION_P  + i*4);
     for (int i = 0; i < 9; ++i) cfg->normal_mv_inv_t[i] = (int32_t)pf_csr_read32(base, PIXELFORGE_CSR_VTX_XF_NORMAL_MV_INV_T + i*4);
+    for (int t = 0; t < PIXELFORGE_NUM_TEXTURES; ++t)
+        for (int i = 0; i < 16; ++i) cfg->texture_transform[t][i] = (int32_t)pf_csr_read32(base, tex_transform_bases[t] + i*4);
+}
+
+/* =============================
+ * Texturing
+ * ============================= */
+void pf_csr_set_texture(volatile uint8_t *base, const pixelforge_texture_config_t *cfg) {
+    uint32_t w[PF_TEXTURE_WORDS];
+    pf_pack_texture(cfg, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_TEX_ADDRESS, w, PF_TEXTURE_WORDS);
+}
+
+void pf_csr_get_texture(volatile uint8_t *base, pixelforge_texture_config_t *cfg) {
+    uint32_t conf = pf_csr_read32(base, PIXELFORGE_CSR_TEX_CONFIG);
+    cfg->address = pf_csr_read32(base, PIXELFORGE_CSR_TEX_ADDRESS);
+    cfg->enabled = (conf >> 0) & 0x1;
+    cfg->filter = (pixelforge_texture_filter_t)((conf >> 1) & 0x1);
+    cfg->wrap_s = (pixelforge_texture_wrap_t)((conf >> 2) & 0x1);
+    cfg->wrap_t = (pixelforge_texture_wrap_t)((conf >> 3) & 0x1);
+    cfg->env_mode = (pixelforge_texture_env_mode_t)((conf >> 4) & 0x3);
+    cfg->width_log2 = (uint8_t)((conf >> 8) & 0xF);
+    cfg->height_log2 = (uint8_t)((conf >> 12) & 0xF);
 }
 
 /* =============================
  * Material & Light0
  * ============================= */
 void pf_csr_set_material(volatile uint8_t *base, const pixelforge_material_t *mat) {
-    for (int i = 0; i < 3; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_AMBIENT + i*4, (uint32_t)mat->ambient[i]);
-    for (int i = 3; i < 4; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_AMBIENT + i*4, 0);
-    for (int i = 0; i < 3; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_DIFFUSE + i*4, (uint32_t)mat->diffuse[i]);
-    for (int i = 3; i < 4; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_DIFFUSE + i*4, 0);
-    for (int i = 0; i < 3; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_SPECULAR + i*4, (uint32_t)mat->specular[i]);
-    for (int i = 3; i < 4; ++i) pf_csr_write32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_SPECULAR + i*4, 0);
-    pf_csr_write32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_SHININESS, (uint32_t)mat->shininess);
+    uint32_t w[PF_MATERIAL_WORDS];
+    pf_pack_material(mat, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_AMBIENT, w, PF_MATERIAL_WORDS);
 }
 void pf_csr_get_material(volatile uint8_t *base, pixelforge_material_t *mat) {
     for (int i = 0; i < 3; ++i) mat->ambient[i]  = (int32_t)pf_csr_read32(base, PIXELFORGE_CSR_VTX_SH_MATERIAL_AMBIENT + i*4);
@@ -171,18 +467,9 @@ void pf_csr_get_material(volatile uint8_t *base, pixelforge_material_t *mat) {
 }
 
 static void pf_csr_set_light_any(volatile uint8_t *base, uint32_t light_base, const pixelforge_light_t *lit) {
-    uint32_t pos_off = PIXELFORGE_CSR_VTX_SH_0_LIGHT_POSITION - PIXELFORGE_CSR_VTX_SH_0_LIGHT_POSITION;
-    uint32_t amb_off = PIXELFORGE_CSR_VTX_SH_0_LIGHT_AMBIENT - PIXELFORGE_CSR_VTX_SH_0_LIGHT_POSITION;
-    uint32_t dif_off = PIXELFORGE_CSR_VTX_SH_0_LIGHT_DIFFUSE - PIXELFORGE_CSR_VTX_SH_0_LIGHT_POSITION;
-    uint32_t spec_off = PIXELFORGE_CSR_VTX_SH_0_LIGHT_SPECULAR - PIXELFORGE_CSR_VTX_SH_0_LIGHT_POSITION;
-
-    for (int i = 0; i < 4; ++i) pf_csr_write32(base, light_base + pos_off + i*4, (uint32_t)lit->position[i]);
-    for (int i = 0; i < 3; ++i) pf_csr_write32(base, light_base + amb_off + i*4, (uint32_t)lit->ambient[i]);
-    for (int i = 3; i < 4; ++i) pf_csr_write32(base, light_base + amb_off + i*4, 0);
-    for (int i = 0; i < 3; ++i) pf_csr_write32(base, light_base + dif_off + i*4, (uint32_t)lit->diffuse[i]);
-    for (int i = 3; i < 4; ++i) pf_csr_write32(base, light_base + dif_off + i*4, 0);
-    for (int i = 0; i < 3; ++i) pf_csr_write32(base, light_base + spec_off + i*4, (uint32_t)lit->specular[i]);
-    for (int i = 3; i < 4; ++i) pf_csr_write32(base, light_base + spec_off + i*4, 0);
+    uint32_t w[PF_LIGHT_WORDS];
+    pf_pack_light(lit, w);
+    pf_csr_write_regs(base, light_base, w, PF_LIGHT_WORDS);
 }
 
 static void pf_csr_get_light_any(volatile uint8_t *base, uint32_t light_base, pixelforge_light_t *lit) {
@@ -197,8 +484,11 @@ static void pf_csr_get_light_any(volatile uint8_t *base, uint32_t light_base, pi
     for (int i = 0; i < 3; ++i) lit->specular[i] = (int32_t)pf_csr_read32(base, light_base + spec_off + i*4);
 }
 
-static const uint32_t light_bases[] = {
+static const uint32_t light_bases[PIXELFORGE_NUM_LIGHTS] = {
     PIXELFORGE_CSR_VTX_SH_0_LIGHT_POSITION,
+    PIXELFORGE_CSR_VTX_SH_1_LIGHT_POSITION,
+    PIXELFORGE_CSR_VTX_SH_2_LIGHT_POSITION,
+    PIXELFORGE_CSR_VTX_SH_3_LIGHT_POSITION,
 };
 
 void pf_csr_set_light(volatile uint8_t *base, uint32_t light_idx, const pixelforge_light_t *lit) {
@@ -211,14 +501,22 @@ void pf_csr_get_light(volatile uint8_t *base, uint32_t light_idx, pixelforge_lig
     pf_csr_get_light_any(base, light_bases[light_idx], lit);
 }
 
+void pf_csr_set_light_enable(volatile uint8_t *base, uint32_t mask) {
+    pf_csr_write32(base, PIXELFORGE_CSR_LIGHTING_ENABLE, mask & ((1u << PIXELFORGE_NUM_LIGHTS) - 1u));
+}
+
+uint32_t pf_csr_get_light_enable(volatile uint8_t *base) {
+    return pf_csr_read32(base, PIXELFORGE_CSR_LIGHTING_ENABLE);
+}
+
 
 /* =============================
  * Primitive Assembly
  * ============================= */
 void pf_csr_set_prim(volatile uint8_t *base, const pixelforge_prim_config_t *cfg) {
-    pf_csr_write32(base, PIXELFORGE_CSR_PRIM_TYPE, (uint32_t)cfg->type);
-    pf_csr_write32(base, PIXELFORGE_CSR_PRIM_CULL, (uint32_t)cfg->cull);
-    pf_csr_write32(base, PIXELFORGE_CSR_PRIM_WINDING, (uint32_t)cfg->winding);
+    uint32_t w[PF_PRIM_WORDS];
+    pf_pack_prim(cfg, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_PRIM_TYPE, w, PF_PRIM_WORDS);
 }
 void pf_csr_get_prim(volatile uint8_t *base, pixelforge_prim_config_t *cfg) {
     cfg->type = (uint8_t)pf_csr_read32(base, PIXELFORGE_CSR_PRIM_TYPE);
@@ -230,22 +528,11 @@ void pf_csr_get_prim(volatile uint8_t *base, pixelforge_prim_config_t *cfg) {
  * Framebuffer
  * ============================= */
 void pf_csr_set_fb(volatile uint8_t *base, const pixelforge_framebuffer_config_t *cfg) {
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_WIDTH,  (uint32_t)cfg->width);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_HEIGHT, (uint32_t)cfg->height);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_VIEWPORT_X,        (uint32_t)cfg->viewport_x);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_VIEWPORT_Y,        (uint32_t)cfg->viewport_y);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_VIEWPORT_WIDTH,    (uint32_t)cfg->viewport_width);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_VIEWPORT_HEIGHT,   (uint32_t)cfg->viewport_height);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_VIEWPORT_MIN_DEPTH,(uint32_t)cfg->viewport_min_depth);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_VIEWPORT_MAX_DEPTH,(uint32_t)cfg->viewport_max_depth);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_SCISSOR_OFFSET_X,  (uint32_t)cfg->scissor_offset_x);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_SCISSOR_OFFSET_Y,  (uint32_t)cfg->scissor_offset_y);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_SCISSOR_WIDTH,     (uint32_t)cfg->scissor_width);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_SCISSOR_HEIGHT,    (uint32_t)cfg->scissor_height);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_COLOR_ADDRESS, cfg->color_address);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_COLOR_PITCH,   (uint32_t)cfg->color_pitch);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_DEPTHSTENCIL_ADDRESS, cfg->depthstencil_address);
-    pf_csr_write32(base, PIXELFORGE_CSR_FB_DEPTHSTENCIL_PITCH,   (uint32_t)cfg->depthstencil_pitch);
+    uint32_t w[PF_FB_WORDS];
+    pf_pack_fb(cfg, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_FB_WIDTH, w, PF_FB_WORDS);
+    pf_pack_fb_format(cfg, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_FB_FORMAT_COLOR, w, PF_FB_FORMAT_WORDS);
 }
 void pf_csr_get_fb(volatile uint8_t *base, pixelforge_framebuffer_config_t *cfg) {
     cfg->width  = (uint16_t)pf_csr_read32(base, PIXELFORGE_CSR_FB_WIDTH);
@@ -264,22 +551,17 @@ void pf_csr_get_fb(volatile uint8_t *base, pixelforge_framebuffer_config_t *cfg)
     cfg->color_pitch       = (uint16_t)pf_csr_read32(base, PIXELFORGE_CSR_FB_COLOR_PITCH);
     cfg->depthstencil_address = pf_csr_read32(base, PIXELFORGE_CSR_FB_DEPTHSTENCIL_ADDRESS);
     cfg->depthstencil_pitch   = (uint16_t)pf_csr_read32(base, PIXELFORGE_CSR_FB_DEPTHSTENCIL_PITCH);
+    cfg->color_format         = (uint8_t)pf_csr_read32(base, PIXELFORGE_CSR_FB_FORMAT_COLOR);
+    cfg->depthstencil_format  = (uint8_t)pf_csr_read32(base, PIXELFORGE_CSR_FB_FORMAT_DEPTHSTENCIL);
 }
 
 /* =============================
  * Depth/Stencil & Blend helpers
  * ============================= */
 static void pf_csr_set_stencil_conf(volatile uint8_t *base, uint32_t off, const pixelforge_stencil_op_config_t *c) {
-    uint32_t w = 0;
-    w |= ((uint32_t)c->compare_op & 0x7) << 0;
-    w |= ((uint32_t)c->pass_op    & 0x7) << 3;
-    w |= ((uint32_t)c->fail_op    & 0x7) << 6;
-    w |= ((uint32_t)c->depth_fail_op & 0x7) << 9;
-    w |= ((uint32_t)c->reference  & 0xFF) << 16;
-    w |= ((uint32_t)c->mask       & 0xFF) << 24;
-
-    pf_csr_write32(base, off, w);
-    pf_csr_write32(base, off + 4, ((uint32_t)c->write_mask & 0xFF));
+    uint32_t w[PF_STENCIL_WORDS];
+    pf_pack_stencil_conf(c, w);
+    pf_csr_write_regs(base, off, w, PF_STENCIL_WORDS);
 }
 static void pf_csr_get_stencil_conf(volatile uint8_t *base, uint32_t off, pixelforge_stencil_op_config_t *c) {
     uint32_t w = pf_csr_read32(base, off);
@@ -292,31 +574,12 @@ static void pf_csr_get_stencil_conf(volatile uint8_t *base, uint32_t off, pixelf
     c->write_mask = (uint8_t)(pf_csr_read32(base, off + 4) & 0xFF);
 }
 
-static uint32_t pf_pack_depth_test(const pixelforge_depth_test_config_t *c) {
-    uint32_t w = 0;
-    w |= ((uint32_t)c->test_enabled  & 0x1) << 0;
-    w |= ((uint32_t)c->write_enabled & 0x1) << 1;
-    w |= ((uint32_t)c->compare_op    & 0x7) << 2;
-    return w;
-}
 static void pf_unpack_depth_test(uint32_t w, pixelforge_depth_test_config_t *c) {
     c->test_enabled  = (uint8_t)((w >> 0) & 0x1);
     c->write_enabled = (uint8_t)((w >> 1) & 0x1);
     c->compare_op    = (uint8_t)((w >> 2) & 0x7);
 }
 
-static uint32_t pf_pack_blend_config(const pixelforge_blend_config_t *c) {
-    uint32_t w = 0;
-    w |= ((uint32_t)c->src_factor   & 0xF) << 0;
-    w |= ((uint32_t)c->dst_factor   & 0xF) << 4;
-    w |= ((uint32_t)c->src_a_factor & 0xF) << 8;
-    w |= ((uint32_t)c->dst_a_factor & 0xF) << 12;
-    w |= ((uint32_t)c->enabled      & 0x1) << 16;
-    w |= ((uint32_t)c->blend_op     & 0x7) << 17;
-    w |= ((uint32_t)c->blend_a_op   & 0x7) << 20;
-    w |= ((uint32_t)c->color_write_mask & 0xF) << 24;
-    return w;
-}
 static void pf_unpack_blend_config(uint32_t w, pixelforge_blend_config_t *c) {
     c->src_factor   = (uint32_t)((w >> 0) & 0xF);
     c->dst_factor   = (uint32_t)((w >> 4) & 0xF);
@@ -360,6 +623,16 @@ void pf_csr_get_blend(volatile uint8_t *base, pixelforge_blend_config_t *c) {
     pf_unpack_blend_config(w, c);
 }
 
+void pf_csr_set_clear(volatile uint8_t *base, const pixelforge_clear_config_t *c) {
+    uint32_t w[PF_CLEAR_WORDS];
+    pf_pack_clear(c, w);
+    pf_csr_write_regs(base, PIXELFORGE_CSR_CLEAR_FLAGS, w, PF_CLEAR_WORDS);
+}
+
+void pf_csr_clear_start(volatile uint8_t *base) {
+    pf_csr_write32(base, PIXELFORGE_CSR_CLEAR_START, 1u);
+}
+
 uint32_t pf_csr_get_ready(volatile uint8_t *base) {
     return pf_csr_read32(base, PIXELFORGE_CSR_READY);
 }
@@ -371,3 +644,465 @@ uint32_t pf_csr_get_ready_components(volatile uint8_t *base) {
 uint32_t pf_csr_get_ready_vec(volatile uint8_t *base) {
     return pf_csr_read32(base, PIXELFORGE_CSR_READY_VEC);
 }
+
+uint32_t pf_csr_get_fence_issued(volatile uint8_t *base) {
+    return pf_csr_read32(base, PIXELFORGE_CSR_FENCE_ISSUED);
+}
+
+uint32_t pf_csr_get_fence_retired(volatile uint8_t *base) {
+    return pf_csr_read32(base, PIXELFORGE_CSR_FENCE_RETIRED);
+}
+
+void pf_csr_set_vtx_cache_enable(volatile uint8_t *base, bool enable) {
+    pf_csr_write32(base, PIXELFORGE_CSR_VTX_CACHE_ENABLE, enable ? 1u : 0u);
+}
+
+void pf_csr_get_vtx_cache_stats(volatile uint8_t *base, pixelforge_vtx_cache_stats_t *stats) {
+    stats->lookups = pf_csr_read32(base, PIXELFORGE_CSR_VTX_CACHE_LOOKUPS);
+    stats->hits = pf_csr_read32(base, PIXELFORGE_CSR_VTX_CACHE_HITS);
+}
+
+void pf_csr_set_early_cull_enable(volatile uint8_t *base, bool enable) {
+    pf_csr_write32(base, PIXELFORGE_CSR_EARLY_CULL_ENABLE, enable ? 1u : 0u);
+}
+
+uint32_t pf_csr_get_early_culled(volatile uint8_t *base) {
+    return pf_csr_read32(base, PIXELFORGE_CSR_EARLY_CULL_CULLED);
+}
+
+void pf_csr_set_guard_band(volatile uint8_t *base, pixelforge_guard_band_t guard_band) {
+    pf_csr_write32(base, PIXELFORGE_CSR_CLIP_GUARD_BAND, (uint32_t)guard_band & 0x3u);
+}
+
+pixelforge_guard_band_t pf_csr_get_guard_band(volatile uint8_t *base) {
+    uint32_t guard_band = pf_csr_read32(base, PIXELFORGE_CSR_CLIP_GUARD_BAND) & 0x3u;
+    /* the clipper treats 3 as 4X */
+    return guard_band > PIXELFORGE_GUARD_BAND_4X ? PIXELFORGE_GUARD_BAND_4X : (pixelforge_guard_band_t)guard_band;
+}
+
+void pf_csr_get_clip_stats(volatile uint8_t *base, pixelforge_clip_stats_t *stats) {
+    stats->trivial_accepts = pf_csr_read32(base, PIXELFORGE_CSR_CLIP_TRIVIAL_ACCEPTS);
+    stats->guard_band_accepts = pf_csr_read32(base, PIXELFORGE_CSR_CLIP_GUARD_BAND_ACCEPTS);
+    stats->clipped = pf_csr_read32(base, PIXELFORGE_CSR_CLIP_CLIPPED);
+}
+
+const char *const pf_perf_fifo_names[PIXELFORGE_PERF_NUM_FIFOS] = {
+    "idx_to_topo", "idx_to_topo_draws", "topo_to_ia", "vc_to_ia", "vc_tickets",
+    "ia_to_vtx_xf", "vtx_xf_to_cull", "cull_to_vtx_sh", "cull_tickets", "vtx_sh_to_clip",
+    "vc_to_clip", "clip_to_div", "div_to_tri_prep", "tri_prep_to_rast", "rast_to_tex",
+    "tex_to_ds", "ds_to_sc",
+};
+
+const char *const pf_perf_bus_names[PIXELFORGE_PERF_NUM_BUSES] = {
+    "index", "vertex", "depthstencil", "color",
+};
+
+static void pf_perf_wait(volatile uint8_t *base) {
+    while (pf_csr_read32(base, PIXELFORGE_CSR_PERF_PENDING) & 1u) {
+    }
+}
+
+void pf_perf_reset(volatile uint8_t *base) {
+    pf_csr_write32(base, PIXELFORGE_CSR_PERF_RESET, 1u);
+    pf_perf_wait(base);
+}
+
+static void pf_perf_read_cache(volatile uint8_t *base, uint32_t addr, pixelforge_perf_cache_t *c) {
+    c->lookups = pf_csr_read32(base, addr);
+    c->misses = pf_csr_read32(base, addr + 4u);
+}
+
+void pf_perf_read(volatile uint8_t *base, pixelforge_perf_counters_t *perf) {
+    pf_csr_write32(base, PIXELFORGE_CSR_PERF_SNAPSHOT, 1u);
+    pf_perf_wait(base);
+
+    perf->triangles_in = pf_csr_read32(base, PIXELFORGE_CSR_PERF_TRIANGLES_IN);
+    perf->triangles_clipped = pf_csr_read32(base, PIXELFORGE_CSR_PERF_TRIANGLES_CLIPPED);
+    perf->triangles_culled = pf_csr_read32(base, PIXELFORGE_CSR_PERF_TRIANGLES_CULLED);
+    perf->triangles_rasterized = pf_csr_read32(base, PIXELFORGE_CSR_PERF_TRIANGLES_RASTERIZED);
+    perf->hiz_tile_rejects = pf_csr_read32(base, PIXELFORGE_CSR_PERF_HIZ_TILE_REJECTS);
+    perf->coarse_block_rejects = pf_csr_read32(base, PIXELFORGE_CSR_PERF_COARSE_BLOCK_REJECTS);
+    perf->fragments_generated = pf_csr_read32(base, PIXELFORGE_CSR_PERF_FRAGMENTS_GENERATED);
+    perf->fragments_early_z_rejected = pf_csr_read32(base, PIXELFORGE_CSR_PERF_FRAGMENTS_EARLY_Z_REJECTED);
+    perf->fragments_stencil_failed = pf_csr_read32(base, PIXELFORGE_CSR_PERF_FRAGMENTS_STENCIL_FAILED);
+    perf->fragments_depth_failed = pf_csr_read32(base, PIXELFORGE_CSR_PERF_FRAGMENTS_DEPTH_FAILED);
+    perf->fragments_written = pf_csr_read32(base, PIXELFORGE_CSR_PERF_FRAGMENTS_WRITTEN);
+
+    /* the FIFO and bus registers are laid out consecutively, in table order */
+    for (uint32_t i = 0; i < PIXELFORGE_PERF_NUM_FIFOS; i++) {
+        uint32_t addr = PIXELFORGE_CSR_PERF_FIFO_IDX_TO_TOPO_STALL + 8u * i;
+        perf->fifo[i].stall = pf_csr_read32(base, addr);
+        perf->fifo[i].starve = pf_csr_read32(base, addr + 4u);
+    }
+    for (uint32_t i = 0; i < PIXELFORGE_PERF_NUM_BUSES; i++) {
+        uint32_t addr = PIXELFORGE_CSR_PERF_BUS_INDEX_READ_BEATS + 12u * i;
+        perf->bus[i].read_beats = pf_csr_read32(base, addr);
+        perf->bus[i].write_beats = pf_csr_read32(base, addr + 4u);
+        perf->bus[i].wait_cycles = pf_csr_read32(base, addr + 8u);
+    }
+    pf_perf_read_cache(base, PIXELFORGE_CSR_PERF_CACHE_DEPTHSTENCIL_LOOKUPS, &perf->depthstencil_cache);
+    pf_perf_read_cache(base, PIXELFORGE_CSR_PERF_CACHE_COLOR_LOOKUPS, &perf->color_cache);
+    pf_perf_read_cache(base, PIXELFORGE_CSR_PERF_CACHE_TEXTURE_LOOKUPS, &perf->texture_cache);
+}
+
+void pf_csr_set_hiz_enable(volatile uint8_t *base, bool enable) {
+    pf_csr_write32(base, PIXELFORGE_CSR_HIZ_ENABLE, enable ? 1u : 0u);
+}
+
+void pf_csr_set_irq_enable(volatile uint8_t *base, uint32_t mask) {
+    pf_csr_write32(base, PIXELFORGE_CSR_IRQ_ENABLE, mask);
+}
+
+uint32_t pf_csr_get_irq_status(volatile uint8_t *base) {
+    return pf_csr_read32(base, PIXELFORGE_CSR_IRQ_STATUS);
+}
+
+void pf_csr_clear_irq_status(volatile uint8_t *base, uint32_t mask) {
+    pf_csr_write32(base, PIXELFORGE_CSR_IRQ_STATUS, mask);
+}
+
+/* =============================
+ * Command Ring
+ * ============================= */
+static uint32_t pf_cmdbuf_free_bytes(const pixelforge_cmdbuf_t *cb) {
+    /* one word is kept unused so that a full ring differs from an empty one */
+    return (cb->tail + cb->size - cb->head - 4) % cb->size;
+}
+
+/* Returns false if a recorded list has no room left, the packet is dropped then */
+static bool pf_cmdbuf_reserve(pixelforge_cmdbuf_t *cb, uint32_t words) {
+    pixelforge_cmdlist_t *list = cb->list;
+    if (list) {
+        if (list->overflow || list->capacity - list->size < words * 4) {
+            list->overflow = true;
+            return false;
+        }
+        return true;
+    }
+
+    assert(words * 4 < cb->size && "packet does not fit into the command ring");
+    while (pf_cmdbuf_free_bytes(cb) < words * 4) {
+        /* the GPU can only drain what has already been published */
+        pf_cmdbuf_kick(cb);
+        cb->tail = pf_csr_read32(cb->csr_base, PIXELFORGE_CSR_CMD_RPTR);
+    }
+    return true;
+}
+
+static void pf_cmdbuf_emit(pixelforge_cmdbuf_t *cb, uint32_t word) {
+    if (cb->list) {
+        cb->list->words[cb->list->size / 4] = word;
+        cb->list->size += 4;
+        return;
+    }
+
+    cb->ring[cb->head / 4] = word;
+    cb->head += 4;
+    if (cb->head >= cb->size) cb->head = 0;
+}
+
+void pf_cmdbuf_init(pixelforge_cmdbuf_t *cb, volatile uint8_t *csr_base, void *ring_virt, uint32_t ring_phys, uint32_t size) {
+    assert(size >= 64 && (size % 4) == 0);
+
+    cb->csr_base = csr_base;
+    cb->ring = (volatile uint32_t *)ring_virt;
+    cb->ring_phys = ring_phys;
+    cb->size = size;
+    cb->head = 0;
+    cb->wptr = 0;
+    cb->tail = 0;
+    cb->draws = pf_csr_get_fence_issued(csr_base);
+    cb->state_wait = 0;
+    cb->list = NULL;
+    pf_csr_shadow_invalidate(&cb->shadow);
+    pf_csr_shadow_reset_stats(&cb->shadow);
+
+    /* read pointer is held at zero while the ring is disabled */
+    pf_csr_write32(csr_base, PIXELFORGE_CSR_CMD_ENABLE, 0);
+    pf_csr_write32(csr_base, PIXELFORGE_CSR_CMD_BASE, ring_phys);
+    pf_csr_write32(csr_base, PIXELFORGE_CSR_CMD_SIZE, size);
+    pf_csr_write32(csr_base, PIXELFORGE_CSR_CMD_WPTR, 0);
+    pf_csr_write32(csr_base, PIXELFORGE_CSR_CMD_ENABLE, 1);
+}
+
+void pf_cmdbuf_fini(pixelforge_cmdbuf_t *cb) {
+    assert(!cb->list && "pf_cmdbuf_end_list() missing");
+    pf_cmdbuf_kick(cb);
+    while (pf_csr_read32(cb->csr_base, PIXELFORGE_CSR_CMD_RPTR) != cb->wptr) {
+    }
+    pf_csr_write32(cb->csr_base, PIXELFORGE_CSR_CMD_ENABLE, 0);
+}
+
+void pf_cmdbuf_kick(pixelforge_cmdbuf_t *cb) {
+    if (cb->head == cb->wptr) return;
+
+    /* packets must be in memory before the GPU is allowed to fetch them;
+     * pf_csr_write32 issues the barrier */
+    pf_csr_write32(cb->csr_base, PIXELFORGE_CSR_CMD_WPTR, cb->head);
+    cb->wptr = cb->head;
+}
+
+uint32_t pf_cmdbuf_get_rptr(const pixelforge_cmdbuf_t *cb) {
+    return pf_csr_read32(cb->csr_base, PIXELFORGE_CSR_CMD_RPTR);
+}
+
+bool pf_cmdbuf_idle(const pixelforge_cmdbuf_t *cb) {
+    return cb->head == cb->wptr && pf_cmdbuf_get_rptr(cb) == cb->wptr;
+}
+
+static void pf_cmdbuf_emit_regs(pixelforge_cmdbuf_t *cb, uint32_t offset, const uint32_t *values, uint32_t count) {
+    uint32_t max_chunk = cb->size / 4 - 3;
+    if (max_chunk > PIXELFORGE_CMD_MAX_ARG) max_chunk = PIXELFORGE_CMD_MAX_ARG;
+
+    while (count > 0) {
+        uint32_t n = count < max_chunk ? count : max_chunk;
+
+        if (!pf_cmdbuf_reserve(cb, n + 2)) return;
+        pf_cmdbuf_emit(cb, PIXELFORGE_CMD_HEADER(PIXELFORGE_CMD_WRITE_REGS, n));
+        pf_cmdbuf_emit(cb, offset);
+        for (uint32_t i = 0; i < n; ++i) pf_cmdbuf_emit(cb, values[i]);
+
+        if (cb->list) {
+            for (uint32_t i = 0; i < n && offset / 4 + i < PF_CSR_SHADOW_WORDS; ++i) {
+                cb->list->written[offset / 4 + i] = 1;
+            }
+        }
+
+        offset += n * 4;
+        values += n;
+        count -= n;
+    }
+}
+
+void pf_cmdbuf_write_regs(pixelforge_cmdbuf_t *cb, uint32_t offset, const uint32_t *values, uint32_t count) {
+    while (count > 0) {
+        bool dirty;
+        uint32_t n = pf_csr_shadow_run(cb->list ? &cb->list->shadow : &cb->shadow,
+                                       offset, values, count, &dirty);
+
+        if (dirty) {
+            if (cb->state_wait) {
+                pf_cmdbuf_wait_ready(cb, cb->state_wait);
+                cb->state_wait = 0;
+            }
+            pf_cmdbuf_emit_regs(cb, offset, values, n);
+        }
+
+        offset += n * 4;
+        values += n;
+        count -= n;
+    }
+}
+
+void pf_cmdbuf_write32(pixelforge_cmdbuf_t *cb, uint32_t offset, uint32_t value) {
+    pf_cmdbuf_write_regs(cb, offset, &value, 1);
+}
+
+void pf_cmdbuf_wait_ready(pixelforge_cmdbuf_t *cb, uint32_t stage_mask) {
+    if (!pf_cmdbuf_reserve(cb, 1)) return;
+    pf_cmdbuf_emit(cb, PIXELFORGE_CMD_HEADER(PIXELFORGE_CMD_WAIT_READY, stage_mask));
+}
+
+void pf_cmdbuf_begin_state(pixelforge_cmdbuf_t *cb, uint32_t stage_mask) {
+    cb->state_wait = stage_mask;
+}
+
+void pf_cmdbuf_end_state(pixelforge_cmdbuf_t *cb) {
+    cb->state_wait = 0;
+}
+
+void pf_cmdbuf_start(pixelforge_cmdbuf_t *cb) {
+    pf_cmdbuf_write32(cb, PIXELFORGE_CSR_IDX_START, 1u);
+    if (cb->list) cb->list->draws++;
+    else cb->draws++;
+}
+
+/* =============================
+ * Command Lists
+ * ============================= */
+void pf_cmdlist_init(pixelforge_cmdlist_t *list, void *virt, uint32_t phys, uint32_t capacity) {
+    assert((phys % 4) == 0 && (capacity % 4) == 0);
+
+    list->words = (volatile uint32_t *)virt;
+    list->phys = phys;
+    list->capacity = capacity;
+    list->size = 0;
+    list->draws = 0;
+    list->overflow = false;
+    pf_csr_shadow_invalidate(&list->shadow);
+    pf_csr_shadow_reset_stats(&list->shadow);
+    memset(list->written, 0, sizeof(list->written));
+}
+
+void pf_cmdlist_move(pixelforge_cmdlist_t *list, void *virt, uint32_t phys) {
+    assert((phys % 4) == 0);
+
+    volatile uint32_t *words = (volatile uint32_t *)virt;
+    for (uint32_t i = 0; i < list->size / 4; ++i) words[i] = list->words[i];
+
+    list->words = words;
+    list->phys = phys;
+    list->capacity = list->size;
+}
+
+void pf_cmdbuf_begin_list(pixelforge_cmdbuf_t *cb, pixelforge_cmdlist_t *list, const pixelforge_cmdlist_t *after) {
+    assert(!cb->list && "command lists cannot be nested");
+
+    list->size = 0;
+    list->draws = 0;
+    list->overflow = false;
+    if (after) {
+        memcpy(list->shadow.value, after->shadow.value, sizeof(list->shadow.value));
+        memcpy(list->shadow.valid, after->shadow.valid, sizeof(list->shadow.valid));
+        memcpy(list->written, after->written, sizeof(list->written));
+    } else {
+        pf_csr_shadow_invalidate(&list->shadow);
+        memset(list->written, 0, sizeof(list->written));
+    }
+    pf_csr_shadow_reset_stats(&list->shadow);
+
+    cb->list = list;
+    cb->state_wait = 0;
+}
+
+bool pf_cmdbuf_end_list(pixelforge_cmdbuf_t *cb) {
+    assert(cb->list && "pf_cmdbuf_begin_list() missing");
+
+    bool ok = !cb->list->overflow;
+    cb->list = NULL;
+    cb->state_wait = 0;
+    return ok;
+}
+
+void pf_cmdbuf_call_list(pixelforge_cmdbuf_t *cb, const pixelforge_cmdlist_t *list) {
+    assert(!cb->list && "command lists cannot be nested");
+    assert(!list->overflow);
+
+    if (list->size > 0) {
+        pf_cmdbuf_reserve(cb, 3);
+        pf_cmdbuf_emit(cb, PIXELFORGE_CMD_HEADER(PIXELFORGE_CMD_CALL, 2));
+        pf_cmdbuf_emit(cb, list->phys);
+        pf_cmdbuf_emit(cb, list->size);
+    }
+    cb->draws += list->draws;
+
+    /* the ring continues in the state the list leaves behind */
+    for (uint32_t i = 0; i < PF_CSR_SHADOW_WORDS; ++i) {
+        if (!list->written[i]) continue;
+        cb->shadow.value[i] = list->shadow.value[i];
+        cb->shadow.valid[i] = list->shadow.valid[i];
+    }
+}
+
+void pf_cmdbuf_set_idx(pixelforge_cmdbuf_t *cb, const pixelforge_idx_config_t *cfg) {
+    uint32_t w[PF_IDX_WORDS];
+    pf_pack_idx(cfg, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_IDX_ADDRESS, w, PF_IDX_WORDS);
+    pf_cmdbuf_write32(cb, PIXELFORGE_CSR_MULTI_DRAW_COUNT, cfg->draw_count);
+}
+
+void pf_cmdbuf_set_topology(pixelforge_cmdbuf_t *cb, const pixelforge_topo_config_t *cfg) {
+    uint32_t w[PF_TOPO_WORDS];
+    pf_pack_topology(cfg, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_TOPO_INPUT_TOPOLOGY, w, PF_TOPO_WORDS);
+}
+
+static void pf_cmdbuf_set_attr(pixelforge_cmdbuf_t *cb, uint32_t mode_off, uint32_t info_off, const pixelforge_input_attr_t *attr) {
+    uint32_t w[PF_ATTR_INFO_WORDS];
+    pf_pack_attr_info(attr, w);
+    pf_cmdbuf_write32(cb, mode_off, (uint32_t)attr->mode);
+    pf_cmdbuf_write_regs(cb, info_off, w, PF_ATTR_INFO_WORDS);
+}
+
+void pf_cmdbuf_set_attr_position(pixelforge_cmdbuf_t *cb, const pixelforge_input_attr_t *attr) {
+    pf_cmdbuf_set_attr(cb, PIXELFORGE_CSR_IA_POS_MODE, PIXELFORGE_CSR_IA_POS_INFO, attr);
+}
+
+void pf_cmdbuf_set_attr_normal(pixelforge_cmdbuf_t *cb, const pixelforge_input_attr_t *attr) {
+    pf_cmdbuf_set_attr(cb, PIXELFORGE_CSR_IA_NORM_MODE, PIXELFORGE_CSR_IA_NORM_INFO, attr);
+}
+
+void pf_cmdbuf_set_attr_color(pixelforge_cmdbuf_t *cb, const pixelforge_input_attr_t *attr) {
+    pf_cmdbuf_set_attr(cb, PIXELFORGE_CSR_IA_COL_MODE, PIXELFORGE_CSR_IA_COL_INFO, attr);
+}
+
+void pf_cmdbuf_set_attr_texcoord(pixelforge_cmdbuf_t *cb, uint32_t unit, const pixelforge_input_attr_t *attr) {
+    assert(unit < PIXELFORGE_NUM_TEXTURES);
+    pf_cmdbuf_set_attr(cb, tex_attr_bases[unit][0], tex_attr_bases[unit][1], attr);
+}
+void pf_cmdbuf_set_vtx_xf(pixelforge_cmdbuf_t *cb, const pixelforge_vtx_xf_config_t *cfg) {
+    uint32_t w[PF_VTX_XF_WORDS];
+    pf_pack_vtx_xf_matrices(cfg, w);
+    pf_cmdbuf_write32(cb, PIXELFORGE_CSR_VTX_XF_ENABLED, pf_pack_vtx_xf_enabled(cfg));
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_VTX_XF_POSITION_MV, w, PF_VTX_XF_WORDS);
+    for (int t = 0; t < PIXELFORGE_NUM_TEXTURES; ++t)
+        pf_cmdbuf_write_regs(cb, tex_transform_bases[t], (const uint32_t *)cfg->texture_transform[t], 16);
+}
+void pf_cmdbuf_set_texture(pixelforge_cmdbuf_t *cb, const pixelforge_texture_config_t *cfg) {
+    uint32_t w[PF_TEXTURE_WORDS];
+    pf_pack_texture(cfg, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_TEX_ADDRESS, w, PF_TEXTURE_WORDS);
+}
+
+void pf_cmdbuf_set_material(pixelforge_cmdbuf_t *cb, const pixelforge_material_t *mat) {
+    uint32_t w[PF_MATERIAL_WORDS];
+    pf_pack_material(mat, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_VTX_SH_MATERIAL_AMBIENT, w, PF_MATERIAL_WORDS);
+}
+
+void pf_cmdbuf_set_light(pixelforge_cmdbuf_t *cb, uint32_t light_idx, const pixelforge_light_t *lit) {
+    assert(light_idx < sizeof(light_bases)/sizeof(light_bases[0]));
+    uint32_t w[PF_LIGHT_WORDS];
+    pf_pack_light(lit, w);
+    pf_cmdbuf_write_regs(cb, light_bases[light_idx], w, PF_LIGHT_WORDS);
+}
+
+void pf_cmdbuf_set_light_enable(pixelforge_cmdbuf_t *cb, uint32_t mask) {
+    pf_cmdbuf_write32(cb, PIXELFORGE_CSR_LIGHTING_ENABLE, mask & ((1u << PIXELFORGE_NUM_LIGHTS) - 1u));
+}
+
+void pf_cmdbuf_set_prim(pixelforge_cmdbuf_t *cb, const pixelforge_prim_config_t *cfg) {
+    uint32_t w[PF_PRIM_WORDS];
+    pf_pack_prim(cfg, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_PRIM_TYPE, w, PF_PRIM_WORDS);
+}
+
+void pf_cmdbuf_set_fb(pixelforge_cmdbuf_t *cb, const pixelforge_framebuffer_config_t *cfg) {
+    uint32_t w[PF_FB_WORDS];
+    pf_pack_fb(cfg, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_FB_WIDTH, w, PF_FB_WORDS);
+    pf_pack_fb_format(cfg, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_FB_FORMAT_COLOR, w, PF_FB_FORMAT_WORDS);
+}
+
+void pf_cmdbuf_set_stencil_front(pixelforge_cmdbuf_t *cb, const pixelforge_stencil_op_config_t *c) {
+    uint32_t w[PF_STENCIL_WORDS];
+    pf_pack_stencil_conf(c, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_DS_STENCIL_FRONT, w, PF_STENCIL_WORDS);
+}
+
+void pf_cmdbuf_set_stencil_back(pixelforge_cmdbuf_t *cb, const pixelforge_stencil_op_config_t *c) {
+    uint32_t w[PF_STENCIL_WORDS];
+    pf_pack_stencil_conf(c, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_DS_STENCIL_BACK, w, PF_STENCIL_WORDS);
+}
+
+void pf_cmdbuf_set_depth(pixelforge_cmdbuf_t *cb, const pixelforge_depth_test_config_t *c) {
+    pf_cmdbuf_write32(cb, PIXELFORGE_CSR_DS_DEPTH, pf_pack_depth_test(c));
+}
+
+void pf_cmdbuf_set_blend(pixelforge_cmdbuf_t *cb, const pixelforge_blend_config_t *c) {
+    pf_cmdbuf_write32(cb, PIXELFORGE_CSR_BLEND_CONFIG, pf_pack_blend_config(c));
+}
+
+void pf_cmdbuf_set_clear(pixelforge_cmdbuf_t *cb, const pixelforge_clear_config_t *c) {
+    uint32_t w[PF_CLEAR_WORDS];
+    pf_pack_clear(c, w);
+    pf_cmdbuf_write_regs(cb, PIXELFORGE_CSR_CLEAR_FLAGS, w, PF_CLEAR_WORDS);
+}
+
+void pf_cmdbuf_clear(pixelforge_cmdbuf_t *cb) {
+    pf_cmdbuf_write32(cb, PIXELFORGE_CSR_CLEAR_START, 1u);
+    /* clears take a fence sequence number just like draws */
+    cb->draws++;
+}
@@ -0,0 +1,170 @@
+/*
+ * obj2pfm: convert a Wavefront OBJ model to a PixelForge mesh (.pfm)
+ *
+ * The OBJ is parsed, indexed and ordered for the vertex cache once, offline, and the
+ * vertex stream is stored in the formats input assembly reads:
+ * - default:   position SQ(16,16) xyzw, normal SQ(16,16) xyz         (28 bytes per vertex)
+ * - --compact: position S16 normalized xyz, normal S8 normalized xyz  (12 bytes per vertex)
+ *
+ * Compact positions are quantized over the bounding box, the header's position_scale and
+ * position_bias map them back to object space (apply them with the model matrix).
+ * Texture coordinates, if the model has any, are stored as SQ(16,16) uv.
+ */
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "graphics_pipeline_formats.h"
+#include "obj_loader.h"
+#include "pfm_loader.h"
+
+static int32_t fp16_16(float v) {
+    return (int32_t)lrintf(v * 65536.0f);
+}
+
+static int32_t quantize(float v, int32_t max) {
+    long q = lrintf(v * (float)max);
+    if (q > max) q = max;
+    if (q < -max) q = -max;
+    return (int32_t)q;
+}
+
+static void put_u32(uint8_t *dst, int32_t v) {
+    memcpy(dst, &v, sizeof(v));
+}
+
+static void put_s16(uint8_t *dst, int32_t v) {
+    int16_t s = (int16_t)v;
+    memcpy(dst, &s, sizeof(s));
+}
+
+static void set_attribute(pfm_attribute_t *attr, uint32_t *offset, pixelforge_component_type_t type,
+                          uint8_t size, bool normalized, uint32_t bytes) {
+    attr->offset = *offset;
+    attr->type = (uint8_t)type;
+    attr->size = size;
+    attr->normalized = normalized;
+    *offset += bytes;
+}
+
+int main(int argc, char **argv) {
+    const char *in_file = NULL;
+    const char *out_file = NULL;
+    bool compact = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--compact")) compact = true;
+        else if (argv[i][0] != '-' && !in_file) in_file = argv[i];
+        else if (argv[i][0] != '-' && !out_file) out_file = argv[i];
+    }
+
+    if (!in_file || !out_file) {
+        fprintf(stderr, "Usage: %s [--compact] <model.obj> <model.pfm>\n", argv[0]);
+        return 1;
+    }
+
+    obj_model model;
+    if (obj_load(in_file, &model) != 0) {
+        fprintf(stderr, "Failed to load OBJ file: %s\n", in_file);
+        return 1;
+    }
+
+    obj_indexed_mesh mesh;
+    if (obj_build_indexed_mesh(&model, &mesh) != 0) {
+        fprintf(stderr, "Failed to build indexed mesh\n");
+        obj_free(&model);
+        return 1;
+    }
+
+    bool has_texcoords = model.num_texcoords > 0;
+    obj_free(&model);
+
+    pfm_header_t h = {0};
+    h.vertex_count = (uint32_t)mesh.num_vertices;
+    h.index_count = (uint32_t)mesh.num_indices;
+    h.index_size = (uint32_t)mesh.index_size;
+
+    /* Bounds of the referenced vertices */
+    for (int c = 0; c < 3; c++) {
+        h.bounds_min[c] = INFINITY;
+        h.bounds_max[c] = -INFINITY;
+    }
+    for (size_t i = 0; i < mesh.num_vertices; i++) {
+        const float *p = &mesh.vertices[i].position.x;
+        for (int c = 0; c < 3; c++) {
+            if (p[c] < h.bounds_min[c]) h.bounds_min[c] = p[c];
+            if (p[c] > h.bounds_max[c]) h.bounds_max[c] = p[c];
+        }
+    }
+
+    uint32_t stride = 0;
+    if (compact) {
+        /* S16 components are naturally aligned, pad to keep the vertex word aligned */
+        set_attribute(&h.position, &stride, PIXELFORGE_COMPONENT_S16, 3, true, 8);
+        set_attribute(&h.normal, &stride, PIXELFORGE_COMPONENT_S8, 3, true, 4);
+        for (int c = 0; c < 3; c++) {
+            float half = (h.bounds_max[c] - h.bounds_min[c]) * 0.5f;
+            h.position_bias[c] = (h.bounds_max[c] + h.bounds_min[c]) * 0.5f;
+            h.position_scale[c] = half > 0.0f ? half : 1.0f;
+        }
+    } else {
+        set_attribute(&h.position, &stride, PIXELFORGE_COMPONENT_FIXED, 4, false, 16);
+        set_attribute(&h.normal, &stride, PIXELFORGE_COMPONENT_FIXED, 3, false, 12);
+        for (int c = 0; c < 3; c++) {
+            h.position_bias[c] = 0.0f;
+            h.position_scale[c] = 1.0f;
+        }
+    }
+    if (has_texcoords) {
+        set_attribute(&h.texcoord, &stride, PIXELFORGE_COMPONENT_FIXED, 2, false, 8);
+    }
+    h.vertex_stride = stride;
+
+    uint8_t *vertices = calloc(mesh.num_vertices, stride);
+    if (!vertices) {
+        fprintf(stderr, "Out of memory\n");
+        obj_free_indexed_mesh(&mesh);
+        return 1;
+    }
+
+    for (size_t i = 0; i < mesh.num_vertices; i++) {
+        const obj_vertex *v = &mesh.vertices[i];
+        const float *p = &v->position.x;
+        const float *n = &v->normal.x;
+        uint8_t *dst = vertices + i * stride;
+
+        if (compact) {
+            for (int c = 0; c < 3; c++) {
+                float q = (p[c] - h.position_bias[c]) / h.position_scale[c];
+                put_s16(dst + h.position.offset + 2 * c, quantize(q, INT16_MAX));
+                dst[h.normal.offset + c] = (uint8_t)(int8_t)quantize(n[c], INT8_MAX);
+            }
+        } else {
+            for (int c = 0; c < 3; c++) {
+                put_u32(dst + h.position.offset + 4 * c, fp16_16(p[c]));
+                put_u32(dst + h.normal.offset + 4 * c, fp16_16(n[c]));
+            }
+            put_u32(dst + h.position.offset + 12, fp16_16(1.0f));
+        }
+
+        if (has_texcoords) {
+            put_u32(dst + h.texcoord.offset, fp16_16(v->texcoord.u));
+            put_u32(dst + h.texcoord.offset + 4, fp16_16(v->texcoord.v));
+        }
+    }
+
+    int ret = pfm_write(out_file, &h, vertices, mesh.indices);
+    if (ret == 0) {
+        printf("%s: %u vertices (stride %u), %u triangles, ACMR %.3f\n", out_file,
+               h.vertex_count, h.vertex_stride, h.index_count / 3,
+               obj_mesh_acmr(&mesh, OBJ_VERTEX_CACHE_SIZE));
+    }
+
+    free(vertices);
+    obj_free_indexed_mesh(&mesh);
+    return ret == 0 ? 0 : 1;
+}
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
+#include <stdbool.h>
 
 #define INITIAL_CAPACITY 1024
 
@@ -159,3 +160,258 @@ void obj_get_bounds(const obj_model *model, vec3f *min, vec3f *max) {
         if (v->z > max->z) max->z = v->z;
     }
 }
+
+/* ============================================================================
+ * Indexed mesh
+ * ============================================================================ */
+
+static uint32_t hash_face_vertex(const face_vertex *fv) {
+    uint32_t h = (uint32_t)fv->v_idx * 0x9E3779B1u;
+    h ^= (uint32_t)fv->vt_idx * 0x85EBCA77u + (h << 6) + (h >> 2);
+    h ^= (uint32_t)fv->vn_idx * 0xC2B2AE3Du + (h << 6) + (h >> 2);
+    return h ^ (h >> 15);
+}
+
+static bool same_face_vertex(const face_vertex *a, const face_vertex *b) {
+    return a->v_idx == b->v_idx && a->vt_idx == b->vt_idx && a->vn_idx == b->vn_idx;
+}
+
+/* Merges face corners with the same attribute indices. Fills `corner_vertex` with the vertex of
+ * every corner and `first_corner` with the first corner of every vertex.
+ * Returns the number of vertices, SIZE_MAX on allocation failure */
+static size_t dedup_face_vertices(const obj_model *model, uint32_t *corner_vertex, uint32_t *first_corner) {
+    size_t table_size = 16;
+    while (table_size < model->num_faces * 2) table_size *= 2;
+
+    /* open addressing, vertex + 1 (0 - empty) */
+    uint32_t *table = calloc(table_size, sizeof(uint32_t));
+    if (!table) return SIZE_MAX;
+
+    size_t num_vertices = 0;
+    for (size_t i = 0; i < model->num_faces; i++) {
+        const face_vertex *fv = &model->faces[i];
+        size_t slot = hash_face_vertex(fv) & (table_size - 1);
+
+        while (table[slot] && !same_face_vertex(&model->faces[first_corner[table[slot] - 1]], fv)) {
+            slot = (slot + 1) & (table_size - 1);
+        }
+
+        if (!table[slot]) {
+            first_corner[num_vertices] = (uint32_t)i;
+            table[slot] = (uint32_t)++num_vertices;
+        }
+        corner_vertex[i] = table[slot] - 1;
+    }
+
+    free(table);
+    return num_vertices;
+}
+
+/* Picks the next fanning vertex: the most recently cached candidate whose remaining triangles
+ * still fit in the cache, else any candidate with triangles left */
+static int64_t tipsify_next_vertex(const uint32_t *candidates, size_t num_candidates,
+                                   const uint32_t *live, const size_t *cache_time, size_t timestamp,
+                                   size_t cache_size, const uint32_t *dead_end, size_t *dead_end_top,
+                                   size_t *cursor, size_t num_vertices) {
+    int64_t best = -1;
+    int64_t best_priority = -1;
+
+    for (size_t i = 0; i < num_candidates; i++) {
+        uint32_t v = candidates[i];
+        if (!live[v]) continue;
+
+        int64_t priority = 0;
+        if (timestamp - cache_time[v] + 2 * (size_t)live[v] <= cache_size) {
+            priority = (int64_t)(timestamp - cache_time[v]);
+        }
+        if (priority > best_priority) {
+            best_priority = priority;
+            best = v;
+        }
+    }
+    if (best >= 0) return best;
+
+    /* dead end: go back to a recently used vertex, then to the next one in input order */
+    while (*dead_end_top) {
+        uint32_t v = dead_end[--*dead_end_top];
+        if (live[v]) return v;
+    }
+    while (*cursor < num_vertices) {
+        size_t v = (*cursor)++;
+        if (live[v]) return (int64_t)v;
+    }
+    return -1;
+}
+
+/* Tipsify (Sander, Nehab, Barczak 2007): reorders triangles for a FIFO vertex cache of
+ * `cache_size` entries in linear time. Returns 0 on success, -1 on allocation failure */
+static int tipsify(const uint32_t *indices, size_t num_triangles, size_t num_vertices,
+                   size_t cache_size, uint32_t *out) {
+    size_t num_indices = num_triangles * 3;
+
+    uint32_t *offsets = calloc(num_vertices + 1, sizeof(uint32_t));
+    uint32_t *adjacency = malloc(num_indices * sizeof(uint32_t));
+    uint32_t *live = calloc(num_vertices, sizeof(uint32_t));
+    size_t *cache_time = calloc(num_vertices, sizeof(size_t));
+    bool *emitted = calloc(num_triangles, sizeof(bool));
+    uint32_t *dead_end = malloc(num_indices * sizeof(uint32_t));
+    uint32_t *candidates = malloc(num_indices * sizeof(uint32_t));
+
+    int ret = -1;
+    if (!offsets || !adjacency || !live || !cache_time || !emitted || !dead_end || !candidates) goto out;
+
+    /* vertex -> triangle adjacency */
+    for (size_t i = 0; i < num_indices; i++) live[indices[i]]++;
+    for (size_t v = 0; v < num_vertices; v++) offsets[v + 1] = offsets[v] + live[v];
+    for (size_t i = 0; i < num_indices; i++) {
+        uint32_t v = indices[i];
+        adjacency[offsets[v + 1] - live[v]--] = (uint32_t)(i / 3);
+    }
+    for (size_t v = 0; v < num_vertices; v++) live[v] = offsets[v + 1] - offsets[v];
+
+    size_t timestamp = cache_size + 1;
+    size_t dead_end_top = 0;
+    size_t cursor = 1;
+    size_t emitted_indices = 0;
+    int64_t fan = num_vertices ? 0 : -1;
+
+    while (fan >= 0) {
+        size_t num_candidates = 0;
+
+        for (uint32_t a = offsets[fan]; a < offsets[fan + 1]; a++) {
+            uint32_t t = adjacency[a];
+            if (emitted[t]) continue;
+            emitted[t] = true;
+
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                out[emitted_indices++] = v;
+                dead_end[dead_end_top++] = v;
+                candidates[num_candidates++] = v;
+                live[v]--;
+                if (timestamp - cache_time[v] > cache_size) {
+                    cache_time[v] = timestamp++;
+                }
+            }
+        }
+
+        fan = tipsify_next_vertex(candidates, num_candidates, live, cache_time, timestamp, cache_size,
+                                  dead_end, &dead_end_top, &cursor, num_vertices);
+    }
+    ret = 0;
+
+out:
+    free(offsets);
+    free(adjacency);
+    free(live);
+    free(cache_time);
+    free(emitted);
+    free(dead_end);
+    free(candidates);
+    return ret;
+}
+
+static void fill_obj_vertex(const obj_model *model, const face_vertex *fv, obj_vertex *v) {
+    memset(v, 0, sizeof(*v));
+    v->normal.z = 1.0f;
+
+    if (fv->v_idx >= 0 && (size_t)fv->v_idx < model->num_positions) v->position = model->positions[fv->v_idx];
+    if (fv->vn_idx >= 0 && (size_t)fv->vn_idx < model->num_normals) v->normal = model->normals[fv->vn_idx];
+    if (fv->vt_idx >= 0 && (size_t)fv->vt_idx < model->num_texcoords) v->texcoord = model->texcoords[fv->vt_idx];
+}
+
+int obj_build_indexed_mesh(const obj_model *model, obj_indexed_mesh *mesh) {
+    memset(mesh, 0, sizeof(obj_indexed_mesh));
+
+    size_t num_indices = model->num_faces;
+    if (num_indices == 0) {
+        fprintf(stderr, "OBJ model has no triangles\n");
+        return -1;
+    }
+
+    uint32_t *corner_vertex = malloc(num_indices * sizeof(uint32_t));
+    uint32_t *first_corner = malloc(num_indices * sizeof(uint32_t));
+    uint32_t *ordered = malloc(num_indices * sizeof(uint32_t));
+    uint32_t *remap = NULL;
+    int ret = -1;
+
+    if (!corner_vertex || !first_corner || !ordered) goto out_of_memory;
+
+    size_t num_vertices = dedup_face_vertices(model, corner_vertex, first_corner);
+    if (num_vertices == SIZE_MAX) goto out_of_memory;
+    if (num_vertices > 65536) {
+        fprintf(stderr, "OBJ model has %zu unique vertices, at most 65536 can be indexed\n", num_vertices);
+        goto out;
+    }
+
+    if (tipsify(corner_vertex, num_indices / 3, num_vertices, OBJ_VERTEX_CACHE_SIZE, ordered)) goto out_of_memory;
+
+    /* vertices in order of first use */
+    remap = malloc(num_vertices * sizeof(uint32_t));
+    mesh->index_size = num_vertices <= 256 ? 1 : 2;
+    mesh->vertices = malloc(num_vertices * sizeof(obj_vertex));
+    mesh->indices = malloc(num_indices * mesh->index_size);
+    if (!remap || !mesh->vertices || !mesh->indices) goto out_of_memory;
+
+    memset(remap, 0xFF, num_vertices * sizeof(uint32_t));
+    for (size_t i = 0; i < num_indices; i++) {
+        uint32_t v = ordered[i];
+        if (remap[v] == UINT32_MAX) {
+            remap[v] = (uint32_t)mesh->num_vertices;
+            fill_obj_vertex(model, &model->faces[first_corner[v]], &mesh->vertices[mesh->num_vertices++]);
+        }
+
+        if (mesh->index_size == 1) ((uint8_t *)mesh->indices)[i] = (uint8_t)remap[v];
+        else ((uint16_t *)mesh->indices)[i] = (uint16_t)remap[v];
+    }
+    mesh->num_indices = num_indices;
+    ret = 0;
+
+    printf("Indexed mesh: %zu vertices (from %zu face corners), ACMR %.2f\n",
+           mesh->num_vertices, num_indices, obj_mesh_acmr(mesh, OBJ_VERTEX_CACHE_SIZE));
+
+    goto out;
+
+out_of_memory:
+    fprintf(stderr, "Out of memory while building indexed mesh\n");
+out:
+    if (ret) obj_free_indexed_mesh(mesh);
+    free(corner_vertex);
+    free(first_corner);
+    free(ordered);
+    free(remap);
+    return ret;
+}
+
+void obj_free_indexed_mesh(obj_indexed_mesh *mesh) {
+    if (mesh) {
+        free(mesh->vertices);
+        free(mesh->indices);
+        memset(mesh, 0, sizeof(obj_indexed_mesh));
+    }
+}
+
+float obj_mesh_acmr(const obj_indexed_mesh *mesh, size_t cache_size) {
+    if (!mesh || mesh->num_indices < 3 || cache_size == 0) return 0.0f;
+
+    uint32_t *cache = malloc(cache_size * sizeof(uint32_t));
+    if (!cache) return 0.0f;
+    memset(cache, 0xFF, cache_size * sizeof(uint32_t));
+
+    size_t next = 0;
+    size_t misses = 0;
+    for (size_t i = 0; i < mesh->num_indices; i++) {
+        uint32_t v = mesh->index_size == 1 ? ((const uint8_t *)mesh->indices)[i]
+                                           : ((const uint16_t *)mesh->indices)[i];
+        bool hit = false;
+        for (size_t k = 0; k < cache_size && !hit; k++) hit = cache[k] == v;
+        if (!hit) {
+            cache[next] = v;
+            next = (next + 1) % cache_size;
+            misses++;
+        }
+    }
+
+    free(cache);
+    return (float)misses / (float)(mesh->num_indices / 3);
+}
@@ -0,0 +1,621 @@
+/*
+ * pf_bench: PixelForge benchmark of fixed scenes through the OpenGL ES 1.1 wrapper
+ *
+ * Every scene is rendered for a number of frames (after a few warm-up frames), animated by the
+ * frame number only, so runs are reproducible and can be compared between bitstreams and driver
+ * builds. Each frame is split into phases:
+ * - clear:  glClear() until the GPU has executed it
+ * - submit: CPU time spent recording the scene's draws, excluding GPU waits inside them
+ * - gpu:    from the first draw being recorded until all of them have retired
+ * - swap:   glSwapBuffers(), queueing the frame (only waits when no buffer is free)
+ * - wait:   time spent waiting for the GPU (stage ready waits and fences) in any phase
+ * Triangle and fragment rates are relative to the GPU time, fragments are taken from the
+ * hardware performance counters. The results are written as JSON.
+ */
+
+#define _GNU_SOURCE
+#include <math.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "demo_utils.h"
+#include "gles11_wrapper.h"
+#include "graphics_pipeline_csr_access.h"
+#include "obj_loader.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* The wrapper renders to the whole 640x480 framebuffer */
+#define BENCH_WIDTH  640
+#define BENCH_HEIGHT 480
+
+#define OVERDRAW_LAYERS 8
+#define STATE_CHANGE_GRID 16    /* cubes per row and column */
+#define SMALL_TRI_CELL 4        /* pixels, two triangles per cell */
+
+static volatile bool keep_running = true;
+
+static void handle_sigint(int sig) {
+    (void)sig;
+    keep_running = false;
+}
+
+static int32_t fp16_16(float v) {
+    return (int32_t)(v * 65536.0f);
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static uint64_t take_wait_ns(void) {
+    uint64_t wait_ns = 0;
+    glGetWaitStatsPF(&wait_ns, NULL, true);
+    return wait_ns;
+}
+
+typedef enum {
+    SCENE_MESH,
+    SCENE_OVERDRAW,
+    SCENE_STATE_CHANGE,
+    SCENE_SMALL_TRIANGLES,
+} scene_kind_t;
+
+typedef struct {
+    const char *name;
+    scene_kind_t kind;
+    const char *model;      /* OBJ file of SCENE_MESH, relative to --model-dir */
+} scene_desc_t;
+
+static const scene_desc_t scenes[] = {
+    { "teapot",          SCENE_MESH,            "teapot.obj" },
+    { "sphere",          SCENE_MESH,            "sphere.obj" },
+    { "sphere_faceted",  SCENE_MESH,            "sphere_faceted.obj" },
+    { "overdraw",        SCENE_OVERDRAW,        NULL },
+    { "state_change",    SCENE_STATE_CHANGE,    NULL },
+    { "small_triangles", SCENE_SMALL_TRIANGLES, NULL },
+};
+
+#define NUM_SCENES (sizeof(scenes) / sizeof(scenes[0]))
+
+/* Geometry of a scene, uploaded once */
+typedef struct {
+    GLuint vertex_buffer;
+    GLuint index_buffer;    /* 0 for non-indexed scenes */
+    GLenum index_type;
+    GLsizei count;          /* indices (or vertices) of one draw */
+    uint32_t triangles;     /* submitted per frame */
+    uint32_t draws;         /* per frame */
+} scene_geometry_t;
+
+static void upload_geometry(scene_geometry_t *geo, const struct demo_vertex *vertices, size_t num_vertices,
+                            const void *indices, size_t index_size, size_t num_indices) {
+    glGenBuffers(1, &geo->vertex_buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, geo->vertex_buffer);
+    glBufferData(GL_ARRAY_BUFFER, num_vertices * sizeof(*vertices), vertices, GL_STATIC_DRAW);
+
+    geo->index_buffer = 0;
+    geo->count = (GLsizei)num_vertices;
+    if (indices) {
+        glGenBuffers(1, &geo->index_buffer);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geo->index_buffer);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, num_indices * index_size, indices, GL_STATIC_DRAW);
+        geo->index_type = index_size == 1 ? GL_UNSIGNED_BYTE : GL_UNSIGNED_SHORT;
+        geo->count = (GLsizei)num_indices;
+    }
+}
+
+static void free_geometry(scene_geometry_t *geo) {
+    glDeleteBuffers(1, &geo->vertex_buffer);
+    if (geo->index_buffer) glDeleteBuffers(1, &geo->index_buffer);
+}
+
+/* Loads an OBJ model as an indexed mesh, centered and scaled to fit a 2 unit box */
+static bool setup_mesh(scene_geometry_t *geo, const char *path) {
+    obj_model model;
+    if (obj_load(path, &model) != 0) {
+        fprintf(stderr, "Failed to load OBJ file: %s\n", path);
+        return false;
+    }
+
+    obj_indexed_mesh mesh;
+    if (obj_build_indexed_mesh(&model, &mesh) != 0) {
+        fprintf(stderr, "Failed to build indexed mesh: %s\n", path);
+        obj_free(&model);
+        return false;
+    }
+
+    vec3f min, max;
+    obj_get_bounds(&model, &min, &max);
+    obj_free(&model);
+
+    vec3f center = { (min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f };
+    float size = fmaxf(max.x - min.x, fmaxf(max.y - min.y, max.z - min.z));
+    float scale = size > 0.0f ? 2.0f / size : 1.0f;
+
+    struct demo_vertex *vertices = calloc(mesh.num_vertices, sizeof(*vertices));
+    if (!vertices) {
+        obj_free_indexed_mesh(&mesh);
+        return false;
+    }
+
+    for (size_t i = 0; i < mesh.num_vertices; i++) {
+        const obj_vertex *v = &mesh.vertices[i];
+        vertices[i].pos[0] = fp16_16((v->position.x - center.x) * scale);
+        vertices[i].pos[1] = fp16_16((v->position.y - center.y) * scale);
+        vertices[i].pos[2] = fp16_16((v->position.z - center.z) * scale);
+        vertices[i].pos[3] = fp16_16(1.0f);
+        vertices[i].norm[0] = fp16_16(v->normal.x);
+        vertices[i].norm[1] = fp16_16(v->normal.y);
+        vertices[i].norm[2] = fp16_16(v->normal.z);
+        for (int c = 0; c < 4; c++) vertices[i].col[c] = fp16_16(1.0f);
+    }
+
+    upload_geometry(geo, vertices, mesh.num_vertices, mesh.indices, mesh.index_size, mesh.num_indices);
+    geo->triangles = (uint32_t)(mesh.num_indices / 3);
+    geo->draws = 1;
+
+    free(vertices);
+    obj_free_indexed_mesh(&mesh);
+    return true;
+}
+
+/* Full screen quads drawn on top of each other */
+static bool setup_overdraw(scene_geometry_t *geo) {
+    struct demo_vertex vertices[OVERDRAW_LAYERS * 6];
+    static const float corners[6][2] = { {-1, -1}, {1, -1}, {1, 1}, {-1, -1}, {1, 1}, {-1, 1} };
+
+    for (int layer = 0; layer < OVERDRAW_LAYERS; layer++) {
+        float shade = (float)(layer + 1) / OVERDRAW_LAYERS;
+        for (int i = 0; i < 6; i++) {
+            struct demo_vertex *v = &vertices[layer * 6 + i];
+            v->pos[0] = fp16_16(corners[i][0]);
+            v->pos[1] = fp16_16(corners[i][1]);
+            v->pos[2] = fp16_16(0.0f);
+            v->pos[3] = fp16_16(1.0f);
+            v->norm[0] = v->norm[1] = 0;
+            v->norm[2] = fp16_16(1.0f);
+            v->col[0] = fp16_16(shade);
+            v->col[1] = fp16_16(0.5f);
+            v->col[2] = fp16_16(1.0f - shade);
+            v->col[3] = fp16_16(0.25f);
+        }
+    }
+
+    upload_geometry(geo, vertices, OVERDRAW_LAYERS * 6, NULL, 0, 0);
+    geo->triangles = OVERDRAW_LAYERS * 2;
+    geo->draws = 1;
+    return true;
+}
+
+/* A grid of cubes, drawn one by one with their own matrices and material */
+static bool setup_state_change(scene_geometry_t *geo) {
+    struct demo_vertex vertices[24];
+    uint16_t indices[36];
+    uint32_t idx_count;
+    demo_create_cube(vertices, indices, &idx_count);
+
+    upload_geometry(geo, vertices, 24, indices, sizeof(uint16_t), idx_count);
+    geo->triangles = STATE_CHANGE_GRID * STATE_CHANGE_GRID * idx_count / 3;
+    geo->draws = STATE_CHANGE_GRID * STATE_CHANGE_GRID;
+    return true;
+}
+
+/* The screen tiled with triangles of SMALL_TRI_CELL^2 / 2 pixels */
+static bool setup_small_triangles(scene_geometry_t *geo) {
+    const int cols = BENCH_WIDTH / SMALL_TRI_CELL;
+    const int rows = BENCH_HEIGHT / SMALL_TRI_CELL;
+    size_t num_vertices = (size_t)cols * rows * 6;
+
+    struct demo_vertex *vertices = calloc(num_vertices, sizeof(*vertices));
+    if (!vertices) return false;
+
+    static const int corners[6][2] = { {0, 0}, {1, 0}, {1, 1}, {0, 0}, {1, 1}, {0, 1} };
+    struct demo_vertex *v = vertices;
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            for (int i = 0; i < 6; i++, v++) {
+                v->pos[0] = fp16_16((float)((x + corners[i][0]) * SMALL_TRI_CELL));
+                v->pos[1] = fp16_16((float)((y + corners[i][1]) * SMALL_TRI_CELL));
+                v->pos[2] = fp16_16(0.0f);
+                v->pos[3] = fp16_16(1.0f);
+                v->norm[2] = fp16_16(1.0f);
+                v->col[0] = fp16_16((float)x / cols);
+                v->col[1] = fp16_16((float)y / rows);
+                v->col[2] = fp16_16(i < 3 ? 1.0f : 0.0f);
+                v->col[3] = fp16_16(1.0f);
+            }
+        }
+    }
+
+    upload_geometry(geo, vertices, num_vertices, NULL, 0, 0);
+    geo->triangles = (uint32_t)(num_vertices / 3);
+    geo->draws = 1;
+
+    free(vertices);
+    return true;
+}
+
+static void bind_geometry(const scene_geometry_t *geo) {
+    glBindBuffer(GL_ARRAY_BUFFER, geo->vertex_buffer);
+    glVertexPointer(4, GL_FIXED, sizeof(struct demo_vertex), (void*)offsetof(struct demo_vertex, pos));
+    glNormalPointer(GL_FIXED, sizeof(struct demo_vertex), (void*)offsetof(struct demo_vertex, norm));
+    glColorPointer(4, GL_FIXED, sizeof(struct demo_vertex), (void*)offsetof(struct demo_vertex, col));
+    if (geo->index_buffer) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, geo->index_buffer);
+}
+
+static void draw_geometry(const scene_geometry_t *geo) {
+    if (geo->index_buffer) glDrawElements(GL_TRIANGLES, geo->count, geo->index_type, (void*)0);
+    else glDrawArrays(GL_TRIANGLES, 0, geo->count);
+}
+
+static void set_perspective(void) {
+    float fovy = 45.0f * (float)M_PI / 180.0f;
+    float aspect = (float)BENCH_WIDTH / BENCH_HEIGHT;
+    float near = 0.5f;
+    float far = 20.0f;
+    float f = 1.0f / tanf(fovy / 2.0f);
+
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    glFrustumf(-near * aspect / f, near * aspect / f, -near / f, near / f, near, far);
+}
+
+/* Fixed state of a scene, set once before its frames */
+static void setup_state(scene_kind_t kind) {
+    glDisable(GL_BLEND);
+    glDisable(GL_STENCIL_TEST);
+    glDisable(GL_LIGHTING);
+    glDisable(GL_DEPTH_TEST);
+    glDisable(GL_CULL_FACE);
+    glDepthFunc(GL_LESS);
+    glDepthMask(true);
+
+    if (kind == SCENE_MESH || kind == SCENE_STATE_CHANGE) {
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_BACK);
+        glFrontFace(GL_CCW);
+
+        glEnable(GL_LIGHTING);
+        glEnable(GL_LIGHT0);
+        GLfloat light_pos[] = {1.0f, 1.0f, 1.0f, 0.0f};
+        GLfloat light_ambient[] = {0.2f, 0.2f, 0.2f};
+        GLfloat light_diffuse[] = {0.8f, 0.8f, 0.8f};
+        glLightfv(GL_LIGHT0, GL_POSITION, light_pos);
+        glLightfv(GL_LIGHT0, GL_AMBIENT, light_ambient);
+        glLightfv(GL_LIGHT0, GL_DIFFUSE, light_diffuse);
+
+        GLfloat mat[] = {1.0f, 1.0f, 1.0f, 1.0f};
+        glMaterialfv(GL_FRONT_AND_BACK, GL_AMBIENT, mat);
+        glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, mat);
+        set_perspective();
+    } else if (kind == SCENE_OVERDRAW) {
+        /* every layer reads and writes the color buffer */
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+    } else {
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+        glOrthof(0.0f, BENCH_WIDTH, 0.0f, BENCH_HEIGHT, -1.0f, 1.0f);
+    }
+}
+
+static void draw_scene(scene_kind_t kind, const scene_geometry_t *geo, int frame) {
+    float t = (float)frame / 60.0f;
+
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+
+    switch (kind) {
+        case SCENE_MESH:
+            glTranslatef(0.0f, 0.0f, -4.0f);
+            glRotatef(t * 60.0f, 0.3f, 1.0f, 0.2f);
+            draw_geometry(geo);
+            break;
+        case SCENE_OVERDRAW:
+        case SCENE_SMALL_TRIANGLES:
+            draw_geometry(geo);
+            break;
+        case SCENE_STATE_CHANGE:
+            glTranslatef(0.0f, 0.0f, -12.0f);
+            for (int y = 0; y < STATE_CHANGE_GRID; y++) {
+                for (int x = 0; x < STATE_CHANGE_GRID; x++) {
+                    GLfloat diffuse[] = {
+                        (float)x / STATE_CHANGE_GRID, (float)y / STATE_CHANGE_GRID, 0.5f, 1.0f,
+                    };
+                    glMaterialfv(GL_FRONT_AND_BACK, GL_DIFFUSE, diffuse);
+                    glDepthFunc((x + y) & 1 ? GL_LEQUAL : GL_LESS);
+
+                    glPushMatrix();
+                    glTranslatef((x - STATE_CHANGE_GRID / 2 + 0.5f) * 0.6f,
+                                 (y - STATE_CHANGE_GRID / 2 + 0.5f) * 0.6f, 0.0f);
+                    glRotatef(t * 90.0f + (float)(x * 7 + y * 13), 1.0f, 1.0f, 0.0f);
+                    glScalef(0.4f, 0.4f, 0.4f);
+                    draw_geometry(geo);
+                    glPopMatrix();
+                }
+            }
+            break;
+    }
+}
+
+/* Per frame timings of one scene, in nanoseconds */
+typedef struct {
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+} timing_t;
+
+enum {
+    TIMING_FRAME,
+    TIMING_CLEAR,
+    TIMING_SUBMIT,
+    TIMING_GPU,
+    TIMING_SWAP,
+    TIMING_WAIT,
+    NUM_TIMINGS,
+};
+
+static const char *const timing_names[NUM_TIMINGS] = {
+    "frame_ms", "clear_ms", "submit_ms", "gpu_ms", "swap_ms", "wait_ms",
+};
+
+static void timing_add(timing_t *t, uint64_t ns) {
+    if (ns < t->min) t->min = ns;
+    if (ns > t->max) t->max = ns;
+    t->sum += ns;
+}
+
+typedef struct {
+    int frames;
+    uint32_t triangles;     /* submitted in total */
+    uint32_t draws;
+    timing_t timings[NUM_TIMINGS];
+    pixelforge_perf_counters_t perf;
+    GLuint presented;       /* glGetPresentStatsPF() over the measured frames */
+    GLuint late;
+    GLuint dropped;
+} scene_result_t;
+
+static bool run_scene(const scene_desc_t *desc, const char *model_dir, int warmup, int frames,
+                      scene_result_t *result) {
+    scene_geometry_t geo = {0};
+    bool ok = false;
+
+    switch (desc->kind) {
+        case SCENE_MESH: {
+            char path[512];
+            snprintf(path, sizeof(path), "%s/%s", model_dir, desc->model);
+            ok = setup_mesh(&geo, path);
+            break;
+        }
+        case SCENE_OVERDRAW:        ok = setup_overdraw(&geo); break;
+        case SCENE_STATE_CHANGE:    ok = setup_state_change(&geo); break;
+        case SCENE_SMALL_TRIANGLES: ok = setup_small_triangles(&geo); break;
+    }
+    if (!ok) return false;
+
+    setup_state(desc->kind);
+    bind_geometry(&geo);
+
+    memset(result, 0, sizeof(*result));
+    for (int i = 0; i < NUM_TIMINGS; i++) result->timings[i].min = UINT64_MAX;
+
+    for (int frame = -warmup; frame < frames && keep_running; frame++) {
+        if (frame == 0) {
+            /* measure from an idle GPU */
+            glFinish();
+            take_wait_ns();
+            glGetPerfCountersPF(NULL, true);
+            glGetPresentStatsPF(NULL, NULL, NULL, NULL, true);
+        }
+
+        uint64_t t_start = now_ns();
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        glFinish();
+        uint64_t t_clear = now_ns();
+        uint64_t wait_clear = take_wait_ns();
+
+        draw_scene(desc->kind, &geo, frame);
+        glFlush();
+        uint64_t t_submit = now_ns();
+        uint64_t wait_submit = take_wait_ns();
+
+        glFinish();
+        uint64_t t_gpu = now_ns();
+        uint64_t wait_gpu = take_wait_ns();
+
+        glSwapBuffers();
+        uint64_t t_swap = now_ns();
+        uint64_t wait_swap = take_wait_ns();
+
+        if (frame < 0) continue;
+
+        timing_t *t = result->timings;
+        timing_add(&t[TIMING_FRAME], t_swap - t_start);
+        timing_add(&t[TIMING_CLEAR], t_clear - t_start);
+        timing_add(&t[TIMING_SUBMIT], t_submit - t_clear - wait_submit);
+        timing_add(&t[TIMING_GPU], t_gpu - t_clear);
+        timing_add(&t[TIMING_SWAP], t_swap - t_gpu);
+        timing_add(&t[TIMING_WAIT], wait_clear + wait_submit + wait_gpu + wait_swap);
+        result->frames++;
+    }
+
+    result->triangles = geo.triangles * (uint32_t)result->frames;
+    result->draws = geo.draws * (uint32_t)result->frames;
+    glGetPerfCountersPF(&result->perf, false);
+    glGetPresentStatsPF(&result->presented, &result->late, &result->dropped, NULL, false);
+
+    free_geometry(&geo);
+    return true;
+}
+
+static double ns_to_ms(uint64_t ns) {
+    return (double)ns / 1e6;
+}
+
+static void print_perf_json(FILE *out, const pixelforge_perf_counters_t *p) {
+    fprintf(out, ",\n      \"perf\": {\n");
+    fprintf(out, "        \"triangles_in\": %u, \"triangles_clipped\": %u, \"triangles_culled\": %u, "
+                 "\"triangles_rasterized\": %u,\n",
+            p->triangles_in, p->triangles_clipped, p->triangles_culled, p->triangles_rasterized);
+    fprintf(out, "        \"hiz_tile_rejects\": %u, \"coarse_block_rejects\": %u,\n",
+            p->hiz_tile_rejects, p->coarse_block_rejects);
+    fprintf(out, "        \"fragments_generated\": %u, \"fragments_early_z_rejected\": %u, "
+                 "\"fragments_stencil_failed\": %u, \"fragments_depth_failed\": %u, "
+                 "\"fragments_written\": %u,\n",
+            p->fragments_generated, p->fragments_early_z_rejected, p->fragments_stencil_failed,
+            p->fragments_depth_failed, p->fragments_written);
+
+    fprintf(out, "        \"fifo\": {");
+    for (int i = 0; i < PIXELFORGE_PERF_NUM_FIFOS; i++) {
+        fprintf(out, "%s\n          \"%s\": {\"stall\": %u, \"starve\": %u}", i ? "," : "",
+                pf_perf_fifo_names[i], p->fifo[i].stall, p->fifo[i].starve);
+    }
+    fprintf(out, "\n        },\n        \"bus\": {");
+    for (int i = 0; i < PIXELFORGE_PERF_NUM_BUSES; i++) {
+        fprintf(out, "%s\n          \"%s\": {\"read_beats\": %u, \"write_beats\": %u, \"wait_cycles\": %u}",
+                i ? "," : "", pf_perf_bus_names[i], p->bus[i].read_beats, p->bus[i].write_beats,
+                p->bus[i].wait_cycles);
+    }
+    fprintf(out, "\n        },\n        \"cache\": {\n");
+    fprintf(out, "          \"depthstencil\": {\"lookups\": %u, \"misses\": %u},\n",
+            p->depthstencil_cache.lookups, p->depthstencil_cache.misses);
+    fprintf(out, "          \"color\": {\"lookups\": %u, \"misses\": %u},\n",
+            p->color_cache.lookups, p->color_cache.misses);
+    fprintf(out, "          \"texture\": {\"lookups\": %u, \"misses\": %u}\n",
+            p->texture_cache.lookups, p->texture_cache.misses);
+    fprintf(out, "        }\n      }");
+}
+
+static void print_scene_json(FILE *out, const char *name, const scene_result_t *r, bool perf, bool first) {
+    double gpu_s = (double)r->timings[TIMING_GPU].sum / 1e9;
+
+    fprintf(out, "%s    {\n", first ? "" : ",\n");
+    fprintf(out, "      \"name\": \"%s\",\n", name);
+    fprintf(out, "      \"frames\": %d,\n", r->frames);
+    fprintf(out, "      \"draws\": %u,\n", r->draws);
+    fprintf(out, "      \"triangles\": %u,\n", r->triangles);
+    fprintf(out, "      \"fragments\": %u,\n", r->perf.fragments_generated);
+    fprintf(out, "      \"present\": {\"presented\": %u, \"late\": %u, \"dropped\": %u},\n",
+            r->presented, r->late, r->dropped);
+    for (int i = 0; i < NUM_TIMINGS; i++) {
+        const timing_t *t = &r->timings[i];
+        fprintf(out, "      \"%s\": {\"avg\": %.3f, \"min\": %.3f, \"max\": %.3f},\n", timing_names[i],
+                r->frames ? ns_to_ms(t->sum) / r->frames : 0.0, r->frames ? ns_to_ms(t->min) : 0.0,
+                ns_to_ms(t->max));
+    }
+    fprintf(out, "      \"triangles_per_s\": %.0f,\n", gpu_s > 0.0 ? r->triangles / gpu_s : 0.0);
+    fprintf(out, "      \"fragments_per_s\": %.0f", gpu_s > 0.0 ? r->perf.fragments_generated / gpu_s : 0.0);
+    if (perf) print_perf_json(out, &r->perf);
+    fprintf(out, "\n    }");
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--frames N] [--warmup N] [--scene NAME]... [--model-dir DIR] [--perf] "
+                    "[--no-stencil] [--out FILE]\n", prog);
+    fprintf(stderr, "Scenes:");
+    for (size_t i = 0; i < NUM_SCENES; i++) fprintf(stderr, " %s", scenes[i].name);
+    fprintf(stderr, " (default: all)\n");
+}
+
+int main(int argc, char **argv) {
+    int frames = 100;
+    int warmup = 5;
+    const char *model_dir = ".";
+    const char *out_file = NULL;
+    bool perf = false;
+    bool stencil = true;
+    bool selected[NUM_SCENES] = {0};
+    bool any_selected = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
+            frames = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--warmup") && i + 1 < argc) {
+            warmup = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "--model-dir") && i + 1 < argc) {
+            model_dir = argv[++i];
+        } else if (!strcmp(argv[i], "--out") && i + 1 < argc) {
+            out_file = argv[++i];
+        } else if (!strcmp(argv[i], "--perf")) {
+            perf = true;
+        } else if (!strcmp(argv[i], "--no-stencil")) {
+            stencil = false;  /* D16 depth buffer */
+        } else if (!strcmp(argv[i], "--scene") && i + 1 < argc) {
+            const char *name = argv[++i];
+            size_t s = 0;
+            while (s < NUM_SCENES && strcmp(scenes[s].name, name)) s++;
+            if (s == NUM_SCENES) {
+                fprintf(stderr, "Unknown scene: %s\n", name);
+                usage(argv[0]);
+                return 1;
+            }
+            selected[s] = true;
+            any_selected = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (frames <= 0 || warmup < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    FILE *out = stdout;
+    if (out_file && !(out = fopen(out_file, "w"))) {
+        perror(out_file);
+        return 1;
+    }
+
+    signal(SIGINT, handle_sigint);
+
+    if (!glInitPF(stencil)) {
+        fprintf(stderr, "Failed to initialize OpenGL ES context\n");
+        if (out != stdout) fclose(out);
+        return 1;
+    }
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+    glEnableClientState(GL_VERTEX_ARRAY);
+    glEnableClientState(GL_NORMAL_ARRAY);
+    glEnableClientState(GL_COLOR_ARRAY);
+
+    int ret = 0;
+    bool first = true;
+    fprintf(out, "{\n  \"width\": %d,\n  \"height\": %d,\n  \"warmup\": %d,\n  \"stencil\": %s,\n"
+                 "  \"scenes\": [\n",
+            BENCH_WIDTH, BENCH_HEIGHT, warmup, stencil ? "true" : "false");
+
+    for (size_t s = 0; s < NUM_SCENES && keep_running; s++) {
+        if (any_selected && !selected[s]) continue;
+
+        fprintf(stderr, "Running %s (%d frames)...\n", scenes[s].name, frames);
+        scene_result_t result;
+        if (!run_scene(&scenes[s], model_dir, warmup, frames, &result)) {
+            ret = 1;
+            continue;
+        }
+        print_scene_json(out, scenes[s].name, &result, perf, first);
+        first = false;
+    }
+
+    fprintf(out, "\n  ]\n}\n");
+    if (out != stdout) fclose(out);
+
+    glDestroy();
+    return ret;
+}
@@ -0,0 +1,139 @@
+#define _GNU_SOURCE
+#include <stdlib.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "pfm_loader.h"
+
+#define PFM_ALIGN(v) (((v) + 15u) & ~(size_t)15u)
+
+static bool range_valid(uint64_t offset, uint64_t bytes, uint64_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+static bool attribute_valid(const pfm_attribute_t *attr, uint32_t stride) {
+    static const uint32_t component_bytes[] = { 4, 1, 1, 2, 2 };  /* by pixelforge_component_type_t */
+
+    if (attr->size == 0) return true;
+    if (attr->size > 4 || attr->type >= sizeof(component_bytes) / sizeof(component_bytes[0])) return false;
+
+    uint32_t bytes = component_bytes[attr->type];
+    return attr->offset % bytes == 0 && stride % bytes == 0 &&
+           (uint64_t)attr->offset + (uint64_t)attr->size * bytes <= stride;
+}
+
+int pfm_open(const char *filename, pfm_mesh *mesh) {
+    memset(mesh, 0, sizeof(pfm_mesh));
+
+    int fd = open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "Failed to open PFM file: %s\n", filename);
+        return -1;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(pfm_header_t)) {
+        fprintf(stderr, "Invalid PFM file: %s\n", filename);
+        close(fd);
+        return -1;
+    }
+
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "Failed to map PFM file: %s\n", filename);
+        return -1;
+    }
+    /* the streams are read once, front to back, while copying them into VRAM.
+     * The advice values are not flags, each one needs its own call */
+    madvise(map, size, MADV_SEQUENTIAL);
+    madvise(map, size, MADV_WILLNEED);
+
+    const pfm_header_t *h = map;
+    uint64_t vertex_bytes = (uint64_t)h->vertex_count * h->vertex_stride;
+    uint64_t index_bytes = (uint64_t)h->index_count * h->index_size;
+
+    bool valid = h->magic == PFM_MAGIC && h->version == PFM_VERSION &&
+                 h->vertex_stride != 0 && h->vertex_stride <= UINT16_MAX && h->vertex_count <= 65536 &&
+                 (h->index_size == 1 || h->index_size == 2) && h->index_count % 3 == 0 &&
+                 h->vertex_offset % 16 == 0 && h->index_offset % 16 == 0 &&
+                 range_valid(h->vertex_offset, vertex_bytes, size) &&
+                 range_valid(h->index_offset, index_bytes, size) &&
+                 h->position.size != 0 &&
+                 attribute_valid(&h->position, h->vertex_stride) &&
+                 attribute_valid(&h->normal, h->vertex_stride) &&
+                 attribute_valid(&h->texcoord, h->vertex_stride) &&
+                 attribute_valid(&h->color, h->vertex_stride);
+
+    if (!valid) {
+        fprintf(stderr, "Invalid PFM file: %s\n", filename);
+        munmap(map, size);
+        return -1;
+    }
+
+    mesh->header = h;
+    mesh->vertices = (const uint8_t *)map + h->vertex_offset;
+    mesh->vertex_bytes = (size_t)vertex_bytes;
+    mesh->indices = (const uint8_t *)map + h->index_offset;
+    mesh->index_bytes = (size_t)index_bytes;
+    mesh->map = map;
+    mesh->map_size = size;
+
+    printf("Mapped PFM: %u vertices (stride %u), %u triangles\n",
+           h->vertex_count, h->vertex_stride, h->index_count / 3);
+
+    return 0;
+}
+
+void pfm_close(pfm_mesh *mesh) {
+    if (mesh && mesh->map) {
+        munmap(mesh->map, mesh->map_size);
+        memset(mesh, 0, sizeof(pfm_mesh));
+    }
+}
+
+static bool write_padded(FILE *f, const void *data, size_t bytes, size_t *pos) {
+    static const uint8_t zeros[16];
+    size_t pad = PFM_ALIGN(*pos) - *pos;
+
+    if (fwrite(zeros, 1, pad, f) != pad) return false;
+    if (bytes && fwrite(data, 1, bytes, f) != bytes) return false;
+    *pos += pad + bytes;
+    return true;
+}
+
+int pfm_write(const char *filename, const pfm_header_t *header, const void *vertices, const void *indices) {
+    pfm_header_t h = *header;
+    size_t vertex_bytes = (size_t)h.vertex_count * h.vertex_stride;
+    size_t index_bytes = (size_t)h.index_count * h.index_size;
+
+    h.magic = PFM_MAGIC;
+    h.version = PFM_VERSION;
+    h.vertex_offset = (uint32_t)PFM_ALIGN(sizeof(pfm_header_t));
+    h.index_offset = (uint32_t)PFM_ALIGN(h.vertex_offset + vertex_bytes);
+
+    FILE *f = fopen(filename, "wb");
+    if (!f) {
+        fprintf(stderr, "Failed to create PFM file: %s\n", filename);
+        return -1;
+    }
+
+    size_t pos = 0;
+    bool ok = write_padded(f, &h, sizeof(h), &pos) &&
+              write_padded(f, vertices, vertex_bytes, &pos) &&
+              write_padded(f, indices, index_bytes, &pos);
+
+    if (fclose(f) != 0 || !ok) {
+        fprintf(stderr, "Failed to write PFM file: %s\n", filename);
+        remove(filename);
+        return -1;
+    }
+
+    return 0;
+}
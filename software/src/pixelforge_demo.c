@@ -200,6 +200,7 @@ static void configure_gpu_pipeline(pixelforge_dev *dev,
         light.specular[i] = fp16_16(0.0f);
     }
     pf_csr_set_light(csr, 0, &light);
+    pf_csr_set_light_enable(csr, 1u);
     DBG("Light 0 set: pos=(0,0,1) ambient=1.0 diffuse=0.0 specular=0.0");
 
     /* Primitive config */
@@ -279,6 +280,8 @@ static void usage(const char *prog) {
     fprintf(stderr, "  --verbose             Enable debug output\n");
     fprintf(stderr, "  --throttle            Throttle debug output with delays\n");
     fprintf(stderr, "  --front               Operate on front buffer instead of back buffer\n");
+    fprintf(stderr, "  --capture-frames      Save the rendered frames (PNG)\n");
+    fprintf(stderr, "  --capture-format FMT  Save the rendered frames as png, ppm or raw (BGRA stream)\n");
 }
 
 int main(int argc, char **argv) {
@@ -287,6 +290,7 @@ int main(int argc, char **argv) {
     bool render_triangle = false;
     bool front = false;
     bool capture_frames = false;
+    frame_capture_format_t capture_format = FRAME_CAPTURE_PNG;
     int frames = 1;
 
     for (int i = 1; i < argc; ++i) {
@@ -296,6 +300,12 @@ int main(int argc, char **argv) {
             xor_test = 1;
         } else if (!strcmp(argv[i], "--capture-frames")) {
             capture_frames = true;
+        } else if (!strcmp(argv[i], "--capture-format") && i + 1 < argc) {
+            if (frame_capture_parse_format(argv[++i], &capture_format) != 0) {
+                usage(argv[0]);
+                return 1;
+            }
+            capture_frames = true;
         } else if (!strcmp(argv[i], "--render-triangle")) {
             render_triangle = 1;
         } else if (!strcmp(argv[i], "--frames") && i + 1 < argc) {
@@ -353,6 +363,7 @@ int main(int argc, char **argv) {
         } else {
             memset(pixels, 0, dev->buffer_size);
         }
+        pixelforge_vram_sync_for_device(dev, pixels, dev->buffer_size);
 
         /* Submit buffer for display */
         if (!front) pixelforge_swap_buffers(dev);
@@ -378,9 +389,22 @@ int main(int argc, char **argv) {
         setup_triangle_geometry(vb_block.phys, vb_virt,
                                &idx_addr, &idx_count,
                                &pos_addr, &norm_addr, &col_addr, &stride);
+        pixelforge_vram_sync_for_device(dev, vb_virt, VB_REGION_SIZE);
 
         printf("Rendering %d frame(s)...\n", frames);
 
+        frame_capture_t *capture = NULL;
+        if (capture_frames) {
+            frame_capture_config_t capture_config = {
+                .prefix = "pixelforge_demo",
+                .format = capture_format,
+                .color_format = dev->color_format,
+                .width = dev->x_resolution,
+                .height = dev->y_resolution,
+            };
+            capture = frame_capture_start(&capture_config);
+        }
+
         for (int frame = 0; frame < frames && keep_running; ++frame) {
             /* Request next buffer */
             uint8_t *buffer = pixelforge_get_back_buffer(dev);
@@ -388,6 +412,7 @@ int main(int argc, char **argv) {
 
             /* Clear buffer */
             memset(buffer, 0, dev->buffer_size);
+            pixelforge_vram_sync_for_device(dev, buffer, dev->buffer_size);
             DBG("Frame %d: buffer cleared", frame);
 
             /* Configure pipeline */
@@ -411,18 +436,14 @@ int main(int argc, char **argv) {
             /* Submit buffer for display */
             pixelforge_swap_buffers(dev);
 
-            if (capture_frames) {
-                char filename[256];
-                if (frame_capture_gen_filename(filename, sizeof(filename), "pixelforge_demo", frame, ".png") == 0) {
-                    uint8_t *display_buffer = pixelforge_get_front_buffer(dev);
-                    frame_capture_rgba(filename, display_buffer, dev->x_resolution,
-                                     dev->y_resolution, dev->buffer_stride);
-                }
+            if (capture) {
+                frame_capture_submit(capture, pixelforge_wait_presented_frame(dev), dev->buffer_stride, frame);
             }
 
             printf("Frame %d rendered\n", frame);
         }
 
+        frame_capture_stop(capture, NULL);
         pixelforge_close_dev(dev);
         return 0;
     }
@@ -5,11 +5,13 @@
 #include <sys/mman.h>
 #include <sys/ioctl.h>
 #include <sys/syscall.h>
+#include <poll.h>
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <dirent.h>
 #include <inttypes.h>
+#include <time.h>
 #include <linux/udmabuf.h>
 
 #include "pixelforge_utils.h"
@@ -25,6 +27,9 @@
 #define PAGE_ALIGN_DOWN(a) ((a) & PAGE_MASK)
 #define PAGE_OFFSET(a)  ((a) & ~PAGE_MASK)
 
+/* Upper bound for a single sleep, so keep_running is still checked regularly */
+#define PF_IRQ_WAIT_TIMEOUT_MS 10
+
 static void* map_physical(int memfd, uint32_t phys, size_t length) {
     uint32_t aligned_phys = PAGE_ALIGN_DOWN(phys);
     uint32_t offset = PAGE_OFFSET(phys);
@@ -47,19 +52,54 @@ static int init_udmabuf(pixelforge_dev *dev, size_t size) {
     dev->vram_base_phys = dev->vram_dma.phys;
     dev->vram_size = dev->vram_dma.size;
 
-    printf("VRAM allocated: phys=0x%08x, virt=%p, size=%zu\n",
-           dev->vram_base_phys, dev->vram_base_virt, dev->vram_size);
+    printf("VRAM allocated: phys=0x%08x, virt=%p, size=%zu, %s\n",
+           dev->vram_base_phys, dev->vram_base_virt, dev->vram_size,
+           dev->vram_dma.cached ? "cached" : "uncached");
 
     return 0;
 }
 
+static int open_uio(const char *name) {
+    DIR *dir = opendir("/sys/class/uio");
+    if (!dir) return -1;
+
+    int fd = -1;
+    struct dirent *ent;
+    while (fd < 0 && (ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, "uio", 3) != 0) continue;
+
+        char path[320];
+        snprintf(path, sizeof(path), "/sys/class/uio/%s/name", ent->d_name);
+        FILE *f = fopen(path, "r");
+        if (!f) continue;
+
+        char dev_name[64] = {0};
+        bool found = fgets(dev_name, sizeof(dev_name), f) != NULL;
+        fclose(f);
+
+        dev_name[strcspn(dev_name, "\n")] = '\0';
+        if (found && strcmp(dev_name, name) == 0) {
+            snprintf(path, sizeof(path), "/dev/%s", ent->d_name);
+            fd = open(path, O_RDWR | O_CLOEXEC);
+        }
+    }
+
+    closedir(dir);
+    return fd;
+}
+
 pixelforge_dev* pixelforge_open_dev(void) {
+    return pixelforge_open_dev_ds(PIXELFORGE_DS_D16_X8_S8);
+}
+
+pixelforge_dev* pixelforge_open_dev_ds(pixelforge_depthstencil_format_t depthstencil_format) {
     pixelforge_dev *dev = calloc(1, sizeof(pixelforge_dev));
     if (!dev) return NULL;
 
     dev->memfd = -1;
-    memset(&dev->vram_dma, 0, sizeof(dev->vram_dma));
-    dev->vram_dma.dmafd = dev->vram_dma.memfd = dev->vram_dma.ctrl_fd = -1;
+    dev->uio_fd = -1;
+    dev->swapping_buffer = -1;
+    dev->presented_buffer = -1;
 
     dev->memfd = open("/dev/mem", O_RDWR | O_SYNC);
     if (dev->memfd < 0) {
@@ -75,15 +115,39 @@ pixelforge_dev* pixelforge_open_dev(void) {
         return NULL;
     }
 
+    dev->uio_fd = open_uio(PF_UIO_NAME);
+    if (dev->uio_fd < 0) {
+        printf("GPU interrupt not available, polling for completion\n");
+    }
+    pf_csr_set_irq_enable(dev->csr_base, 0);
+    pf_csr_set_vtx_cache_enable(dev->csr_base, true);
+    pf_csr_set_early_cull_enable(dev->csr_base, true);
+    pf_csr_set_guard_band(dev->csr_base, PIXELFORGE_GUARD_BAND_2X);
+    /* only used for depth buffers cleared by the GPU, CPU cleared ones are never tracked */
+    pf_csr_set_hiz_enable(dev->csr_base, true);
+
     /* Read resolution from VGA DMA hardware */
     dev->x_resolution = dev->vga_dma_regs->resolution.bits.x_resolution;
     dev->y_resolution = dev->vga_dma_regs->resolution.bits.y_resolution;
-    dev->data_width = FB_DATA_WIDTH;
+
+    /* The GPU renders in the format the VGA DMA scans out (color_type: bytes per pixel) */
+    uint32_t vga_bpp = dev->vga_dma_regs->status.bits.color_type;
+    dev->color_format = vga_bpp == 2 ? PIXELFORGE_COLOR_R5G6B5 : PIXELFORGE_COLOR_B8G8R8A8;
+    dev->data_width = pf_color_format_size(dev->color_format);
+    if (vga_bpp != dev->data_width) {
+        printf("VGA DMA color type %u not supported, assuming 32-bit BGRA\n", vga_bpp);
+    }
     dev->buffer_stride = dev->x_resolution * dev->data_width;
     dev->buffer_size = (size_t)dev->buffer_stride * dev->y_resolution;
 
-    printf("x resolution: %u, y resolution: %u, buffer size: %zu bytes\n",
-          dev->x_resolution, dev->y_resolution, dev->buffer_size);
+    /* rows stay word aligned for the 16-bit formats */
+    dev->depthstencil_format = depthstencil_format;
+    dev->depthstencil_stride =
+        (dev->x_resolution * pf_depthstencil_format_size(depthstencil_format) + 3u) & ~3u;
+    dev->depthstencil_size = dev->depthstencil_stride * dev->y_resolution;
+
+    printf("x resolution: %u, y resolution: %u, buffer size: %zu bytes, depth/stencil: %zu bytes\n",
+          dev->x_resolution, dev->y_resolution, dev->buffer_size, dev->depthstencil_size);
 
     if (init_udmabuf(dev, PF_VRAM_SIZE)) {
         goto error;
@@ -99,30 +163,36 @@ pixelforge_dev* pixelforge_open_dev(void) {
         dev->buffers[i] = bufs[i].virt;
         dev->buffer_phys[i] = bufs[i].phys;
         memset(dev->buffers[i], 0, dev->buffer_size);
+        pixelforge_vram_sync_for_device(dev, dev->buffers[i], dev->buffer_size);
         printf("Buffer %d:          0x%08x\n", i, dev->buffer_phys[i]);
     }
 
-    /* Initialize buffer indices:
-     * - Buffer 0: old display (possibly still being scanned out)
-     * - Buffer 1: current display
+    /* Initialize buffer ownership:
+     * - Buffer 0: old display (scanned out until the initial swap completes)
+     * - Buffer 1: swapped in at the next vsync
      * - Buffer 2: available for rendering */
-    dev->old_display_buffer = 0;
-    dev->current_display_buffer = 1;
+    dev->current_display_buffer = 0;
+    dev->swapping_buffer = 1;
     dev->render_buffer = 2;
+    dev->buffer_state[0] = PF_BUFFER_DISPLAYED;
+    dev->buffer_state[1] = PF_BUFFER_SWAPPING;
+    dev->buffer_state[2] = PF_BUFFER_RENDERING;
+    dev->present_count = 0;
+    dev->presented_buffer = -1;
 
-    /* Initialize VGA DMA with buffer 0 */
+    /* Trigger the initial swap to buffer 1 */
     dev->vga_dma_regs->back_buffer = dev->buffer_phys[1];
-    dev->vga_dma_regs->front_buffer = 1; /* Trigger initial swap */
+    dev->vga_dma_regs->front_buffer = 1;
 
     /* Initialize depth/stencil buffer */
-    size_t ds_size = (size_t)dev->x_resolution * dev->y_resolution * 4;
     struct vram_block ds_block;
-    if (vram_alloc(&dev->vram, ds_size, PAGE_SIZE, &ds_block)) {
+    if (vram_alloc(&dev->vram, dev->depthstencil_size, PAGE_SIZE, &ds_block)) {
         goto error;
     }
     dev->depthstencil_buffer = ds_block.virt;
     dev->depthstencil_buffer_phys = ds_block.phys;
-    memset(dev->depthstencil_buffer, 0, ds_size);
+    memset(dev->depthstencil_buffer, 0, dev->depthstencil_size);
+    pixelforge_vram_sync_for_device(dev, dev->depthstencil_buffer, dev->depthstencil_size);
 
     return dev;
 
@@ -133,27 +203,34 @@ error:
 
 void pixelforge_close_dev(pixelforge_dev *dev) {
     if (dev) {
+        /* the queued frames are still shown, their buffers are freed below */
+        if (dev->csr_base && dev->vga_dma_regs) pixelforge_present_flush(dev);
+        if (dev->csr_base) pf_csr_set_irq_enable(dev->csr_base, 0);
+        if (dev->uio_fd >= 0) close(dev->uio_fd);
         udma_free(&dev->vram_dma);
         if (dev->memfd >= 0) close(dev->memfd);
         free(dev);
     }
 }
 
-static void pixelforge_swap_buffers_impl(pixelforge_dev *dev, bool vsync) {
-    if (!dev || !dev->vga_dma_regs) return;
+static size_t vram_offset(const pixelforge_dev *dev, const void *virt) {
+    return (size_t)((const uint8_t *)virt - dev->vram_base_virt);
+}
 
-    /* Wait for previous swap to complete BEFORE triggering new swap */
-    while (vsync && dev->vga_dma_regs->status.bits.swap_busy) {
-        usleep(10);
-    }
+void pixelforge_vram_sync_for_device(pixelforge_dev *dev, const void *virt, size_t size) {
+    udma_sync_for_device(&dev->vram_dma, vram_offset(dev, virt), size);
+}
 
-    dev->vga_dma_regs->back_buffer = dev->buffer_phys[dev->render_buffer];
-    dev->vga_dma_regs->front_buffer = 1;
+void pixelforge_vram_sync_for_cpu(pixelforge_dev *dev, const void *virt, size_t size) {
+    udma_sync_for_cpu(&dev->vram_dma, vram_offset(dev, virt), size);
+}
 
-    int old_old_display = dev->old_display_buffer;
-    dev->old_display_buffer = dev->current_display_buffer;
-    dev->current_display_buffer = dev->render_buffer;
-    dev->render_buffer = old_old_display;
+static void pixelforge_swap_buffers_impl(pixelforge_dev *dev, bool vsync) {
+    if (!dev || !dev->vga_dma_regs) return;
+
+    /* everything drawn so far has been waited for by the caller */
+    pixelforge_fence_t done = { .seq = pf_csr_get_fence_retired(dev->csr_base) };
+    pixelforge_present(dev, done, vsync);
 }
 
 void pixelforge_swap_buffers(pixelforge_dev *dev) {
@@ -174,21 +251,199 @@ uint8_t* pixelforge_get_front_buffer(pixelforge_dev *dev) {
     return dev->buffers[dev->current_display_buffer];
 }
 
-bool pixelforge_wait_for_gpu_ready(pixelforge_dev *dev, enum gpu_stage stage, volatile bool *keep_running) {
-    // component is really ready if all prior stages are also ready
-    // TODO: actually make use of interrupts (uio or a real kernel driver)
-
-    uint32_t mask = (1u << (stage + 1)) - 1;
+typedef bool (*pf_wait_cond_fn)(pixelforge_dev *dev, uint32_t arg);
 
+static bool wait_for_event_loop(pixelforge_dev *dev, uint32_t irq_mask, pf_wait_cond_fn done, uint32_t arg,
+                                volatile bool *keep_running) {
     while (true) {
         if (keep_running && !*keep_running)
             return false;
 
-        uint32_t ready_components = pf_csr_get_ready_components(dev->csr_base);
+        // frames queued behind the draws being waited for go on screen as soon as they retire
+        pixelforge_present_poll(dev);
+
+        if (done(dev, arg))
+            return true;
+
+        if (dev->uio_fd < 0) {
+            usleep(50);
+            continue;
+        }
+
+        // drop stale events first, so an event after the check below still raises the interrupt
+        pf_csr_clear_irq_status(dev->csr_base, irq_mask);
+        pf_csr_set_irq_enable(dev->csr_base, irq_mask);
 
-        if ((ready_components & mask) == mask)
+        if (done(dev, arg))
             return true;
 
-        usleep(50);
+        // uio masks the interrupt after each delivery, re-enable it before sleeping
+        uint32_t unmask = 1;
+        if (write(dev->uio_fd, &unmask, sizeof(unmask)) != sizeof(unmask)) {
+            usleep(50);
+            continue;
+        }
+
+        struct pollfd pfd = { .fd = dev->uio_fd, .events = POLLIN };
+        if (poll(&pfd, 1, PF_IRQ_WAIT_TIMEOUT_MS) > 0) {
+            uint32_t irq_count;
+            if (read(dev->uio_fd, &irq_count, sizeof(irq_count)) != sizeof(irq_count)) {
+                usleep(50);
+            }
+        }
     }
 }
+
+static uint64_t monotonic_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static bool wait_for_event(pixelforge_dev *dev, uint32_t irq_mask, pf_wait_cond_fn done, uint32_t arg,
+                           volatile bool *keep_running) {
+    uint64_t start = monotonic_ns();
+    bool ret = wait_for_event_loop(dev, irq_mask, done, arg, keep_running);
+    dev->wait_ns += monotonic_ns() - start;
+    dev->wait_count++;
+    return ret;
+}
+
+static bool stages_ready(pixelforge_dev *dev, uint32_t mask) {
+    return (pf_csr_get_ready_components(dev->csr_base) & mask) == mask;
+}
+
+bool pixelforge_wait_for_gpu_ready(pixelforge_dev *dev, enum gpu_stage stage, volatile bool *keep_running) {
+    // component is really ready if all prior stages are also ready
+    uint32_t mask = (1u << (stage + 1)) - 1;
+
+    return wait_for_event(dev, PIXELFORGE_IRQ_STAGE_READY(stage), stages_ready, mask, keep_running);
+}
+
+static bool fence_retired(pixelforge_dev *dev, uint32_t seq) {
+    // counters wrap around, compare the distance instead of the raw values
+    return (int32_t)(pf_csr_get_fence_retired(dev->csr_base) - seq) >= 0;
+}
+
+pixelforge_fence_t pf_fence_insert(pixelforge_cmdbuf_t *cb) {
+    pf_cmdbuf_kick(cb);
+    return (pixelforge_fence_t){ .seq = cb->draws };
+}
+
+bool pf_fence_poll(pixelforge_dev *dev, pixelforge_fence_t fence) {
+    return fence_retired(dev, fence.seq);
+}
+
+bool pf_fence_wait(pixelforge_dev *dev, pixelforge_fence_t fence, volatile bool *keep_running) {
+    return wait_for_event(dev, PIXELFORGE_IRQ_RETIRED, fence_retired, fence.seq, keep_running);
+}
+
+/* Polling interval for swap completion, the VGA DMA cannot interrupt */
+#define PF_SWAP_POLL_US 100
+
+static void present_pop(pixelforge_dev *dev) {
+    dev->present_count--;
+    for (int i = 0; i < dev->present_count; i++) {
+        dev->present_queue[i] = dev->present_queue[i + 1];
+    }
+}
+
+void pixelforge_present_poll(pixelforge_dev *dev) {
+    volatile struct vga_dma_regs *regs = dev->vga_dma_regs;
+
+    if (dev->swapping_buffer >= 0) {
+        if (regs->status.bits.swap_busy) return;
+
+        /* the swap happened at the last vsync, the old front buffer is no longer scanned out */
+        dev->buffer_state[dev->current_display_buffer] = PF_BUFFER_FREE;
+        dev->current_display_buffer = dev->swapping_buffer;
+        dev->buffer_state[dev->current_display_buffer] = PF_BUFFER_DISPLAYED;
+        dev->swapping_buffer = -1;
+        dev->last_flip_ns = monotonic_ns();
+    }
+
+    /* without vsync only the newest finished frame is shown */
+    while (dev->present_count > 1 && !dev->buffer_vsync[dev->present_queue[0]] &&
+           fence_retired(dev, dev->buffer_fence[dev->present_queue[1]].seq)) {
+        dev->buffer_state[dev->present_queue[0]] = PF_BUFFER_FREE;
+        present_pop(dev);
+        dev->present_stats.dropped++;
+    }
+
+    if (dev->present_count == 0) return;
+
+    int buf = dev->present_queue[0];
+    if (!fence_retired(dev, dev->buffer_fence[buf].seq)) return;
+
+    present_pop(dev);
+    regs->back_buffer = dev->buffer_phys[buf];
+    regs->front_buffer = 1;
+    dev->buffer_state[buf] = PF_BUFFER_SWAPPING;
+    dev->swapping_buffer = buf;
+
+    dev->present_stats.presented++;
+    if (dev->last_flip_ns && monotonic_ns() - dev->last_flip_ns > 1000000000u / PF_REFRESH_HZ) {
+        dev->present_stats.late++;
+    }
+}
+
+/* Sleeps until the queue can make progress: the oldest frame's draws retire or the swap completes */
+static void present_wait(pixelforge_dev *dev) {
+    if (dev->swapping_buffer < 0 && dev->present_count > 0) {
+        pf_fence_wait(dev, dev->buffer_fence[dev->present_queue[0]], NULL);
+    } else {
+        usleep(PF_SWAP_POLL_US);
+    }
+}
+
+void pixelforge_present(pixelforge_dev *dev, pixelforge_fence_t fence, bool vsync) {
+    int buf = dev->render_buffer;
+    dev->presented_buffer = buf;
+    dev->buffer_state[buf] = PF_BUFFER_QUEUED;
+    dev->buffer_fence[buf] = fence;
+    dev->buffer_vsync[buf] = vsync;
+    dev->present_queue[dev->present_count++] = buf;
+
+    uint64_t start = 0;
+    while (true) {
+        pixelforge_present_poll(dev);
+
+        for (int i = 0; i < 3; i++) {
+            if (dev->buffer_state[i] != PF_BUFFER_FREE) continue;
+
+            dev->render_buffer = i;
+            dev->buffer_state[i] = PF_BUFFER_RENDERING;
+            if (start) dev->present_stats.blocked_ns += monotonic_ns() - start;
+            return;
+        }
+
+        if (!start) {
+            start = monotonic_ns();
+            dev->present_stats.blocked++;
+        }
+        present_wait(dev);
+    }
+}
+
+void pixelforge_present_flush(pixelforge_dev *dev) {
+    pixelforge_present_poll(dev);
+    while (dev->present_count > 0 || dev->swapping_buffer >= 0) {
+        present_wait(dev);
+        pixelforge_present_poll(dev);
+    }
+}
+
+const uint8_t* pixelforge_wait_presented_frame(pixelforge_dev *dev) {
+    if (!dev || dev->presented_buffer < 0) return NULL;
+
+    /* a later present is needed before the buffer can be dropped or rendered to again */
+    int buf = dev->presented_buffer;
+    pf_fence_wait(dev, dev->buffer_fence[buf], NULL);
+    pixelforge_vram_sync_for_cpu(dev, dev->buffers[buf], dev->buffer_size);
+    return dev->buffers[buf];
+}
+
+void pixelforge_get_present_stats(pixelforge_dev *dev, pixelforge_present_stats_t *stats, bool reset) {
+    if (stats) *stats = dev->present_stats;
+    if (reset) memset(&dev->present_stats, 0, sizeof(dev->present_stats));
+}
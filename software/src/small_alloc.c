@@ -2,86 +2,428 @@
 #include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 
-typedef struct block_header {
-    uint64_t free: 1;
-    uint64_t size: 63;
-    struct block_header* next;
-} block_header;
+/* Free blocks are kept in segregated lists indexed by a first level (power of two)
+ * and a second level (SL_COUNT linear steps within that power of two). Sizes are
+ * counted in granules (the pool alignment). */
+#define SL_LOG2 4
+#define SL_COUNT (1u << SL_LOG2)
+#define FL_COUNT (32 - SL_LOG2 + 1)
+
+#define DEFAULT_ALIGNMENT 16
+#define NONE UINT32_MAX
+#define MAP_EMPTY SIZE_MAX
+
+typedef struct {
+    size_t offset;          /* from the start of the managed region */
+    size_t size;            /* in bytes, multiple of the granule */
+    uint32_t prev_phys;     /* neighbouring blocks in memory */
+    uint32_t next_phys;
+    uint32_t prev_free;     /* segregated free list links, next_free also links unused descriptors */
+    uint32_t next_free;
+    bool free;
+} block_t;
 
 typedef struct pool_t {
-    block_header* free_list;
+    uint8_t *base;
+    size_t size;
+    size_t granule;
+    unsigned granule_log2;
+
+    uint32_t fl_bitmap;
+    uint32_t sl_bitmap[FL_COUNT];
+    uint32_t heads[FL_COUNT][SL_COUNT];
+
+    block_t *blocks;
+    uint32_t block_capacity;
+    uint32_t unused_blocks;     /* stack of recycled descriptors */
+
+    /* block start offset -> descriptor, open addressing with linear probing */
+    size_t *map_keys;
+    uint32_t *map_values;
+    uint32_t map_capacity;
+    uint32_t map_count;
+
+    size_t used;
+    size_t high_water;
+    size_t used_blocks;
+    size_t free_blocks;
 } pool_t;
 
-static size_t align(size_t size) {
-    return (size + 15) & ~15; // align to 16 bytes
+static unsigned log2_floor(size_t v) {
+    unsigned r = 0;
+    while (v >>= 1) r++;
+    return r;
+}
+
+static size_t align_up(size_t v, size_t alignment) {
+    return (v + alignment - 1) & ~(alignment - 1);
 }
 
-static void split_block(block_header *block, size_t size) {
-    if (block->size < size + sizeof(*block) + sizeof(void*)) return;
+/* =============================
+ * Descriptor storage
+ * ============================= */
+
+static uint32_t block_new(pool_t *pool) {
+    if (pool->unused_blocks == NONE) {
+        uint32_t new_capacity = pool->block_capacity ? pool->block_capacity * 2 : 64;
+        block_t *new_blocks = realloc(pool->blocks, new_capacity * sizeof(block_t));
+        if (!new_blocks) return NONE;
 
-    block_header *new_block = (block_header*)((uint8_t*)(block + 1) + size);
-    new_block->size = block->size - size - sizeof(*block);
-    new_block->next = block->next;
-    new_block->free = true;
+        for (uint32_t i = pool->block_capacity; i < new_capacity; i++) {
+            new_blocks[i].next_free = i + 1 < new_capacity ? i + 1 : NONE;
+        }
+        pool->blocks = new_blocks;
+        pool->unused_blocks = pool->block_capacity;
+        pool->block_capacity = new_capacity;
+    }
 
-    block->size = size;
-    block->next = new_block;
+    uint32_t idx = pool->unused_blocks;
+    pool->unused_blocks = pool->blocks[idx].next_free;
+    return idx;
 }
 
-static void coalesce_block(pool_t *pool, struct block_header *block) {
-    if (block->next && block->next->free) {
-        block->size += block->next->size + sizeof(*block);
-        block->next = block->next->next;
+static void block_delete(pool_t *pool, uint32_t idx) {
+    pool->blocks[idx].next_free = pool->unused_blocks;
+    pool->unused_blocks = idx;
+}
+
+/* =============================
+ * Offset map
+ * ============================= */
+
+static uint32_t map_home(const pool_t *pool, size_t key) {
+    return ((uint32_t)(key >> pool->granule_log2) * 2654435761u) & (pool->map_capacity - 1);
+}
+
+static uint32_t map_slot(const pool_t *pool, size_t key) {
+    uint32_t mask = pool->map_capacity - 1;
+    uint32_t i = map_home(pool, key);
+    while (pool->map_keys[i] != MAP_EMPTY && pool->map_keys[i] != key) {
+        i = (i + 1) & mask;
     }
+    return i;
+}
 
-    struct block_header *current = pool->free_list;
+static bool map_grow(pool_t *pool) {
+    uint32_t old_capacity = pool->map_capacity;
+    size_t *old_keys = pool->map_keys;
+    uint32_t *old_values = pool->map_values;
 
-    while (current && current->next != block) {
-        current = current->next;
+    uint32_t new_capacity = old_capacity ? old_capacity * 2 : 128;
+    size_t *keys = malloc(new_capacity * sizeof(*keys));
+    uint32_t *values = malloc(new_capacity * sizeof(*values));
+    if (!keys || !values) {
+        free(keys);
+        free(values);
+        return false;
     }
+    for (uint32_t i = 0; i < new_capacity; i++) keys[i] = MAP_EMPTY;
+
+    pool->map_keys = keys;
+    pool->map_values = values;
+    pool->map_capacity = new_capacity;
+
+    for (uint32_t i = 0; i < old_capacity; i++) {
+        if (old_keys[i] == MAP_EMPTY) continue;
+        uint32_t slot = map_slot(pool, old_keys[i]);
+        keys[slot] = old_keys[i];
+        values[slot] = old_values[i];
+    }
+
+    free(old_keys);
+    free(old_values);
+    return true;
+}
+
+/* Keeps the load factor at or below 1/2, so inserts that follow cannot fail */
+static bool map_reserve(pool_t *pool, uint32_t extra) {
+    while ((pool->map_count + extra) * 2 > pool->map_capacity) {
+        if (!map_grow(pool)) return false;
+    }
+    return true;
+}
+
+static void map_insert(pool_t *pool, size_t key, uint32_t value) {
+    uint32_t slot = map_slot(pool, key);
+    if (pool->map_keys[slot] == MAP_EMPTY) pool->map_count++;
+    pool->map_keys[slot] = key;
+    pool->map_values[slot] = value;
+}
+
+static uint32_t map_find(const pool_t *pool, size_t key) {
+    uint32_t slot = map_slot(pool, key);
+    return pool->map_keys[slot] == MAP_EMPTY ? NONE : pool->map_values[slot];
+}
+
+static void map_remove(pool_t *pool, size_t key) {
+    uint32_t mask = pool->map_capacity - 1;
+    uint32_t i = map_slot(pool, key);
+    if (pool->map_keys[i] == MAP_EMPTY) return;
+
+    // backward shift deletion, entries after the hole move up unless they sit at their home slot range
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & mask;
+        if (pool->map_keys[j] == MAP_EMPTY) break;
+
+        uint32_t k = map_home(pool, pool->map_keys[j]);
+        bool stays = i <= j ? (i < k && k <= j) : (i < k || k <= j);
+        if (stays) continue;
+
+        pool->map_keys[i] = pool->map_keys[j];
+        pool->map_values[i] = pool->map_values[j];
+        i = j;
+    }
+    pool->map_keys[i] = MAP_EMPTY;
+    pool->map_count--;
+}
+
+/* =============================
+ * Segregated free lists
+ * ============================= */
+
+static void mapping(const pool_t *pool, size_t size, unsigned *fl, unsigned *sl) {
+    size_t n = size >> pool->granule_log2;
+    if (n < SL_COUNT) {
+        *fl = 0;
+        *sl = (unsigned)n;
+    } else {
+        unsigned l = log2_floor(n);
+        *fl = l - SL_LOG2 + 1;
+        *sl = (unsigned)(n >> (l - SL_LOG2)) - SL_COUNT;
+    }
+}
+
+/* Rounds `size` up to the next list boundary, so every block of the found list fits */
+static void mapping_search(const pool_t *pool, size_t size, unsigned *fl, unsigned *sl) {
+    size_t n = size >> pool->granule_log2;
+    if (n >= SL_COUNT) {
+        n += ((size_t)1 << (log2_floor(n) - SL_LOG2)) - 1;
+    }
+    mapping(pool, n << pool->granule_log2, fl, sl);
+}
+
+static void free_insert(pool_t *pool, uint32_t idx) {
+    block_t *b = &pool->blocks[idx];
+    unsigned fl, sl;
+    mapping(pool, b->size, &fl, &sl);
+
+    b->free = true;
+    b->prev_free = NONE;
+    b->next_free = pool->heads[fl][sl];
+    if (b->next_free != NONE) pool->blocks[b->next_free].prev_free = idx;
+    pool->heads[fl][sl] = idx;
+
+    pool->fl_bitmap |= 1u << fl;
+    pool->sl_bitmap[fl] |= 1u << sl;
+    pool->free_blocks++;
+}
+
+static void free_remove(pool_t *pool, uint32_t idx) {
+    block_t *b = &pool->blocks[idx];
+    unsigned fl, sl;
+    mapping(pool, b->size, &fl, &sl);
+
+    if (b->prev_free != NONE) pool->blocks[b->prev_free].next_free = b->next_free;
+    else pool->heads[fl][sl] = b->next_free;
+    if (b->next_free != NONE) pool->blocks[b->next_free].prev_free = b->prev_free;
+
+    if (pool->heads[fl][sl] == NONE) {
+        pool->sl_bitmap[fl] &= ~(1u << sl);
+        if (!pool->sl_bitmap[fl]) pool->fl_bitmap &= ~(1u << fl);
+    }
+
+    b->free = false;
+    pool->free_blocks--;
+}
+
+static uint32_t find_free(pool_t *pool, size_t size) {
+    unsigned fl, sl;
+    mapping_search(pool, size, &fl, &sl);
+    if (fl >= FL_COUNT) return NONE;
+
+    uint32_t sl_map = pool->sl_bitmap[fl] & (~0u << sl);
+    if (!sl_map) {
+        uint32_t fl_map = fl + 1 < FL_COUNT ? pool->fl_bitmap & (~0u << (fl + 1)) : 0;
+        if (!fl_map) return NONE;
 
-    if (current && current->free) {
-        current->size += block->size + sizeof(*block);
-        current->next = block->next;
+        fl = (unsigned)__builtin_ctz(fl_map);
+        sl_map = pool->sl_bitmap[fl];
     }
+    sl = (unsigned)__builtin_ctz(sl_map);
+    return pool->heads[fl][sl];
 }
 
-pool_t* small_init(void *memory, size_t size) {
-    if (!memory || size < sizeof(pool_t) + sizeof(block_header)) return NULL;
+/* =============================
+ * Block operations
+ * ============================= */
 
-    pool_t *pool = (pool_t*)memory;
-    pool->free_list = (block_header*)(pool + 1);
-    pool->free_list->size = size - sizeof(pool_t) - sizeof(block_header);
-    pool->free_list->next = NULL;
-    pool->free_list->free = true;
+/* Returns the block to the free lists, merging it with free neighbours */
+static void release(pool_t *pool, uint32_t idx) {
+    block_t *b = &pool->blocks[idx];
+
+    uint32_t next = b->next_phys;
+    if (next != NONE && pool->blocks[next].free) {
+        free_remove(pool, next);
+        b->size += pool->blocks[next].size;
+        b->next_phys = pool->blocks[next].next_phys;
+        if (b->next_phys != NONE) pool->blocks[b->next_phys].prev_phys = idx;
+        map_remove(pool, pool->blocks[next].offset);
+        block_delete(pool, next);
+    }
+
+    uint32_t prev = b->prev_phys;
+    if (prev != NONE && pool->blocks[prev].free) {
+        free_remove(pool, prev);
+        pool->blocks[prev].size += b->size;
+        pool->blocks[prev].next_phys = b->next_phys;
+        if (b->next_phys != NONE) pool->blocks[b->next_phys].prev_phys = prev;
+        map_remove(pool, b->offset);
+        block_delete(pool, idx);
+        idx = prev;
+    }
+
+    free_insert(pool, idx);
+}
+
+/* Cuts the block at `size` bytes and returns the remainder (or NONE if there is none) */
+static uint32_t split(pool_t *pool, uint32_t idx, size_t size) {
+    if (pool->blocks[idx].size <= size) return NONE;
+    if (!map_reserve(pool, 1)) return NONE;
+
+    uint32_t rest = block_new(pool);
+    if (rest == NONE) return NONE;
+
+    block_t *b = &pool->blocks[idx];
+    block_t *r = &pool->blocks[rest];
+    r->offset = b->offset + size;
+    r->size = b->size - size;
+    r->prev_phys = idx;
+    r->next_phys = b->next_phys;
+    r->free = false;
+    if (r->next_phys != NONE) pool->blocks[r->next_phys].prev_phys = rest;
+
+    b->size = size;
+    b->next_phys = rest;
+
+    map_insert(pool, r->offset, rest);
+    return rest;
+}
+
+static void mark_used(pool_t *pool, size_t size) {
+    pool->used += size;
+    pool->used_blocks++;
+    if (pool->used > pool->high_water) pool->high_water = pool->used;
+}
+
+static uint32_t lookup_used(const pool_t *pool, const void *ptr) {
+    const uint8_t *p = ptr;
+    if (p < pool->base || p >= pool->base + pool->size) return NONE;
+
+    uint32_t idx = map_find(pool, (size_t)(p - pool->base));
+    if (idx == NONE || pool->blocks[idx].free) return NONE;
+    return idx;
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+pool_t* small_init(void *memory, size_t size, size_t alignment) {
+    if (alignment == 0) alignment = DEFAULT_ALIGNMENT;
+    if (!memory || (alignment & (alignment - 1)) != 0) return NULL;
+
+    pool_t *pool = calloc(1, sizeof(pool_t));
+    if (!pool) return NULL;
+
+    pool->granule = alignment;
+    pool->granule_log2 = log2_floor(alignment);
+    pool->unused_blocks = NONE;
+    for (unsigned fl = 0; fl < FL_COUNT; fl++) {
+        for (unsigned sl = 0; sl < SL_COUNT; sl++) {
+            pool->heads[fl][sl] = NONE;
+        }
+    }
+
+    // only manage the aligned part of the region
+    uint8_t *start = (uint8_t*)align_up((uintptr_t)memory, alignment);
+    size_t skipped = (size_t)(start - (uint8_t*)memory);
+    size_t usable = size > skipped ? (size - skipped) & ~(alignment - 1) : 0;
+    if (usable == 0 || (usable >> pool->granule_log2) > UINT32_MAX) {
+        free(pool);
+        return NULL;
+    }
+
+    pool->base = start;
+    pool->size = usable;
+
+    uint32_t idx = block_new(pool);
+    if (idx == NONE || !map_reserve(pool, 1)) {
+        small_destroy(pool);
+        return NULL;
+    }
+
+    pool->blocks[idx] = (block_t){
+        .offset = 0,
+        .size = usable,
+        .prev_phys = NONE,
+        .next_phys = NONE,
+    };
+    map_insert(pool, 0, idx);
+    free_insert(pool, idx);
 
     return pool;
 }
 
 void small_destroy(pool_t *pool) {
-    (void)pool; // No dynamic resources to free
+    if (!pool) return;
+
+    free(pool->blocks);
+    free(pool->map_keys);
+    free(pool->map_values);
+    free(pool);
 }
 
-void *small_malloc(pool_t *pool, size_t size) {
+void *small_memalign(pool_t *pool, size_t alignment, size_t size) {
     if (!pool) return NULL;
     if (size == 0) return NULL;
-    if (!pool->free_list) return NULL; // no memory available
+    if ((alignment & (alignment - 1)) != 0) return NULL;
+    if (alignment < pool->granule) alignment = pool->granule;
+    if (size > pool->size) return NULL;
+
+    size = align_up(size, pool->granule);
+
+    // alignment above the granule is found by over-allocating and splitting off the front
+    size_t search = size + (alignment - pool->granule);
+    uint32_t idx = find_free(pool, search);
+    if (idx == NONE) return NULL;
 
-    size = align(size);
+    free_remove(pool, idx);
 
-    block_header *block = pool->free_list;
-    for (; block; block = block->next)
-        if (block->free && block->size >= size)
-            break;
+    uintptr_t addr = (uintptr_t)(pool->base + pool->blocks[idx].offset);
+    size_t gap = (size_t)(align_up(addr, alignment) - addr);
+    if (gap) {
+        uint32_t aligned = split(pool, idx, gap);
+        if (aligned == NONE) {
+            free_insert(pool, idx);
+            return NULL;
+        }
+        free_insert(pool, idx);
+        idx = aligned;
+    }
 
-    if (!block) return NULL; // no suitable block found
+    uint32_t rest = split(pool, idx, size);
+    if (rest != NONE) release(pool, rest);
 
-    split_block(block, size);
-    block->free = false;
+    mark_used(pool, pool->blocks[idx].size);
+    return pool->base + pool->blocks[idx].offset;
+}
 
-    return block + 1;
+void *small_malloc(pool_t *pool, size_t size) {
+    return small_memalign(pool, 0, size);
 }
 
 void *small_calloc(pool_t *pool, size_t n, size_t size) {
@@ -104,23 +446,40 @@ void *small_realloc(pool_t *pool, void *ptr, size_t size) {
         return NULL;
     }
 
-    block_header *block = (block_header*)ptr - 1;
-    if (block->size >= size) {
-        split_block(block, size);
-        coalesce_block(pool, block->next);
-        return ptr;
+    uint32_t idx = lookup_used(pool, ptr);
+    if (idx == NONE) return NULL;
+    if (size > pool->size) return NULL;
+
+    size_t old_size = pool->blocks[idx].size;
+    size = align_up(size, pool->granule);
+
+    // grow into a free neighbour in place
+    uint32_t next = pool->blocks[idx].next_phys;
+    if (size > old_size && next != NONE && pool->blocks[next].free &&
+        old_size + pool->blocks[next].size >= size) {
+        free_remove(pool, next);
+        pool->blocks[idx].size += pool->blocks[next].size;
+        pool->blocks[idx].next_phys = pool->blocks[next].next_phys;
+        if (pool->blocks[idx].next_phys != NONE) {
+            pool->blocks[pool->blocks[idx].next_phys].prev_phys = idx;
+        }
+        map_remove(pool, pool->blocks[next].offset);
+        block_delete(pool, next);
     }
 
-    if (block->next && block->next->free && block->size + sizeof(*block) + block->next->size >= size) {
-        coalesce_block(pool, block);
-        split_block(block, size);
+    if (pool->blocks[idx].size >= size) {
+        uint32_t rest = split(pool, idx, size);
+        if (rest != NONE) release(pool, rest);
+
+        pool->used = pool->used - old_size + pool->blocks[idx].size;
+        if (pool->used > pool->high_water) pool->high_water = pool->used;
         return ptr;
     }
 
     void *new_ptr = small_malloc(pool, size);
     if (!new_ptr) return NULL;
 
-    memcpy(new_ptr, ptr, block->size);
+    memcpy(new_ptr, ptr, old_size);
     small_free(pool, ptr);
     return new_ptr;
 }
@@ -129,7 +488,35 @@ void small_free(pool_t *pool, void* ptr) {
     if (!pool) return;
     if (!ptr) return;
 
-    block_header *block = (block_header*)ptr - 1;
-    block->free = true;
-    coalesce_block(pool, block);
+    uint32_t idx = lookup_used(pool, ptr);
+    if (idx == NONE) return;
+
+    pool->used -= pool->blocks[idx].size;
+    pool->used_blocks--;
+    release(pool, idx);
+}
+
+void small_stats(const pool_t *pool, small_stats_t *stats) {
+    memset(stats, 0, sizeof(*stats));
+    if (!pool) return;
+
+    stats->total = pool->size;
+    stats->used = pool->used;
+    stats->high_water = pool->high_water;
+    stats->used_blocks = pool->used_blocks;
+    stats->free_blocks = pool->free_blocks;
+
+    for (unsigned fl = 0; fl < FL_COUNT; fl++) {
+        for (unsigned sl = 0; sl < SL_COUNT; sl++) {
+            for (uint32_t idx = pool->heads[fl][sl]; idx != NONE; idx = pool->blocks[idx].next_free) {
+                size_t size = pool->blocks[idx].size;
+                stats->free += size;
+                if (size > stats->largest_free) stats->largest_free = size;
+            }
+        }
+    }
+
+    if (stats->free) {
+        stats->fragmentation = 1.0f - (float)stats->largest_free / (float)stats->free;
+    }
 }
@@ -3,80 +3,260 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/mman.h>
-#include <sys/ioctl.h>
-#include <sys/syscall.h>
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
 #include <dirent.h>
 #include <inttypes.h>
-#include <linux/udmabuf.h>
 #include <stdbool.h>
 
 #include "udma_alloc.h"
 
-static void close_fd(int *fd) {
-    if (*fd >= 0) {
-        close(*fd);
-        *fd = -1;
-    }
-}
+#define UDMA_MAX_POOLS 4
+#define UDMA_MAX_REGIONS 32
+
+/* sync_direction values of u-dma-buf (enum dma_data_direction) */
+#define UDMA_DIR_TO_DEVICE 1
+#define UDMA_DIR_FROM_DEVICE 2
+
+/* u-dma-buf v2+ registers "u-dma-buf", older versions "udmabuf" */
+static const char *const udma_class_dirs[] = { "/sys/class/u-dma-buf", "/sys/class/udmabuf" };
+
+struct udma_region {
+    size_t offset;
+    size_t size;
+};
+
+struct udma_pool {
+    char dev_path[64];           /* /dev/udmabufN, or /dev/mem for the reserved memory */
+    uint32_t phys;
+    size_t size;
+    bool devmem;
+    bool can_sync;               /* cached mappings are only handed out if they can be synced */
+    /* driver attributes, the sync range is only rewritten when it changes */
+    int sync_offset_fd;
+    int sync_size_fd;
+    int sync_direction_fd;
+    int sync_for_cpu_fd;
+    int sync_for_device_fd;
+    long long last_offset;
+    long long last_size;
+    long long last_direction;
+    size_t region_count;
+    struct udma_region regions[UDMA_MAX_REGIONS];   /* sorted by offset */
+};
+
+/* pools are found on the first allocation and stay open for the lifetime of the process */
+static struct udma_pool pools[UDMA_MAX_POOLS];
+static size_t pool_count;
+static bool pools_scanned;
 
 static size_t page_align_up(size_t size) {
     size_t page = (size_t)getpagesize();
     return (size + page - 1u) & ~(page - 1u);
 }
 
-static bool used = false;
+static bool read_attr(const char *dir, const char *name, unsigned long long *value) {
+    char path[320];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+
+    char text[32] = {0};
+    bool ok = fgets(text, sizeof(text), f) != NULL;
+    fclose(f);
+    if (!ok) return false;
+
+    char *end;
+    errno = 0;
+    *value = strtoull(text, &end, 0);
+    return errno == 0 && end != text;
+}
+
+static int open_attr(const char *dir, const char *name) {
+    char path[320];
+    snprintf(path, sizeof(path), "%s/%s", dir, name);
+    return open(path, O_WRONLY | O_CLOEXEC);
+}
+
+/* sysfs only takes a value written in one go at offset 0 */
+static int write_attr(int fd, long long *last, long long value) {
+    if (last && *last == value) return 0;
+
+    char text[24];
+    int len = snprintf(text, sizeof(text), "%lld", value);
+    if (pwrite(fd, text, (size_t)len, 0) != len) {
+        if (last) *last = -1;
+        return -1;
+    }
+    if (last) *last = value;
+    return 0;
+}
+
+static void add_driver_pool(const char *class_dir, const char *name) {
+    char dir[288];
+    snprintf(dir, sizeof(dir), "%s/%s", class_dir, name);
+
+    unsigned long long phys, size;
+    if (!read_attr(dir, "phys_addr", &phys) || !read_attr(dir, "size", &size)) return;
+    if (size == 0 || phys + size > UINT32_MAX + 1ull) {
+        fprintf(stderr, "udma_alloc: %s is not addressable by the GPU\n", name);
+        return;
+    }
+
+    struct udma_pool *pool = &pools[pool_count];
+    memset(pool, 0, sizeof(*pool));
+    snprintf(pool->dev_path, sizeof(pool->dev_path), "/dev/%s", name);
+    pool->phys = (uint32_t)phys;
+    pool->size = (size_t)size;
+    pool->last_offset = pool->last_size = pool->last_direction = -1;
+
+    pool->sync_offset_fd = open_attr(dir, "sync_offset");
+    pool->sync_size_fd = open_attr(dir, "sync_size");
+    pool->sync_direction_fd = open_attr(dir, "sync_direction");
+    pool->sync_for_cpu_fd = open_attr(dir, "sync_for_cpu");
+    pool->sync_for_device_fd = open_attr(dir, "sync_for_device");
+    pool->can_sync = pool->sync_offset_fd >= 0 && pool->sync_size_fd >= 0 &&
+                     pool->sync_direction_fd >= 0 && pool->sync_for_cpu_fd >= 0 &&
+                     pool->sync_for_device_fd >= 0;
+    if (!pool->can_sync) {
+        fprintf(stderr, "udma_alloc: cannot sync %s, mapping it uncached\n", name);
+    }
+
+    /* sync_mode 2: mappings opened with O_SYNC are write-combined instead of uncached */
+    int mode_fd = open_attr(dir, "sync_mode");
+    if (mode_fd >= 0) {
+        write_attr(mode_fd, NULL, 2);
+        close(mode_fd);
+    }
+
+    pool_count++;
+}
+
+static void scan_pools(void) {
+    pools_scanned = true;
+
+    for (size_t c = 0; c < sizeof(udma_class_dirs) / sizeof(udma_class_dirs[0]) && pool_count == 0; c++) {
+        DIR *dir = opendir(udma_class_dirs[c]);
+        if (!dir) continue;
+
+        struct dirent *ent;
+        while (pool_count < UDMA_MAX_POOLS && (ent = readdir(dir)) != NULL) {
+            if (strncmp(ent->d_name, "udmabuf", 7) != 0) continue;
+            add_driver_pool(udma_class_dirs[c], ent->d_name);
+        }
+        closedir(dir);
+    }
+
+    if (pool_count > 0) return;
+
+    fprintf(stderr, "udma_alloc: u-dma-buf not found, using uncached memory at 0x%08x\n",
+            UDMA_DEVMEM_PHYS);
+    struct udma_pool *pool = &pools[pool_count++];
+    memset(pool, 0, sizeof(*pool));
+    snprintf(pool->dev_path, sizeof(pool->dev_path), "/dev/mem");
+    pool->phys = UDMA_DEVMEM_PHYS;
+    pool->size = UDMA_DEVMEM_SIZE;
+    pool->devmem = true;
+}
+
+/* First fit between the allocated regions */
+static bool pool_reserve(struct udma_pool *pool, size_t size, size_t *offset) {
+    if (pool->region_count == UDMA_MAX_REGIONS) return false;
+
+    size_t start = 0;
+    size_t i;
+    for (i = 0; i <= pool->region_count; i++) {
+        size_t end = i < pool->region_count ? pool->regions[i].offset : pool->size;
+        if (end - start >= size) break;
+        if (i < pool->region_count) start = pool->regions[i].offset + pool->regions[i].size;
+    }
+    if (i > pool->region_count) return false;
+
+    memmove(&pool->regions[i + 1], &pool->regions[i], (pool->region_count - i) * sizeof(pool->regions[0]));
+    pool->regions[i] = (struct udma_region){ .offset = start, .size = size };
+    pool->region_count++;
+    *offset = start;
+    return true;
+}
+
+static void pool_release(struct udma_pool *pool, size_t offset) {
+    for (size_t i = 0; i < pool->region_count; i++) {
+        if (pool->regions[i].offset != offset) continue;
+
+        memmove(&pool->regions[i], &pool->regions[i + 1], (pool->region_count - i - 1) * sizeof(pool->regions[0]));
+        pool->region_count--;
+        return;
+    }
+}
+
+static int pool_sync(struct udma_pool *pool, int trigger_fd, int direction, size_t offset, size_t size) {
+    if (write_attr(pool->sync_offset_fd, &pool->last_offset, (long long)offset) != 0 ||
+        write_attr(pool->sync_size_fd, &pool->last_size, (long long)size) != 0 ||
+        write_attr(pool->sync_direction_fd, &pool->last_direction, direction) != 0 ||
+        write_attr(trigger_fd, NULL, 1) != 0) {
+        perror("udma_alloc: sync");
+        return -1;
+    }
+    return 0;
+}
 
 int udma_alloc(size_t size, struct udma_buffer *buf) {
+    return udma_alloc_mapping(size, UDMA_CACHED, buf);
+}
+
+int udma_alloc_mapping(size_t size, udma_mapping_t mapping, struct udma_buffer *buf) {
     if (!buf || size == 0) return -1;
     size = page_align_up(size);
     memset(buf, 0, sizeof(*buf));
-    buf->dmafd = buf->memfd = buf->ctrl_fd = -1;
 
-    buf->phys = 0x3C000000;
+    if (!pools_scanned) scan_pools();
 
-    int devmem_fd = open("/dev/mem", O_RDWR | O_SYNC);
-    if (devmem_fd < 0) {
-        perror("open /dev/mem");
-        goto error;
+    struct udma_pool *pool = NULL;
+    size_t offset = 0;
+    for (size_t i = 0; i < pool_count && !pool; i++) {
+        if (pool_reserve(&pools[i], size, &offset)) pool = &pools[i];
+    }
+    if (!pool) {
+        fprintf(stderr, "udma_alloc: no room for %zu bytes\n", size);
+        return -1;
+    }
+
+    buf->cached = mapping == UDMA_CACHED && pool->can_sync;
+    int fd = open(pool->dev_path, O_RDWR | O_CLOEXEC | (buf->cached ? 0 : O_SYNC));
+    if (fd < 0) {
+        perror(pool->dev_path);
+        pool_release(pool, offset);
+        return -1;
     }
 
-    buf->virt = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, devmem_fd, buf->phys);
-    close(devmem_fd);
+    off_t map_offset = (off_t)(pool->devmem ? pool->phys + offset : offset);
+    buf->virt = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, map_offset);
+    close(fd);
 
     if (buf->virt == MAP_FAILED) {
+        perror("udma_alloc: mmap");
         buf->virt = NULL;
-        perror("mmap /dev/mem");
-        goto error;
-    }
-
-    if (used) {
-        fprintf(stderr, "udma_alloc: warning: for now only a single allocation is supported "
-                        "-> returing aliasing allocation\n");
+        pool_release(pool, offset);
+        return -1;
     }
-    used = true;
 
+    buf->phys = pool->phys + (uint32_t)offset;
     buf->size = size;
+    buf->offset = offset;
+    buf->pool = pool;
     return 0;
-
-error:
-    udma_free(buf);
-    return -1;
 }
 
 int udma_free(struct udma_buffer *buf) {
     if (!buf) return -1;
     if (buf->virt && buf->size) {
         munmap(buf->virt, buf->size);
-        buf->virt = NULL;
     }
-    close_fd(&buf->dmafd);
-    close_fd(&buf->memfd);
-    close_fd(&buf->ctrl_fd);
-    buf->phys = 0;
-    buf->size = 0;
+    if (buf->pool) {
+        pool_release(buf->pool, buf->offset);
+    }
+    memset(buf, 0, sizeof(*buf));
     return 0;
 }
 
@@ -91,3 +271,24 @@ uint8_t* udma_get_virt(const struct udma_buffer *buf) {
 size_t udma_get_size(const struct udma_buffer *buf) {
     return buf ? buf->size : 0;
 }
+
+static int buffer_sync(const struct udma_buffer *buf, bool for_device, size_t offset, size_t size) {
+    if (!buf || !buf->virt) return -1;
+    if (offset > buf->size || size > buf->size - offset) return -1;
+    if (!buf->cached || size == 0) return 0;
+
+    struct udma_pool *pool = buf->pool;
+    return pool_sync(pool, for_device ? pool->sync_for_device_fd : pool->sync_for_cpu_fd,
+                     for_device ? UDMA_DIR_TO_DEVICE : UDMA_DIR_FROM_DEVICE,
+                     buf->offset + offset, size);
+}
+
+/* Writes the CPU caches back, so the GPU sees the CPU writes and no line is evicted on top of its own */
+int udma_sync_for_device(const struct udma_buffer *buf, size_t offset, size_t size) {
+    return buffer_sync(buf, true, offset, size);
+}
+
+/* Drops the CPU cache lines of the range, so later reads fetch what the GPU wrote */
+int udma_sync_for_cpu(const struct udma_buffer *buf, size_t offset, size_t size) {
+    return buffer_sync(buf, false, offset, size);
+}
@@ -0,0 +1,427 @@
+"""Throughput benchmarks of the pipeline stages and of the whole GraphicsPipeline.
+
+Inputs are kept saturated, outputs are drained either every cycle or with random
+backpressure. Results are rates over the cycles from the first input to the last
+output, they are collected into ``--bench-output`` (see tests/conftest.py).
+
+Run with ``pytest tests/bench --run-bench [--bench-baseline old.json]``.
+"""
+
+import random
+import struct
+
+import pytest
+from amaranth import Module
+from amaranth.lib import wiring
+from amaranth.sim import Simulator
+
+from gpu.input_assembly.layouts import InputData, InputMode
+from gpu.pipeline import GraphicsPipeline
+from gpu.pixel_shading.cores import BlendFactor, BlendOp, StencilOp
+from gpu.rasterizer.cores import (
+    PerspectiveDivide,
+    PrimitiveClipper,
+    TrianglePrep,
+    TriangleRasterizer,
+)
+from gpu.utils import fixed
+from gpu.utils.layouts import num_lights, num_textures
+from gpu.utils.types import (
+    CompareOp,
+    CullFace,
+    FrontFace,
+    IndexKind,
+    InputTopology,
+    PrimitiveType,
+)
+from gpu.vertex_shading.cores import VertexShading
+from gpu.vertex_transform.cores import VertexTransform
+
+from ..utils.bench import record_throughput, stream_drain, stream_feed, throughput
+from ..utils.testbench import SimpleTestbench
+
+BACKPRESSURE = [1.0, 0.5]  # probability of the consumer being ready
+
+IDENTITY_4X4 = [1.0 if i % 5 == 0 else 0.0 for i in range(16)]
+IDENTITY_3X3 = [1.0 if i % 4 == 0 else 0.0 for i in range(9)]
+
+
+def make_fb_info(width: int, height: int, color_address=0, depthstencil_address=0):
+    return {
+        "width": width,
+        "height": height,
+        "viewport_x": 0.0,
+        "viewport_y": 0.0,
+        "viewport_width": float(width),
+        "viewport_height": float(height),
+        "viewport_min_depth": 0.0,
+        "viewport_max_depth": 1.0,
+        "scissor_offset_x": 0,
+        "scissor_offset_y": 0,
+        "scissor_width": width,
+        "scissor_height": height,
+        "color_address": color_address,
+        "color_pitch": width * 4,
+        "depthstencil_address": depthstencil_address,
+        "depthstencil_pitch": width * 4,
+    }
+
+
+def make_pa_vertex(pos, color):
+    return {
+        "position_ndc": pos,
+        "texcoords": [[0.0, 0.0, 0.0, 1.0] for _ in range(num_textures)],
+        "color": color,
+    }
+
+
+def grid_triangles(cells: int, z: float = 0.5) -> list[list[float]]:
+    """Triangles of a cells x cells grid of quads covering NDC, as corner positions."""
+    triangles = []
+    step = 2.0 / cells
+    for j in range(cells):
+        for i in range(cells):
+            x0, y0 = -1.0 + i * step, -1.0 + j * step
+            x1, y1 = x0 + step, y0 + step
+            triangles += [
+                [[x0, y0, z, 1.0], [x1, y0, z, 1.0], [x1, y1, z, 1.0]],
+                [[x0, y0, z, 1.0], [x1, y1, z, 1.0], [x0, y1, z, 1.0]],
+            ]
+    return triangles
+
+
+def config_shading(ctx, material, lights):
+    ctx.set(material.ambient, [0.2] * 3)
+    ctx.set(material.diffuse, [0.8] * 3)
+    ctx.set(material.specular, [0.0] * 3)
+    ctx.set(material.shininess, fixed.Const(1.0))
+    for light in lights:
+        ctx.set(light.position, [0.0, 0.0, 1.0, 0.0])
+        ctx.set(light.ambient, [0.2] * 3)
+        ctx.set(light.diffuse, [0.8] * 3)
+        ctx.set(light.specular, [0.0] * 3)
+
+
+@pytest.mark.bench
+@pytest.mark.parametrize("ready_probability", BACKPRESSURE)
+@pytest.mark.parametrize("enabled_lights", [0, 1, num_lights])
+@pytest.mark.parametrize("num_lanes", [1, num_lights])
+def test_bench_vertex_processing(
+    record_property, num_lanes: int, enabled_lights: int, ready_probability: float
+):
+    """VertexTransform and VertexShading, vertices/cycle"""
+    m = Module()
+    m.submodules.vtx_xf = vtx_xf = VertexTransform()
+    m.submodules.vtx_sh = vtx_sh = VertexShading(num_lights, num_lanes=num_lanes)
+    wiring.connect(m, vtx_xf.o, vtx_sh.i)
+
+    rng = random.Random(0)
+    num_vertices = 64
+    vertices = [
+        {
+            "position": [rng.uniform(-1, 1), rng.uniform(-1, 1), 0.5, 1.0],
+            "normal": [0.0, 0.0, 1.0],
+            "texcoords": [[0.0, 0.0, 0.0, 1.0] for _ in range(num_textures)],
+            "color": [1.0, 1.0, 1.0, 1.0],
+        }
+        for _ in range(num_vertices)
+    ]
+
+    inputs, outputs = [], []
+
+    async def feed(ctx):
+        ctx.set(vtx_xf.enabled.normal, 1)
+        ctx.set(vtx_xf.position_mv, IDENTITY_4X4)
+        ctx.set(vtx_xf.position_p, IDENTITY_4X4)
+        ctx.set(vtx_xf.normal_mv_inv_t, IDENTITY_3X3)
+        config_shading(ctx, vtx_sh.material, vtx_sh.lights)
+        ctx.set(vtx_sh.light_enable, (1 << enabled_lights) - 1)
+        await stream_feed(ctx, vtx_xf.i, vertices, inputs)
+
+    async def drain(ctx):
+        await stream_drain(
+            ctx, vtx_sh.o, outputs, num_vertices, ready_probability=ready_probability
+        )
+
+    sim = Simulator(m)
+    sim.add_clock(1e-6)
+    sim.add_testbench(feed)
+    sim.add_testbench(drain)
+    sim.run()
+
+    t = throughput(inputs, outputs)
+    record_throughput(
+        record_property,
+        vertices=num_vertices,
+        **t,
+        vertices_per_cycle=num_vertices / t["cycles"],
+    )
+
+
+@pytest.mark.bench
+@pytest.mark.parametrize("ready_probability", BACKPRESSURE)
+@pytest.mark.parametrize("workload", ["inside", "clipped"])
+def test_bench_clipper(record_property, workload: str, ready_probability: float):
+    """PrimitiveClipper, triangles/cycle (trivially accepted or crossing near)"""
+    dut = PrimitiveClipper()
+
+    rng = random.Random(0)
+    num_triangles = 32
+    vertices = []
+    for _ in range(num_triangles):
+        for k in range(3):
+            # the clipped workload has the first vertex of every triangle behind near
+            z = -1.5 if workload == "clipped" and k == 0 else rng.uniform(-0.5, 0.5)
+            pos = [rng.uniform(-0.8, 0.8), rng.uniform(-0.8, 0.8), z, 1.0]
+            vertices.append(make_pa_vertex(pos, [1.0, 1.0, 1.0, 1.0]))
+
+    inputs, outputs = [], []
+
+    async def feed(ctx):
+        ctx.set(dut.prim_type, PrimitiveType.TRIANGLES)
+        await stream_feed(ctx, dut.i, vertices, inputs)
+
+    async def drain(ctx):
+        await stream_drain(
+            ctx, dut.o, outputs, idle_for=2000, ready_probability=ready_probability
+        )
+
+    sim = Simulator(dut)
+    sim.add_clock(1e-6)
+    sim.add_testbench(feed)
+    sim.add_testbench(drain)
+    sim.run()
+
+    t = throughput(inputs, outputs)
+    record_throughput(
+        record_property,
+        triangles=num_triangles,
+        output_vertices=len(outputs),
+        **t,
+        triangles_per_cycle=num_triangles / t["cycles"],
+    )
+
+
+@pytest.mark.bench
+@pytest.mark.parametrize("ready_probability", BACKPRESSURE)
+@pytest.mark.parametrize("cells", [1, 16], ids=["large", "small"])
+@pytest.mark.parametrize("num_generators", [1, 4, 8])
+def test_bench_rasterizer(
+    record_property, num_generators: int, cells: int, ready_probability: float
+):
+    """PerspectiveDivide, TrianglePrep and TriangleRasterizer over a 64x64 target.
+
+    The same pixels are covered by 2 large triangles or 512 small ones (~8 pixels each).
+    """
+    m = Module()
+    m.submodules.div = div = PerspectiveDivide()
+    m.submodules.prep = prep = TrianglePrep()
+    m.submodules.rast = dut = TriangleRasterizer(num_generators=num_generators)
+    wiring.connect(m, div.o, prep.i)
+    wiring.connect(m, prep.o, dut.i)
+    t = SimpleTestbench(m)
+
+    fb_info = make_fb_info(64, 64)
+    triangles = grid_triangles(cells)
+    vertices = [
+        make_pa_vertex(pos, [1.0, 0.5, 0.25, 1.0]) for tri in triangles for pos in tri
+    ]
+
+    inputs, outputs = [], []
+
+    async def feed(ctx):
+        ctx.set(prep.fb_info, fb_info)
+        ctx.set(dut.fb_info, fb_info)
+        await stream_feed(ctx, div.i, vertices, inputs)
+
+    async def drain(ctx):
+        await stream_drain(
+            ctx, dut.o, outputs, idle_for=2000, ready_probability=ready_probability
+        )
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+    sim.add_testbench(feed)
+    sim.add_testbench(drain)
+    sim.run()
+
+    assert outputs, "No fragments generated"
+
+    tp = throughput(inputs, outputs)
+    record_throughput(
+        record_property,
+        triangles=len(triangles),
+        fragments=len(outputs),
+        **tp,
+        triangles_per_cycle=len(triangles) / tp["cycles"],
+        fragments_per_cycle=len(outputs) / tp["cycles"],
+    )
+
+
+SYNC_PERIOD = 1e-6
+PIXEL_PERIOD = 4e-7
+
+MEM_ADDR = 0x80000000
+FB_SIZE = 32
+VERTEX_BUFFER = MEM_ADDR
+COLOR_BUFFER = MEM_ADDR + 0x10000
+DEPTHSTENCIL_BUFFER = MEM_ADDR + 0x20000
+
+
+def build_grid_mesh(cells: int) -> tuple[bytes, int, int]:
+    """Indexed grid of quads covering NDC: (memory, index offset, index count)."""
+    vb = bytearray()
+    for j in range(cells + 1):
+        for i in range(cells + 1):
+            pos = [-1.0 + 2.0 * i / cells, -1.0 + 2.0 * j / cells, 0.5, 1.0]
+            for v in pos + [0.0, 0.0, 1.0] + [1.0, 1.0, 1.0, 1.0]:
+                vb += struct.pack("<i", int(v * 65536))
+
+    indices = []
+    for j in range(cells):
+        for i in range(cells):
+            a = j * (cells + 1) + i
+            b, c, d = a + 1, a + cells + 2, a + cells + 1
+            indices += [a, b, c, a, c, d]
+    return bytes(vb) + struct.pack(f"<{len(indices)}H", *indices), len(vb), len(indices)
+
+
+def config_pipeline(ctx, dut: GraphicsPipeline, idx_offset: int, idx_count: int):
+    stride = 44  # position xyzw, normal xyz, color rgba, SQ(16,16)
+
+    ctx.set(dut.c_index_address, VERTEX_BUFFER + idx_offset)
+    ctx.set(dut.c_index_count, idx_count)
+    ctx.set(dut.c_index_kind, IndexKind.U16)
+    ctx.set(dut.c_input_topology, InputTopology.TRIANGLE_LIST)
+    ctx.set(dut.c_vtx_cache_enable, 1)
+
+    for attr, offset in [(dut.c_pos, 0), (dut.c_norm, 16), (dut.c_col, 28)]:
+        ctx.set(attr.mode, InputMode.PER_VERTEX)
+        ctx.set(
+            attr.info,
+            InputData.const(
+                {"per_vertex": {"address": VERTEX_BUFFER + offset, "stride": stride}}
+            ),
+        )
+
+    ctx.set(dut.vt_enabled.normal, 1)
+    ctx.set(dut.position_mv, IDENTITY_4X4)
+    ctx.set(dut.position_p, IDENTITY_4X4)
+    ctx.set(dut.normal_mv_inv_t, IDENTITY_3X3)
+    config_shading(ctx, dut.material, dut.lights[:1])
+    ctx.set(dut.light_enable, 0b1)
+
+    ctx.set(dut.pa_conf.type, PrimitiveType.TRIANGLES)
+    ctx.set(dut.pa_conf.cull, CullFace.NONE)
+    ctx.set(dut.pa_conf.winding, FrontFace.CCW)
+
+    ctx.set(
+        dut.fb_info,
+        make_fb_info(FB_SIZE, FB_SIZE, COLOR_BUFFER, DEPTHSTENCIL_BUFFER),
+    )
+
+    ctx.set(dut.depth_conf.test_enabled, 1)
+    ctx.set(dut.depth_conf.write_enabled, 1)
+    ctx.set(dut.depth_conf.compare_op, CompareOp.LESS_OR_EQUAL)
+    for stencil_conf in [dut.stencil_conf_front, dut.stencil_conf_back]:
+        ctx.set(stencil_conf.compare_op, CompareOp.ALWAYS)
+        ctx.set(stencil_conf.mask, 0xFF)
+        ctx.set(stencil_conf.write_mask, 0xFF)
+        ctx.set(stencil_conf.pass_op, StencilOp.KEEP)
+        ctx.set(stencil_conf.fail_op, StencilOp.KEEP)
+        ctx.set(stencil_conf.depth_fail_op, StencilOp.KEEP)
+
+    ctx.set(dut.blend_conf.enabled, 0)
+    ctx.set(dut.blend_conf.src_factor, BlendFactor.ONE)
+    ctx.set(dut.blend_conf.dst_factor, BlendFactor.ZERO)
+    ctx.set(dut.blend_conf.src_a_factor, BlendFactor.ONE)
+    ctx.set(dut.blend_conf.dst_a_factor, BlendFactor.ZERO)
+    ctx.set(dut.blend_conf.blend_op, BlendOp.ADD)
+    ctx.set(dut.blend_conf.blend_a_op, BlendOp.ADD)
+    ctx.set(dut.blend_conf.color_write_mask, 0xF)
+
+
+@pytest.mark.bench
+@pytest.mark.parametrize("fifo_depth", [16, 256])
+@pytest.mark.parametrize("mem_latency", [0, 8, 32])
+def test_bench_pipeline(record_property, mem_latency: int, fifo_depth: int):
+    """GraphicsPipeline drawing an 8x8 quad grid over a 32x32 target.
+
+    Vertices and triangles are per sync cycle, fragments per pixel cycle, both over
+    the time from start until the pipeline is ready again.
+    """
+    dut = GraphicsPipeline(fifo_depth=fifo_depth)
+    t = SimpleTestbench(
+        dut, mem_addr=MEM_ADDR, mem_size=0x30000, mem_latency=mem_latency
+    )
+    t.arbiter.add(dut.wb_index)
+    t.arbiter.add(dut.wb_vertex)
+    t.arbiter.add(dut.wb_depthstencil)
+    t.arbiter.add(dut.wb_color)
+
+    memory, idx_offset, idx_count = build_grid_mesh(8)
+    result = {}
+
+    async def testbench(ctx):
+        await t.initialize_memory(ctx, VERTEX_BUFFER, memory)
+        await t.initialize_memory(
+            ctx, DEPTHSTENCIL_BUFFER, struct.pack("<I", 0xFFFF) * FB_SIZE * FB_SIZE
+        )
+        config_pipeline(ctx, dut, idx_offset, idx_count)
+        await ctx.tick().repeat(2)
+
+        ctx.set(dut.perf_reset, 1)
+        await ctx.tick()
+        ctx.set(dut.perf_reset, 0)
+        await ctx.tick().until(~dut.perf_pending)
+
+        ctx.set(dut.start, 1)
+        await ctx.tick()
+        ctx.set(dut.start, 0)
+        cycles = 1
+
+        # the ready signals lag behind start
+        await ctx.tick().repeat(4)
+        cycles += 4
+        async for _, _, ready in ctx.tick().sample(dut.ready):
+            cycles += 1
+            if ready:
+                break
+
+        ctx.set(dut.perf_snapshot, 1)
+        await ctx.tick()
+        ctx.set(dut.perf_snapshot, 0)
+        await ctx.tick().until(~dut.perf_pending)
+
+        perf = dut.perf
+        result["cycles"] = cycles
+        for name in [
+            "triangles_in",
+            "triangles_rasterized",
+            "fragments_generated",
+            "fragments_written",
+        ]:
+            result[name] = ctx.get(getattr(perf, name))
+        result["memory_wait_cycles"] = sum(
+            ctx.get(getattr(perf.bus, bus).wait_cycles)
+            for bus in ["index", "vertex", "depthstencil", "color"]
+        )
+
+    sim = Simulator(t)
+    sim.add_clock(SYNC_PERIOD)
+    sim.add_clock(PIXEL_PERIOD, domain="pixel")
+    sim.add_testbench(testbench)
+    sim.run()
+
+    assert result["fragments_written"] > 0, "Nothing was drawn"
+
+    cycles = result["cycles"]
+    pixel_cycles = cycles * SYNC_PERIOD / PIXEL_PERIOD
+    record_throughput(
+        record_property,
+        vertices=idx_count,
+        **result,
+        vertices_per_cycle=idx_count / cycles,
+        triangles_per_cycle=result["triangles_in"] / cycles,
+        fragments_per_cycle=result["fragments_written"] / pixel_cycles,
+    )
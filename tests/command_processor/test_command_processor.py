@@ -0,0 +1,198 @@
+from amaranth import *
+from amaranth.sim import Simulator
+
+from gpu.command_processor.cores import CommandProcessor
+from gpu.command_processor.layouts import CommandOpcode
+from tests.utils.testbench import SimpleTestbench
+
+
+LIST_ADDR = 0x80000200
+
+
+def header(opcode: CommandOpcode, arg: int) -> int:
+    return opcode.value | (arg << 16)
+
+
+def words_to_bytes(words: list[int]) -> bytes:
+    return b"".join(w.to_bytes(4, "little") for w in words)
+
+
+def make_test_command_processor(
+    ring: list[int],
+    wptr: int,
+    expected_writes: list[tuple[int, int]],
+    rptr: int = 0,
+    ready_components: int = 0b1111,
+    list_words: list[int] | None = None,
+):
+    ring_addr = 0x80000000
+    ring_size = len(ring) * 4
+
+    dut = CommandProcessor()
+    t = SimpleTestbench(dut, mem_addr=ring_addr, mem_size=1024)
+
+    t.arbiter.add(dut.bus)
+
+    writes = []
+
+    async def tb(ctx):
+        await t.initialize_memory(ctx, ring_addr, words_to_bytes(ring))
+        if list_words:
+            await t.initialize_memory(ctx, LIST_ADDR, words_to_bytes(list_words))
+
+        ctx.set(dut.ready_components, ready_components)
+        ctx.set(dut.c_base, ring_addr)
+        ctx.set(dut.c_size, ring_size)
+        ctx.set(dut.c_wptr, 0)
+        ctx.set(dut.enable, 1)
+        await ctx.tick()
+
+        if rptr != 0:
+            # move the read pointer by publishing (and consuming) NOPs up to `rptr`
+            ctx.set(dut.c_wptr, rptr)
+            await ctx.tick().until(dut.ready & (dut.rptr == rptr))
+
+        ctx.set(dut.c_wptr, wptr)
+        await ctx.tick().repeat(2)
+        await ctx.tick().until(dut.ready)
+
+        assert ctx.get(dut.rptr) == wptr
+        assert writes == expected_writes, f"{writes} != {expected_writes}"
+
+    async def csr_target(ctx):
+        async for _, _, cyc, stb, adr, dat_w in ctx.tick().sample(
+            dut.csr_bus.cyc, dut.csr_bus.stb, dut.csr_bus.adr, dut.csr_bus.dat_w
+        ):
+            ctx.set(dut.csr_bus.ack, 0)
+            if cyc and stb and not ctx.get(dut.csr_bus.ack):
+                writes.append((adr * 4, dat_w))
+                ctx.set(dut.csr_bus.ack, 1)
+
+    sim = Simulator(t)
+    sim.add_clock(1e-9)
+    sim.add_testbench(tb)
+    sim.add_process(csr_target)
+
+    try:
+        sim.run_until(1e-5)
+    except Exception:
+        sim.reset()
+
+        with sim.write_vcd(
+            "test_command_processor.vcd",
+            "test_command_processor.gtkw",
+            traces=dut,
+        ):
+            sim.run_until(1e-5)
+        raise
+
+
+def test_write_regs():
+    ring = [
+        header(CommandOpcode.WRITE_REGS, 3),
+        0x40,
+        1,
+        2,
+        3,
+    ] + [0] * 11
+    make_test_command_processor(
+        ring=ring,
+        wptr=5 * 4,
+        expected_writes=[(0x40, 1), (0x44, 2), (0x48, 3)],
+    )
+
+
+def test_nop_and_wait():
+    ring = [
+        header(CommandOpcode.NOP, 2),
+        0xDEAD,
+        0xBEEF,
+        header(CommandOpcode.WAIT_READY, 0b0011),
+        header(CommandOpcode.WRITE_REGS, 1),
+        0x10,
+        0x1234,
+    ] + [0] * 9
+    make_test_command_processor(
+        ring=ring,
+        wptr=7 * 4,
+        expected_writes=[(0x10, 0x1234)],
+    )
+
+
+def test_wrap_around():
+    # header and offset at the end of the ring, data words after the wrap
+    # (the leading words decode as unknown opcodes with no payload while rptr is advanced)
+    ring = [0xA, 0xB] + [0] * 12 + [header(CommandOpcode.WRITE_REGS, 2), 0x20]
+    make_test_command_processor(
+        ring=ring,
+        rptr=14 * 4,
+        wptr=2 * 4,
+        expected_writes=[(0x20, 0xA), (0x24, 0xB)],
+    )
+
+
+def test_call_list():
+    list_words = [
+        header(CommandOpcode.WRITE_REGS, 2),
+        0x30,
+        5,
+        6,
+        # nested calls are skipped
+        header(CommandOpcode.CALL, 2),
+        LIST_ADDR,
+        4 * 4,
+        header(CommandOpcode.WAIT_READY, 0b0001),
+    ]
+    ring = [
+        header(CommandOpcode.WRITE_REGS, 1),
+        0x10,
+        1,
+        header(CommandOpcode.CALL, 2),
+        LIST_ADDR,
+        len(list_words) * 4,
+        header(CommandOpcode.CALL, 2),
+        LIST_ADDR,
+        4 * 4,
+        header(CommandOpcode.WRITE_REGS, 1),
+        0x14,
+        2,
+    ] + [0] * 4
+    make_test_command_processor(
+        ring=ring,
+        wptr=12 * 4,
+        expected_writes=[
+            (0x10, 1),
+            (0x30, 5),
+            (0x34, 6),
+            (0x30, 5),
+            (0x34, 6),
+            (0x14, 2),
+        ],
+        list_words=list_words,
+    )
+
+
+def test_call_list_misaligned_size():
+    # the list ends after its partial last word instead of running past it
+    list_words = [
+        header(CommandOpcode.WRITE_REGS, 1),
+        0x30,
+        5,
+        header(CommandOpcode.WRITE_REGS, 1),
+        0x34,
+        6,
+    ]
+    ring = [
+        header(CommandOpcode.CALL, 2),
+        LIST_ADDR,
+        3 * 4 - 2,
+        header(CommandOpcode.WRITE_REGS, 1),
+        0x14,
+        2,
+    ] + [0] * 10
+    make_test_command_processor(
+        ring=ring,
+        wptr=6 * 4,
+        expected_writes=[(0x30, 5), (0x14, 2)],
+        list_words=list_words,
+    )
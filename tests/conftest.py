@@ -1,15 +1,79 @@
+import json
+
 import pytest
 
+# throughput results of the benchmarks, by test id
+bench_results: dict[str, dict] = {}
+
 
 def pytest_addoption(parser):
     parser.addoption("--run-slow", action="store_true", help="Run slow tests")
+    parser.addoption(
+        "--run-bench", action="store_true", help="Run throughput benchmarks"
+    )
+    parser.addoption(
+        "--bench-output",
+        default="bench_results.json",
+        help="File the benchmark results are written to",
+    )
+    parser.addoption(
+        "--bench-baseline",
+        default=None,
+        help="Earlier benchmark results to compare against",
+    )
 
 
 def pytest_collection_modifyitems(config, items):
-    if config.getoption("--run-slow"):
-        return
+    run_slow = config.getoption("--run-slow")
+    run_bench = config.getoption("--run-bench")
 
     skip_slow = pytest.mark.skip(reason="Skipping slow tests")
+    skip_bench = pytest.mark.skip(reason="Skipping benchmarks (run with '--run-bench')")
     for item in items:
-        if "slow" in item.keywords:
+        if "bench" in item.keywords:
+            if not run_bench:
+                item.add_marker(skip_bench)
+        elif "slow" in item.keywords and not run_slow:
             item.add_marker(skip_slow)
+
+
+def pytest_runtest_logreport(report):
+    # with xdist the controller receives the user properties of the workers' reports
+    if report.when == "call" and report.passed:
+        for key, value in report.user_properties:
+            if key == "bench":
+                bench_results[report.nodeid] = value
+
+
+def is_controller(config) -> bool:
+    return not hasattr(config, "workerinput")
+
+
+def pytest_sessionfinish(session):
+    if not bench_results or not is_controller(session.config):
+        return
+
+    with open(session.config.getoption("--bench-output"), "w") as f:
+        json.dump(dict(sorted(bench_results.items())), f, indent=2)
+        f.write("\n")
+
+
+def pytest_terminal_summary(terminalreporter, config):
+    baseline_file = config.getoption("--bench-baseline")
+    if not bench_results or not baseline_file or not is_controller(config):
+        return
+
+    with open(baseline_file) as f:
+        baseline = json.load(f)
+
+    terminalreporter.section("throughput vs. baseline")
+    for test, metrics in sorted(bench_results.items()):
+        old = baseline.get(test)
+        if old is None:
+            terminalreporter.write_line(f"{test}: new")
+            continue
+        changes = []
+        for key, value in metrics.items():
+            if key.endswith("_per_cycle") and old.get(key):
+                changes.append(f"{key} {100.0 * (value / old[key] - 1.0):+.1f}%")
+        terminalreporter.write_line(f"{test}: {', '.join(changes)}")
@@ -13,6 +13,8 @@ def make_test_index_generator(
     kind: IndexKind,
     memory_data: bytes,
     expected: list[int],
+    draw_count: int = 0,
+    expected_draws: list[tuple[int, int]] | None = None,
 ):
     dut = IndexGenerator()
     t = SimpleTestbench(dut, mem_addr=0x80000000, mem_size=1024)
@@ -25,13 +27,25 @@ def make_test_index_generator(
         ctx.set(dut.c_address, addr)
         ctx.set(dut.c_count, count)
         ctx.set(dut.c_kind, kind)
+        ctx.set(dut.c_draw_count, draw_count)
 
         ctx.set(dut.start, 1)
         await ctx.tick()
         ctx.set(dut.start, 0)
 
+    draws = []
+
+    async def draws_sink(ctx):
+        ctx.set(dut.draws.ready, 1)
+        async for _, _, valid, n, base_vertex in ctx.tick().sample(
+            dut.draws.valid, dut.draws.payload.count, dut.draws.payload.base_vertex
+        ):
+            if valid:
+                draws.append((n, base_vertex))
+
     sim = Simulator(t)
     sim.add_clock(1e-9)
+    sim.add_process(draws_sink)
     stream_testbench(
         sim,
         init_process=tb,
@@ -50,6 +64,9 @@ def make_test_index_generator(
         ):
             sim.run()
 
+    expected_draws = expected_draws or []
+    assert draws == expected_draws, f"{draws} != {expected_draws}"
+
 
 def test_not_indexed():
     make_test_index_generator(
@@ -113,3 +130,42 @@ def test_indexed_u16_unaligned():
         memory_data=b"".join((i.to_bytes(2, "little") for i in [2, 3, 4, 5, 1, 0])),
         expected=[2, 3, 4, 5, 1, 0],
     )
+
+
+def test_multi_draw():
+    records_addr = 0x80000000
+    index_addr = 0x80000100
+
+    records = [
+        (index_addr + 0, 3, 0),  # U16 indices 0..2
+        (index_addr + 6, 0, 7),  # empty draw is skipped
+        (index_addr + 6, 4, 10),  # unaligned start
+    ]
+    records_data = b"".join(
+        w.to_bytes(4, "little") for record in records for w in record
+    )
+    index_data = b"".join(i.to_bytes(2, "little") for i in [5, 6, 7, 1, 2, 3, 4])
+
+    make_test_index_generator(
+        addr=records_addr,
+        count=0,
+        kind=IndexKind.U16,
+        memory_data=records_data
+        + bytes(index_addr - records_addr - len(records_data))
+        + index_data,
+        expected=[5, 6, 7, 1, 2, 3, 4],
+        draw_count=len(records),
+        expected_draws=[(3, 0), (4, 10)],
+    )
+
+
+def test_indexed_u16_bursts():
+    # unaligned start, then several aligned bursts of the prefetcher
+    indices = [(i * 7) % 251 for i in range(75)]
+    make_test_index_generator(
+        addr=0x80000006,
+        count=len(indices),
+        kind=IndexKind.U16,
+        memory_data=b"".join(i.to_bytes(2, "little") for i in indices),
+        expected=indices,
+    )
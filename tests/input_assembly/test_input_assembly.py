@@ -1,9 +1,11 @@
+import struct
+
 import pytest
 from amaranth import *
 from amaranth.sim import Simulator
 
 from gpu.input_assembly.cores import InputAssembly
-from gpu.input_assembly.layouts import InputData, InputMode
+from gpu.input_assembly.layouts import ComponentType, InputData, InputMode
 from gpu.utils.layouts import num_textures
 from gpu.utils.types import Vector4_mem
 
@@ -181,3 +183,92 @@ def test_input_assembly_single_component(test_name, comp, comp_in, separation):
         expected=expected,
         **v,
     )
+
+
+def test_input_assembly_packed_formats():
+    # interleaved vertex: S16 xyz position (w defaults to 1.0), 2 bytes padding, RGBA8 color
+    vertices = [
+        ((-3, 7, 100), (51, 102, 0, 255)),
+        ((1, -2, 3), (255, 0, 51, 102)),
+    ]
+    memory_data = b"".join(struct.pack("<3hxx4B", *pos, *col) for pos, col in vertices)
+
+    def per_vertex(offset, type, normalized, size):
+        return InputData.const(
+            {
+                "per_vertex": {
+                    "address": 0x80000000 + offset,
+                    "stride": 12,
+                    "format": {"type": type, "normalized": normalized, "size": size},
+                }
+            }
+        )
+
+    expected = [
+        {
+            "position": [float(c) for c in pos] + [1.0],
+            "normal": [0.0, 0.0, 0.0],
+            "texcoords": [[0.0, 0.0, 0.0, 1.0] for _ in range(num_textures)],
+            "color": [c / 255 for c in col],
+        }
+        for pos, col in (vertices[1], vertices[0], vertices[1])
+    ]
+
+    make_test_input_assembly(
+        test_name="test_input_assembly_packed_formats",
+        addr=0x80000000,
+        memory_data=memory_data,
+        input_idx=[1, 0, 1],
+        expected=expected,
+        pos_mode=InputMode.PER_VERTEX,
+        pos_data=per_vertex(0, ComponentType.S16, 0, 3),
+        color_mode=InputMode.PER_VERTEX,
+        color_data=per_vertex(8, ComponentType.U8, 1, 0),
+    )
+
+
+def test_input_assembly_packed_stream_skip():
+    # packed attributes (stride == size) are streamed: skipped vertices inside the
+    # prefetch window are dropped, going back or jumping past it restarts the stream
+    vertex_count = 12
+    col_offset = 0x100
+    positions = [[float(i), i + 0.5, -float(i), 1.0] for i in range(vertex_count)]
+    colors = [(i * 10, 255 - i * 10, i, 255) for i in range(vertex_count)]
+
+    memory_data = b"".join(
+        Vector4_mem.const(pos).as_bits().to_bytes(16, "little") for pos in positions
+    )
+    memory_data = memory_data.ljust(col_offset, b"\x00") + b"".join(
+        bytes(col) for col in colors
+    )
+
+    input_idx = [0, 1, 3, 2, 4, 10, 11, 11]
+    expected = [
+        {
+            "position": positions[i],
+            "normal": [0.0, 0.0, 0.0],
+            "texcoords": [[0.0, 0.0, 0.0, 1.0] for _ in range(num_textures)],
+            "color": [c / 255 for c in colors[i]],
+        }
+        for i in input_idx
+    ]
+
+    make_test_input_assembly(
+        test_name="test_input_assembly_packed_stream_skip",
+        addr=0x80000000,
+        memory_data=memory_data,
+        input_idx=input_idx,
+        expected=expected,
+        pos_mode=InputMode.PER_VERTEX,
+        pos_data=InputData.const({"per_vertex": {"address": 0x80000000, "stride": 16}}),
+        color_mode=InputMode.PER_VERTEX,
+        color_data=InputData.const(
+            {
+                "per_vertex": {
+                    "address": 0x80000000 + col_offset,
+                    "stride": 4,
+                    "format": {"type": ComponentType.U8, "normalized": 1, "size": 4},
+                }
+            }
+        ),
+    )
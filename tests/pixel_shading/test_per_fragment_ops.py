@@ -7,20 +7,28 @@ from gpu.pixel_shading import (
     BlendFactor,
     BlendOp,
     DepthStencilTest,
+    FastClear,
+    HierarchicalZ,
     StencilOp,
     SwapchainOutput,
+    TextureCache,
+    TextureEnvMode,
+    TextureFilter,
+    TextureWrap,
+    Texturing,
+    TileCache,
 )
 from gpu.utils.layouts import num_textures
-from gpu.utils.types import CompareOp
+from gpu.utils.types import ColorFormat, CompareOp, DepthStencilFormat
 
 from ..utils.streams import stream_testbench
 from ..utils.testbench import SimpleTestbench
 
 
-def make_fragment(x, y, depth, color, front_facing=1):
+def make_fragment(x, y, depth, color, front_facing=1, texcoord=(0.0, 0.0)):
     return {
         "depth": depth,
-        "texcoords": [[0.0, 0.0, 0.0, 1.0] for _ in range(num_textures)],
+        "texcoords": [[*texcoord, 0.0, 1.0] for _ in range(num_textures)],
         "color": color,
         "coord_pos": [x, y],
         "front_facing": front_facing,
@@ -420,6 +428,84 @@ def test_depth_stencil_stencil_write_mask():
     )
 
 
+def test_depth_test_d16():
+    """D16 pixel pairs share a word; without stencil the stencil test passes."""
+    dut = DepthStencilTest()
+    t = SimpleTestbench(dut, mem_size=4096, mem_addr=0)
+    t.arbiter.add(dut.wb_bus)
+
+    fb_info = make_fb_info()
+    fb_info.update(
+        depthstencil_pitch=fb_info["width"] * 2,
+        depthstencil_format=DepthStencilFormat.D16,
+    )
+
+    # would reject every fragment with a stencil buffer
+    stencil_conf = {
+        "compare_op": CompareOp.NEVER,
+        "pass_op": StencilOp.KEEP,
+        "fail_op": StencilOp.KEEP,
+        "depth_fail_op": StencilOp.KEEP,
+        "reference": 0,
+        "mask": 0xFF,
+        "write_mask": 0xFF,
+    }
+
+    depth_conf = {
+        "test_enabled": 1,
+        "write_enabled": 1,
+        "compare_op": CompareOp.LESS,
+    }
+
+    fragments = [
+        make_fragment(1, 0, 0.25, [0.2, 0.2, 0.2, 1.0]),
+        make_fragment(0, 0, 0.75, [0.2, 0.2, 0.2, 1.0]),
+        make_fragment(3, 1, 0.5, [0.2, 0.2, 0.2, 1.0]),
+        make_fragment(1, 0, 0.5, [0.2, 0.2, 0.2, 1.0]),  # occluded
+    ]
+
+    def quantize(depth):
+        return round(depth * ((1 << 16) - 1))
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def init_proc(ctx):
+        await t.initialize_memory(
+            ctx, fb_info["depthstencil_address"], b"\xff\xff" * (8 * 8)
+        )
+        ctx.set(t.dut.fb_info, fb_info)
+        ctx.set(t.dut.stencil_conf_front, stencil_conf)
+        ctx.set(t.dut.stencil_conf_back, stencil_conf)
+        ctx.set(t.dut.depth_conf, depth_conf)
+
+    async def check_output(ctx, results):
+        assert len(results) == 3
+        pitch = fb_info["depthstencil_pitch"]
+        mem = await t.dbg_access.read_bytes(
+            ctx, fb_info["depthstencil_address"], 2 * pitch
+        )
+        stored = [int.from_bytes(mem[i : i + 2], "little") for i in range(0, 32, 2)]
+
+        assert stored[0] == quantize(0.75)
+        assert stored[1] == quantize(0.25)
+        assert stored[2] == 0xFFFF
+        assert stored[8 + 3] == quantize(0.5)
+        assert stored[8 + 2] == 0xFFFF
+
+    stream_testbench(
+        sim,
+        input_stream=dut.i,
+        input_data=fragments,
+        output_stream=dut.o,
+        output_data_checker=check_output,
+        init_process=init_proc,
+        idle_for=1000,
+    )
+
+    sim.run()
+
+
 # Test cases for SwapchainOutput blending operations
 SWAPCHAIN_TEST_CASES = [
     pytest.param(
@@ -581,3 +667,575 @@ def test_swapchain_output(blend_conf, fragments, expected_color, dst_color):
     )
 
     sim.run()
+
+
+def test_swapchain_output_rgb565():
+    """R5G6B5 pixels are half words; a partial write mask keeps components."""
+    dut = SwapchainOutput()
+    t = SimpleTestbench(dut, mem_size=4096, mem_addr=0)
+    t.arbiter.add(dut.wb_bus)
+    fb_info = make_fb_info()
+    fb_info.update(
+        color_pitch=fb_info["width"] * 2,
+        color_format=ColorFormat.R5G6B5,
+    )
+
+    initial = 0x1234
+    blend_conf = {
+        "src_factor": BlendFactor.ONE,
+        "dst_factor": BlendFactor.ZERO,
+        "src_a_factor": BlendFactor.ONE,
+        "dst_a_factor": BlendFactor.ZERO,
+        "enabled": 0,
+        "blend_op": BlendOp.ADD,
+        "blend_a_op": BlendOp.ADD,
+        "color_write_mask": 0xF,
+    }
+    fragments = [
+        make_fragment(1, 0, 0.5, [1.0, 0.5, 0.0, 1.0]),
+        make_fragment(2, 1, 0.5, [0.0, 1.0, 1.0, 1.0]),
+    ]
+
+    def pack(r, g, b):
+        return (round(r * 31) << 11) | (round(g * 63) << 5) | round(b * 31)
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def tb(ctx):
+        await t.initialize_memory(
+            ctx, fb_info["color_address"], initial.to_bytes(2, "little") * (8 * 8)
+        )
+        ctx.set(dut.fb_info, fb_info)
+
+        async def draw(fragment, mask):
+            ctx.set(dut.conf, {**blend_conf, "color_write_mask": mask})
+            ctx.set(dut.i.payload, fragment)
+            ctx.set(dut.i.valid, 1)
+            await ctx.tick().until(dut.i.ready)
+            ctx.set(dut.i.valid, 0)
+            await ctx.tick().until(dut.ready)
+
+        await draw(fragments[0], 0xF)
+        await draw(fragments[1], 0b1010)  # green and alpha only
+
+        mem = await t.dbg_access.read_bytes(ctx, fb_info["color_address"], 32)
+        stored = [int.from_bytes(mem[i : i + 2], "little") for i in range(0, 32, 2)]
+
+        assert stored[0] == initial
+        assert stored[1] == pack(1.0, 0.5, 0.0)
+        assert stored[2] == initial
+        assert stored[8 + 2] == (initial & ~0x07E0) | pack(0.0, 1.0, 0.0)
+        assert stored[8 + 3] == initial
+
+    sim.add_testbench(tb)
+    sim.run()
+
+
+@pytest.mark.parametrize("clear_stencil", [False, True])
+def test_fast_clear_scissor(clear_stencil):
+    """Clear color and depth inside the scissor, stencil is preserved unless cleared."""
+    dut = FastClear()
+    t = SimpleTestbench(dut, mem_size=4096, mem_addr=0)
+    t.arbiter.add(dut.wb_color)
+    t.arbiter.add(dut.wb_depthstencil)
+
+    fb_info = make_fb_info()
+    fb_info.update(
+        scissor_offset_x=2,
+        scissor_offset_y=3,
+        scissor_width=4,
+        scissor_height=2,
+    )
+    width, height = fb_info["width"], fb_info["height"]
+
+    initial_color = 0x11223344
+    initial_ds = 0x05001234
+    clear_color = 0xAABBCCDD
+    clear_ds = 0x7F00FFFF
+
+    def inside(x, y):
+        return 2 <= x < 6 and 3 <= y < 5
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def tb(ctx):
+        await t.initialize_memory(
+            ctx,
+            fb_info["color_address"],
+            initial_color.to_bytes(4, "little") * (width * height),
+        )
+        await t.initialize_memory(
+            ctx,
+            fb_info["depthstencil_address"],
+            initial_ds.to_bytes(4, "little") * (width * height),
+        )
+
+        ctx.set(dut.fb_info, fb_info)
+        ctx.set(
+            dut.conf,
+            {
+                "flags": {
+                    "color_enable": 1,
+                    "depth_enable": 1,
+                    "stencil_mask": 0xFF if clear_stencil else 0x00,
+                },
+                "color": clear_color,
+                "depthstencil": clear_ds,
+            },
+        )
+        ctx.set(dut.start, 1)
+        await ctx.tick()
+        ctx.set(dut.start, 0)
+        await ctx.tick().until(dut.done)
+
+        color_mem = await t.dbg_access.read_bytes(
+            ctx, fb_info["color_address"], width * height * 4
+        )
+        ds_mem = await t.dbg_access.read_bytes(
+            ctx, fb_info["depthstencil_address"], width * height * 4
+        )
+
+        expected_ds = clear_ds if clear_stencil else (initial_ds & 0xFF000000) | (clear_ds & 0xFFFF)
+        for y in range(height):
+            for x in range(width):
+                i = (y * width + x) * 4
+                color = int.from_bytes(color_mem[i : i + 4], "little")
+                ds = int.from_bytes(ds_mem[i : i + 4], "little")
+                if inside(x, y):
+                    assert color == clear_color, (x, y)
+                    assert ds == expected_ds, (x, y)
+                else:
+                    assert color == initial_color, (x, y)
+                    assert ds == initial_ds, (x, y)
+
+    sim.add_testbench(tb)
+    sim.run()
+
+
+def test_fast_clear_16bit_formats():
+    """R5G6B5 and D16 clears preserve the pixels sharing a word outside the scissor."""
+    dut = FastClear()
+    t = SimpleTestbench(dut, mem_size=4096, mem_addr=0)
+    t.arbiter.add(dut.wb_color)
+    t.arbiter.add(dut.wb_depthstencil)
+
+    fb_info = make_fb_info()
+    fb_info.update(
+        color_pitch=fb_info["width"] * 2,
+        depthstencil_pitch=fb_info["width"] * 2,
+        color_format=ColorFormat.R5G6B5,
+        depthstencil_format=DepthStencilFormat.D16,
+        scissor_offset_x=1,
+        scissor_offset_y=2,
+        scissor_width=4,
+        scissor_height=3,
+    )
+    width, height = fb_info["width"], fb_info["height"]
+
+    initial = 0x1111
+    clear_color = 0xF81F
+    clear_depth = 0xBEEF
+
+    def inside(x, y):
+        return 1 <= x < 5 and 2 <= y < 5
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def tb(ctx):
+        for address in [fb_info["color_address"], fb_info["depthstencil_address"]]:
+            await t.initialize_memory(
+                ctx, address, initial.to_bytes(2, "little") * (width * height)
+            )
+
+        ctx.set(dut.fb_info, fb_info)
+        ctx.set(
+            dut.conf,
+            {
+                "flags": {"color_enable": 1, "depth_enable": 1, "stencil_mask": 0xFF},
+                "color": clear_color,
+                "depthstencil": 0xFF000000 | clear_depth,
+            },
+        )
+        ctx.set(dut.start, 1)
+        await ctx.tick()
+        ctx.set(dut.start, 0)
+        await ctx.tick().until(dut.done)
+
+        for address, value in [
+            (fb_info["color_address"], clear_color),
+            (fb_info["depthstencil_address"], clear_depth),
+        ]:
+            mem = await t.dbg_access.read_bytes(ctx, address, width * height * 2)
+            for y in range(height):
+                for x in range(width):
+                    i = (y * width + x) * 2
+                    stored = int.from_bytes(mem[i : i + 2], "little")
+                    assert stored == (value if inside(x, y) else initial), (x, y)
+
+    sim.add_testbench(tb)
+    sim.run()
+
+
+def test_hierarchical_z_clear_and_refine():
+    """Tile bounds are set by clears and only lowered once a tile is fully covered."""
+    dut = HierarchicalZ(max_width=16, max_height=16)
+
+    sim = Simulator(dut)
+    sim.add_clock(1e-6)
+
+    async def query(ctx, tx, ty):
+        ctx.set(dut.query, {"tx": tx, "ty": ty})
+        await ctx.tick()
+        return ctx.get(dut.bound)
+
+    async def report(ctx, x, y, depth):
+        ctx.set(dut.update, {"valid": 1, "x": x, "y": y, "depth": depth})
+        await ctx.tick()
+        ctx.set(dut.update.valid, 0)
+        await ctx.tick()  # written back
+
+    async def tb(ctx):
+        # nothing is tracked before the first depth clear
+        assert await query(ctx, 0, 0) == 0xFFFF
+
+        ctx.set(dut.c_enable, 1)
+        ctx.set(
+            dut.clear,
+            {
+                "x0": 0,
+                "y0": 0,
+                "x1": 12,
+                "y1": 16,
+                "depth": 0x8000,
+                "address": 0x100,
+                "pitch": 64,
+            },
+        )
+        ctx.set(dut.clear_start, 1)
+        await ctx.tick()
+        ctx.set(dut.clear_start, 0)
+        await ctx.tick().until(~dut.busy)
+
+        assert ctx.get(dut.buffer.valid)
+        assert await query(ctx, 0, 0) == 0x80FF
+        assert await query(ctx, 0, 1) == 0x80FF
+        # partially cleared tile of a buffer that was not tracked yet
+        assert await query(ctx, 1, 0) == 0xFFFF
+        # out of the tracked area
+        assert await query(ctx, 2, 0) == 0xFFFF
+
+        # covering all but one pixel keeps the bound
+        for y in range(8):
+            for x in range(8):
+                if (x, y) != (7, 7):
+                    await report(ctx, x, y, 0x2000 + x)
+        assert await query(ctx, 0, 0) == 0x80FF
+
+        # the last pixel refines it to the largest depth reported
+        await report(ctx, 7, 7, 0x1000)
+        assert await query(ctx, 0, 0) == 0x20FF
+
+        # reports above the bound raise it
+        await report(ctx, 8, 8, 0x9000)
+        assert await query(ctx, 1, 1) == 0xFFFF
+        await report(ctx, 0, 3, 0x9000)
+        assert await query(ctx, 0, 0) == 0x90FF
+
+    sim.add_testbench(tb)
+    sim.run()
+
+
+def test_tile_cache_write_back():
+    """Writes stay in the cache until evicted or flushed, reads see them."""
+    dut = TileCache(num_lines=4)
+    t = SimpleTestbench(dut, mem_size=4096, mem_addr=0)
+    t.arbiter.add(dut.mem_bus)
+
+    num_words = 1024
+    initial = [0x1000 + i for i in range(num_words)]
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def access(ctx, adr, data=None):
+        ctx.set(dut.bus.adr, adr)
+        ctx.set(dut.bus.we, data is not None)
+        ctx.set(dut.bus.dat_w, data or 0)
+        ctx.set(dut.bus.sel, ~0)
+        ctx.set(dut.bus.cyc, 1)
+        ctx.set(dut.bus.stb, 1)
+        await ctx.tick().until(dut.bus.ack)
+        value = ctx.get(dut.bus.dat_r)
+        ctx.set(dut.bus.cyc, 0)
+        ctx.set(dut.bus.stb, 0)
+        await ctx.tick()
+        return value
+
+    async def tb(ctx):
+        await t.initialize_memory(
+            ctx, 0, b"".join(v.to_bytes(4, "little") for v in initial)
+        )
+
+        # more lines than the cache holds, every other one dirty
+        written = {}
+        for line in range(10):
+            adr = line * 16 + line % 8
+            assert await access(ctx, adr) == initial[adr]
+            if line % 2 == 0:
+                written[adr] = 0xA000 + line
+                await access(ctx, adr, written[adr])
+
+        for adr in range(0, 160):
+            assert await access(ctx, adr) == written.get(adr, initial[adr]), adr
+
+        assert ctx.get(dut.misses) < ctx.get(dut.lookups)
+
+        ctx.set(dut.flush, 1)
+        await ctx.tick()
+        ctx.set(dut.flush, 0)
+        await ctx.tick().until(dut.clean)
+        await ctx.tick().repeat(4 + 2 * 4)  # scan finished
+
+        mem = await t.dbg_access.read_bytes(ctx, 0, 160 * 4)
+        for adr in range(160):
+            value = int.from_bytes(mem[adr * 4 : adr * 4 + 4], "little")
+            assert value == written.get(adr, initial[adr]), adr
+
+    sim.add_testbench(tb)
+    sim.run()
+
+
+def texel_offset(x, y, width_log2):
+    """Word offset of texel (x, y) in the 4x4 tiled texture layout."""
+    tile = ((y >> 2) << max(width_log2 - 2, 0)) | (x >> 2)
+    return (tile << 4) | ((y & 3) << 2) | (x & 3)
+
+
+def texel_color(x, y):
+    return [x * 32, y * 32, 0x80, 0xF0]
+
+
+# texel (x, y) of the 8x8 test texture is (x * 32, y * 32, 0x80, 0xF0)
+texturing_test_cases = [
+    pytest.param(
+        {
+            "filter": TextureFilter.NEAREST,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.REPLACE,
+        },
+        (2.5 / 8, 5.5 / 8),
+        [0.3, 0.3, 0.3, 0.3],
+        [64, 160, 0x80, 0xF0],
+        id="nearest",
+    ),
+    pytest.param(
+        {
+            "filter": TextureFilter.LINEAR,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.REPLACE,
+        },
+        (6.5 / 8, 1.5 / 8),
+        [0.3, 0.3, 0.3, 0.3],
+        [192, 32, 0x80, 0xF0],
+        id="linear_texel_center",
+    ),
+    pytest.param(
+        {
+            "filter": TextureFilter.NEAREST,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.REPLACE,
+        },
+        (-4.5 / 8, 15.5 / 8),
+        [0.3, 0.3, 0.3, 0.3],
+        [96, 224, 0x80, 0xF0],
+        id="repeat",
+    ),
+    pytest.param(
+        {
+            "filter": TextureFilter.NEAREST,
+            "wrap_s": TextureWrap.CLAMP_TO_EDGE,
+            "wrap_t": TextureWrap.CLAMP_TO_EDGE,
+            "env_mode": TextureEnvMode.REPLACE,
+        },
+        (1.5, -0.5),
+        [0.3, 0.3, 0.3, 0.3],
+        [224, 0, 0x80, 0xF0],
+        id="clamp_to_edge",
+    ),
+    # halfway between columns 3 and 4 (different tiles) and rows 1 and 2
+    pytest.param(
+        {
+            "filter": TextureFilter.LINEAR,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.REPLACE,
+        },
+        (4.0 / 8, 2.0 / 8),
+        [0.3, 0.3, 0.3, 0.3],
+        [112, 48, 0x80, 0xF0],
+        id="linear_across_tiles",
+    ),
+    # the footprint wraps around to column 7
+    pytest.param(
+        {
+            "filter": TextureFilter.LINEAR,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.REPLACE,
+        },
+        (0.0, 0.5 / 8),
+        [0.3, 0.3, 0.3, 0.3],
+        [112, 0, 0x80, 0xF0],
+        id="linear_repeat_edge",
+    ),
+    pytest.param(
+        {
+            "filter": TextureFilter.NEAREST,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.MODULATE,
+        },
+        (4.5 / 8, 4.5 / 8),
+        [0.5, 1.0, 0.25, 0.5],
+        [64, 128, 32, 0x78],
+        id="modulate",
+    ),
+    pytest.param(
+        {
+            "filter": TextureFilter.NEAREST,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.DECAL,
+        },
+        (0.5 / 8, 0.5 / 8),
+        [1.0, 1.0, 1.0, 0.25],
+        [15, 15, 0x87, 0x40],
+        id="decal",
+    ),
+    pytest.param(
+        {
+            "filter": TextureFilter.NEAREST,
+            "wrap_s": TextureWrap.REPEAT,
+            "wrap_t": TextureWrap.REPEAT,
+            "env_mode": TextureEnvMode.ADD,
+        },
+        (1.5 / 8, 1.5 / 8),
+        [0.5, 0.5, 0.75, 0.5],
+        [160, 160, 255, 0x78],
+        id="add",
+    ),
+]
+
+
+@pytest.mark.parametrize(
+    "tex_conf, texcoord, color, expected", texturing_test_cases
+)
+def test_texturing(tex_conf, texcoord, color, expected):
+    dut = Texturing()
+    t = SimpleTestbench(dut, mem_size=4096, mem_addr=0)
+    t.arbiter.add(dut.bus)
+
+    width_log2 = height_log2 = 3
+    tex_address = 0x400
+
+    texture = bytearray(4 << (width_log2 + height_log2))
+    for y in range(1 << height_log2):
+        for x in range(1 << width_log2):
+            r, g, b, a = texel_color(x, y)
+            offset = texel_offset(x, y, width_log2) * 4
+            texture[offset : offset + 4] = bytes([b, g, r, a])
+
+    fragments = [make_fragment(0, 0, 0.5, color, texcoord=texcoord)]
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def init_proc(ctx):
+        await t.initialize_memory(ctx, tex_address, bytes(texture))
+        ctx.set(
+            dut.conf,
+            {
+                "enabled": 1,
+                "width_log2": width_log2,
+                "height_log2": height_log2,
+                **tex_conf,
+            },
+        )
+        ctx.set(dut.address, tex_address)
+
+    async def check_output(ctx, results):
+        assert len(results) == 1
+        got = [c.as_float() * 255 for c in results[0].color]
+        assert got == pytest.approx(expected, abs=1.5)
+
+    stream_testbench(
+        sim,
+        input_stream=dut.i,
+        input_data=fragments,
+        output_stream=dut.o,
+        output_data_checker=check_output,
+        init_process=init_proc,
+        idle_for=200,
+    )
+
+    sim.run()
+
+
+def test_texture_cache_hits():
+    """Repeated reads within a tile hit, a set holds as many tiles as it has ways."""
+    dut = TextureCache(num_sets=2, num_ways=2)
+    t = SimpleTestbench(dut, mem_size=4096, mem_addr=0)
+    t.arbiter.add(dut.mem_bus)
+
+    num_words = 1024
+    initial = [0x5000 + i for i in range(num_words)]
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def read(ctx, adr):
+        ctx.set(dut.bus.adr, adr)
+        ctx.set(dut.bus.we, 0)
+        ctx.set(dut.bus.cyc, 1)
+        ctx.set(dut.bus.stb, 1)
+        await ctx.tick().until(dut.bus.ack)
+        value = ctx.get(dut.bus.dat_r)
+        ctx.set(dut.bus.cyc, 0)
+        ctx.set(dut.bus.stb, 0)
+        await ctx.tick()
+        return value
+
+    async def tb(ctx):
+        await t.initialize_memory(
+            ctx, 0, b"".join(v.to_bytes(4, "little") for v in initial)
+        )
+
+        # lines 0 and 2 share set 0, 1 goes to set 1; fills start at the missed word
+        for adr in [5, 0, 15, 16 + 3, 32 + 7, 32, 1, 31]:
+            assert await read(ctx, adr) == initial[adr], adr
+        assert ctx.get(dut.lookups) == 8
+        assert ctx.get(dut.misses) == 3
+
+        # line 4 evicts line 0 (round-robin), 2 stays
+        assert await read(ctx, 64) == initial[64]
+        assert await read(ctx, 33) == initial[33]
+        assert await read(ctx, 2) == initial[2]
+        assert ctx.get(dut.misses) == 5
+
+        # invalidated lines are refetched, memory written around the cache is seen
+        await t.dbg_access.write(ctx, 33 * 4, [0xBEEF])
+        ctx.set(dut.invalidate, 1)
+        await ctx.tick()
+        ctx.set(dut.invalidate, 0)
+        await ctx.tick()
+        assert await read(ctx, 33) == 0xBEEF
+        assert ctx.get(dut.misses) == 6
+
+    sim.add_testbench(tb)
+    sim.run()
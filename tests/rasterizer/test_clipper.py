@@ -424,3 +424,190 @@ def test_clipper_interpolation():
     )
 
     sim.run()
+
+
+@pytest.mark.parametrize(
+    "test_name,guard_band,input_vertices,expected_count,expected_counters",
+    [
+        # Crosses +x, but stays within the 2x guard band: forwarded as is
+        (
+            "guard_band_accept_2x",
+            1,
+            [
+                make_vertex(0.0, 0.5, 0.0),
+                make_vertex(1.5, 0.0, 0.0),
+                make_vertex(0.0, 0.0, 0.0),
+            ],
+            1,
+            (0, 1, 0),
+        ),
+        # Same triangle with the guard band disabled is clipped
+        (
+            "guard_band_disabled",
+            0,
+            [
+                make_vertex(0.0, 0.5, 0.0),
+                make_vertex(1.5, 0.0, 0.0),
+                make_vertex(0.0, 0.0, 0.0),
+            ],
+            2,
+            (0, 0, 1),
+        ),
+        # Outside the 2x guard band, inside the 4x one
+        (
+            "guard_band_accept_4x",
+            2,
+            [
+                make_vertex(0.0, 0.5, 0.0),
+                make_vertex(-3.0, -3.5, 0.0),
+                make_vertex(0.0, 0.0, 0.0),
+            ],
+            1,
+            (0, 1, 0),
+        ),
+        # Near plane crossings are always clipped
+        (
+            "guard_band_near_plane",
+            2,
+            [
+                make_vertex(0.0, 0.5, 0.0),
+                make_vertex(0.2, 0.0, -3.0),
+                make_vertex(0.0, 0.0, 0.0),
+            ],
+            2,
+            (0, 0, 1),
+        ),
+        # Fully inside is counted as trivial accept
+        (
+            "guard_band_trivial",
+            2,
+            [
+                make_vertex(0.0, 0.0, 0.0),
+                make_vertex(0.5, 0.0, 0.0),
+                make_vertex(0.0, 0.5, 0.0),
+            ],
+            1,
+            (1, 0, 0),
+        ),
+    ],
+)
+def test_clipper_guard_band(
+    test_name, guard_band, input_vertices, expected_count, expected_counters
+):
+    """Test guard band acceptance and the clipper counters."""
+    dut = PrimitiveClipper()
+
+    async def output_checker(ctx, results):
+        assert len(results) % 3 == 0, "Output vertex count not multiple of 3"
+        assert (
+            len(results) // 3 == expected_count
+        ), f"{test_name}: expected {expected_count} triangles, got {len(results) // 3}"
+
+        gb_w = float(1 << guard_band)
+        for v in results:
+            x, y, z, w = [p.as_float() for p in v.position_ndc]
+            assert -gb_w * w - 0.001 <= x <= gb_w * w + 0.001
+            assert -gb_w * w - 0.001 <= y <= gb_w * w + 0.001
+            assert -w - 0.001 <= z <= w + 0.001
+
+        counters = (
+            ctx.get(dut.trivial_accepts),
+            ctx.get(dut.guard_band_accepts),
+            ctx.get(dut.clipped),
+        )
+        assert counters == expected_counters, f"{test_name}: counters {counters}"
+
+    async def init_process(ctx):
+        ctx.set(dut.prim_type, PrimitiveType.TRIANGLES)
+        ctx.set(dut.guard_band, guard_band)
+
+    sim = Simulator(dut)
+    sim.add_clock(1e-6)
+
+    stream_testbench(
+        sim,
+        input_stream=dut.i,
+        input_data=input_vertices,
+        output_stream=dut.o,
+        output_data_checker=output_checker,
+        init_process=init_process,
+        idle_for=3000,
+    )
+
+    sim.run()
+
+
+@pytest.mark.parametrize(
+    "test_name,viewport_width,input_vertices,expected_counters",
+    [
+        # Inside the 2x guard band, which still fits a 1000 pixel viewport
+        (
+            "guard_band_2x_wide_viewport",
+            1000.0,
+            [
+                make_vertex(0.0, 0.5, 0.0),
+                make_vertex(1.5, 0.0, 0.0),
+                make_vertex(0.0, 0.0, 0.0),
+            ],
+            (0, 1, 0),
+        ),
+        # Needs the 4x guard band, which would leave the screen coordinate range
+        (
+            "guard_band_4x_wide_viewport",
+            1000.0,
+            [
+                make_vertex(0.0, 0.5, 0.0),
+                make_vertex(-3.0, -3.5, 0.0),
+                make_vertex(0.0, 0.0, 0.0),
+            ],
+            (0, 0, 1),
+        ),
+        # Same triangle with a viewport that fits the 4x guard band
+        (
+            "guard_band_4x_small_viewport",
+            640.0,
+            [
+                make_vertex(0.0, 0.5, 0.0),
+                make_vertex(-3.0, -3.5, 0.0),
+                make_vertex(0.0, 0.0, 0.0),
+            ],
+            (0, 1, 0),
+        ),
+    ],
+)
+def test_clipper_guard_band_viewport_limit(
+    test_name, viewport_width, input_vertices, expected_counters
+):
+    """The guard band is narrowed to what the viewport's screen coordinates fit."""
+    dut = PrimitiveClipper()
+
+    async def output_checker(ctx, results):
+        assert len(results) % 3 == 0, "Output vertex count not multiple of 3"
+
+        counters = (
+            ctx.get(dut.trivial_accepts),
+            ctx.get(dut.guard_band_accepts),
+            ctx.get(dut.clipped),
+        )
+        assert counters == expected_counters, f"{test_name}: counters {counters}"
+
+    async def init_process(ctx):
+        ctx.set(dut.prim_type, PrimitiveType.TRIANGLES)
+        ctx.set(dut.guard_band, 2)
+        ctx.set(dut.fb_info.viewport_width, viewport_width)
+        ctx.set(dut.fb_info.viewport_height, viewport_width * 3 / 4)
+
+    sim = Simulator(dut)
+    sim.add_clock(1e-6)
+
+    stream_testbench(
+        sim,
+        input_stream=dut.i,
+        input_data=input_vertices,
+        output_stream=dut.o,
+        output_data_checker=output_checker,
+        init_process=init_process,
+        idle_for=3000,
+    )
+
+    sim.run()
@@ -11,6 +11,7 @@ from gpu.input_assembly.cores import (
     InputTopologyProcessor,
 )
 from gpu.input_assembly.layouts import InputData, InputMode
+from gpu.pixel_shading import StencilOp
 from gpu.rasterizer.cores import (
     PerspectiveDivide,
     PrimitiveClipper,
@@ -19,6 +20,7 @@ from gpu.rasterizer.cores import (
 )
 from gpu.utils.layouts import num_lights, num_textures
 from gpu.utils.types import (
+    CompareOp,
     IndexKind,
     InputTopology,
     PrimitiveType,
@@ -173,6 +175,7 @@ def test_clip_to_perspective_divide_colors():
         ctx.set(vtx_sh.lights[0].ambient, [1.0, 1.0, 1.0])
         ctx.set(vtx_sh.lights[0].diffuse, [0.0, 0.0, 0.0])
         ctx.set(vtx_sh.lights[0].specular, [0.0, 0.0, 0.0])
+        ctx.set(vtx_sh.light_enable, 0b1)
 
         ctx.set(clip.prim_type, PrimitiveType.TRIANGLES)
 
@@ -653,3 +656,235 @@ def test_rasterizer_two_overlapping_triangles(alpha: bool):
     visualizer.generate_ppm_image(file)
     stats = visualizer.generate_statistics(fragments)
     print("Rasterization statistics:", stats)
+
+
+def test_rasterizer_early_z():
+    """Pixels behind the depth buffer are rejected before interpolation"""
+    m = Module()
+    m.submodules.div = div = PerspectiveDivide()
+    m.submodules.prep = prep = TrianglePrep()
+    m.submodules.rast = dut = TriangleRasterizer(num_generators=2)
+    wiring.connect(m, div.o, prep.i)
+    wiring.connect(m, prep.o, dut.i)
+    t = SimpleTestbench(m)
+    t.arbiter.add(dut.ds_bus)
+
+    fb_width = 16
+    fb_height = 16
+    fb_info = {
+        "width": fb_width,
+        "height": fb_height,
+        "viewport_x": 0.0,
+        "viewport_y": 0.0,
+        "viewport_width": float(fb_width),
+        "viewport_height": float(fb_height),
+        "viewport_min_depth": 0.0,
+        "viewport_max_depth": 1.0,
+        "scissor_offset_x": 0,
+        "scissor_offset_y": 0,
+        "scissor_width": fb_width,
+        "scissor_height": fb_height,
+        "color_address": 0,
+        "color_pitch": fb_width * 4,
+        "depthstencil_address": t.mem_addr,
+        "depthstencil_pitch": fb_width * 4,
+    }
+
+    stencil_conf = {
+        "compare_op": CompareOp.ALWAYS,
+        "pass_op": StencilOp.KEEP,
+        "fail_op": StencilOp.KEEP,
+        "depth_fail_op": StencilOp.KEEP,
+        "reference": 0,
+        "mask": 0xFF,
+        "write_mask": 0xFF,
+    }
+
+    depth_conf = {
+        "test_enabled": 1,
+        "write_enabled": 1,
+        "compare_op": CompareOp.LESS,
+    }
+
+    # Left half of the depth buffer is at the near plane, right half at the far one
+    depth_buffer = b"".join(
+        (0 if x < fb_width // 2 else 0xFFFF).to_bytes(4, "little")
+        for y in range(fb_height)
+        for x in range(fb_width)
+    )
+
+    triangle = [
+        make_pa_vertex([-0.75, -0.75, 0.5, 1.0], [1.0, 1.0, 1.0, 1.0]),
+        make_pa_vertex([0.75, -0.75, 0.5, 1.0], [1.0, 1.0, 1.0, 1.0]),
+        make_pa_vertex([0.0, 0.75, 0.5, 1.0], [1.0, 1.0, 1.0, 1.0]),
+    ]
+
+    async def check_output(ctx, results):
+        assert len(results) > 0
+        assert all(f.coord_pos[0] >= fb_width // 2 for f in results)
+        assert ctx.get(dut.early_z_rejects) > 0
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def init_proc(ctx):
+        await t.initialize_memory(ctx, t.mem_addr, depth_buffer)
+        ctx.set(prep.fb_info, fb_info)
+        ctx.set(dut.fb_info, fb_info)
+        ctx.set(dut.stencil_conf_front, stencil_conf)
+        ctx.set(dut.stencil_conf_back, stencil_conf)
+        ctx.set(dut.depth_conf, depth_conf)
+        ctx.set(dut.pixel_drained, 1)
+
+    stream_testbench(
+        sim,
+        init_process=init_proc,
+        input_stream=div.i,
+        input_data=triangle,
+        output_stream=dut.o,
+        output_data_checker=check_output,
+        idle_for=10000,
+    )
+
+    sim.run()
+
+
+def test_rasterizer_pixel_order():
+    """Fragments of a pixel keep triangle order with several triangles in flight"""
+    m = Module()
+    m.submodules.div = div = PerspectiveDivide()
+    m.submodules.prep = prep = TrianglePrep()
+    m.submodules.rast = dut = TriangleRasterizer(num_generators=4)
+    wiring.connect(m, div.o, prep.i)
+    wiring.connect(m, prep.o, dut.i)
+    t = SimpleTestbench(m)
+
+    fb_width = 16
+    fb_height = 16
+    fb_info = {
+        "width": fb_width,
+        "height": fb_height,
+        "viewport_x": 0.0,
+        "viewport_y": 0.0,
+        "viewport_width": float(fb_width),
+        "viewport_height": float(fb_height),
+        "viewport_min_depth": 0.0,
+        "viewport_max_depth": 1.0,
+        "scissor_offset_x": 0,
+        "scissor_offset_y": 0,
+        "scissor_width": fb_width,
+        "scissor_height": fb_height,
+        "color_address": 0,
+        "color_pitch": fb_width * 4,
+    }
+
+    # Small triangles over the same few pixels, told apart by their red channel
+    num_triangles = 6
+    triangles = []
+    for i in range(num_triangles):
+        color = [i / 8, 0.0, 0.0, 1.0]
+        shift = (i % 2) * 0.125
+        triangles += [
+            make_pa_vertex([-0.5 + shift, -0.5, 0.5, 1.0], color),
+            make_pa_vertex([0.25 + shift, -0.5, 0.5, 1.0], color),
+            make_pa_vertex([-0.5 + shift, 0.25, 0.5, 1.0], color),
+        ]
+
+    async def check_output(ctx, results):
+        assert len(results) > 0
+        per_pixel = {}
+        for f in results:
+            pos = (int(f.coord_pos[0]), int(f.coord_pos[1]))
+            per_pixel.setdefault(pos, []).append(round(f.color[0].as_float() * 8))
+
+        for pos, order in per_pixel.items():
+            assert order == sorted(order), f"pixel {pos} out of order: {order}"
+        assert max(len(order) for order in per_pixel.values()) == num_triangles
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def init_proc(ctx):
+        ctx.set(prep.fb_info, fb_info)
+        ctx.set(dut.fb_info, fb_info)
+
+    stream_testbench(
+        sim,
+        init_process=init_proc,
+        input_stream=div.i,
+        input_data=triangles,
+        output_stream=dut.o,
+        output_data_checker=check_output,
+        idle_for=10000,
+    )
+
+    sim.run()
+
+
+def test_rasterizer_coarse_blocks():
+    """Blocks of a thin diagonal triangle's bounding box outside it are skipped"""
+    m = Module()
+    m.submodules.div = div = PerspectiveDivide()
+    m.submodules.prep = prep = TrianglePrep()
+    m.submodules.rast = dut = TriangleRasterizer(num_generators=4)
+    wiring.connect(m, div.o, prep.i)
+    wiring.connect(m, prep.o, dut.i)
+    t = SimpleTestbench(m)
+
+    fb_width = 32
+    fb_height = 32
+    fb_info = {
+        "width": fb_width,
+        "height": fb_height,
+        "viewport_x": 0.0,
+        "viewport_y": 0.0,
+        "viewport_width": float(fb_width),
+        "viewport_height": float(fb_height),
+        "viewport_min_depth": 0.0,
+        "viewport_max_depth": 1.0,
+        "scissor_offset_x": 0,
+        "scissor_offset_y": 0,
+        "scissor_width": fb_width,
+        "scissor_height": fb_height,
+        "color_address": 0,
+        "color_pitch": fb_width * 4,
+    }
+
+    triangle = [
+        make_pa_vertex([-0.9, -0.9, 0.5, 1.0], [1.0, 1.0, 1.0, 1.0]),
+        make_pa_vertex([-0.7, -0.9, 0.5, 1.0], [1.0, 1.0, 1.0, 1.0]),
+        make_pa_vertex([0.9, 0.9, 0.5, 1.0], [1.0, 1.0, 1.0, 1.0]),
+    ]
+
+    async def check_output(ctx, results):
+        assert len(results) > 0
+        pixels = [(int(f.coord_pos[0]), int(f.coord_pos[1])) for f in results]
+        assert len(set(pixels)) == len(pixels), "pixel rasterized twice"
+
+        # every row of a triangle is a single span, skipped blocks may not cut it
+        rows = {}
+        for x, y in pixels:
+            rows.setdefault(y, []).append(x)
+        for y, xs in rows.items():
+            assert max(xs) - min(xs) + 1 == len(xs), f"row {y} has a gap: {xs}"
+
+        assert ctx.get(dut.coarse_rejects) > 0
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+
+    async def init_proc(ctx):
+        ctx.set(prep.fb_info, fb_info)
+        ctx.set(dut.fb_info, fb_info)
+
+    stream_testbench(
+        sim,
+        init_process=init_proc,
+        input_stream=div.i,
+        input_data=triangle,
+        output_stream=dut.o,
+        output_data_checker=check_output,
+        idle_for=10000,
+    )
+
+    sim.run()
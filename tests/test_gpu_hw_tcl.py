@@ -0,0 +1,92 @@
+"""
+Check that the Platform Designer component description in quartus/gpu_hw.tcl
+matches the ports of the generated graphics_pipeline_avalon_csr.sv.
+
+The SystemVerilog is generated at build time from GraphicsPipelineAvalonCSR, so
+the port list is compared against its signature instead of the netlist.
+"""
+
+import pathlib
+import shlex
+
+import pytest
+from amaranth.hdl import Shape
+from amaranth.lib.wiring import In, Out
+
+from gpu.pipeline import GraphicsPipelineAvalonCSR
+
+TCL_PATH = pathlib.Path(__file__).resolve().parents[1] / "quartus" / "gpu_hw.tcl"
+
+# Clock and reset ports added by the Verilog backend
+CLOCK_RESET_PORTS = {
+    "clk": ("Input", 1),
+    "rst": ("Input", 1),
+    "pixel_clk": ("Input", 1),
+    "pixel_rst": ("Input", 1),
+}
+
+
+def read_tcl() -> list[list[str]]:
+    """Return the tcl commands as lists of words."""
+    commands = []
+    for line in TCL_PATH.read_text().splitlines():
+        line = line.strip()
+        if line and not line.startswith("#"):
+            commands.append(shlex.split(line))
+    return commands
+
+
+def tcl_ports() -> dict[str, tuple[str, int]]:
+    """Map each port in add_interface_port to its (direction, width)."""
+    return {
+        cmd[2]: (cmd[4], int(cmd[5]))
+        for cmd in read_tcl()
+        if cmd[0] == "add_interface_port"
+    }
+
+
+def interface_properties(interface: str) -> dict[str, str]:
+    """Return the set_interface_property values of an interface."""
+    return {
+        cmd[2]: cmd[3]
+        for cmd in read_tcl()
+        if cmd[0] == "set_interface_property" and cmd[1] == interface
+    }
+
+
+def signature_ports() -> dict[str, tuple[str, int]]:
+    """Map each top level Verilog port of GraphicsPipelineAvalonCSR to its
+    (direction, width)."""
+    dut = GraphicsPipelineAvalonCSR()
+    ports = dict(CLOCK_RESET_PORTS)
+    for path, member in dut.signature.members.flatten():
+        if not member.is_port:
+            continue
+        direction = {In: "Input", Out: "Output"}[member.flow]
+        ports["__".join(path)] = (direction, Shape.cast(member.shape).width)
+    return ports
+
+
+def test_tcl_ports_match_signature():
+    assert tcl_ports() == signature_ports()
+
+
+@pytest.mark.parametrize(
+    "interface,clock,reset",
+    [
+        ("avl_index", "clock", "reset"),
+        ("avl_vertex", "clock", "reset"),
+        ("avl_color", "pixel_clock", "pixel_reset"),
+        ("avl_depthstencil", "pixel_clock", "pixel_reset"),
+    ],
+)
+def test_tcl_burst_masters(interface, clock, reset):
+    props = interface_properties(interface)
+    assert props["associatedClock"] == clock
+    assert props["associatedReset"] == reset
+    assert props["burstcountUnits"] == "WORDS"
+    assert props["linewrapBursts"] == "false"
+
+    ports = tcl_ports()
+    assert ports[f"{interface}__burstcount"] == ("Output", 5)
+    assert ports[f"{interface}__readdatavalid"] == ("Input", 1)
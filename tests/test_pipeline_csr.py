@@ -0,0 +1,181 @@
+"""
+Fence and interrupt registers of GraphicsPipelineCSR, driven through the host CSR bus.
+
+The draws are non-indexed with constant attributes and the framebuffer has an empty
+scissor, so they only keep the pipeline busy without touching memory.
+"""
+
+import pytest
+from amaranth import *
+from amaranth.sim import Simulator
+
+from gpu.pipeline import GraphicsPipelineCSR
+from gpu.utils.types import InputTopology
+from tests.utils.testbench import SimpleTestbench
+
+IRQ_RETIRED = 1 << 4
+
+# long enough for the second draw to still be in flight when the first retires
+DRAW_VERTICES = 48
+
+
+def csr_addresses(dut: GraphicsPipelineCSR) -> dict[str, int]:
+    """Map dotted register names to word addresses of ``wb_csr``."""
+    addresses = {}
+    for ri in dut.wb_csr.memory_map.all_resources():
+        name = ".".join(n for p in ri.path for n in p)
+        addresses[name] = ri.start
+    return addresses
+
+
+def make_pipeline_csr_sim(retire_holdoff: int = 4):
+    dut = GraphicsPipelineCSR(retire_holdoff=retire_holdoff)
+    t = SimpleTestbench(dut, mem_size=1024)
+
+    t.arbiter.add(dut.wb_index)
+    t.arbiter.add(dut.wb_vertex)
+    t.arbiter.add(dut.wb_depthstencil)
+    t.arbiter.add(dut.wb_color)
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+    sim.add_clock(4e-7, domain="pixel")
+
+    # the memory map of wb_csr is only known once the design has been elaborated
+    addresses = csr_addresses(dut)
+    bus = dut.wb_csr
+
+    async def write(ctx, name, value):
+        ctx.set(bus.adr, addresses[name])
+        ctx.set(bus.dat_w, value)
+        ctx.set(bus.sel, ~0)
+        ctx.set(bus.we, 1)
+        ctx.set(bus.cyc, 1)
+        ctx.set(bus.stb, 1)
+        await ctx.tick().until(bus.ack)
+        ctx.set(bus.cyc, 0)
+        ctx.set(bus.stb, 0)
+        ctx.set(bus.we, 0)
+        await ctx.tick()
+
+    async def read(ctx, name):
+        ctx.set(bus.adr, addresses[name])
+        ctx.set(bus.sel, ~0)
+        ctx.set(bus.we, 0)
+        ctx.set(bus.cyc, 1)
+        ctx.set(bus.stb, 1)
+        while True:
+            _, _, ack, value = await ctx.tick().sample(bus.ack, bus.dat_r)
+            if ack:
+                break
+        ctx.set(bus.cyc, 0)
+        ctx.set(bus.stb, 0)
+        await ctx.tick()
+        return value
+
+    return dut, sim, read, write
+
+
+async def configure_draws(ctx, write, count: int):
+    await write(ctx, "topo.input_topology", InputTopology.TRIANGLE_LIST.value)
+    await write(ctx, "idx.count", count)
+
+
+async def wait_until(ctx, read, name, mask=~0, limit=5000):
+    """Polls register ``name`` until one of the ``mask`` bits is set."""
+    for _ in range(limit):
+        if await read(ctx, name) & mask:
+            return
+    raise AssertionError(f"{name} did not become ready")
+
+
+@pytest.mark.slow
+def test_fence_retires_per_draw():
+    dut, sim, read, write = make_pipeline_csr_sim()
+
+    async def testbench(ctx):
+        await configure_draws(ctx, write, DRAW_VERTICES)
+
+        # back to back draws, the second one is queued as soon as input assembly
+        # accepts it
+        for _ in range(2):
+            await wait_until(ctx, read, "ready_components", mask=0b0001)
+            await write(ctx, "idx.start", 1)
+        assert await read(ctx, "fence.issued") == 2
+
+        # the first draw retires while the second one is still in flight
+        seen = []
+        for _ in range(5000):
+            retired = await read(ctx, "fence.retired")
+            ready = await read(ctx, "ready")
+            seen.append((retired, ready))
+            if ready and retired == 2:
+                break
+        assert (1, 0) in seen, seen
+        assert [r for r, _ in seen] == sorted(r for r, _ in seen)
+        assert seen[-1] == (2, 1)
+
+    sim.add_testbench(testbench)
+    sim.run()
+
+
+@pytest.mark.slow
+def test_fence_irq_write_1_to_clear():
+    dut, sim, read, write = make_pipeline_csr_sim()
+
+    async def testbench(ctx):
+        await configure_draws(ctx, write, DRAW_VERTICES)
+        await write(ctx, "irq.enable", IRQ_RETIRED)
+        await write(ctx, "irq.status", 0x1F)
+        assert not ctx.get(dut.irq)
+
+        await write(ctx, "idx.start", 1)
+        await wait_until(ctx, read, "ready")
+        assert await read(ctx, "fence.retired") == 1
+        assert await read(ctx, "irq.status") & IRQ_RETIRED
+        assert ctx.get(dut.irq)
+
+        # writing 0 keeps the status, writing 1 clears it
+        await write(ctx, "irq.status", 0)
+        assert ctx.get(dut.irq)
+        await write(ctx, "irq.status", IRQ_RETIRED)
+        assert not await read(ctx, "irq.status") & IRQ_RETIRED
+        assert not ctx.get(dut.irq)
+
+        # clears retire like draws
+        await write(ctx, "clear.start", 1)
+        await wait_until(ctx, read, "ready")
+        assert await read(ctx, "fence.issued") == 2
+        assert await read(ctx, "fence.retired") == 2
+        assert ctx.get(dut.irq)
+
+    sim.add_testbench(testbench)
+    sim.run()
+
+
+@pytest.mark.slow
+def test_fence_start_during_holdoff():
+    # longer than the empty draw takes to pass, so the second start arrives in it
+    dut, sim, read, write = make_pipeline_csr_sim(retire_holdoff=256)
+
+    async def testbench(ctx):
+        # an empty draw, immediately followed by a long one
+        await write(ctx, "idx.count", 0)
+        await write(ctx, "idx.start", 1)
+        await configure_draws(ctx, write, DRAW_VERTICES)
+        await wait_until(ctx, read, "ready_components", mask=0b0001)
+        await write(ctx, "idx.start", 1)
+        assert await read(ctx, "fence.issued") == 2
+
+        # the long draw is only retired once the pipeline has been ready
+        ready = 0
+        for _ in range(5000):
+            retired = await read(ctx, "fence.retired")
+            ready |= await read(ctx, "ready")
+            assert retired < 2 or ready
+            if retired == 2:
+                break
+        assert retired == 2
+
+    sim.add_testbench(testbench)
+    sim.run()
@@ -18,6 +18,7 @@ from gpu.utils import fixed
 from gpu.utils.types import (
     CompareOp,
     CullFace,
+    DepthStencilFormat,
     FrontFace,
     IndexKind,
     InputTopology,
@@ -148,15 +149,154 @@ COLOR_BUFFER = VB_MEM_ADDR + 0x00400000
 DEPTHSTENCIL_BUFFER = VB_MEM_ADDR + 0x00600000
 
 
+def configure_triangle_draw(
+    ctx,
+    dut: GraphicsPipeline,
+    geometry: tuple,
+    color_buffer: int = COLOR_BUFFER,
+    depthstencil_buffer: int = DEPTHSTENCIL_BUFFER,
+):
+    """Set the draw configuration of the RGB triangle from setup_triangle_geometry."""
+    idx_addr, idx_count, pos_addr, norm_addr, col_addr, stride, _ = geometry
+
+    # Configure index generator
+    ctx.set(dut.c_index_address, idx_addr)
+    ctx.set(dut.c_index_count, idx_count)
+    ctx.set(dut.c_index_kind, IndexKind.U16)
+
+    # Configure topology
+    ctx.set(dut.c_input_topology, InputTopology.TRIANGLE_LIST)
+    ctx.set(dut.c_primitive_restart_enable, 0)
+    ctx.set(dut.c_primitive_restart_index, 0)
+    ctx.set(dut.c_base_vertex, 0)
+
+    # Configure input assembly (per-vertex attributes)
+    # Position
+    ctx.set(dut.c_pos.mode, InputMode.PER_VERTEX)
+    ctx.set(
+        dut.c_pos.info,
+        InputData.const(
+            {
+                "per_vertex": {
+                    "address": pos_addr,
+                    "stride": stride,
+                }
+            }
+        ),
+    )
+
+    # Normal
+    ctx.set(dut.c_norm.mode, InputMode.PER_VERTEX)
+    ctx.set(
+        dut.c_norm.info,
+        InputData.const(
+            {
+                "per_vertex": {
+                    "address": norm_addr,
+                    "stride": stride,
+                }
+            }
+        ),
+    )
+
+    # Color
+    ctx.set(dut.c_col.mode, InputMode.PER_VERTEX)
+    ctx.set(
+        dut.c_col.info,
+        InputData.const(
+            {
+                "per_vertex": {
+                    "address": col_addr,
+                    "stride": stride,
+                }
+            }
+        ),
+    )
+
+    # Vertex transform: identity matrices
+    ctx.set(dut.vt_enabled.normal, 1)
+
+    # Identity 4x4 for position_mv
+    identity_4x4 = [1.0 if i % 5 == 0 else 0.0 for i in range(16)]
+    ctx.set(dut.position_mv, identity_4x4)
+
+    # Identity 4x4 for position_p
+    ctx.set(dut.position_p, identity_4x4)
+
+    # Identity 3x3 for normal_mv_inv_t
+    identity_3x3 = [1.0 if i % 4 == 0 else 0.0 for i in range(9)]
+    ctx.set(dut.normal_mv_inv_t, identity_3x3)
+
+    # Material: ambient=0.2, diffuse=0.8, specular=0.2, shininess=1.0
+    ctx.set(dut.material.ambient, [0.2] * 3)
+    ctx.set(dut.material.diffuse, [0.8] * 3)
+    ctx.set(dut.material.specular, [0.2] * 3)
+    ctx.set(dut.material.shininess, fixed.Const(1.0))
+
+    # Light 0: position=(0,0,1,1), ambient=0.2, diffuse=0.8, specular=0.2
+    ctx.set(dut.lights[0].position, [0.0, 0.0, 1.0, 1.0])
+    ctx.set(dut.lights[0].ambient, [0.2] * 3)
+    ctx.set(dut.lights[0].diffuse, [0.8] * 3)
+    ctx.set(dut.lights[0].specular, [0.2] * 3)
+    ctx.set(dut.light_enable, 0b1)
+
+    # Primitive assembly: TRIANGLES, no culling, CCW
+    ctx.set(dut.pa_conf.type, PrimitiveType.TRIANGLES)
+    ctx.set(dut.pa_conf.cull, CullFace.NONE)
+    ctx.set(dut.pa_conf.winding, FrontFace.CCW)
+
+    # Framebuffer: 640x480
+    ctx.set(dut.fb_info.width, FB_WIDTH)
+    ctx.set(dut.fb_info.height, FB_HEIGHT)
+    ctx.set(dut.fb_info.viewport_x, 0.0)
+    ctx.set(dut.fb_info.viewport_y, 0.0)
+    ctx.set(dut.fb_info.viewport_width, float(FB_WIDTH))
+    ctx.set(dut.fb_info.viewport_height, float(FB_HEIGHT))
+    ctx.set(dut.fb_info.viewport_min_depth, 0.0)
+    ctx.set(dut.fb_info.viewport_max_depth, 1.0)
+    ctx.set(dut.fb_info.scissor_offset_x, 0)
+    ctx.set(dut.fb_info.scissor_offset_y, 0)
+    ctx.set(dut.fb_info.scissor_width, FB_WIDTH)
+    ctx.set(dut.fb_info.scissor_height, FB_HEIGHT)
+    ctx.set(dut.fb_info.color_address, color_buffer)
+    ctx.set(dut.fb_info.color_pitch, FB_WIDTH * 4)
+    ctx.set(dut.fb_info.depthstencil_address, depthstencil_buffer)
+    ctx.set(dut.fb_info.depthstencil_pitch, FB_WIDTH * 4)
+
+    # Depth/stencil: disabled
+    ctx.set(dut.depth_conf.test_enabled, 0)
+    ctx.set(dut.depth_conf.write_enabled, 0)
+    ctx.set(dut.depth_conf.compare_op, CompareOp.ALWAYS)
+
+    # Stencil: compare=ALWAYS, masks=0xFF, ops=KEEP
+    for stencil_conf in [dut.stencil_conf_front, dut.stencil_conf_back]:
+        ctx.set(stencil_conf.compare_op, CompareOp.ALWAYS)
+        ctx.set(stencil_conf.reference, 0x00)
+        ctx.set(stencil_conf.mask, 0xFF)
+        ctx.set(stencil_conf.write_mask, 0xFF)
+        ctx.set(stencil_conf.pass_op, StencilOp.KEEP)
+        ctx.set(stencil_conf.fail_op, StencilOp.KEEP)
+        ctx.set(stencil_conf.depth_fail_op, StencilOp.KEEP)
+
+    # Blending: disabled (src=ONE, dst=ZERO)
+    ctx.set(dut.blend_conf.enabled, 0)
+    ctx.set(dut.blend_conf.src_factor, BlendFactor.ONE)
+    ctx.set(dut.blend_conf.dst_factor, BlendFactor.ZERO)
+    ctx.set(dut.blend_conf.src_a_factor, BlendFactor.ONE)
+    ctx.set(dut.blend_conf.dst_a_factor, BlendFactor.ZERO)
+    ctx.set(dut.blend_conf.blend_op, BlendOp.ADD)
+    ctx.set(dut.blend_conf.blend_a_op, BlendOp.ADD)
+    ctx.set(dut.blend_conf.color_write_mask, 0xF)
+
+
 @pytest.mark.slow
 def test_render_triangle():
     """
     Test rendering a single RGB triangle through the full pipeline.
     """
     # Memory setup
-    idx_addr, idx_count, pos_addr, norm_addr, col_addr, stride, vb_data = (
-        setup_triangle_geometry(VERTEX_BUFFER)
-    )
+    geometry = setup_triangle_geometry(VERTEX_BUFFER)
+    idx_addr, idx_count, pos_addr, norm_addr, col_addr, stride, vb_data = geometry
 
     # Create DUT with testbench infrastructure
     dut = GraphicsPipeline()
@@ -190,133 +330,7 @@ def test_render_triangle():
             f"  pos_addr=0x{pos_addr:08x}, norm_addr=0x{norm_addr:08x}, col_addr=0x{col_addr:08x}"
         )
 
-        # Configure index generator
-        ctx.set(dut.c_index_address, idx_addr)
-        ctx.set(dut.c_index_count, idx_count)
-        ctx.set(dut.c_index_kind, IndexKind.U16)
-
-        # Configure topology
-        ctx.set(dut.c_input_topology, InputTopology.TRIANGLE_LIST)
-        ctx.set(dut.c_primitive_restart_enable, 0)
-        ctx.set(dut.c_primitive_restart_index, 0)
-        ctx.set(dut.c_base_vertex, 0)
-
-        # Configure input assembly (per-vertex attributes)
-        # Position
-        ctx.set(dut.c_pos.mode, InputMode.PER_VERTEX)
-        ctx.set(
-            dut.c_pos.info,
-            InputData.const(
-                {
-                    "per_vertex": {
-                        "address": pos_addr,
-                        "stride": stride,
-                    }
-                }
-            ),
-        )
-
-        # Normal
-        ctx.set(dut.c_norm.mode, InputMode.PER_VERTEX)
-        ctx.set(
-            dut.c_norm.info,
-            InputData.const(
-                {
-                    "per_vertex": {
-                        "address": norm_addr,
-                        "stride": stride,
-                    }
-                }
-            ),
-        )
-
-        # Color
-        ctx.set(dut.c_col.mode, InputMode.PER_VERTEX)
-        ctx.set(
-            dut.c_col.info,
-            InputData.const(
-                {
-                    "per_vertex": {
-                        "address": col_addr,
-                        "stride": stride,
-                    }
-                }
-            ),
-        )
-
-        # Vertex transform: identity matrices
-        ctx.set(dut.vt_enabled.normal, 1)
-
-        # Identity 4x4 for position_mv
-        identity_4x4 = [1.0 if i % 5 == 0 else 0.0 for i in range(16)]
-        ctx.set(dut.position_mv, identity_4x4)
-
-        # Identity 4x4 for position_p
-        ctx.set(dut.position_p, identity_4x4)
-
-        # Identity 3x3 for normal_mv_inv_t
-        identity_3x3 = [1.0 if i % 4 == 0 else 0.0 for i in range(9)]
-        ctx.set(dut.normal_mv_inv_t, identity_3x3)
-
-        # Material: ambient=0.2, diffuse=0.8, specular=0.2, shininess=1.0
-        ctx.set(dut.material.ambient, [0.2] * 3)
-        ctx.set(dut.material.diffuse, [0.8] * 3)
-        ctx.set(dut.material.specular, [0.2] * 3)
-        ctx.set(dut.material.shininess, fixed.Const(1.0))
-
-        # Light 0: position=(0,0,1,1), ambient=0.2, diffuse=0.8, specular=0.2
-        ctx.set(dut.lights[0].position, [0.0, 0.0, 1.0, 1.0])
-        ctx.set(dut.lights[0].ambient, [0.2] * 3)
-        ctx.set(dut.lights[0].diffuse, [0.8] * 3)
-        ctx.set(dut.lights[0].specular, [0.2] * 3)
-
-        # Primitive assembly: TRIANGLES, no culling, CCW
-        ctx.set(dut.pa_conf.type, PrimitiveType.TRIANGLES)
-        ctx.set(dut.pa_conf.cull, CullFace.NONE)
-        ctx.set(dut.pa_conf.winding, FrontFace.CCW)
-
-        # Framebuffer: 640x480
-        ctx.set(dut.fb_info.width, FB_WIDTH)
-        ctx.set(dut.fb_info.height, FB_HEIGHT)
-        ctx.set(dut.fb_info.viewport_x, 0.0)
-        ctx.set(dut.fb_info.viewport_y, 0.0)
-        ctx.set(dut.fb_info.viewport_width, float(FB_WIDTH))
-        ctx.set(dut.fb_info.viewport_height, float(FB_HEIGHT))
-        ctx.set(dut.fb_info.viewport_min_depth, 0.0)
-        ctx.set(dut.fb_info.viewport_max_depth, 1.0)
-        ctx.set(dut.fb_info.scissor_offset_x, 0)
-        ctx.set(dut.fb_info.scissor_offset_y, 0)
-        ctx.set(dut.fb_info.scissor_width, FB_WIDTH)
-        ctx.set(dut.fb_info.scissor_height, FB_HEIGHT)
-        ctx.set(dut.fb_info.color_address, COLOR_BUFFER)
-        ctx.set(dut.fb_info.color_pitch, FB_WIDTH * 4)
-        ctx.set(dut.fb_info.depthstencil_address, DEPTHSTENCIL_BUFFER)
-        ctx.set(dut.fb_info.depthstencil_pitch, FB_WIDTH * 4)
-
-        # Depth/stencil: disabled
-        ctx.set(dut.depth_conf.test_enabled, 0)
-        ctx.set(dut.depth_conf.write_enabled, 0)
-        ctx.set(dut.depth_conf.compare_op, CompareOp.ALWAYS)
-
-        # Stencil: compare=ALWAYS, masks=0xFF, ops=KEEP
-        for stencil_conf in [dut.stencil_conf_front, dut.stencil_conf_back]:
-            ctx.set(stencil_conf.compare_op, CompareOp.ALWAYS)
-            ctx.set(stencil_conf.reference, 0x00)
-            ctx.set(stencil_conf.mask, 0xFF)
-            ctx.set(stencil_conf.write_mask, 0xFF)
-            ctx.set(stencil_conf.pass_op, StencilOp.KEEP)
-            ctx.set(stencil_conf.fail_op, StencilOp.KEEP)
-            ctx.set(stencil_conf.depth_fail_op, StencilOp.KEEP)
-
-        # Blending: disabled (src=ONE, dst=ZERO)
-        ctx.set(dut.blend_conf.enabled, 0)
-        ctx.set(dut.blend_conf.src_factor, BlendFactor.ONE)
-        ctx.set(dut.blend_conf.dst_factor, BlendFactor.ZERO)
-        ctx.set(dut.blend_conf.src_a_factor, BlendFactor.ONE)
-        ctx.set(dut.blend_conf.dst_a_factor, BlendFactor.ZERO)
-        ctx.set(dut.blend_conf.blend_op, BlendOp.ADD)
-        ctx.set(dut.blend_conf.blend_a_op, BlendOp.ADD)
-        ctx.set(dut.blend_conf.color_write_mask, 0xF)
+        configure_triangle_draw(ctx, dut, geometry)
 
         print("Configuration done, starting test...")
         # Wait a few cycles for config to settle
@@ -396,3 +410,131 @@ def test_render_triangle():
             "test_render_triangle.vcd", "test_render_triangle.gtkw", traces=dut
         ):
             sim.run()
+
+
+@pytest.mark.slow
+def test_render_two_draws_with_own_state():
+    """
+    Start a second draw while the first one is in flight: the state written for the
+    second draw (modelview, framebuffer and depth writes) must not leak into the
+    first one, and input assembly stays busy until a state slot is free.
+    """
+    geometry = setup_triangle_geometry(VERTEX_BUFFER)
+    vb_data = geometry[-1]
+
+    color_buffer_2 = VB_MEM_ADDR + 0x00500000
+    depthstencil_buffer_2 = VB_MEM_ADDR + 0x00700000
+    clear_color = struct.pack("<I", 0xFFFF0000)
+    clear_depthstencil = struct.pack("<I", 0x0000FFFF)
+    fb_size = FB_WIDTH * FB_HEIGHT
+
+    dut = GraphicsPipeline()
+    t = SimpleTestbench(dut, mem_addr=VB_MEM_ADDR, mem_size=VB_SIZE)
+
+    t.arbiter.add(dut.wb_index)
+    t.arbiter.add(dut.wb_vertex)
+    t.arbiter.add(dut.wb_depthstencil)
+    t.arbiter.add(dut.wb_color)
+
+    async def testbench(ctx):
+        await t.initialize_memory(ctx, VERTEX_BUFFER, vb_data)
+        for buffer in [COLOR_BUFFER, color_buffer_2]:
+            await t.initialize_memory(ctx, buffer, clear_color * fb_size)
+        for buffer in [DEPTHSTENCIL_BUFFER, depthstencil_buffer_2]:
+            await t.initialize_memory(ctx, buffer, clear_depthstencil * fb_size)
+
+        # first draw: full size triangle, depth writes enabled
+        configure_triangle_draw(ctx, dut, geometry)
+        ctx.set(dut.depth_conf.test_enabled, 1)
+        ctx.set(dut.depth_conf.write_enabled, 1)
+        await ctx.tick().repeat(2)
+
+        ctx.set(dut.start, 1)
+        await ctx.tick()
+        ctx.set(dut.start, 0)
+        await ctx.tick()
+
+        # second draw: half size, into other buffers, depth writes disabled
+        configure_triangle_draw(
+            ctx,
+            dut,
+            geometry,
+            color_buffer=color_buffer_2,
+            depthstencil_buffer=depthstencil_buffer_2,
+        )
+        half_size = [0.5 if i in (0, 5, 10) else float(i == 15) for i in range(16)]
+        ctx.set(dut.position_mv, half_size)
+
+        await ctx.tick().until(dut.ready_components[0])
+        assert not ctx.get(dut.ready), "the first draw should still be in flight"
+        ctx.set(dut.start, 1)
+        _, _, started = await ctx.tick().sample(dut.draw_started)
+        ctx.set(dut.start, 0)
+        assert started
+
+        # both slots are in use until the marker of the second draw has left the
+        # pipeline, behind the first draw
+        while True:
+            _, _, ia_ready, retired = await ctx.tick().sample(
+                dut.ready_components[0], dut.marker_retired
+            )
+            if retired:
+                break
+            assert not ia_ready, "input assembly accepts a draw without a free slot"
+
+        await ctx.tick().until(dut.ready)
+        await ctx.tick().repeat(100)
+        assert ctx.get(dut.ready)
+
+        def covered(data: bytes, clear: bytes) -> int:
+            return sum(data[i : i + 4] != clear for i in range(0, len(data), 4))
+
+        color_1 = await t.dbg_access.read_bytes(ctx, COLOR_BUFFER, fb_size * 4)
+        color_2 = await t.dbg_access.read_bytes(ctx, color_buffer_2, fb_size * 4)
+        ds_1 = await t.dbg_access.read_bytes(ctx, DEPTHSTENCIL_BUFFER, fb_size * 4)
+        ds_2 = await t.dbg_access.read_bytes(ctx, depthstencil_buffer_2, fb_size * 4)
+
+        # the half size triangle covers about a quarter of the pixels
+        covered_1 = covered(color_1, clear_color)
+        covered_2 = covered(color_2, clear_color)
+        assert covered_2 > 0
+        assert covered_1 > 2 * covered_2, (covered_1, covered_2)
+
+        assert covered(ds_1, clear_depthstencil) > 0
+        assert covered(ds_2, clear_depthstencil) == 0
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+    sim.add_clock(4e-7, domain="pixel")
+    sim.add_testbench(testbench)
+    sim.run()
+
+
+def test_pipeline_elaborates_d16():
+    """
+    Elaborate the whole pipeline with a D16 depth buffer: the early depth reads of
+    the rasterizer share the byte-granular depth/stencil bus with the depth test.
+    """
+    dut = GraphicsPipeline()
+    t = SimpleTestbench(dut, mem_addr=VB_MEM_ADDR, mem_size=VB_SIZE)
+
+    t.arbiter.add(dut.wb_index)
+    t.arbiter.add(dut.wb_vertex)
+    t.arbiter.add(dut.wb_depthstencil)
+    t.arbiter.add(dut.wb_color)
+
+    async def testbench(ctx):
+        ctx.set(dut.fb_info.depthstencil_format, DepthStencilFormat.D16)
+        ctx.set(dut.fb_info.depthstencil_address, DEPTHSTENCIL_BUFFER)
+        ctx.set(dut.fb_info.depthstencil_pitch, FB_WIDTH * 2)
+        ctx.set(dut.depth_conf.test_enabled, 1)
+        ctx.set(dut.depth_conf.write_enabled, 1)
+        ctx.set(dut.depth_conf.compare_op, CompareOp.LESS)
+
+        await ctx.tick().repeat(4)
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+    sim.add_clock(4e-7, domain="pixel")
+    sim.add_testbench(testbench)
+    sim.run()
@@ -0,0 +1,71 @@
+import random
+
+from amaranth.lib import stream
+from amaranth.sim import SimulatorContext
+
+
+async def stream_feed(
+    ctx: SimulatorContext, stream: stream.Interface, data: list, transfers: list[int]
+):
+    """Keeps ``stream`` saturated with ``data``, logs the cycle of every transfer."""
+    cycle = 0
+    items = iter(data)
+    item = next(items, None)
+    while item is not None:
+        ctx.set(stream.payload, item)
+        ctx.set(stream.valid, 1)
+        _, _, ready = await ctx.tick().sample(stream.ready)
+        cycle += 1
+        if ready:
+            transfers.append(cycle)
+            item = next(items, None)
+    ctx.set(stream.valid, 0)
+
+
+async def stream_drain(
+    ctx: SimulatorContext,
+    stream: stream.Interface,
+    transfers: list[int],
+    count: int | None = None,
+    idle_for: int = 1000,
+    ready_probability: float = 1.0,
+    seed: int = 0,
+):
+    """Accepts from ``stream``, ready with ``ready_probability`` every cycle.
+
+    Logs the cycle of every transfer and stops after ``count`` transfers, or when
+    nothing has arrived for ``idle_for`` cycles (after the first transfer).
+    """
+    rng = random.Random(seed)
+    cycle = 0
+    idle = 0
+
+    ctx.set(stream.ready, rng.random() < ready_probability)
+    async for _, _, valid, ready in ctx.tick().sample(stream.valid, stream.ready):
+        cycle += 1
+        if valid and ready:
+            transfers.append(cycle)
+            idle = 0
+            if count is not None and len(transfers) == count:
+                break
+        elif transfers:
+            idle += 1
+            if count is None and idle >= idle_for:
+                break
+        ctx.set(stream.ready, rng.random() < ready_probability)
+    ctx.set(stream.ready, 0)
+
+
+def throughput(inputs: list[int], outputs: list[int]) -> dict:
+    """Cycles from the first input to the last output, and to the first output."""
+    cycles = outputs[-1] - inputs[0] + 1
+    return {"cycles": cycles, "latency": outputs[0] - inputs[0]}
+
+
+def record_throughput(record_property, **metrics):
+    """Stores the results of a benchmark (collected by tests/conftest.py)."""
+    rounded = {
+        k: round(v, 4) if isinstance(v, float) else v for k, v in metrics.items()
+    }
+    print("Throughput:", rounded)
+    record_property("bench", rounded)
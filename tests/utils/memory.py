@@ -1,5 +1,8 @@
+from amaranth import *
+from amaranth.lib import wiring
+from amaranth.lib.wiring import In, Out
 from amaranth_soc.memory import MemoryMap, ResourceInfo
-from amaranth_soc.wishbone.bus import Interface
+from amaranth_soc.wishbone.bus import Interface, Signature
 
 
 def get_memory_resource(mmap: MemoryMap, path) -> ResourceInfo:
@@ -12,6 +15,58 @@ def get_memory_resource(mmap: MemoryMap, path) -> ResourceInfo:
     raise KeyError(f"Resource {path} not found in memory map")
 
 
+class LatencyAdapter(wiring.Component):
+    """Wishbone pass-through adding wait states in front of a memory.
+
+    The first access of a bus cycle waits ``latency`` cycles before it is forwarded,
+    accesses continuing at the next address in the same bus cycle (bursts) wait
+    ``beat_latency`` cycles. The testbench buses carry no cycle type tags, so bursts
+    are recognized by their addresses.
+    """
+
+    def __init__(self, target: Interface, latency: int, beat_latency: int = 0):
+        self._latency = latency
+        self._beat_latency = beat_latency
+        sig = Signature(
+            addr_width=target.addr_width,
+            data_width=target.data_width,
+            granularity=target.granularity,
+        )
+        super().__init__({"bus": In(sig), "mem": Out(sig)})
+        self.bus.memory_map = target.memory_map
+
+    def elaborate(self, platform):
+        m = Module()
+
+        wait = Signal(range(max(self._latency, self._beat_latency) + 1))
+        last_adr = Signal.like(self.bus.adr)
+        in_cycle = Signal()  # an access of this bus cycle has completed
+
+        sequential = in_cycle & (self.bus.adr == last_adr + 1)
+        needed = Mux(sequential, self._beat_latency, self._latency)
+        request = self.bus.cyc & self.bus.stb
+
+        m.d.comb += [
+            self.mem.cyc.eq(self.bus.cyc),
+            self.mem.stb.eq(request & (wait >= needed)),
+            self.mem.adr.eq(self.bus.adr),
+            self.mem.we.eq(self.bus.we),
+            self.mem.sel.eq(self.bus.sel),
+            self.mem.dat_w.eq(self.bus.dat_w),
+            self.bus.dat_r.eq(self.mem.dat_r),
+            self.bus.ack.eq(self.mem.ack),
+        ]
+
+        with m.If(~self.bus.cyc):
+            m.d.sync += [wait.eq(0), in_cycle.eq(0)]
+        with m.Elif(self.mem.ack):
+            m.d.sync += [wait.eq(0), in_cycle.eq(1), last_adr.eq(self.bus.adr)]
+        with m.Elif(request & (wait < needed)):
+            m.d.sync += wait.eq(wait + 1)
+
+        return m
+
+
 class DebugAccess(Interface):
     async def read_bytes(self, ctx, addr: int, width: int) -> bytes:
         """Perform read of 8-bit data."""
@@ -0,0 +1,46 @@
+from amaranth import *
+from amaranth.sim import Simulator
+
+from gpu.utils.perf import CounterSnapshot
+
+
+def test_counter_snapshot():
+    dut = CounterSnapshot(2, width=8)
+
+    async def tb(ctx):
+        ctx.set(dut.counters, [10, 250])
+        ctx.set(dut.snapshot, 1)
+        await ctx.tick()
+        ctx.set(dut.snapshot, 0)
+        assert [ctx.get(v) for v in dut.values] == [10, 250]
+
+        # reset keeps the values, later snapshots are relative to it
+        ctx.set(dut.reset, 1)
+        await ctx.tick()
+        ctx.set(dut.reset, 0)
+        assert [ctx.get(v) for v in dut.values] == [10, 250]
+
+        # the second counter wraps around
+        ctx.set(dut.counters, [15, 4])
+        ctx.set(dut.snapshot, 1)
+        await ctx.tick()
+        ctx.set(dut.snapshot, 0)
+        assert [ctx.get(v) for v in dut.values] == [5, 10]
+
+        # a snapshot taken together with a reset still sees the old base
+        ctx.set(dut.counters, [20, 6])
+        ctx.set(dut.snapshot, 1)
+        ctx.set(dut.reset, 1)
+        await ctx.tick()
+        ctx.set(dut.snapshot, 0)
+        ctx.set(dut.reset, 0)
+        assert [ctx.get(v) for v in dut.values] == [10, 12]
+
+        ctx.set(dut.snapshot, 1)
+        await ctx.tick()
+        assert [ctx.get(v) for v in dut.values] == [0, 0]
+
+    sim = Simulator(dut)
+    sim.add_clock(1e-9)
+    sim.add_testbench(tb)
+    sim.run()
@@ -7,7 +7,7 @@ from amaranth_soc.wishbone.bus import Arbiter, Decoder
 from amaranth_soc.wishbone.sram import WishboneSRAM
 
 from gpu.utils.layouts import wb_bus_addr_width, wb_bus_data_width, wb_bus_granularity
-from tests.utils.memory import DebugAccess, get_memory_resource
+from tests.utils.memory import DebugAccess, LatencyAdapter, get_memory_resource
 
 
 def div_ceil(a: int, b: int) -> int:
@@ -24,6 +24,8 @@ class SimpleTestbench(Elaboratable):
         features: frozenset = frozenset(),
         mem_size: int = 1024 * 4,
         mem_addr: int = 0x80000000,
+        mem_latency: int = 0,
+        mem_beat_latency: int = 0,
     ):
         self.dut = dut
         self.data_width = data_width
@@ -58,6 +60,13 @@ class SimpleTestbench(Elaboratable):
             size=mem_size, data_width=data_width, granularity=granularity, writable=True
         )
 
+        # wait states in front of the memory (see LatencyAdapter)
+        self.mem_delay = None
+        if mem_latency or mem_beat_latency:
+            self.mem_delay = LatencyAdapter(
+                self.mem.wb_bus, mem_latency, mem_beat_latency
+            )
+
         self.arbiter.add(self.dbg_access)
         self.csrs = []
 
@@ -91,7 +100,12 @@ class SimpleTestbench(Elaboratable):
             self.csr_decoder.bus, data_width=self.data_width
         )
 
-        self.decoder.add(self.mem.wb_bus, addr=self.mem_addr)
+        if self.mem_delay is not None:
+            m.submodules.mem_delay = self.mem_delay
+            wiring.connect(m, self.mem_delay.mem, self.mem.wb_bus)
+            self.decoder.add(self.mem_delay.bus, addr=self.mem_addr)
+        else:
+            self.decoder.add(self.mem.wb_bus, addr=self.mem_addr)
         self.decoder.add(csr_bridge.wb_bus)
 
         wiring.connect(m, self.arbiter.bus, self.decoder.bus)
@@ -0,0 +1,335 @@
+import pytest
+from amaranth import *
+from amaranth.lib import fifo
+from amaranth.sim import Simulator
+
+from gpu.utils.layouts import ShadingVertexLayout, num_textures
+from gpu.utils.types import CullFace, FixedPoint, FrontFace, PrimitiveType
+from gpu.vertex_cache.cores import EarlyCull, VertexCacheLookup, VertexCacheMerge
+from gpu.vertex_cache.layouts import VertexCacheTicket, vertex_cache_entries
+
+from ..utils.streams import stream_testbench
+
+
+class VertexCacheHarness(Elaboratable):
+    """Lookup and merge around a stand-in for vertex processing that puts the index
+    into the raw bits of position x"""
+
+    def __init__(self):
+        self.lookup = VertexCacheLookup()
+        self.merge = VertexCacheMerge()
+
+    def elaborate(self, platform):
+        m = Module()
+        m.submodules.lookup = lookup = self.lookup
+        m.submodules.merge = merge = self.merge
+        m.submodules.misses = misses = fifo.SyncFIFOBuffered(
+            width=len(lookup.o.payload), depth=8
+        )
+        m.submodules.tickets = tickets = fifo.SyncFIFOBuffered(
+            width=Shape.cast(VertexCacheTicket).width, depth=32
+        )
+
+        m.d.comb += [
+            misses.w_stream.payload.eq(lookup.o.payload),
+            misses.w_stream.valid.eq(lookup.o.valid),
+            lookup.o.ready.eq(misses.w_stream.ready),
+            merge.i.payload.position_ndc[0].eq(misses.r_stream.payload),
+            merge.i.valid.eq(misses.r_stream.valid),
+            misses.r_stream.ready.eq(merge.i.ready),
+            tickets.w_stream.payload.eq(lookup.tickets.payload),
+            tickets.w_stream.valid.eq(lookup.tickets.valid),
+            lookup.tickets.ready.eq(tickets.w_stream.ready),
+            merge.tickets.payload.eq(tickets.r_stream.payload),
+            merge.tickets.valid.eq(tickets.r_stream.valid),
+            tickets.r_stream.ready.eq(merge.tickets.ready),
+        ]
+
+        return m
+
+
+def make_test_vertex_cache(
+    test_name: str, indices: list[int], expected_hits: int, enable: bool = True
+):
+    dut = VertexCacheHarness()
+
+    async def init_tb(ctx):
+        ctx.set(dut.lookup.c_enable, enable)
+
+    async def final_tb(ctx):
+        assert ctx.get(dut.lookup.lookups) == len(indices)
+        assert ctx.get(dut.lookup.hits) == expected_hits
+
+    lsb = 2.0**-FixedPoint.f_bits
+    expected = [
+        {
+            "position_ndc": [i * lsb, 0.0, 0.0, 0.0],
+            "texcoords": [[0.0, 0.0, 0.0, 0.0] for _ in range(num_textures)],
+            "color": [0.0, 0.0, 0.0, 0.0],
+        }
+        for i in indices
+    ]
+
+    sim = Simulator(dut)
+    sim.add_clock(1e-9)
+    stream_testbench(
+        sim,
+        init_process=init_tb,
+        input_stream=dut.lookup.i,
+        input_data=indices,
+        output_stream=dut.merge.o,
+        expected_output_data=expected,
+        final_checker=final_tb,
+        idle_for=50,
+    )
+
+    try:
+        sim.run()
+    except Exception:
+        sim.reset()
+
+        with sim.write_vcd(f"{test_name}.vcd", f"{test_name}.gtkw", traces=[]):
+            sim.run()
+        raise
+
+
+def test_vertex_cache_strip():
+    make_test_vertex_cache(
+        "test_vertex_cache_strip",
+        indices=[0, 1, 2, 2, 1, 3, 2, 3, 4, 4, 3, 5],
+        expected_hits=6,
+    )
+
+
+def test_vertex_cache_disabled():
+    make_test_vertex_cache(
+        "test_vertex_cache_disabled",
+        indices=[0, 1, 2, 2, 1, 3],
+        expected_hits=0,
+        enable=False,
+    )
+
+
+def test_vertex_cache_eviction():
+    # round-robin replacement: the first index is evicted by the last new one
+    n = vertex_cache_entries
+    make_test_vertex_cache(
+        "test_vertex_cache_eviction",
+        indices=list(range(n + 1)) + [0, n],
+        expected_hits=1,
+    )
+
+
+def connect_fifo(m, name, source, sink=None, depth=32):
+    """Queues ``source`` in a FIFO of raw bits, its read side drives ``sink``."""
+    m.submodules[name] = f = fifo.SyncFIFOBuffered(
+        width=len(Value.cast(source.payload)), depth=depth
+    )
+    m.d.comb += [
+        f.w_stream.payload.eq(source.payload),
+        f.w_stream.valid.eq(source.valid),
+        source.ready.eq(f.w_stream.ready),
+    ]
+    if sink is not None:
+        m.d.comb += [
+            sink.payload.eq(f.r_stream.payload),
+            sink.valid.eq(f.r_stream.valid),
+            f.r_stream.ready.eq(sink.ready),
+        ]
+    return f.r_stream
+
+
+class EarlyCullHarness(Elaboratable):
+    """Lookup, cull and merge around stand-ins for vertex processing.
+
+    Transform looks the clip-space x, y and w of an index up in ``vertices`` and puts
+    the index into the raw bits of z, shading passes the clip-space position on.
+    ``shaded`` counts the vertices sent to shading.
+    """
+
+    def __init__(self, vertices):
+        self.vertices = vertices
+        self.lookup = VertexCacheLookup()
+        self.cull = EarlyCull()
+        self.merge = VertexCacheMerge()
+        self.shaded = Signal(32)
+
+    def elaborate(self, platform):
+        m = Module()
+        m.submodules.lookup = lookup = self.lookup
+        m.submodules.cull = cull = self.cull
+        m.submodules.merge = merge = self.merge
+
+        coords = [
+            Array(
+                C(int(vtx[c] * 2**FixedPoint.f_bits), FixedPoint.as_shape())
+                for vtx in self.vertices
+            )
+            for c in range(3)
+        ]
+
+        misses = connect_fifo(m, "misses", lookup.o)
+        position = cull.i.payload.position_proj
+        m.d.comb += [
+            position[0].eq(coords[0][misses.payload]),
+            position[1].eq(coords[1][misses.payload]),
+            position[2].eq(misses.payload),
+            position[3].eq(coords[2][misses.payload]),
+            cull.i.valid.eq(misses.valid),
+            misses.ready.eq(cull.i.ready),
+        ]
+
+        shading = connect_fifo(m, "shading", cull.o)
+        vertex = ShadingVertexLayout(shading.payload)
+        m.d.comb += [
+            merge.i.payload.position_ndc.eq(vertex.position_proj),
+            merge.i.valid.eq(shading.valid),
+            shading.ready.eq(merge.i.ready),
+        ]
+        with m.If(cull.o.valid & cull.o.ready):
+            m.d.sync += self.shaded.eq(self.shaded + 1)
+
+        connect_fifo(m, "tickets", lookup.tickets, cull.tickets)
+        connect_fifo(m, "cull_tickets", cull.o_tickets, merge.tickets)
+
+        return m
+
+
+# clip-space (x, y, w): a quad of two counter-clockwise triangles (0, 1, 2), (2, 1, 3)
+# and a vertex behind the eye
+cull_test_vertices = [
+    (0.0, 0.0, 1.0),
+    (1.0, 0.0, 1.0),
+    (0.0, 1.0, 1.0),
+    (1.0, 1.0, 1.0),
+    (0.5, 0.5, -1.0),
+]
+
+
+def make_test_early_cull(
+    test_name: str,
+    vertices: list,
+    indices: list[int],
+    kept: list[int],
+    shaded: int,
+    cull: CullFace = CullFace.BACK,
+    winding: FrontFace = FrontFace.CCW,
+    viewport_flip: bool = False,
+    enable: bool = True,
+):
+    """Checks the vertices of the triangles (indices into ``indices``) kept"""
+    dut = EarlyCullHarness(vertices)
+
+    async def init_tb(ctx):
+        ctx.set(dut.lookup.c_enable, 1)
+        ctx.set(dut.cull.c_enable, enable)
+        ctx.set(
+            dut.cull.pa_conf,
+            {"type": PrimitiveType.TRIANGLES, "cull": cull, "winding": winding},
+        )
+        ctx.set(dut.cull.viewport_flip, viewport_flip)
+
+    async def final_tb(ctx):
+        assert ctx.get(dut.cull.culled) == len(indices) // 3 - len(kept)
+        assert ctx.get(dut.shaded) == shaded
+
+    lsb = 2.0**-FixedPoint.f_bits
+    expected = [
+        {
+            "position_ndc": [
+                vertices[i][0],
+                vertices[i][1],
+                i * lsb,
+                vertices[i][2],
+            ],
+            "texcoords": [[0.0, 0.0, 0.0, 0.0] for _ in range(num_textures)],
+            "color": [0.0, 0.0, 0.0, 0.0],
+        }
+        for t in kept
+        for i in indices[3 * t : 3 * t + 3]
+    ]
+
+    sim = Simulator(dut)
+    sim.add_clock(1e-9)
+    stream_testbench(
+        sim,
+        init_process=init_tb,
+        input_stream=dut.lookup.i,
+        input_data=indices,
+        output_stream=dut.merge.o,
+        expected_output_data=expected,
+        final_checker=final_tb,
+        idle_for=100,
+    )
+
+    try:
+        sim.run()
+    except Exception:
+        sim.reset()
+
+        with sim.write_vcd(f"{test_name}.vcd", f"{test_name}.gtkw", traces=[]):
+            sim.run()
+        raise
+
+
+@pytest.mark.parametrize(
+    "cull, winding, viewport_flip, kept, shaded",
+    [
+        (CullFace.BACK, FrontFace.CCW, False, [0, 2], 4),
+        (CullFace.FRONT, FrontFace.CCW, False, [1, 3], 4),
+        (CullFace.BACK, FrontFace.CW, False, [1, 3], 4),
+        (CullFace.BACK, FrontFace.CCW, True, [1, 3], 4),
+        (CullFace.NONE, FrontFace.CCW, False, [0, 1, 2, 3], 4),
+        (CullFace.FRONT_AND_BACK, FrontFace.CCW, False, [], 0),
+    ],
+)
+def test_early_cull(cull, winding, viewport_flip, kept, shaded):
+    make_test_early_cull(
+        "test_early_cull",
+        cull_test_vertices,
+        # front, back, front, back
+        indices=[0, 1, 2, 0, 2, 1, 2, 1, 3, 3, 1, 2],
+        kept=kept,
+        shaded=shaded,
+        cull=cull,
+        winding=winding,
+        viewport_flip=viewport_flip,
+    )
+
+
+def test_early_cull_disabled():
+    make_test_early_cull(
+        "test_early_cull_disabled",
+        cull_test_vertices,
+        indices=[0, 1, 2, 0, 2, 1],
+        kept=[0, 1],
+        shaded=3,
+        enable=False,
+    )
+
+
+def test_early_cull_behind_eye():
+    # back facing by the determinant, but left to the clipper
+    make_test_early_cull(
+        "test_early_cull_behind_eye",
+        cull_test_vertices,
+        indices=[0, 2, 1, 0, 4, 1],
+        kept=[1],
+        shaded=3,
+    )
+
+
+def test_early_cull_replaced_slot():
+    # back facing triangles of new vertices fill all but the last slot, the last
+    # triangle hits vertex 0 and then replaces its slot, before 0 was ever shaded
+    n = vertex_cache_entries
+    corners = [(0.0, 0.0, 1.0), (1.0, 0.0, 1.0), (0.0, 1.0, 1.0)]
+    vertices = [corners[i % 3] for i in range(n - 1)] + corners[1:]
+    indices = [i for t in range(n // 3) for i in (3 * t, 3 * t + 2, 3 * t + 1)]
+    make_test_early_cull(
+        "test_early_cull_replaced_slot",
+        vertices,
+        indices=indices + [0, n - 1, n],
+        kept=[n // 3],
+        shaded=3,
+    )
@@ -0,0 +1 @@
+# Tests for vertex shading stage
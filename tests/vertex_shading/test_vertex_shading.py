@@ -0,0 +1,110 @@
+import numpy as np
+import pytest
+from amaranth.sim import Simulator
+
+from gpu.utils import fixed
+from gpu.utils.layouts import num_lights, num_textures
+from gpu.vertex_shading.cores import VertexShading
+
+from ..utils.streams import stream_testbench
+from ..utils.testbench import SimpleTestbench
+
+MATERIAL = {
+    "ambient": [0.5, 0.5, 0.5],
+    "diffuse": [1.0, 0.75, 0.5],
+}
+
+# directional lights, the position is the direction the light travels
+LIGHTS = [
+    {
+        "position": [0.0, 0.0, -1.0, 0.0],
+        "ambient": [0.1, 0.0, 0.0],
+        "diffuse": [0.2, 0.2, 0.2],
+    },
+    {
+        "position": [-1.0, 0.0, 0.0, 0.0],
+        "ambient": [0.0, 0.1, 0.0],
+        "diffuse": [0.3, 0.0, 0.1],
+    },
+    {
+        "position": [0.0, -0.6, -0.8, 0.0],
+        "ambient": [0.0, 0.0, 0.1],
+        "diffuse": [0.0, 0.25, 0.0],
+    },
+    {
+        "position": [0.0, 0.0, 1.0, 0.0],  # facing away from every normal below
+        "ambient": [0.05, 0.05, 0.05],
+        "diffuse": [0.5, 0.5, 0.5],
+    },
+][:num_lights]
+
+VERTICES = [
+    {"normal": [0.0, 0.0, 1.0], "color": [1.0, 1.0, 1.0, 1.0]},
+    {"normal": [1.0, 0.0, 0.0], "color": [0.5, 1.0, 0.25, 0.5]},
+    {"normal": [0.0, 0.6, 0.8], "color": [1.0, 0.5, 1.0, 0.75]},
+]
+
+
+def make_vertex(v):
+    return {
+        "position_view": [0.0, 0.0, 0.0, 1.0],
+        "position_proj": [0.1, 0.2, 0.3, 1.0],
+        "normal_view": v["normal"],
+        "texcoords": [[0.0, 0.0, 0.0, 1.0] for _ in range(num_textures)],
+        "color": v["color"],
+    }
+
+
+def reference_color(v, mask):
+    n = np.array(v["normal"])
+    color = np.zeros(3)
+    for i, light in enumerate(LIGHTS):
+        if not mask & (1 << i):
+            continue
+        dp = max(0.0, float(n @ -np.array(light["position"][:3])))
+        color += np.array(MATERIAL["ambient"]) * np.array(light["ambient"])
+        color += np.array(MATERIAL["diffuse"]) * np.array(light["diffuse"]) * dp
+    return list(color * np.array(v["color"][:3])) + [v["color"][3]]
+
+
+@pytest.mark.parametrize("num_lanes", [1, 2, num_lights])
+@pytest.mark.parametrize("mask", [0b0000, 0b0001, 0b1010, 0b1111])
+def test_light_mask(num_lanes: int, mask: int):
+    mask &= (1 << num_lights) - 1
+    dut = VertexShading(num_lights, num_lanes=num_lanes)
+    t = SimpleTestbench(dut)
+
+    async def init_proc(ctx):
+        ctx.set(dut.material.ambient, MATERIAL["ambient"])
+        ctx.set(dut.material.diffuse, MATERIAL["diffuse"])
+        ctx.set(dut.material.specular, [0.0] * 3)
+        ctx.set(dut.material.shininess, fixed.Const(1.0))
+        for light, conf in zip(dut.lights, LIGHTS):
+            ctx.set(light.position, conf["position"])
+            ctx.set(light.ambient, conf["ambient"])
+            ctx.set(light.diffuse, conf["diffuse"])
+            ctx.set(light.specular, [0.0] * 3)
+        ctx.set(dut.light_enable, mask)
+
+    async def output_checker(ctx, results):
+        assert len(results) == len(VERTICES)
+        for v, out in zip(VERTICES, results):
+            assert [c.as_float() for c in out.color] == pytest.approx(
+                reference_color(v, mask), abs=2e-3
+            )
+            assert [c.as_float() for c in out.position_ndc] == pytest.approx(
+                [0.1, 0.2, 0.3, 1.0], abs=1e-3
+            )
+
+    sim = Simulator(t)
+    sim.add_clock(1e-6)
+    stream_testbench(
+        sim,
+        input_stream=dut.i,
+        input_data=[make_vertex(v) for v in VERTICES],
+        output_stream=dut.o,
+        output_data_checker=output_checker,
+        init_process=init_proc,
+        is_finished=dut.ready,
+    )
+    sim.run()
@@ -59,11 +59,11 @@ def test_identity_transform_positions():
         assert vec_to_list(out.position_view) == pytest.approx(vertex["position"])
         assert vec_to_list(out.position_proj) == pytest.approx(vertex["position"])
 
-        # Disabled normal/tex transforms should zero normals and leave texcoords as identity defaults (0,0,0,1)
+        # Disabled normal/tex transforms should zero normals and pass texcoords through
         assert vec_to_list(out.normal_view) == pytest.approx([0.0, 0.0, 0.0])
         for tex_idx in range(num_textures):
             assert vec_to_list(out.texcoords[tex_idx]) == pytest.approx(
-                [0.0, 0.0, 0.0, 1.0]
+                vertex["texcoords"][tex_idx], abs=1e-3
             )
 
     sim = Simulator(t)
@@ -9,6 +9,9 @@ The generator emits:
 - #define macros for each register byte address
 - an enum with the same byte addresses
 - a packed struct reflecting the register layout (multiword fields as arrays)
+- the size of the register map and an X-macro listing every register as
+  X(NAME, byte address, byte size, shadow), where ``shadow`` marks plain
+  storage registers that the host may mirror and skip rewriting
 """
 
 from __future__ import annotations
@@ -23,11 +26,16 @@ from typing import Any, Dict, Iterable, List, Tuple
 
 def _flatten_regs(
     node: Dict[str, Any], path: List[str]
-) -> Iterable[Tuple[List[str], int, int]]:
-    """Yield (path, address, size_bytes) for every leaf register."""
+) -> Iterable[Tuple[List[str], int, int, bool]]:
+    """Yield (path, address, size_bytes, shadow) for every leaf register."""
     for key, value in node.items():
-        if isinstance(value, dict) and {"address", "size"} <= set(value.keys()):
-            yield path + [key], int(value["address"]), int(value["size"])
+        if isinstance(value, dict) and {"address", "size"} <= set(value.keys()) and not isinstance(value["address"], dict):
+            yield (
+                path + [key],
+                int(value["address"]),
+                int(value["size"]),
+                bool(value.get("shadow", False)),
+            )
         elif isinstance(value, dict):
             yield from _flatten_regs(value, path + [key])
         else:
@@ -66,11 +74,22 @@ def generate_header(json_path: Path, prefix: str) -> str:
 
     # enum
     lines.append("typedef enum {")
-    for parts, addr, _ in items:
+    for parts, addr, _, _ in items:
         lines.append(f"    {macro(parts)} = 0x{addr:04X}u,")
     lines.append(f"}} {prefix.lower()}_offsets_t;")
     lines.append("")
 
+    # register table
+    map_size = max(addr + size for _, addr, size, _ in items)
+    lines.append(f"#define {prefix}_MAP_SIZE 0x{map_size:04X}u")
+    lines.append("")
+    lines.append("/* X(name, byte address, byte size, shadow) */")
+    lines.append(f"#define {prefix}_REGISTERS(X) \\")
+    for parts, addr, size, shadow in items:
+        name = _sanitize(parts, upper=True)
+        lines.append(f"    X({name}, 0x{addr:04X}u, {size}u, {int(shadow)}) \\")
+    lines.append("")
+
     lines.append("")
     lines.append(f"#endif /* {guard} */")
 